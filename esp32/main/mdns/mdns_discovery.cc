@@ -1,15 +1,66 @@
 #include "mdns_discovery.h"
 #include <esp_log.h>
 #include <string.h>
-#define MAX_DISCOVERED_DEVICES 20
+#include <strings.h>
+#define MAX_RECORD_TTL_S 86400  // 记录 TTL 的上限，避免换算为 tick 时溢出
+#define HOST_RESOLVE_DELAY_MS 1000    // 新设备等待应答带来地址的时间，之后才单独查询
+#define HOST_RESOLVE_TIMEOUT_MS 1000  // 主机地址查询的超时时间
+#define HOST_RESOLVE_RETRY_MS 10000   // 查询没有结果时再次查询的间隔
 static const char* TAG = "MDNSDiscovery";
 
+MDNSDiscovery* MDNSDiscovery::s_active = nullptr;
 
-MDNSDiscovery::MDNSDiscovery() : is_discovery_running_(false) {}
+// 复制到定长缓冲区，超长时截断并返回 false
+template <size_t N>
+static bool copy_field(char (&dst)[N], const char* src) {
+    size_t len = strlen(src);
+    bool fits = len < N;
+    if (!fits) {
+        len = N - 1;
+    }
+    memcpy(dst, src, len);
+    dst[len] = '\0';
+    return fits;
+}
+
+// 从地址列表中取 IPv4 地址，当前地址仍在列表中时保持不变
+static bool pick_ipv4(const mdns_ip_addr_t* addr, esp_ip4_addr_t* ip) {
+    const mdns_ip_addr_t* first = nullptr;
+    for (; addr; addr = addr->next) {
+        if (addr->addr.type != ESP_IPADDR_TYPE_V4) {
+            continue;
+        }
+        if (addr->addr.u_addr.ip4.addr == ip->addr) {
+            return true;
+        }
+        if (!first) {
+            first = addr;
+        }
+    }
+    if (!first) {
+        return false;
+    }
+    *ip = first->addr.u_addr.ip4;
+    return true;
+}
+
+
+MDNSDiscovery::MDNSDiscovery()
+    : event_head_(0), event_count_(0), dropped_events_(0), search_(nullptr), host_search_(nullptr),
+      is_discovery_running_(false), m_bIsInit(false), mutex_(nullptr), event_(nullptr) {
+    memset(slots_, 0, sizeof(slots_));
+    host_query_[0] = '\0';
+}
 
 MDNSDiscovery::~MDNSDiscovery() {
     stop_discovery();
     m_bIsInit = false;
+    if (event_) {
+        vSemaphoreDelete(event_);
+    }
+    if (mutex_) {
+        vSemaphoreDelete(mutex_);
+    }
 }
 
 esp_err_t MDNSDiscovery::init() {
@@ -21,110 +72,429 @@ esp_err_t MDNSDiscovery::init() {
         ESP_LOGE(TAG, "MDNS init failed: %s", esp_err_to_name(err));
         return err;
     }
-    m_bIsInit = true;
     mutex_ = xSemaphoreCreateMutex();
+    event_ = xSemaphoreCreateBinary();
+    if (!mutex_ || !event_) {
+        ESP_LOGE(TAG, "create semaphore failed");
+        return ESP_ERR_NO_MEM;
+    }
+    m_bIsInit = true;
     return ESP_OK;
 }
 
 esp_err_t MDNSDiscovery::start_discovery(const char* service_type, int timeout) {
-    mdns_result_t *results = NULL;
-    discovered_devices_.clear();
+    if (!m_bIsInit) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (is_discovery_running_ && service_type_ != service_type) {
+        stop_discovery();
+    }
+    if (s_active && s_active != this) {
+        ESP_LOGE(TAG, "another MDNSDiscovery instance is running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (!is_discovery_running_) {
+        service_type_ = service_type;
+        s_active = this;
+        // browse 持续接收该服务的应答和通告，设备变化时由 mDNS 任务通知
+        if (!mdns_browse_new(service_type, "_tcp", browse_notify)) {
+            ESP_LOGE(TAG, "MDNS browse failed for %s", service_type);
+            s_active = nullptr;
+            return ESP_FAIL;
+        }
+        is_discovery_running_ = true;
+        ESP_LOGI(TAG, "started mdns discovery for service: %s", service_type);
+    }
+
+    // 上一次查询结束并取回结果后才发出新的查询
+    if (search_) {
+        ESP_LOGD(TAG, "previous query still running");
+        return ESP_OK;
+    }
+    search_ = mdns_query_async_new(NULL, service_type, "_tcp", MDNS_TYPE_PTR, timeout,
+                                   CONFIG_MDNS_DISCOVERY_MAX_DEVICES, query_notify);
+    if (!search_) {
+        ESP_LOGE(TAG, "MDNS query failed: %s", service_type);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "mdns query sent");
+    return ESP_OK;
+}
+
+esp_err_t MDNSDiscovery::stop_discovery() {
+    if (!is_discovery_running_) {
+        return ESP_OK;
+    }
+    mdns_browse_delete(service_type_.c_str(), "_tcp");
+    if (search_) {
+        // 未结束的查询不能删除，等待它超时
+        mdns_result_t* results = NULL;
+        mdns_query_async_get_results(search_, portMAX_DELAY, &results, NULL);
+        mdns_query_async_delete(search_);
+        mdns_query_results_free(results);
+        search_ = nullptr;
+    }
+    if (host_search_) {
+        mdns_result_t* results = NULL;
+        mdns_query_async_get_results(host_search_, portMAX_DELAY, &results, NULL);
+        mdns_query_async_delete(host_search_);
+        mdns_query_results_free(results);
+        host_search_ = nullptr;
+    }
+    is_discovery_running_ = false;
+    s_active = nullptr;
+    ESP_LOGI(TAG, "stopped mdns discovery");
+    return ESP_OK;
+}
+
+size_t MDNSDiscovery::wait_for_changes(uint32_t timeout_ms) {
+    if (!m_bIsInit) {
+        return 0;
+    }
     xSemaphoreTake(mutex_, portMAX_DELAY);
-    esp_err_t err = mdns_query_ptr(service_type, "_tcp", timeout, MAX_DISCOVERED_DEVICES, &results);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "MDNS query failed: %s", esp_err_to_name(err));
+    TickType_t wait = resolve_wait(xTaskGetTickCount(), pdMS_TO_TICKS(timeout_ms));
+    xSemaphoreGive(mutex_);
+
+    xSemaphoreTake(event_, wait);
+    collect_query_results();
+    collect_host_results();
+
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    expire_devices(xTaskGetTickCount());
+    uint32_t dropped = dropped_events_;
+    dropped_events_ = 0;
+    xSemaphoreGive(mutex_);
+    if (is_discovery_running_) {
+        start_host_resolve(xTaskGetTickCount());
+    }
+    if (dropped) {
+        ESP_LOGW(TAG, "event queue full, %lu events dropped", (unsigned long)dropped);
+    }
+
+    // 每次只取出一个事件，回调不持有锁，可以在回调中访问设备表
+    size_t delivered = 0;
+    for (;;) {
+        xSemaphoreTake(mutex_, portMAX_DELAY);
+        if (event_count_ == 0) {
+            xSemaphoreGive(mutex_);
+            break;
+        }
+        delivering_ = events_[event_head_];
+        event_head_ = (event_head_ + 1) % CONFIG_MDNS_DISCOVERY_EVENT_QUEUE_LEN;
+        event_count_--;
         xSemaphoreGive(mutex_);
-        return err;
+
+        if (callback_) {
+            callback_(delivering_.event, delivering_.device);
+        }
+        delivered++;
     }
+    return delivered;
+}
+
+size_t MDNSDiscovery::visit_devices(DeviceVisitor visitor, void* context) const {
+    if (!m_bIsInit || !visitor) {
+        return 0;
+    }
+    size_t count = 0;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (const auto& slot : slots_) {
+        if (slot.used) {
+            visitor(slot.device, context);
+            count++;
+        }
+    }
+    xSemaphoreGive(mutex_);
+    return count;
+}
+
+size_t MDNSDiscovery::device_count() const {
+    if (!m_bIsInit) {
+        return 0;
+    }
+    size_t count = 0;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (const auto& slot : slots_) {
+        count += slot.used ? 1 : 0;
+    }
+    xSemaphoreGive(mutex_);
+    return count;
+}
+
+void MDNSDiscovery::browse_notify(mdns_result_t* result) {
+    MDNSDiscovery* self = s_active;
+    if (!self) {
+        return;
+    }
+    // 在 mDNS 任务中执行，结果只在通知期间有效，复制后交给应用任务
+    xSemaphoreTake(self->mutex_, portMAX_DELAY);
+    self->parse_mdns_response(result);
+    xSemaphoreGive(self->mutex_);
+    xSemaphoreGive(self->event_);
+}
+
+void MDNSDiscovery::query_notify(mdns_search_once_t* search) {
+    (void)search;
+    MDNSDiscovery* self = s_active;
+    if (self) {
+        xSemaphoreGive(self->event_);
+    }
+}
+
+void MDNSDiscovery::collect_query_results() {
+    mdns_result_t* results = NULL;
+    if (!search_ || !mdns_query_async_get_results(search_, 0, &results, NULL)) {
+        return;
+    }
+    mdns_query_async_delete(search_);
+    search_ = nullptr;
 
-    ESP_LOGI(TAG, "mdns query success");
     if (results) {
-        ESP_LOGI(TAG, "found %s devices:", service_type);
+        xSemaphoreTake(mutex_, portMAX_DELAY);
         parse_mdns_response(results);
+        xSemaphoreGive(mutex_);
         mdns_query_results_free(results);
     } else {
-        ESP_LOGI(TAG, "no %s devices found", service_type);
+        ESP_LOGI(TAG, "no %s devices found", service_type_.c_str());
     }
+}
 
-    xSemaphoreGive(mutex_);
-    ESP_LOGI(TAG, "started mdns discovery for service: %s", service_type);
-    return ESP_OK;
+void MDNSDiscovery::parse_mdns_response(mdns_result_t* result) {
+    TickType_t now = xTaskGetTickCount();
+    for (; result; result = result->next) {
+        if (!result->instance_name) {
+            ESP_LOGE(TAG, "MDNS instance name is empty");
+            continue;
+        }
+        if (result->ttl == 0) {
+            remove_device(result->instance_name);
+            continue;
+        }
+        update_device(result, now);
+    }
 }
 
-esp_err_t MDNSDiscovery::stop_discovery() {
-    ESP_LOGI(TAG, "stopped mdns discovery");
-    return ESP_OK;
+MDNSDiscovery::DeviceSlot* MDNSDiscovery::find_slot(const char* instance_name) {
+    for (auto& slot : slots_) {
+        // mDNS 名称不区分大小写
+        if (slot.used && strcasecmp(slot.device.name, instance_name) == 0) {
+            return &slot;
+        }
+    }
+    return nullptr;
 }
 
-std::vector<MDNSDevice> MDNSDiscovery::get_discovered_devices() const {
-    return discovered_devices_;
+const MDNSDiscovery::DeviceSlot* MDNSDiscovery::find_host_address(const char* hostname) const {
+    for (const auto& slot : slots_) {
+        if (slot.used && slot.device.ip.addr != 0 && strcasecmp(slot.device.hostname, hostname) == 0) {
+            return &slot;
+        }
+    }
+    return nullptr;
 }
 
+MDNSDiscovery::DeviceSlot* MDNSDiscovery::allocate_slot() {
+    DeviceSlot* oldest = nullptr;
+    for (auto& slot : slots_) {
+        if (!slot.used) {
+            return &slot;
+        }
+        if (!oldest || static_cast<int32_t>(slot.last_seen - oldest->last_seen) < 0) {
+            oldest = &slot;
+        }
+    }
+    // 设备表已满，淘汰最久没有收到应答的设备
+    ESP_LOGW(TAG, "device table full, evict %s", oldest->device.name);
+    push_event(MDNSDeviceEvent::Removed, oldest->device);
+    oldest->used = false;
+    return oldest;
+}
 
-void MDNSDiscovery::parse_mdns_response(mdns_result_t* result) {
-    if (!result) {
+void MDNSDiscovery::push_event(MDNSDeviceEvent event, const MDNSDevice& device) {
+    if (event_count_ == CONFIG_MDNS_DISCOVERY_EVENT_QUEUE_LEN) {
+        // 应用任务处理不过来时丢弃新事件，设备表本身仍是最新的
+        dropped_events_++;
         return;
     }
+    size_t tail = (event_head_ + event_count_) % CONFIG_MDNS_DISCOVERY_EVENT_QUEUE_LEN;
+    events_[tail].event = event;
+    events_[tail].device = device;
+    event_count_++;
+}
 
-    while(result){
-        MDNSDevice device;
-        if(result->hostname){
-            device.hostname = result->hostname;
+void MDNSDiscovery::update_device(const mdns_result_t* result, TickType_t now) {
+    DeviceSlot* slot = find_slot(result->instance_name);
+    if (!slot && !result->hostname) {
+        // 还没有收到 SRV 记录，等 browse 通知完整结果
+        ESP_LOGD(TAG, "MDNS hostname is empty: %s", result->instance_name);
+        return;
+    }
+
+    // 在 mDNS 任务的栈上组装，只复制定长缓冲区
+    MDNSDevice device;
+    if (slot) {
+        device = slot->device;
+    } else {
+        memset(&device, 0, sizeof(device));
+        if (!copy_field(device.name, result->instance_name)) {
+            // 截断的实例名可能与其他设备相同，不记录
+            ESP_LOGW(TAG, "MDNS instance name too long: %s", result->instance_name);
+            return;
         }
-        else{
-            ESP_LOGE(TAG, "MDNS hostname is empty");
+    }
+    if (result->hostname && !copy_field(device.hostname, result->hostname)) {
+        ESP_LOGW(TAG, "MDNS hostname truncated: %s", result->hostname);
+    }
+    for (size_t i = 0; i < result->txt_count; i++) {
+        mdns_txt_item_t* txt = &result->txt[i];
+        if (!txt->key || !txt->value) {
             continue;
         }
-        if(result->instance_name){
-            device.name = result->instance_name;
+        if (strcmp(txt->key, "u") == 0) {
+            copy_field(device.uid, txt->value);
+        } else if (strcmp(txt->key, "a") == 0) {
+            copy_field(device.appId, txt->value);
         }
-        else{
-            ESP_LOGE(TAG, "MDNS instance name is empty");
-            continue;
+    }
+    if (result->hostname) {
+        device.port = result->port;
+    }
+    if (!pick_ipv4(result->addr, &device.ip) && device.ip.addr == 0 && device.hostname[0]) {
+        // 应答没有带地址，同一主机的其他服务实例可能已经有了
+        const DeviceSlot* same_host = find_host_address(device.hostname);
+        if (same_host) {
+            device.ip = same_host->device.ip;
         }
+    }
 
-        
-        ESP_LOGI(TAG, "hostname: %s", result->hostname);
-        ESP_LOGI(TAG, "instance_name: %s", result->instance_name);
+    uint32_t ttl = result->ttl < MAX_RECORD_TTL_S ? result->ttl : MAX_RECORD_TTL_S;
+    TickType_t expires = now + ttl * configTICK_RATE_HZ;
+    if (!slot) {
+        ESP_LOGI(TAG, "device added: %s (%s) " IPSTR ":%u uid=%s", device.name, device.hostname,
+                 IP2STR(&device.ip), device.port, device.uid);
+        slot = allocate_slot();
+        slot->device = device;
+        slot->expires = expires;
+        slot->last_seen = now;
+        slot->resolve_after = now + pdMS_TO_TICKS(HOST_RESOLVE_DELAY_MS);
+        slot->used = true;
+        push_event(MDNSDeviceEvent::Added, device);
+        return;
+    }
 
-        for (int i = 0; i < result->txt_count; i++) {
-            mdns_txt_item_t* txt = &result->txt[i];
-            ESP_LOGI(TAG, "TXT: %s = %s", txt->key, txt->value);
-            if(std::string(txt->key) == "u"){
-                device.uid = txt->value;
-            }
-            else if(std::string(txt->key) == "a"){
-                device.appId = txt->value;
+    slot->expires = expires;
+    slot->last_seen = now;
+    if (strcmp(slot->device.hostname, device.hostname) != 0 || strcmp(slot->device.uid, device.uid) != 0 ||
+        strcmp(slot->device.appId, device.appId) != 0 || slot->device.ip.addr != device.ip.addr ||
+        slot->device.port != device.port) {
+        ESP_LOGI(TAG, "device updated: %s", device.name);
+        slot->device = device;
+        push_event(MDNSDeviceEvent::Updated, device);
+    }
+}
+
+void MDNSDiscovery::remove_device(const char* instance_name) {
+    DeviceSlot* slot = find_slot(instance_name);
+    if (slot) {
+        ESP_LOGI(TAG, "device removed: %s", instance_name);
+        push_event(MDNSDeviceEvent::Removed, slot->device);
+        slot->used = false;
+    }
+}
+
+void MDNSDiscovery::expire_devices(TickType_t now) {
+    for (auto& slot : slots_) {
+        // tick 计数回绕时按差值比较
+        if (slot.used && static_cast<int32_t>(now - slot.expires) >= 0) {
+            ESP_LOGI(TAG, "device expired: %s", slot.device.name);
+            push_event(MDNSDeviceEvent::Removed, slot.device);
+            slot.used = false;
+        }
+    }
+}
+
+TickType_t MDNSDiscovery::resolve_wait(TickType_t now, TickType_t wait) const {
+    if (!is_discovery_running_ || host_search_) {
+        return wait;
+    }
+    // 有设备等待查询地址时提前醒来
+    for (const auto& slot : slots_) {
+        if (!slot.used || slot.device.ip.addr != 0 || !slot.device.hostname[0]) {
+            continue;
+        }
+        int32_t remaining = static_cast<int32_t>(slot.resolve_after - now);
+        if (remaining <= 0) {
+            return 0;
+        }
+        if (static_cast<TickType_t>(remaining) < wait) {
+            wait = remaining;
+        }
+    }
+    return wait;
+}
+
+void MDNSDiscovery::start_host_resolve(TickType_t now) {
+    if (host_search_) {
+        return;
+    }
+    bool found = false;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (auto& slot : slots_) {
+        if (slot.used && slot.device.ip.addr == 0 && slot.device.hostname[0] &&
+            static_cast<int32_t>(now - slot.resolve_after) >= 0) {
+            copy_field(host_query_, slot.device.hostname);
+            found = true;
+            break;
+        }
+    }
+    if (found) {
+        // 同一主机的设备共用这次查询
+        for (auto& slot : slots_) {
+            if (slot.used && slot.device.ip.addr == 0 && strcasecmp(slot.device.hostname, host_query_) == 0) {
+                slot.resolve_after = now + pdMS_TO_TICKS(HOST_RESOLVE_RETRY_MS);
             }
         }
-        discovered_devices_.push_back(device);
-        ESP_LOGI(TAG, "discovered_devices_.size(): %d \n\n", discovered_devices_.size());
+    }
+    xSemaphoreGive(mutex_);
+    if (!found) {
+        return;
+    }
 
-        result = result->next;
+    host_search_ = mdns_query_async_new(host_query_, NULL, NULL, MDNS_TYPE_A, HOST_RESOLVE_TIMEOUT_MS, 1, query_notify);
+    if (!host_search_) {
+        ESP_LOGE(TAG, "MDNS host query failed: %s", host_query_);
+        return;
     }
+    ESP_LOGD(TAG, "resolving host %s", host_query_);
 }
 
-std::string MDNSDiscovery::resolve_mdns_host(const char * host_name) {
-    std::string resolved_host = host_name;
-    esp_ip4_addr_t addr;
-    addr.addr = 0;
+void MDNSDiscovery::collect_host_results() {
+    mdns_result_t* results = NULL;
+    if (!host_search_ || !mdns_query_async_get_results(host_search_, 0, &results, NULL)) {
+        return;
+    }
+    mdns_query_async_delete(host_search_);
+    host_search_ = nullptr;
 
-    esp_err_t err = mdns_query_a(host_name, 20000, &addr);
-    if(err){
-        if(err == ESP_ERR_NOT_FOUND){
-            ESP_LOGE(TAG, "Host was not found: %s", host_name);
-            return "";
-        }
-        ESP_LOGE(TAG, "Query Failed for host %s: %s", host_name, esp_err_to_name(err));
-        return "";
+    esp_ip4_addr_t ip;
+    ip.addr = 0;
+    for (mdns_result_t* result = results; result && ip.addr == 0; result = result->next) {
+        pick_ipv4(result->addr, &ip);
+    }
+    mdns_query_results_free(results);
+    if (ip.addr == 0) {
+        ESP_LOGW(TAG, "Host was not found: %s", host_query_);
+        return;
     }
 
-    char ip_str[16]; // 足够放下 IPv4 地址 (xxx.xxx.xxx.xxx\0)
-    sprintf(ip_str, "%lu.%lu.%lu.%lu", 
-            (addr.addr) & 0xff, 
-            (addr.addr >> 8) & 0xff, 
-            (addr.addr >> 16) & 0xff, 
-            (addr.addr >> 24) & 0xff);
-    resolved_host = ip_str;
-    return resolved_host;
+    xSemaphoreTake(mutex_, portMAX_DELAY);
+    for (auto& slot : slots_) {
+        if (slot.used && slot.device.ip.addr == 0 && strcasecmp(slot.device.hostname, host_query_) == 0) {
+            slot.device.ip = ip;
+            ESP_LOGI(TAG, "device resolved: %s " IPSTR, slot.device.name, IP2STR(&ip));
+            push_event(MDNSDeviceEvent::Updated, slot.device);
+        }
+    }
+    xSemaphoreGive(mutex_);
 }
@@ -1,39 +1,166 @@
 #pragma once
 
 #include <string>
-#include <vector>
+#include <functional>
 #include <esp_err.h>
+#include "sdkconfig.h"
 #include "esp_netif.h"
 #include "mdns.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 
+// 设备表容量和字段长度见 main/Kconfig.projbuild，未经 menuconfig 生成时使用默认值
+#ifndef CONFIG_MDNS_DISCOVERY_MAX_DEVICES
+#define CONFIG_MDNS_DISCOVERY_MAX_DEVICES 16
+#endif
+#ifndef CONFIG_MDNS_DISCOVERY_EVENT_QUEUE_LEN
+#define CONFIG_MDNS_DISCOVERY_EVENT_QUEUE_LEN 8
+#endif
+#ifndef CONFIG_MDNS_DISCOVERY_NAME_LEN
+#define CONFIG_MDNS_DISCOVERY_NAME_LEN 64
+#endif
+#ifndef CONFIG_MDNS_DISCOVERY_HOSTNAME_LEN
+#define CONFIG_MDNS_DISCOVERY_HOSTNAME_LEN 64
+#endif
+#ifndef CONFIG_MDNS_DISCOVERY_UID_LEN
+#define CONFIG_MDNS_DISCOVERY_UID_LEN 32
+#endif
+#ifndef CONFIG_MDNS_DISCOVERY_APPID_LEN
+#define CONFIG_MDNS_DISCOVERY_APPID_LEN 16
+#endif
 
+
+/**
+ * @brief 发现的设备
+ * @details 字段都是定长的内联缓冲区(以 NUL 结尾)，设备表静态分配，运行期间不申请堆内存。
+ * 超长的主机名和 TXT 值被截断，超长的实例名不记录
+ */
 struct MDNSDevice {
-    std::string name;
-    std::string hostname;
-    std::string ip;
-    std::string uid;
-    std::string appId;
-    uint16_t port;
+    char name[CONFIG_MDNS_DISCOVERY_NAME_LEN];
+    char hostname[CONFIG_MDNS_DISCOVERY_HOSTNAME_LEN];
+    char uid[CONFIG_MDNS_DISCOVERY_UID_LEN];
+    char appId[CONFIG_MDNS_DISCOVERY_APPID_LEN];
+    esp_ip4_addr_t ip;  ///< 网络字节序，0 表示未知
+    uint16_t port;      ///< SRV 记录中的端口，0 表示未知
+};
+
+/**
+ * @brief 设备列表的变化
+ */
+enum class MDNSDeviceEvent {
+    Added,    ///< 新发现的设备
+    Updated,  ///< 主机名、地址、端口或 TXT 记录变化
+    Removed   ///< 设备发送了 goodbye 或记录到期
 };
 
+/**
+ * @brief mDNS 设备发现
+ *
+ * 使用 esp-mdns 的 browse 和异步查询，不阻塞调用任务:
+ * - start_discovery() 建立 browse 并发出一次异步 PTR 查询后立即返回
+ * - mDNS 任务收到应答时在 browse 通知中增量更新设备列表，并唤醒等待的任务
+ * - 应用任务调用 wait_for_changes() 休眠到有结果为止，变化回调在该任务中执行，不持有内部锁
+ *
+ * 地址和端口直接取自应答中的 A 记录和 SRV 记录。应答没有带地址时，先使用同一主机的其他设备的地址，
+ * 仍然没有时才由 wait_for_changes() 发出异步 A 查询，同一时刻只有一个主机查询。
+ *
+ * 设备表是容量为 CONFIG_MDNS_DISCOVERY_MAX_DEVICES 的静态数组，已满时淘汰最久没有收到应答的设备；
+ * 变化事件放在定长的环形队列中。对象较大，应静态分配而不是放在任务栈上。
+ *
+ * browse 的通知函数没有上下文参数，同一时刻只能有一个实例在发现。
+ */
 class MDNSDiscovery {
 public:
+    /// 设备变化回调，在调用 wait_for_changes() 的任务中执行
+    typedef std::function<void(MDNSDeviceEvent, const MDNSDevice&)> DeviceCallback;
+
+    /// visit_devices() 的访问函数，持有内部锁时调用
+    typedef void (*DeviceVisitor)(const MDNSDevice& device, void* context);
+
     MDNSDiscovery();
     ~MDNSDiscovery();
 
     esp_err_t init();
+
+    /**
+     * @brief 开始发现，或再次发出查询
+     * @details 第一次调用时建立 browse，之后每次调用只发出一次异步 PTR 查询，
+     * 上一次查询尚未结束时不重复发送。函数不等待查询结果
+     *
+     * @param service_type 服务类型，例如 "_leboremote"
+     * @param timeout 异步查询收集应答的时间(毫秒)
+     */
     esp_err_t start_discovery(const char* service_type = "_lebo._tcp", int timeout = 3000);
     esp_err_t stop_discovery();
-    std::vector<MDNSDevice> get_discovered_devices() const;
+
+    /**
+     * @brief 休眠到设备列表可能变化或超时，然后处理结果并执行变化回调
+     * @details 收集已结束的异步查询的结果，删除到期的设备
+     *
+     * @param timeout_ms 最长等待时间(毫秒)
+     * @return 本次处理的设备变化数，超时且没有变化时为 0
+     */
+    size_t wait_for_changes(uint32_t timeout_ms);
+
+    void set_device_callback(const DeviceCallback& callback) { callback_ = callback; }
+
+    /**
+     * @brief 在内部锁内依次访问每个设备，不复制设备表
+     * @details 访问期间 mDNS 任务的通知被阻塞，访问函数应尽快返回，不能调用本类的其他方法
+     *
+     * @param visitor 访问函数
+     * @param context 传给访问函数的参数
+     * @return 访问的设备数
+     */
+    size_t visit_devices(DeviceVisitor visitor, void* context) const;
+
+    size_t device_count() const;
     bool is_init() const { return m_bIsInit; }
 private:
+    struct DeviceSlot {
+        MDNSDevice device;
+        TickType_t expires;    ///< 记录到期的时刻
+        TickType_t last_seen;  ///< 最近一次收到应答的时刻，用于淘汰
+        TickType_t resolve_after;  ///< 没有地址时，此时刻之后才查询主机地址
+        bool used;
+    };
+
+    struct PendingEvent {
+        MDNSDeviceEvent event;
+        MDNSDevice device;
+    };
+
+    static void browse_notify(mdns_result_t* result);
+    static void query_notify(mdns_search_once_t* search);
+
     void parse_mdns_response(mdns_result_t* result);
-    std::string resolve_mdns_host(const char * host_name);
+    void update_device(const mdns_result_t* result, TickType_t now);
+    void remove_device(const char* instance_name);
+    void expire_devices(TickType_t now);
+    DeviceSlot* find_slot(const char* instance_name);
+    DeviceSlot* allocate_slot();
+    const DeviceSlot* find_host_address(const char* hostname) const;
+    void push_event(MDNSDeviceEvent event, const MDNSDevice& device);
+    void collect_query_results();
+    TickType_t resolve_wait(TickType_t now, TickType_t wait) const;
+    void start_host_resolve(TickType_t now);
+    void collect_host_results();
 
-    std::vector<MDNSDevice> discovered_devices_;
+    DeviceSlot slots_[CONFIG_MDNS_DISCOVERY_MAX_DEVICES];
+    PendingEvent events_[CONFIG_MDNS_DISCOVERY_EVENT_QUEUE_LEN];  ///< 等待在应用任务中回调的变化
+    size_t event_head_;
+    size_t event_count_;
+    PendingEvent delivering_;                   ///< 正在回调的事件，不占用应用任务的栈
+    uint32_t dropped_events_;                   ///< 队列已满时丢弃的事件数
+    DeviceCallback callback_;
+    std::string service_type_;
+    mdns_search_once_t* search_;                ///< 正在进行的异步查询
+    mdns_search_once_t* host_search_;           ///< 正在进行的主机地址查询
+    char host_query_[CONFIG_MDNS_DISCOVERY_HOSTNAME_LEN];  ///< host_search_ 查询的主机名
     bool is_discovery_running_;
     bool m_bIsInit;
     SemaphoreHandle_t mutex_; // 互斥锁
+    SemaphoreHandle_t event_; // 有新结果时由 mDNS 任务释放，唤醒 wait_for_changes()
+
+    static MDNSDiscovery* s_active;  ///< 接收 browse 通知的实例
 };
@@ -37,6 +37,10 @@
 #define WIFI_PASSWORD  "********" //you wifi password
 #define MAX_RETRY      5
 
+// 持续查询间隔: 从 1 秒开始加倍，最长 60 秒(RFC 6762 5.2)
+#define SEARCH_INITIAL_INTERVAL_MS 1000
+#define SEARCH_MAX_INTERVAL_MS     60000
+
 static const char *TAG = "mdns_search";
 
 // WiFi管理器共享指针
@@ -52,8 +56,8 @@ TaskHandle_t device_search_task_handle = NULL;
  * 此任务作为独立线程运行，完成以下工作：
  * 1. 等待WiFi连接稳定
  * 2. 初始化mDNS服务
- * 3. 定期搜索指定类型的mDNS设备
- * 4. 处理搜索结果
+ * 3. 按退避间隔发出异步查询，查询不阻塞任务
+ * 4. 在两次查询之间休眠，收到结果时被唤醒并处理设备变化
  * 
  * @param pvParameters FreeRTOS任务参数，本函数不使用此参数
  */
@@ -71,21 +75,39 @@ void device_search_task(void *pvParameters) {
         g_wifi_manager->printInfo();
     }
     
-    // 创建并初始化mDNS搜索实例
-    MDNSDiscovery mdns_discovery;
+    // 创建并初始化mDNS搜索实例，设备表较大，静态分配而不占用任务栈
+    static MDNSDiscovery mdns_discovery;
     mdns_discovery.init();
+    mdns_discovery.set_device_callback([](MDNSDeviceEvent event, const MDNSDevice& device) {
+        const char* action = event == MDNSDeviceEvent::Added ? "发现设备" :
+                             event == MDNSDeviceEvent::Updated ? "设备更新" : "设备离线";
+        ESP_LOGI(TAG, "%s: %s (%s) " IPSTR ":%u uid=%s", action, device.name, device.hostname,
+                 IP2STR(&device.ip), device.port, device.uid);
+    });
     
+    uint32_t interval_ms = SEARCH_INITIAL_INTERVAL_MS;
     while (1) {
         // 确保WiFi连接状态
         if (g_wifi_manager && g_wifi_manager->isConnected()) {
             ESP_LOGI(TAG, "开始搜索设备...");
             mdns_discovery.start_discovery("_leboremote", 3000);
+            
+            // 设备上线后会主动通告，搜索间隔逐渐加大；期间有结果时立即被唤醒处理
+            TickType_t next_query = xTaskGetTickCount() + pdMS_TO_TICKS(interval_ms);
+            for (TickType_t now = xTaskGetTickCount(); static_cast<int32_t>(next_query - now) > 0;
+                 now = xTaskGetTickCount()) {
+                mdns_discovery.wait_for_changes((next_query - now) * portTICK_PERIOD_MS);
+            }
+            ESP_LOGI(TAG, "当前设备数: %u", (unsigned)mdns_discovery.device_count());
+            interval_ms = interval_ms * 2 > SEARCH_MAX_INTERVAL_MS ? SEARCH_MAX_INTERVAL_MS : interval_ms * 2;
         } else {
             ESP_LOGW(TAG, "WiFi未连接，无法执行mDNS搜索");
+            
+            // 重新连接后从最短间隔开始搜索
+            mdns_discovery.stop_discovery();
+            interval_ms = SEARCH_INITIAL_INTERVAL_MS;
+            vTaskDelay(SEARCH_INITIAL_INTERVAL_MS / portTICK_PERIOD_MS);
         }
-        
-        // 5秒后再次搜索
-        vTaskDelay(5000 / portTICK_PERIOD_MS);
     }
 }
 
@@ -0,0 +1,239 @@
+/**
+ * @file corpus.h
+ * @brief 基准测试使用的 mDNS 报文样本
+ * @details 按局域网中常见设备的抓包重新构造: 记录组成、TXT 内容和名称压缩方式与原报文一致，
+ * MAC、地址和序列号等可识别信息已替换。新增样本时同时加入 kCorpus。
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bench {
+
+/// _leboremote 电视的完整通告(PTR/SRV/TXT 加附加部分的 A/AAAA/NSEC) (256 字节)
+const uint8_t k_leboremote_announce[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x04, 0x0b, 0x5f, 0x6c, 0x65,
+    0x62, 0x6f, 0x72, 0x65, 0x6d, 0x6f, 0x74, 0x65, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f,
+    0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x11, 0x0e, 0x4c,
+    0x69, 0x76, 0x69, 0x6e, 0x67, 0x20, 0x52, 0x6f, 0x6f, 0x6d, 0x20, 0x54, 0x56, 0xc0, 0x0c, 0xc0,
+    0x2e, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0xd0,
+    0x8c, 0x0b, 0x4c, 0x65, 0x62, 0x6f, 0x54, 0x56, 0x2d, 0x33, 0x46, 0x32, 0x41, 0xc0, 0x1d, 0xc0,
+    0x2e, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x40, 0x09, 0x76, 0x65, 0x72, 0x3d,
+    0x32, 0x2e, 0x33, 0x2e, 0x31, 0x15, 0x6d, 0x61, 0x63, 0x3d, 0x30, 0x30, 0x3a, 0x31, 0x61, 0x3a,
+    0x32, 0x62, 0x3a, 0x33, 0x63, 0x3a, 0x34, 0x64, 0x3a, 0x35, 0x65, 0x0c, 0x6d, 0x6f, 0x64, 0x65,
+    0x6c, 0x3d, 0x4c, 0x42, 0x2d, 0x58, 0x35, 0x35, 0x12, 0x63, 0x68, 0x61, 0x6e, 0x6e, 0x65, 0x6c,
+    0x3d, 0x6c, 0x65, 0x62, 0x6f, 0x72, 0x65, 0x6d, 0x6f, 0x74, 0x65, 0xc0, 0x51, 0x00, 0x01, 0x80,
+    0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8, 0x01, 0x17, 0xc0, 0x51, 0x00, 0x1c, 0x80,
+    0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10, 0xfe, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0a,
+    0x1b, 0x2c, 0xff, 0xfe, 0x3d, 0x4e, 0x5f, 0xc0, 0x2e, 0x00, 0x2f, 0x80, 0x01, 0x00, 0x00, 0x00,
+    0x78, 0x00, 0x09, 0xc0, 0x2e, 0x00, 0x05, 0x00, 0x00, 0x80, 0x00, 0x40, 0xc0, 0x51, 0x00, 0x2f,
+    0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0xc0, 0x51, 0x00, 0x04, 0x40, 0x00, 0x00, 0x08,
+};
+
+/// Apple TV 的 AirPlay/RAOP 通告，TXT 较长，两个 AAAA 地址 (895 字节)
+const uint8_t k_appletv_airplay[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00, 0x00, 0x06, 0x08, 0x5f, 0x61, 0x69,
+    0x72, 0x70, 0x6c, 0x61, 0x79, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c,
+    0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0a, 0x07, 0x42, 0x65, 0x64, 0x72,
+    0x6f, 0x6f, 0x6d, 0xc0, 0x0c, 0x05, 0x5f, 0x72, 0x61, 0x6f, 0x70, 0xc0, 0x15, 0x00, 0x0c, 0x00,
+    0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x17, 0x14, 0x35, 0x43, 0x31, 0x44, 0x44, 0x39, 0x36, 0x41,
+    0x33, 0x42, 0x32, 0x30, 0x40, 0x42, 0x65, 0x64, 0x72, 0x6f, 0x6f, 0x6d, 0xc0, 0x35, 0xc0, 0x2b,
+    0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x01, 0x86, 0x05, 0x61, 0x63, 0x6c, 0x3d, 0x30,
+    0x18, 0x62, 0x74, 0x61, 0x64, 0x64, 0x72, 0x3d, 0x35, 0x43, 0x3a, 0x31, 0x44, 0x3a, 0x44, 0x39,
+    0x3a, 0x36, 0x41, 0x3a, 0x33, 0x42, 0x3a, 0x32, 0x31, 0x1a, 0x64, 0x65, 0x76, 0x69, 0x63, 0x65,
+    0x69, 0x64, 0x3d, 0x35, 0x43, 0x3a, 0x31, 0x44, 0x3a, 0x44, 0x39, 0x3a, 0x36, 0x41, 0x3a, 0x33,
+    0x42, 0x3a, 0x32, 0x30, 0x12, 0x66, 0x65, 0x78, 0x3d, 0x31, 0x64, 0x39, 0x2f, 0x53, 0x74, 0x35,
+    0x2f, 0x46, 0x62, 0x77, 0x6f, 0x6f, 0x51, 0x1e, 0x66, 0x65, 0x61, 0x74, 0x75, 0x72, 0x65, 0x73,
+    0x3d, 0x30, 0x78, 0x34, 0x41, 0x37, 0x46, 0x44, 0x46, 0x44, 0x35, 0x2c, 0x30, 0x78, 0x42, 0x43,
+    0x31, 0x35, 0x37, 0x46, 0x44, 0x45, 0x0d, 0x66, 0x6c, 0x61, 0x67, 0x73, 0x3d, 0x30, 0x78, 0x31,
+    0x38, 0x36, 0x34, 0x34, 0x28, 0x67, 0x69, 0x64, 0x3d, 0x38, 0x42, 0x36, 0x45, 0x36, 0x45, 0x34,
+    0x41, 0x2d, 0x32, 0x30, 0x45, 0x33, 0x2d, 0x34, 0x42, 0x32, 0x41, 0x2d, 0x39, 0x43, 0x35, 0x44,
+    0x2d, 0x33, 0x44, 0x32, 0x44, 0x31, 0x46, 0x35, 0x35, 0x41, 0x36, 0x43, 0x31, 0x05, 0x69, 0x67,
+    0x6c, 0x3d, 0x31, 0x06, 0x67, 0x63, 0x67, 0x6c, 0x3d, 0x31, 0x11, 0x6d, 0x6f, 0x64, 0x65, 0x6c,
+    0x3d, 0x41, 0x70, 0x70, 0x6c, 0x65, 0x54, 0x56, 0x31, 0x31, 0x2c, 0x31, 0x0d, 0x70, 0x72, 0x6f,
+    0x74, 0x6f, 0x76, 0x65, 0x72, 0x73, 0x3d, 0x31, 0x2e, 0x31, 0x27, 0x70, 0x69, 0x3d, 0x32, 0x65,
+    0x33, 0x38, 0x38, 0x30, 0x30, 0x36, 0x2d, 0x31, 0x33, 0x62, 0x61, 0x2d, 0x34, 0x30, 0x34, 0x31,
+    0x2d, 0x39, 0x61, 0x36, 0x37, 0x2d, 0x32, 0x35, 0x64, 0x64, 0x34, 0x61, 0x34, 0x33, 0x64, 0x35,
+    0x33, 0x36, 0x28, 0x70, 0x73, 0x69, 0x3d, 0x33, 0x46, 0x31, 0x46, 0x35, 0x46, 0x30, 0x45, 0x2d,
+    0x38, 0x42, 0x37, 0x43, 0x2d, 0x34, 0x42, 0x38, 0x46, 0x2d, 0x41, 0x35, 0x45, 0x34, 0x2d, 0x30,
+    0x45, 0x37, 0x44, 0x36, 0x42, 0x39, 0x45, 0x32, 0x43, 0x31, 0x31, 0x43, 0x70, 0x6b, 0x3d, 0x61,
+    0x31, 0x62, 0x32, 0x63, 0x33, 0x64, 0x34, 0x65, 0x35, 0x66, 0x36, 0x30, 0x37, 0x31, 0x38, 0x32,
+    0x39, 0x33, 0x61, 0x34, 0x62, 0x35, 0x63, 0x36, 0x64, 0x37, 0x65, 0x38, 0x66, 0x39, 0x30, 0x31,
+    0x61, 0x32, 0x62, 0x33, 0x63, 0x34, 0x64, 0x35, 0x65, 0x36, 0x66, 0x37, 0x30, 0x38, 0x31, 0x39,
+    0x32, 0x61, 0x33, 0x62, 0x34, 0x63, 0x35, 0x64, 0x36, 0x65, 0x37, 0x66, 0x38, 0x30, 0x39, 0x0f,
+    0x73, 0x72, 0x63, 0x76, 0x65, 0x72, 0x73, 0x3d, 0x36, 0x37, 0x30, 0x2e, 0x36, 0x2e, 0x32, 0x0b,
+    0x6f, 0x73, 0x76, 0x65, 0x72, 0x73, 0x3d, 0x31, 0x37, 0x2e, 0x31, 0x04, 0x76, 0x76, 0x3d, 0x32,
+    0xc0, 0x2b, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x19, 0x00, 0x00, 0x00, 0x00,
+    0x1b, 0x58, 0x10, 0x42, 0x65, 0x64, 0x72, 0x6f, 0x6f, 0x6d, 0x2d, 0x41, 0x70, 0x70, 0x6c, 0x65,
+    0x2d, 0x54, 0x56, 0xc0, 0x1a, 0xc0, 0x47, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00,
+    0xc4, 0x0a, 0x63, 0x6e, 0x3d, 0x30, 0x2c, 0x31, 0x2c, 0x32, 0x2c, 0x33, 0x07, 0x64, 0x61, 0x3d,
+    0x74, 0x72, 0x75, 0x65, 0x08, 0x65, 0x74, 0x3d, 0x30, 0x2c, 0x33, 0x2c, 0x35, 0x18, 0x66, 0x74,
+    0x3d, 0x30, 0x78, 0x34, 0x41, 0x37, 0x46, 0x44, 0x46, 0x44, 0x35, 0x2c, 0x30, 0x78, 0x42, 0x43,
+    0x31, 0x35, 0x37, 0x46, 0x44, 0x45, 0x0a, 0x73, 0x66, 0x3d, 0x30, 0x78, 0x31, 0x38, 0x36, 0x34,
+    0x34, 0x08, 0x6d, 0x64, 0x3d, 0x30, 0x2c, 0x31, 0x2c, 0x32, 0x0e, 0x61, 0x6d, 0x3d, 0x41, 0x70,
+    0x70, 0x6c, 0x65, 0x54, 0x56, 0x31, 0x31, 0x2c, 0x31, 0x43, 0x70, 0x6b, 0x3d, 0x61, 0x31, 0x62,
+    0x32, 0x63, 0x33, 0x64, 0x34, 0x65, 0x35, 0x66, 0x36, 0x30, 0x37, 0x31, 0x38, 0x32, 0x39, 0x33,
+    0x61, 0x34, 0x62, 0x35, 0x63, 0x36, 0x64, 0x37, 0x65, 0x38, 0x66, 0x39, 0x30, 0x31, 0x61, 0x32,
+    0x62, 0x33, 0x63, 0x34, 0x64, 0x35, 0x65, 0x36, 0x66, 0x37, 0x30, 0x38, 0x31, 0x39, 0x32, 0x61,
+    0x33, 0x62, 0x34, 0x63, 0x35, 0x64, 0x36, 0x65, 0x37, 0x66, 0x38, 0x30, 0x39, 0x06, 0x74, 0x70,
+    0x3d, 0x55, 0x44, 0x50, 0x08, 0x76, 0x6e, 0x3d, 0x36, 0x35, 0x35, 0x33, 0x37, 0x0a, 0x76, 0x73,
+    0x3d, 0x36, 0x37, 0x30, 0x2e, 0x36, 0x2e, 0x32, 0x07, 0x6f, 0x76, 0x3d, 0x31, 0x37, 0x2e, 0x31,
+    0x04, 0x76, 0x76, 0x3d, 0x32, 0xc0, 0x47, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00,
+    0x08, 0x00, 0x00, 0x00, 0x00, 0x1b, 0x58, 0xc2, 0x02, 0xc2, 0x02, 0x00, 0x01, 0x80, 0x01, 0x00,
+    0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8, 0x01, 0x29, 0xc2, 0x02, 0x00, 0x1c, 0x80, 0x01, 0x00,
+    0x00, 0x00, 0x78, 0x00, 0x10, 0xfe, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x18, 0x7a, 0x3b,
+    0xff, 0xfe, 0xf0, 0xc2, 0x11, 0xc2, 0x02, 0x00, 0x1c, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00,
+    0x10, 0xfd, 0x1c, 0x2b, 0xe4, 0xa8, 0xd7, 0x00, 0x00, 0x1c, 0x2e, 0x4f, 0xfc, 0x3b, 0x9a, 0x7d,
+    0x10, 0xc0, 0x2b, 0x00, 0x2f, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x09, 0xc0, 0x2b, 0x00,
+    0x05, 0x00, 0x00, 0x80, 0x00, 0x40, 0xc0, 0x47, 0x00, 0x2f, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78,
+    0x00, 0x09, 0xc0, 0x47, 0x00, 0x05, 0x00, 0x00, 0x80, 0x00, 0x40, 0xc2, 0x02, 0x00, 0x2f, 0x80,
+    0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0xc2, 0x02, 0x00, 0x04, 0x40, 0x00, 0x00, 0x08,
+};
+
+/// Chromecast 通告，问题部分非空，记录都在附加部分 (365 字节)
+const uint8_t k_chromecast[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x03, 0x0b, 0x5f, 0x67, 0x6f,
+    0x6f, 0x67, 0x6c, 0x65, 0x63, 0x61, 0x73, 0x74, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f,
+    0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+    0x00, 0x78, 0x00, 0x34, 0x31, 0x43, 0x68, 0x72, 0x6f, 0x6d, 0x65, 0x63, 0x61, 0x73, 0x74, 0x2d,
+    0x55, 0x6c, 0x74, 0x72, 0x61, 0x2d, 0x38, 0x66, 0x33, 0x63, 0x32, 0x61, 0x31, 0x62, 0x39, 0x65,
+    0x37, 0x64, 0x34, 0x63, 0x36, 0x66, 0x35, 0x61, 0x30, 0x62, 0x31, 0x63, 0x32, 0x64, 0x33, 0x65,
+    0x34, 0x66, 0x35, 0x61, 0x36, 0x62, 0xc0, 0x0c, 0xc0, 0x34, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00,
+    0x11, 0x94, 0x00, 0xb0, 0x23, 0x69, 0x64, 0x3d, 0x38, 0x66, 0x33, 0x63, 0x32, 0x61, 0x31, 0x62,
+    0x39, 0x65, 0x37, 0x64, 0x34, 0x63, 0x36, 0x66, 0x35, 0x61, 0x30, 0x62, 0x31, 0x63, 0x32, 0x64,
+    0x33, 0x65, 0x34, 0x66, 0x35, 0x61, 0x36, 0x62, 0x23, 0x63, 0x64, 0x3d, 0x34, 0x41, 0x36, 0x42,
+    0x31, 0x43, 0x32, 0x44, 0x33, 0x45, 0x34, 0x46, 0x35, 0x41, 0x36, 0x42, 0x37, 0x43, 0x38, 0x44,
+    0x39, 0x45, 0x30, 0x46, 0x31, 0x41, 0x32, 0x42, 0x33, 0x43, 0x34, 0x44, 0x03, 0x72, 0x6d, 0x3d,
+    0x05, 0x76, 0x65, 0x3d, 0x30, 0x35, 0x13, 0x6d, 0x64, 0x3d, 0x43, 0x68, 0x72, 0x6f, 0x6d, 0x65,
+    0x63, 0x61, 0x73, 0x74, 0x20, 0x55, 0x6c, 0x74, 0x72, 0x61, 0x12, 0x69, 0x63, 0x3d, 0x2f, 0x73,
+    0x65, 0x74, 0x75, 0x70, 0x2f, 0x69, 0x63, 0x6f, 0x6e, 0x2e, 0x70, 0x6e, 0x67, 0x0e, 0x66, 0x6e,
+    0x3d, 0x4c, 0x69, 0x76, 0x69, 0x6e, 0x67, 0x20, 0x52, 0x6f, 0x6f, 0x6d, 0x09, 0x63, 0x61, 0x3d,
+    0x32, 0x30, 0x31, 0x32, 0x32, 0x31, 0x04, 0x73, 0x74, 0x3d, 0x30, 0x0f, 0x62, 0x73, 0x3d, 0x46,
+    0x41, 0x38, 0x46, 0x43, 0x41, 0x37, 0x42, 0x33, 0x43, 0x32, 0x44, 0x04, 0x6e, 0x66, 0x3d, 0x31,
+    0x03, 0x72, 0x73, 0x3d, 0xc0, 0x34, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x2d,
+    0x00, 0x00, 0x00, 0x00, 0x1f, 0x49, 0x24, 0x38, 0x66, 0x33, 0x63, 0x32, 0x61, 0x31, 0x62, 0x2d,
+    0x39, 0x65, 0x37, 0x64, 0x2d, 0x34, 0x63, 0x36, 0x66, 0x2d, 0x35, 0x61, 0x30, 0x62, 0x2d, 0x31,
+    0x63, 0x32, 0x64, 0x33, 0x65, 0x34, 0x66, 0x35, 0x61, 0x36, 0x62, 0xc0, 0x1d, 0xc1, 0x36, 0x00,
+    0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8, 0x01, 0x39,
+};
+
+/// 网络打印机的 IPP 通告，带子类型 PTR 和 20 条 TXT (755 字节)
+const uint8_t k_printer_ipp[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x05, 0x00, 0x00, 0x00, 0x04, 0x04, 0x5f, 0x69, 0x70,
+    0x70, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00,
+    0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x23, 0x20, 0x48, 0x50, 0x20, 0x4c, 0x61, 0x73, 0x65, 0x72,
+    0x4a, 0x65, 0x74, 0x20, 0x4d, 0x46, 0x50, 0x20, 0x4d, 0x32, 0x33, 0x34, 0x73, 0x64, 0x77, 0x20,
+    0x28, 0x37, 0x41, 0x31, 0x42, 0x32, 0x43, 0x29, 0xc0, 0x0c, 0x0a, 0x5f, 0x75, 0x6e, 0x69, 0x76,
+    0x65, 0x72, 0x73, 0x61, 0x6c, 0x04, 0x5f, 0x73, 0x75, 0x62, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01,
+    0x00, 0x00, 0x11, 0x94, 0x00, 0x02, 0xc0, 0x27, 0x06, 0x5f, 0x70, 0x72, 0x69, 0x6e, 0x74, 0xc0,
+    0x55, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x02, 0xc0, 0x27, 0xc0, 0x27, 0x00,
+    0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x11, 0x00, 0x00, 0x00, 0x00, 0x02, 0x77, 0x08,
+    0x48, 0x50, 0x37, 0x41, 0x31, 0x42, 0x32, 0x43, 0xc0, 0x16, 0xc0, 0x27, 0x00, 0x10, 0x80, 0x01,
+    0x00, 0x00, 0x11, 0x94, 0x01, 0xf8, 0x09, 0x74, 0x78, 0x74, 0x76, 0x65, 0x72, 0x73, 0x3d, 0x31,
+    0x08, 0x71, 0x74, 0x6f, 0x74, 0x61, 0x6c, 0x3d, 0x31, 0x0c, 0x72, 0x70, 0x3d, 0x69, 0x70, 0x70,
+    0x2f, 0x70, 0x72, 0x69, 0x6e, 0x74, 0x1c, 0x74, 0x79, 0x3d, 0x48, 0x50, 0x20, 0x4c, 0x61, 0x73,
+    0x65, 0x72, 0x4a, 0x65, 0x74, 0x20, 0x4d, 0x46, 0x50, 0x20, 0x4d, 0x32, 0x33, 0x32, 0x2d, 0x4d,
+    0x32, 0x33, 0x37, 0x2f, 0x61, 0x64, 0x6d, 0x69, 0x6e, 0x75, 0x72, 0x6c, 0x3d, 0x68, 0x74, 0x74,
+    0x70, 0x3a, 0x2f, 0x2f, 0x48, 0x50, 0x37, 0x41, 0x31, 0x42, 0x32, 0x43, 0x2e, 0x6c, 0x6f, 0x63,
+    0x61, 0x6c, 0x2e, 0x2f, 0x23, 0x68, 0x49, 0x64, 0x2d, 0x70, 0x67, 0x41, 0x69, 0x72, 0x50, 0x72,
+    0x69, 0x6e, 0x74, 0x05, 0x6e, 0x6f, 0x74, 0x65, 0x3d, 0x0b, 0x70, 0x72, 0x69, 0x6f, 0x72, 0x69,
+    0x74, 0x79, 0x3d, 0x31, 0x30, 0x23, 0x70, 0x72, 0x6f, 0x64, 0x75, 0x63, 0x74, 0x3d, 0x28, 0x48,
+    0x50, 0x20, 0x4c, 0x61, 0x73, 0x65, 0x72, 0x4a, 0x65, 0x74, 0x20, 0x4d, 0x46, 0x50, 0x20, 0x4d,
+    0x32, 0x33, 0x32, 0x2d, 0x4d, 0x32, 0x33, 0x37, 0x29, 0x52, 0x70, 0x64, 0x6c, 0x3d, 0x61, 0x70,
+    0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x2f, 0x6f, 0x63, 0x74, 0x65, 0x74, 0x2d,
+    0x73, 0x74, 0x72, 0x65, 0x61, 0x6d, 0x2c, 0x69, 0x6d, 0x61, 0x67, 0x65, 0x2f, 0x75, 0x72, 0x66,
+    0x2c, 0x69, 0x6d, 0x61, 0x67, 0x65, 0x2f, 0x70, 0x77, 0x67, 0x2d, 0x72, 0x61, 0x73, 0x74, 0x65,
+    0x72, 0x2c, 0x61, 0x70, 0x70, 0x6c, 0x69, 0x63, 0x61, 0x74, 0x69, 0x6f, 0x6e, 0x2f, 0x70, 0x64,
+    0x66, 0x2c, 0x69, 0x6d, 0x61, 0x67, 0x65, 0x2f, 0x6a, 0x70, 0x65, 0x67, 0x36, 0x55, 0x52, 0x46,
+    0x3d, 0x56, 0x31, 0x2e, 0x34, 0x2c, 0x43, 0x50, 0x39, 0x39, 0x2c, 0x57, 0x38, 0x2c, 0x4f, 0x42,
+    0x31, 0x30, 0x2c, 0x50, 0x51, 0x33, 0x2d, 0x34, 0x2d, 0x35, 0x2c, 0x44, 0x4d, 0x31, 0x2c, 0x49,
+    0x53, 0x31, 0x2d, 0x31, 0x39, 0x2c, 0x4d, 0x54, 0x31, 0x2d, 0x33, 0x2d, 0x35, 0x2c, 0x52, 0x53,
+    0x36, 0x30, 0x30, 0x11, 0x50, 0x61, 0x70, 0x65, 0x72, 0x4d, 0x61, 0x78, 0x3d, 0x6c, 0x65, 0x67,
+    0x61, 0x6c, 0x2d, 0x41, 0x34, 0x25, 0x6b, 0x69, 0x6e, 0x64, 0x3d, 0x64, 0x6f, 0x63, 0x75, 0x6d,
+    0x65, 0x6e, 0x74, 0x2c, 0x65, 0x6e, 0x76, 0x65, 0x6c, 0x6f, 0x70, 0x65, 0x2c, 0x6c, 0x61, 0x62,
+    0x65, 0x6c, 0x2c, 0x70, 0x6f, 0x73, 0x74, 0x63, 0x61, 0x72, 0x64, 0x07, 0x54, 0x4c, 0x53, 0x3d,
+    0x31, 0x2e, 0x32, 0x0d, 0x54, 0x72, 0x61, 0x6e, 0x73, 0x70, 0x61, 0x72, 0x65, 0x6e, 0x74, 0x3d,
+    0x54, 0x08, 0x44, 0x75, 0x70, 0x6c, 0x65, 0x78, 0x3d, 0x54, 0x07, 0x43, 0x6f, 0x6c, 0x6f, 0x72,
+    0x3d, 0x46, 0x29, 0x55, 0x55, 0x49, 0x44, 0x3d, 0x35, 0x36, 0x34, 0x65, 0x34, 0x33, 0x33, 0x33,
+    0x2d, 0x34, 0x61, 0x33, 0x31, 0x2d, 0x33, 0x38, 0x33, 0x31, 0x2d, 0x33, 0x37, 0x33, 0x36, 0x2d,
+    0x37, 0x63, 0x34, 0x64, 0x33, 0x62, 0x32, 0x61, 0x31, 0x63, 0x30, 0x66, 0x14, 0x6d, 0x6f, 0x70,
+    0x72, 0x69, 0x61, 0x2d, 0x63, 0x65, 0x72, 0x74, 0x69, 0x66, 0x69, 0x65, 0x64, 0x3d, 0x32, 0x2e,
+    0x30, 0x0a, 0x75, 0x73, 0x62, 0x5f, 0x4d, 0x46, 0x47, 0x3d, 0x48, 0x50, 0x21, 0x75, 0x73, 0x62,
+    0x5f, 0x4d, 0x44, 0x4c, 0x3d, 0x48, 0x50, 0x20, 0x4c, 0x61, 0x73, 0x65, 0x72, 0x4a, 0x65, 0x74,
+    0x20, 0x4d, 0x46, 0x50, 0x20, 0x4d, 0x32, 0x33, 0x32, 0x2d, 0x4d, 0x32, 0x33, 0x37, 0xc0, 0x8f,
+    0x00, 0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8, 0x01, 0x58, 0xc0, 0x8f,
+    0x00, 0x1c, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x10, 0xfe, 0x80, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xc2, 0x18, 0x7a, 0xff, 0xfe, 0x7a, 0x1b, 0x2c, 0xc0, 0x27, 0x00, 0x2f, 0x80, 0x01,
+    0x00, 0x00, 0x00, 0x78, 0x00, 0x09, 0xc0, 0x27, 0x00, 0x05, 0x00, 0x00, 0x80, 0x00, 0x40, 0xc0,
+    0x8f, 0x00, 0x2f, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0xc0, 0x8f, 0x00, 0x04, 0x40,
+    0x00, 0x00, 0x08,
+};
+
+/// _leboremote 电视下线时的 goodbye(TTL 为 0) (133 字节)
+const uint8_t k_leboremote_goodbye[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x0b, 0x5f, 0x6c, 0x65,
+    0x62, 0x6f, 0x72, 0x65, 0x6d, 0x6f, 0x74, 0x65, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f,
+    0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x11, 0x0e, 0x4c,
+    0x69, 0x76, 0x69, 0x6e, 0x67, 0x20, 0x52, 0x6f, 0x6f, 0x6d, 0x20, 0x54, 0x56, 0xc0, 0x0c, 0xc0,
+    0x2e, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x14, 0x00, 0x00, 0x00, 0x00, 0xd0,
+    0x8c, 0x0b, 0x4c, 0x65, 0x62, 0x6f, 0x54, 0x56, 0x2d, 0x33, 0x46, 0x32, 0x41, 0xc0, 0x1d, 0xc0,
+    0x2e, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x09, 0x76, 0x65, 0x72, 0x3d,
+    0x32, 0x2e, 0x33, 0x2e, 0x31, 0xc0, 0x51, 0x00, 0x01, 0x80, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x04, 0xc0, 0xa8, 0x01, 0x17,
+};
+
+/// 服务类型枚举的应答，10 条 PTR，不属于订阅的服务类型 (290 字节)
+const uint8_t k_service_enumeration[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00, 0x09, 0x5f, 0x73, 0x65,
+    0x72, 0x76, 0x69, 0x63, 0x65, 0x73, 0x07, 0x5f, 0x64, 0x6e, 0x73, 0x2d, 0x73, 0x64, 0x04, 0x5f,
+    0x75, 0x64, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+    0x11, 0x94, 0x00, 0x10, 0x08, 0x5f, 0x61, 0x69, 0x72, 0x70, 0x6c, 0x61, 0x79, 0x04, 0x5f, 0x74,
+    0x63, 0x70, 0xc0, 0x23, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x08,
+    0x05, 0x5f, 0x72, 0x61, 0x6f, 0x70, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+    0x11, 0x94, 0x00, 0x12, 0x0f, 0x5f, 0x63, 0x6f, 0x6d, 0x70, 0x61, 0x6e, 0x69, 0x6f, 0x6e, 0x2d,
+    0x6c, 0x69, 0x6e, 0x6b, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94,
+    0x00, 0x0f, 0x0c, 0x5f, 0x73, 0x6c, 0x65, 0x65, 0x70, 0x2d, 0x70, 0x72, 0x6f, 0x78, 0x79, 0xc0,
+    0x1e, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x0b, 0x08, 0x5f, 0x68,
+    0x6f, 0x6d, 0x65, 0x6b, 0x69, 0x74, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+    0x11, 0x94, 0x00, 0x0e, 0x0b, 0x5f, 0x67, 0x6f, 0x6f, 0x67, 0x6c, 0x65, 0x63, 0x61, 0x73, 0x74,
+    0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x13, 0x10, 0x5f,
+    0x73, 0x70, 0x6f, 0x74, 0x69, 0x66, 0x79, 0x2d, 0x63, 0x6f, 0x6e, 0x6e, 0x65, 0x63, 0x74, 0xc0,
+    0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x07, 0x04, 0x5f, 0x69,
+    0x70, 0x70, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x08,
+    0x05, 0x5f, 0x68, 0x74, 0x74, 0x70, 0xc0, 0x3d, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00,
+    0x11, 0x94, 0x00, 0x0e, 0x0b, 0x5f, 0x6c, 0x65, 0x62, 0x6f, 0x72, 0x65, 0x6d, 0x6f, 0x74, 0x65,
+    0xc0, 0x3d,
+};
+
+/// 其他主机的查询，带两条已知应答 (102 字节)
+const uint8_t k_query_known_answer[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x0b, 0x5f, 0x6c, 0x65,
+    0x62, 0x6f, 0x72, 0x65, 0x6d, 0x6f, 0x74, 0x65, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f,
+    0x63, 0x61, 0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x08, 0x5f, 0x61, 0x69, 0x72, 0x70, 0x6c, 0x61,
+    0x79, 0xc0, 0x18, 0x00, 0x0c, 0x00, 0x01, 0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x10,
+    0x68, 0x00, 0x0d, 0x0a, 0x4b, 0x69, 0x74, 0x63, 0x68, 0x65, 0x6e, 0x20, 0x54, 0x56, 0xc0, 0x0c,
+    0xc0, 0x28, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x10, 0x68, 0x00, 0x0a, 0x07, 0x42, 0x65, 0x64,
+    0x72, 0x6f, 0x6f, 0x6d, 0xc0, 0x28,
+};
+
+struct CorpusPacket {
+    const char* name;
+    const uint8_t* data;
+    size_t size;
+};
+
+const CorpusPacket kCorpus[] = {
+    { "leboremote_announce", k_leboremote_announce, sizeof(k_leboremote_announce) },
+    { "appletv_airplay", k_appletv_airplay, sizeof(k_appletv_airplay) },
+    { "chromecast", k_chromecast, sizeof(k_chromecast) },
+    { "printer_ipp", k_printer_ipp, sizeof(k_printer_ipp) },
+    { "leboremote_goodbye", k_leboremote_goodbye, sizeof(k_leboremote_goodbye) },
+    { "service_enumeration", k_service_enumeration, sizeof(k_service_enumeration) },
+    { "query_known_answer", k_query_known_answer, sizeof(k_query_known_answer) },
+};
+
+const size_t kCorpusSize = sizeof(kCorpus) / sizeof(kCorpus[0]);
+
+} // namespace bench
@@ -0,0 +1,647 @@
+/**
+ * @file mdns_bench.cpp
+ * @brief 报文解析和设备表的基准测试
+ * @details 覆盖接收路径上最热的几段代码，报告每次操作的耗时和内存分配:
+ *  - name/...: 域名解析(对应 parseDNSName)，包括逐层压缩指针链和指针环
+ *  - txt/...: TXT 记录解析(对应 parseTXT)，只遍历或生成键值映射
+ *  - response/...: 对 corpus.h 中的报文执行 parseMDNSResponse 的解析和缓存步骤:
+ *    读取头部、问题和全部记录，按订阅服务类型匹配，解码后写入记录缓存，
+ *    关联 SRV 目标主机的地址记录并解析实例的 TXT；不包括设备组装和回调
+ *  - table/...: 按实例名索引的设备表在 10、1k、100k 个设备时的插入、查找和删除
+ *  - replay/...: 通过 MemoryPacketSource 全速回放报文，经过 DeviceDiscovery 的完整路径
+ *    (parseMDNSResponse、记录缓存、设备表和回调)，包括启动和停止接收线程
+ *
+ * 内存分配通过替换全局 operator new 统计，只在本程序中生效。
+ *
+ * 用法: mdns_bench [过滤子串] [--min-time=毫秒]
+ */
+
+#include "corpus.h"
+#include "device_discovery.h"
+#include "logger.h"
+#include "device_index.h"
+#include "mdns_packet.h"
+#include "record_cache.h"
+#include "service_matcher.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <new>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+
+std::atomic<uint64_t> g_allocations{ 0 };
+std::atomic<uint64_t> g_allocatedBytes{ 0 };
+
+void* countedAlloc(size_t size)
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    g_allocatedBytes.fetch_add(size, std::memory_order_relaxed);
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+    {
+        throw std::bad_alloc();
+    }
+    return p;
+}
+
+} // namespace
+
+void* operator new(size_t size) { return countedAlloc(size); }
+void* operator new[](size_t size) { return countedAlloc(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return countedAlloc(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/// 防止被测代码的结果被优化掉
+volatile size_t g_sink = 0;
+
+struct Options {
+    std::string filter;
+    double minTimeMs = 200;
+};
+
+Options g_options;
+
+/**
+ * @brief 运行一个基准
+ * @details 迭代次数从 1 开始按倍数增加，直到一轮耗时超过 --min-time，
+ * 最后一轮的结果按操作数平均后输出
+ *
+ * @param name 基准名称
+ * @param opsPerIteration 每次调用 body 包含的操作数(例如报文数或设备数)
+ * @param body 被测代码
+ * @param setup 每轮开始前执行，不计入耗时和分配
+ */
+template <typename Body, typename Setup>
+void runBench(const std::string& name, size_t opsPerIteration, Body body, Setup setup)
+{
+    if (!g_options.filter.empty() && name.find(g_options.filter) == std::string::npos)
+    {
+        return;
+    }
+
+    uint64_t iterations = 1;
+    for (;;)
+    {
+        setup();
+        uint64_t allocations = g_allocations.load(std::memory_order_relaxed);
+        uint64_t bytes = g_allocatedBytes.load(std::memory_order_relaxed);
+        Clock::time_point start = Clock::now();
+        for (uint64_t i = 0; i < iterations; i++)
+        {
+            body();
+        }
+        double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        allocations = g_allocations.load(std::memory_order_relaxed) - allocations;
+        bytes = g_allocatedBytes.load(std::memory_order_relaxed) - bytes;
+
+        if (elapsedNs >= g_options.minTimeMs * 1e6 || iterations >= (uint64_t(1) << 40))
+        {
+            double ops = static_cast<double>(iterations) * opsPerIteration;
+            std::printf("%-36s %12.1f %12.2f %12.1f %12llu\n", name.c_str(), elapsedNs / ops,
+                allocations / ops, bytes / ops, static_cast<unsigned long long>(iterations));
+            return;
+        }
+        // 按已测耗时估算下一轮的次数，最多放大 10 倍
+        double scale = elapsedNs > 0 ? g_options.minTimeMs * 1e6 * 1.2 / elapsedNs : 10;
+        uint64_t next = static_cast<uint64_t>(iterations * (scale < 10 ? scale : 10));
+        iterations = next > iterations ? next : iterations + 1;
+    }
+}
+
+template <typename Body>
+void runBench(const std::string& name, size_t opsPerIteration, Body body)
+{
+    runBench(name, opsPerIteration, body, [] {});
+}
+
+// ---------------------------------------------------------------------------
+// name/*
+
+/**
+ * @brief 构造逐层压缩的名称链
+ * @details 第 i 个名称为一个标签加指向第 i-1 个名称的指针，最后一个名称解析时跟随 depth 次指针
+ *
+ * @param depth 指针层数
+ * @param offset 输出最后一个名称的偏移
+ */
+std::vector<uint8_t> makePointerChain(size_t depth, size_t& offset)
+{
+    // 头部之后是链的终点 "local"
+    std::vector<uint8_t> packet(mdns::kHeaderSize + 7, 0);
+    std::memcpy(&packet[mdns::kHeaderSize], "\x05local", 7);
+    size_t previous = mdns::kHeaderSize;
+    for (size_t i = 0; i < depth; i++)
+    {
+        char label[16];
+        int length = std::snprintf(label, sizeof(label), "level%zu", i);
+        offset = packet.size();
+        packet.push_back(static_cast<uint8_t>(length));
+        packet.insert(packet.end(), label, label + length);
+        packet.push_back(static_cast<uint8_t>(0xC0 | (previous >> 8)));
+        packet.push_back(static_cast<uint8_t>(previous & 0xFF));
+        previous = offset;
+    }
+    if (depth == 0)
+    {
+        offset = mdns::kHeaderSize;
+    }
+    return packet;
+}
+
+/// 不压缩的名称
+std::vector<uint8_t> makeFlatName(const std::string& dotted)
+{
+    std::vector<uint8_t> packet(mdns::kHeaderSize, 0);
+    size_t start = 0;
+    while (start < dotted.size())
+    {
+        size_t end = dotted.find('.', start);
+        if (end == std::string::npos)
+        {
+            end = dotted.size();
+        }
+        packet.push_back(static_cast<uint8_t>(end - start));
+        packet.insert(packet.end(), dotted.begin() + start, dotted.begin() + end);
+        start = end + 1;
+    }
+    packet.push_back(0);
+    return packet;
+}
+
+void benchNameParse(const std::string& name, const std::vector<uint8_t>& packet, size_t offset,
+    bool expand)
+{
+    std::string text;
+    runBench(name, 1, [&]
+    {
+        mdns::NameView view;
+        mdns::ParseError error = mdns::NameView::parse(packet.data(), packet.size(), offset, view);
+        if (expand && error == mdns::ParseError::None)
+        {
+            text.clear();
+            view.appendTo(text);
+            g_sink += text.size();
+        }
+        g_sink += view.labelCount() + static_cast<size_t>(error);
+    });
+}
+
+void benchNames()
+{
+    std::vector<uint8_t> flat = makeFlatName("Living Room TV._leboremote._tcp.local");
+    benchNameParse("name/flat", flat, mdns::kHeaderSize, false);
+    benchNameParse("name/flat+toString", flat, mdns::kHeaderSize, true);
+
+    const size_t depths[] = { 1, 4, mdns::kMaxPointerJumps };
+    for (size_t depth : depths)
+    {
+        size_t offset = 0;
+        std::vector<uint8_t> chain = makePointerChain(depth, offset);
+        std::string name = "name/chain-" + std::to_string(depth);
+        benchNameParse(name, chain, offset, false);
+        benchNameParse(name + "+toString", chain, offset, true);
+    }
+
+    // 超过跳转上限和指向自身的指针都应尽早拒绝
+    size_t offset = 0;
+    std::vector<uint8_t> tooDeep = makePointerChain(mdns::kMaxPointerJumps + 1, offset);
+    benchNameParse("name/chain-over-limit", tooDeep, offset, false);
+
+    std::vector<uint8_t> loop(mdns::kHeaderSize, 0);
+    loop.push_back(0xC0);
+    loop.push_back(static_cast<uint8_t>(mdns::kHeaderSize));
+    benchNameParse("name/pointer-loop", loop, mdns::kHeaderSize, false);
+}
+
+// ---------------------------------------------------------------------------
+// txt/*
+
+/// 取出报文中第一条 TXT 记录的数据
+std::string findTxt(const bench::CorpusPacket& packet)
+{
+    mdns::PacketReader reader(packet.data, packet.size);
+    mdns::Header header;
+    if (!reader.readHeader(header))
+    {
+        return std::string();
+    }
+    for (uint16_t i = 0; i < header.qdcount; i++)
+    {
+        mdns::Question question;
+        if (!reader.readQuestion(question))
+        {
+            return std::string();
+        }
+    }
+    mdns::Record record;
+    while (reader.readRecord(record))
+    {
+        if (record.type == mdns::kTypeTXT)
+        {
+            return std::string(reinterpret_cast<const char*>(record.rdata), record.rdlength);
+        }
+    }
+    return std::string();
+}
+
+/// 与 DeviceDiscovery 中的 parseTXT() 相同: 同一个键只保留第一次出现的值
+void parseTxt(const std::string& rdata, std::map<std::string, std::string>& out)
+{
+    mdns::TxtReader txt(reinterpret_cast<const uint8_t*>(rdata.data()), rdata.size());
+    mdns::StrRef key, value;
+    bool hasValue = false;
+    while (txt.next(key, value, hasValue))
+    {
+        if (hasValue && !key.empty())
+        {
+            out.insert(std::make_pair(key.str(), value.str()));
+        }
+    }
+}
+
+void benchTxt()
+{
+    for (size_t i = 0; i < bench::kCorpusSize; i++)
+    {
+        std::string rdata = findTxt(bench::kCorpus[i]);
+        if (rdata.empty())
+        {
+            continue;
+        }
+        std::string suffix = bench::kCorpus[i].name;
+        runBench("txt/iterate-" + suffix, 1, [&]
+        {
+            mdns::TxtReader txt(reinterpret_cast<const uint8_t*>(rdata.data()), rdata.size());
+            mdns::StrRef key, value;
+            bool hasValue = false;
+            while (txt.next(key, value, hasValue))
+            {
+                g_sink += key.size() + value.size();
+            }
+        });
+        runBench("txt/map-" + suffix, 1, [&]
+        {
+            std::map<std::string, std::string> map;
+            parseTxt(rdata, map);
+            g_sink += map.size();
+        });
+    }
+}
+
+// ---------------------------------------------------------------------------
+// response/*
+
+/**
+ * @brief parseMDNSResponse 的解析和缓存步骤
+ * @details 与 DeviceDiscovery 接收线程使用相同的模块和顺序，状态在报文之间保留，
+ * 记录缓存在第一轮之后处于稳定状态(后续报文都是刷新)
+ */
+class ResponsePipeline {
+public:
+    ResponsePipeline()
+    {
+        const char* services[] = {
+            "_leboremote._tcp.local", "_airplay._tcp.local", "_googlecast._tcp.local", "_ipp._tcp.local"
+        };
+        for (uint32_t i = 0; i < sizeof(services) / sizeof(services[0]); i++)
+        {
+            matcher_.add(mdns::StrRef(services[i]), i);
+        }
+    }
+
+    /// 处理一个报文，返回处理的记录数，0 表示报文无效或是查询
+    size_t process(const uint8_t* data, size_t size)
+    {
+        mdns::PacketReader reader(data, size);
+        mdns::Header header;
+        if (!reader.readHeader(header) || !header.isResponse())
+        {
+            return 0;
+        }
+        for (uint16_t i = 0; i < header.qdcount; i++)
+        {
+            mdns::Question question;
+            if (!reader.readQuestion(question))
+            {
+                return 0;
+            }
+        }
+
+        records_.clear();
+        uint32_t total = static_cast<uint32_t>(header.ancount) + header.nscount + header.arcount;
+        for (uint32_t i = 0; i < total; i++)
+        {
+            mdns::Record record;
+            if (!reader.readRecord(record))
+            {
+                break;
+            }
+            records_.push_back(record);
+        }
+
+        mdns::RecordCache::Clock::time_point now = mdns::RecordCache::Clock::now();
+        for (const auto& record : records_)
+        {
+            mdns::ServiceMatcher::Match match;
+            if (!matcher_.match(record.name, match) || (match.exact && record.type != mdns::kTypePTR))
+            {
+                continue;
+            }
+            if (!mdns::RecordCache::decode(reader, record, cached_))
+            {
+                continue;
+            }
+            cache_.insert(cached_, record.cacheFlush(), now);
+            if (record.type == mdns::kTypeSRV && record.ttl != 0)
+            {
+                hosts_.insert(lower(cached_.target));
+            }
+            if (record.type == mdns::kTypeTXT && record.ttl != 0)
+            {
+                txt_.clear();
+                parseTxt(cached_.rdata, txt_);
+            }
+        }
+
+        for (const auto& record : records_)
+        {
+            if ((record.type != mdns::kTypeA && record.type != mdns::kTypeAAAA) || hosts_.empty())
+            {
+                continue;
+            }
+            if (hosts_.find(lower(record.name.toString())) == hosts_.end())
+            {
+                continue;
+            }
+            if (mdns::RecordCache::decode(reader, record, cached_))
+            {
+                cache_.insert(cached_, record.cacheFlush(), now);
+            }
+        }
+        return records_.size();
+    }
+
+    size_t cacheSize() const { return cache_.size(); }
+
+private:
+    static std::string lower(std::string name)
+    {
+        for (auto& c : name)
+        {
+            c = mdns::asciiLower(c);
+        }
+        return name;
+    }
+
+    mdns::ServiceMatcher matcher_;
+    mdns::RecordCache cache_;
+    mdns::CachedRecord cached_;
+    std::vector<mdns::Record> records_;
+    std::unordered_set<std::string> hosts_;
+    std::map<std::string, std::string> txt_;
+};
+
+void benchResponses()
+{
+    for (size_t i = 0; i < bench::kCorpusSize; i++)
+    {
+        const bench::CorpusPacket& packet = bench::kCorpus[i];
+        ResponsePipeline pipeline;
+        runBench(std::string("response/") + packet.name, 1, [&]
+        {
+            g_sink += pipeline.process(packet.data, packet.size);
+        });
+    }
+
+    ResponsePipeline pipeline;
+    runBench("response/corpus", bench::kCorpusSize, [&]
+    {
+        for (size_t i = 0; i < bench::kCorpusSize; i++)
+        {
+            g_sink += pipeline.process(bench::kCorpus[i].data, bench::kCorpus[i].size);
+        }
+    });
+}
+
+// ---------------------------------------------------------------------------
+// table/*
+
+/// 设备表中的元素，与 DeviceRecordPtr 一样通过共享指针保存
+struct BenchDevice {
+    std::string name;
+    uint16_t port;
+};
+typedef std::shared_ptr<const BenchDevice> BenchDevicePtr;
+
+struct BenchDeviceNameOf {
+    mdns::StrRef operator()(const BenchDevicePtr& device) const { return mdns::StrRef(device->name); }
+};
+typedef mdns::DeviceIndex<BenchDevicePtr, BenchDeviceNameOf> BenchTable;
+
+void benchTable(size_t count)
+{
+    std::vector<BenchDevicePtr> devices;
+    std::vector<std::string> missing;
+    devices.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        BenchDevice device;
+        device.name = "Device-" + std::to_string(i * 2654435761u % 1000003) + "-" +
+            std::to_string(i) + "._leboremote._tcp.local";
+        device.port = static_cast<uint16_t>(i);
+        devices.push_back(std::make_shared<const BenchDevice>(device));
+        missing.push_back("Missing-" + std::to_string(i) + "._leboremote._tcp.local");
+    }
+    std::string suffix = std::to_string(count);
+
+    // 表在 setup 中清空，插入时的扩容计入结果
+    BenchTable table;
+    runBench("table/insert-" + suffix, count, [&]
+    {
+        for (const auto& device : devices)
+        {
+            g_sink += table.insert(device).first;
+        }
+    }, [&] { table.clear(); });
+
+    table.clear();
+    for (const auto& device : devices)
+    {
+        table.insert(device);
+    }
+    runBench("table/find-hit-" + suffix, count, [&]
+    {
+        for (const auto& device : devices)
+        {
+            g_sink += table.find(mdns::StrRef(device->name));
+        }
+    });
+    runBench("table/find-miss-" + suffix, count, [&]
+    {
+        for (const auto& name : missing)
+        {
+            g_sink += table.find(mdns::StrRef(name));
+        }
+    });
+    // 全部设备依次离线(例如网络切换后一起到期)，最后读取一次 values() 计入压缩
+    runBench("table/erase-" + suffix, count, [&]
+    {
+        for (const auto& device : devices)
+        {
+            g_sink += table.erase(mdns::StrRef(device->name));
+        }
+        g_sink += table.values().size();
+    }, [&]
+    {
+        table.clear();
+        for (const auto& device : devices)
+        {
+            table.insert(device);
+        }
+    });
+
+    table.clear();
+    for (const auto& device : devices)
+    {
+        table.insert(device);
+    }
+    // 快照发布时复制整个设备指针数组
+    runBench("table/snapshot-" + suffix, 1, [&]
+    {
+        std::vector<BenchDevicePtr> snapshot = table.values();
+        g_sink += snapshot.size();
+    });
+}
+
+// ---------------------------------------------------------------------------
+// replay/...
+
+/**
+ * @brief 全速回放一组报文
+ * @details 每轮新建 DeviceDiscovery，写入报文后关闭来源，等待全部处理完毕
+ *
+ * @param packets 报文总数，按顺序循环使用 corpus 中的应答
+ * @param distinct 为 true 时每个报文都是不同实例和主机的通告，最多 676 个
+ */
+void benchReplay(const std::string& name, size_t packets, bool distinct)
+{
+    typedef DeviceDiscovery::PacketSource::Packet Packet;
+    // 预先生成报文，避免计入复制
+    std::vector<std::vector<uint8_t>> data;
+    const bench::CorpusPacket& announce = bench::kCorpus[0];
+    // 改写实例名 "Living Room TV" 和主机名 "LeboTV-3F2A" 各自的最后两个字节
+    size_t offsets[2];
+    const char* labels[2] = { "Living Room TV", "LeboTV-3F2A" };
+    for (size_t i = 0; i < 2; i++)
+    {
+        size_t length = std::strlen(labels[i]);
+        const uint8_t* position = std::search(announce.data, announce.data + announce.size,
+            labels[i], labels[i] + length);
+        offsets[i] = static_cast<size_t>(position - announce.data) + length - 2;
+    }
+    for (size_t i = 0; i < packets; i++)
+    {
+        const bench::CorpusPacket& packet = distinct ? announce : bench::kCorpus[i % bench::kCorpusSize];
+        data.push_back(std::vector<uint8_t>(packet.data, packet.data + packet.size));
+        for (size_t j = 0; distinct && j < 2; j++)
+        {
+            data.back()[offsets[j]] = static_cast<uint8_t>('A' + i % 26);
+            data.back()[offsets[j] + 1] = static_cast<uint8_t>('A' + i / 26 % 26);
+        }
+    }
+
+    size_t devices = 0;
+    runBench(name, packets, [&]
+    {
+        DeviceDiscovery discovery;
+        std::shared_ptr<DeviceDiscovery::MemoryPacketSource> source =
+            std::make_shared<DeviceDiscovery::MemoryPacketSource>();
+        discovery.setPacketSource(source);
+        for (const auto& bytes : data)
+        {
+            Packet packet;
+            packet.data = bytes.data();
+            packet.size = bytes.size();
+            packet.sender.family = DeviceDiscovery::IpAddress::Family::IPv4;
+            packet.sender.bytes[0] = 192;
+            packet.sender.bytes[1] = 168;
+            packet.sender.bytes[3] = 23;
+            source->push(packet);
+        }
+        source->close();
+        auto onFound = [&devices](const DeviceDiscovery::DeviceInfo&) { devices++; };
+        discovery.subscribe("_leboremote._tcp.local", onFound);
+        discovery.subscribe("_airplay._tcp.local", onFound);
+        discovery.subscribe("_googlecast._tcp.local", onFound);
+        discovery.subscribe("_ipp._tcp.local", onFound);
+        discovery.waitForReplay();
+        discovery.stopDiscovery();
+    });
+    g_sink += devices;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        if (std::strncmp(arg, "--min-time=", 11) == 0)
+        {
+            g_options.minTimeMs = std::atof(arg + 11);
+        }
+        else if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+        {
+            std::printf("Usage: %s [filter] [--min-time=ms]\n", argv[0]);
+            return 0;
+        }
+        else
+        {
+            g_options.filter = arg;
+        }
+    }
+
+    // 回放基准中 DeviceDiscovery 的日志只影响耗时，不输出
+    Logger::getInstance().setLevel(LogLevel::LOG_ERROR);
+
+    std::printf("%-36s %12s %12s %12s %12s\n", "benchmark", "ns/op", "allocs/op", "bytes/op", "iterations");
+    benchNames();
+    benchTxt();
+    benchResponses();
+    const size_t sizes[] = { 10, 1000, 100000 };
+    for (size_t count : sizes)
+    {
+        benchTable(count);
+    }
+    benchReplay("replay/corpus-20k", 20000, false);
+    benchReplay("replay/distinct-676", 676, true);
+    return 0;
+}
@@ -0,0 +1,1017 @@
+/**
+ * @file mdns_loadgen.cpp
+ * @brief 设备发现的负载生成器和端到端扩展性基准
+ * @details 在本机模拟 N 个响应方(100、1k、10k)，测量 DeviceDiscovery 在真实套接字上的表现:
+ *  - 每个虚拟设备是一个 mdns::Responder(与 startBroadcast() 相同的协议实现)，
+ *    按 --ramp 错开启动，完成探测和宣告后才启动发现，模拟设备已经在网络上的冷启动
+ *  - 响应方的报文从 127.10.x.y:5353 单播发往发现套接字(默认 127.0.0.1:5353)，
+ *    多个虚拟设备共用 --sources 个来源地址；发现的多播查询从回环收到后只解析一次，
+ *    按名称索引交给相关的响应方，已知答案抑制、应答延迟和重复应答抑制与真实设备相同
+ *  - 全部发现后进入 --duration 秒的变化阶段，每秒按 --churn 次更新 TXT 记录，
+ *    新的 TXT 带发送时间，用于测量从更新到设备事件回调的延迟
+ *
+ * 每种发现方式(单线程、解析流水线，各自开启或关闭已知答案)输出一行:
+ *  - discover: 从启动发现到全部设备出现在设备表中的时间(毫秒)，超时为 "-"
+ *  - rx/cpu: 发现套接字收到的报文数，及发现线程平均每个报文的 CPU 时间(进程 CPU 时间减去负载线程)
+ *  - drops: 内核(socketDrops)、流水线(pipelineDrops)、限速(rateLimited)丢弃的报文数，
+ *    以及三者合计占负载发送报文的比例
+ *  - cb: DiscoveryStats::callbackLatency 的 p50/p99(回调执行时间，微秒)
+ *  - txt: TXT 更新到 Updated 事件的 p50/p99(微秒) 和收到的更新数/发送的更新数
+ *
+ * 负载线程与发现在同一进程中运行，机器的核数较少时两者互相争用 CPU。
+ * 来源地址远少于设备数，默认关闭按来源限速(--source-rate=0)，否则测到的主要是限速。
+ *
+ * 用法: mdns_loadgen [模式子串] [--devices=100,1000] [--txt-size=字节] [--churn=次每秒]
+ *       [--duration=秒] [--ramp=毫秒] [--sources=个数] [--workers=个数] [--source-rate=报文每秒]
+ *       [--rcvbuf=字节] [--timeout=秒] [--target=地址]
+ */
+
+#include "device_discovery.h"
+#include "logger.h"
+#include "datagram_batch.h"
+#include "device_index.h"
+#include "network_interfaces.h"
+#include "poller.h"
+#include "responder.h"
+#include "socket_platform.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <time.h>
+#endif
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+const char* const kServiceType = "_leboremote._tcp.local";
+const char* const kServicesName = "_services._dns-sd._udp.local";
+const char* const kMdnsGroup = "224.0.0.251";
+const uint16_t kMdnsPort = 5353;
+const uint32_t kPtrTtl = 4500;  ///< Responder 的服务类型 PTR 记录的 TTL(秒)
+
+struct Options {
+    std::string filter;
+    std::vector<size_t> devices{ 100, 1000 };
+    size_t txtSize = 64;
+    uint32_t churn = 100;
+    uint32_t durationS = 5;
+    uint32_t rampMs = 1000;
+    size_t sources = 64;
+    size_t workers = 4;
+    uint32_t sourceRate = 0;
+    int rcvbuf = 0;
+    uint32_t timeoutS = 30;
+    std::string target = "127.0.0.1";
+};
+
+Options g_options;
+
+/// 发现方式
+struct Mode {
+    const char* name;
+    size_t workers;     ///< 0 表示在接收线程中解析
+    bool knownAnswers;
+};
+
+int64_t nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now().time_since_epoch()).count();
+}
+
+#ifdef _WIN32
+uint64_t fileTimeUs(const FILETIME& time)
+{
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return value.QuadPart / 10;
+}
+#else
+uint64_t clockUs(clockid_t clock)
+{
+    struct timespec ts;
+    if (clock_gettime(clock, &ts) != 0)
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+/// 进程的 CPU 时间(用户态加内核态，微秒)
+uint64_t processCpuUs()
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    {
+        return 0;
+    }
+    return fileTimeUs(kernel) + fileTimeUs(user);
+#else
+    return clockUs(CLOCK_PROCESS_CPUTIME_ID);
+#endif
+}
+
+/// 线程的 CPU 时间(微秒)，可以在其他线程中读取
+uint64_t threadCpuUs(std::thread& thread)
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(static_cast<HANDLE>(thread.native_handle()), &creation, &exit, &kernel, &user))
+    {
+        return 0;
+    }
+    return fileTimeUs(kernel) + fileTimeUs(user);
+#else
+    clockid_t clock;
+    if (pthread_getcpuclockid(thread.native_handle(), &clock) != 0)
+    {
+        return 0;
+    }
+    return clockUs(clock);
+#endif
+}
+
+/// 已排序样本的分位数
+uint64_t percentile(const std::vector<uint64_t>& sorted, double q)
+{
+    if (sorted.empty())
+    {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+/**
+ * @brief 虚拟响应方集合
+ * @details 所有响应方在一个负载线程中驱动: 按 ramp 启动、到期时 poll() 并发送输出的报文、
+ * 把收到的查询交给相关的响应方。报文在 poll() 之后立即发送，
+ * Responder::Packet 指向的缓存在下一次调用同一个响应方之前有效。
+ *
+ * 每次调用响应方后按 nextDeadline() 把它放入最小堆，只 poll() 到期的响应方；
+ * 堆中到期时间与 armed_ 不同的项已过期，取出时跳过。收到的报文由 route() 解析一次，
+ * 只交给名称相关、且未被已知答案抑制的响应方，已知答案不再由每个响应方各自解析比较
+ */
+class LoadGenerator {
+public:
+    struct Config {
+        size_t devices = 0;
+        size_t txtSize = 0;
+        uint32_t rampMs = 0;
+        size_t sources = 1;
+        uint32_t target = 0;  ///< 发现套接字的地址，网络字节序
+    };
+
+    ~LoadGenerator() { stop(); }
+
+    /**
+     * @brief 打开套接字并启动负载线程
+     * @return false 套接字创建、绑定或加入多播组失败，或 TXT 记录过长
+     */
+    bool start(const Config& config)
+    {
+        config_ = config;
+        config_.sources = std::max<size_t>(std::min<size_t>(config_.sources, 250 * 250), 1);
+        if (!openQuerySocket() || !openSendSockets())
+        {
+            return false;
+        }
+
+        // 应答报文要容纳 TXT 记录和实例的其他记录，回环接口的 MTU 足够大
+        size_t maxPacketSize = std::max<size_t>(1472, config_.txtSize + 512);
+        responders_.clear();
+        responders_.reserve(config_.devices);
+        for (size_t i = 0; i < config_.devices; i++)
+        {
+            responders_.emplace_back(new mdns::Responder(maxPacketSize));
+        }
+        std::string rdata;
+        if (!mdns::Responder::encodeTxt(txtFor(0, 0), rdata) || rdata.size() + 512 > maxPacketSize)
+        {
+            std::fprintf(stderr, "TXT records of %zu bytes are not supported\n", config_.txtSize);
+            return false;
+        }
+
+        names_ = NameIndex();
+        armed_.assign(config_.devices, Clock::time_point::max());
+        isEstablished_.assign(config_.devices, 0);
+        selected_.assign(config_.devices, 0);
+        suppressed_.assign(config_.devices, 0);
+        stamp_ = 0;
+        established_ = 0;
+        timers_ = TimerQueue();
+
+        running_ = true;
+        thread_ = std::thread([this]() { run(); });
+        return true;
+    }
+
+    void stop()
+    {
+        if (thread_.joinable())
+        {
+            running_ = false;
+            poller_.wakeup();
+            thread_.join();
+        }
+        if (querySocket_ != INVALID_SOCKET)
+        {
+            poller_.remove(querySocket_);
+            closesocket(querySocket_);
+            querySocket_ = INVALID_SOCKET;
+        }
+        for (SOCKET sock : sendSockets_)
+        {
+            closesocket(sock);
+        }
+        sendSockets_.clear();
+    }
+
+    /// 等待全部响应方完成探测和宣告
+    bool waitEstablished(uint32_t timeoutMs)
+    {
+        Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(timeoutMs);
+        while (established_.load() < config_.devices)
+        {
+            if (Clock::now() >= deadline)
+            {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+    }
+
+    /// 每秒更新 TXT 记录的次数，按设备轮流更新，0 表示停止
+    void setChurn(uint32_t perSecond)
+    {
+        churn_ = perSecond;
+        poller_.wakeup();
+    }
+
+    uint64_t packetsSent() const { return packetsSent_.load(); }
+    uint64_t sendErrors() const { return sendErrors_.load(); }
+    uint64_t churnSent() const { return churnSent_.load(); }
+
+    uint64_t cpuUs() { return thread_.joinable() ? threadCpuUs(thread_) : 0; }
+
+private:
+    /// 第 i 个设备的 TXT 记录，stampUs 不为 0 时附带更新时间
+    std::map<std::string, std::string> txtFor(size_t i, int64_t stampUs) const
+    {
+        std::map<std::string, std::string> txt;
+        char uid[24];
+        std::snprintf(uid, sizeof(uid), "1%013zu", i);
+        txt["u"] = uid;
+        txt["a"] = "10658";
+        if (config_.txtSize > 0)
+        {
+            txt["p"] = std::string(config_.txtSize, 'x');
+        }
+        if (stampUs != 0)
+        {
+            txt["t"] = std::to_string(stampUs);
+        }
+        return txt;
+    }
+
+    mdns::Responder::Service serviceFor(size_t i) const
+    {
+        mdns::Responder::Service service;
+        service.name = "LoadGen-" + std::to_string(i);
+        service.serviceType = kServiceType;
+        service.host = "loadgen-" + std::to_string(i) + ".local";
+        service.port = static_cast<uint16_t>(50000 + i % 10000);
+        service.txtRecords = txtFor(i, 0);
+        // 10.x.y.z，每个设备一个地址
+        uint32_t address = (10u << 24) | static_cast<uint32_t>(i + 1);
+        service.addresses.push_back(htonl(address));
+        return service;
+    }
+
+    static sockaddr_in makeAddress(uint32_t address, uint16_t port)
+    {
+        sockaddr_in addr;
+        std::memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = address;
+        addr.sin_port = htons(port);
+        return addr;
+    }
+
+    static SOCKET openReusable()
+    {
+        SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock == INVALID_SOCKET)
+        {
+            return INVALID_SOCKET;
+        }
+        int reuse = 1;
+        if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, (char*)&reuse, sizeof(reuse)) < 0)
+        {
+            closesocket(sock);
+            return INVALID_SOCKET;
+        }
+        return sock;
+    }
+
+    /**
+     * @brief 接收发现发出的多播查询
+     * @details 查询在每个多播接口上发送并回环，因此在这些接口上加入多播组。
+     * 套接字绑定到多播地址而不是任意地址，发往发现套接字的单播应答不会被本套接字收到
+     * (Windows 不能绑定多播地址，只能绑定任意地址)
+     */
+    bool openQuerySocket()
+    {
+        querySocket_ = openReusable();
+        if (querySocket_ == INVALID_SOCKET)
+        {
+            std::fprintf(stderr, "Failed to create query socket\n");
+            return false;
+        }
+#ifdef _WIN32
+        sockaddr_in local = makeAddress(INADDR_ANY, kMdnsPort);
+#else
+        sockaddr_in local = makeAddress(inet_addr(kMdnsGroup), kMdnsPort);
+#endif
+        if (bind(querySocket_, (struct sockaddr*)&local, sizeof(local)) < 0)
+        {
+            std::fprintf(stderr, "Failed to bind query socket: %s\n",
+                mdns::socketErrorString(mdns::lastSocketError()).c_str());
+            return false;
+        }
+
+        std::vector<mdns::NetworkInterface> interfaces;
+        mdns::listInterfaces(interfaces);
+        std::vector<uint32_t> locals;
+        for (const auto& iface : interfaces)
+        {
+            if (!iface.ipv4.empty())
+            {
+                locals.push_back(iface.ipv4.front());
+            }
+        }
+        if (locals.empty())
+        {
+            locals.push_back(htonl(INADDR_ANY));
+        }
+        bool joined = false;
+        for (uint32_t address : locals)
+        {
+            struct ip_mreq mreq;
+            mreq.imr_multiaddr.s_addr = inet_addr(kMdnsGroup);
+            mreq.imr_interface.s_addr = address;
+            joined |= setsockopt(querySocket_, IPPROTO_IP, IP_ADD_MEMBERSHIP,
+                (char*)&mreq, sizeof(mreq)) == 0;
+        }
+        if (!joined || !mdns::setNonBlocking(querySocket_) || !poller_.valid() ||
+            !poller_.add(querySocket_))
+        {
+            std::fprintf(stderr, "Failed to join the mDNS group\n");
+            return false;
+        }
+        return true;
+    }
+
+    /// 每个来源地址 127.10.x.y 一个套接字，绑定 5353 端口(发现只接受来源端口为 5353 的应答)
+    bool openSendSockets()
+    {
+        for (size_t i = 0; i < config_.sources; i++)
+        {
+            SOCKET sock = openReusable();
+            uint32_t address = (127u << 24) | (10u << 16) |
+                static_cast<uint32_t>((i / 250) << 8) | static_cast<uint32_t>(i % 250 + 1);
+            sockaddr_in local = makeAddress(htonl(address), kMdnsPort);
+            if (sock == INVALID_SOCKET || bind(sock, (struct sockaddr*)&local, sizeof(local)) < 0)
+            {
+                std::fprintf(stderr, "Failed to bind source socket %zu: %s\n", i,
+                    mdns::socketErrorString(mdns::lastSocketError()).c_str());
+                if (sock != INVALID_SOCKET)
+                {
+                    closesocket(sock);
+                }
+                return false;
+            }
+            sendSockets_.push_back(sock);
+        }
+        return true;
+    }
+
+    void send(size_t device, const std::vector<mdns::Responder::Packet>& packets)
+    {
+        SOCKET sock = sendSockets_[device % sendSockets_.size()];
+        sockaddr_in target = makeAddress(config_.target, kMdnsPort);
+        for (const auto& packet : packets)
+        {
+            // 多播和单播应答都发往发现套接字
+            if (sendto(sock, (const char*)packet.data->data(), static_cast<int>(packet.data->size()), 0,
+                (struct sockaddr*)&target, sizeof(target)) < 0)
+            {
+                sendErrors_++;
+            }
+            else
+            {
+                packetsSent_++;
+            }
+        }
+    }
+
+    /// 启动第 i 个响应方，并把实例名和主机名加入名称索引(负载中的名称互不相同，不会因冲突改名)
+    void startResponder(size_t i, Clock::time_point now)
+    {
+        mdns::Responder& responder = *responders_[i];
+        responder.start(serviceFor(i), now);
+        names_.insert(NameEntry{ responder.instanceName(), i });
+        names_.insert(NameEntry{ responder.service().host, i });
+        rearm(i);
+    }
+
+    /// 调用响应方之后按新的 nextDeadline() 重新放入堆，并更新完成宣告的设备数
+    void rearm(size_t i)
+    {
+        mdns::Responder& responder = *responders_[i];
+        Clock::time_point due = responder.nextDeadline();
+        if (due != armed_[i])
+        {
+            armed_[i] = due;
+            if (due != Clock::time_point::max())
+            {
+                timers_.push(Timer{ due, i });
+            }
+        }
+        uint8_t established = responder.state() == mdns::Responder::State::Established;
+        if (established != isEstablished_[i])
+        {
+            isEstablished_[i] = established;
+            if (established)
+            {
+                established_++;
+            }
+            else
+            {
+                established_--;
+            }
+        }
+    }
+
+    /// 报文中的名称对应的响应方，不是本负载的名称时返回 npos
+    size_t lookup(const mdns::NameView& name) const
+    {
+        char text[mdns::kMaxNameLength + 1];
+        size_t length = name.copyTo(text, sizeof(text));
+        size_t pos = length ? names_.find(mdns::StrRef(text, length)) : NameIndex::npos;
+        return pos == NameIndex::npos ? NameIndex::npos : names_.at(pos).responder;
+    }
+
+    void select(size_t i, std::vector<size_t>& targets)
+    {
+        if (i != NameIndex::npos && selected_[i] != stamp_)
+        {
+            selected_[i] = stamp_;
+            targets.push_back(i);
+        }
+    }
+
+    /**
+     * @brief 解析一次报文，找出需要处理它的响应方
+     * @details 问题和记录的名称(以及服务类型 PTR 记录指向的实例)按名称索引查找实例和主机。
+     * 服务类型或服务枚举的查询涉及所有已启动的响应方，但已知答案中有该实例的 PTR 记录、
+     * 剩余 TTL 不少于一半时响应方不会应答，不再交给它(名称同时出现在其他问题中的除外)。
+     * 报文格式错误时交给所有已启动的响应方，由它们自行处理
+     *
+     * @param started 已启动的响应方数
+     * @param targets 输出响应方下标
+     */
+    void route(const uint8_t* data, size_t size, size_t started, std::vector<size_t>& targets)
+    {
+        targets.clear();
+        stamp_++;
+        mdns::PacketReader reader(data, size);
+        mdns::Header header;
+        if (!reader.readHeader(header))
+        {
+            return;
+        }
+        bool query = !header.isResponse();
+        bool all = false;
+        bool valid = true;
+        for (uint16_t i = 0; i < header.qdcount && valid; i++)
+        {
+            mdns::Question question;
+            valid = reader.readQuestion(question);
+            if (!valid || !query)
+            {
+                continue;
+            }
+            if (question.name.equals(mdns::StrRef(kServiceType)) ||
+                question.name.equals(mdns::StrRef(kServicesName)))
+            {
+                all = all || question.type == mdns::kTypePTR || question.type == mdns::kTypeANY;
+            }
+            else
+            {
+                select(lookup(question.name), targets);
+            }
+        }
+
+        uint32_t total = static_cast<uint32_t>(header.ancount) + header.nscount + header.arcount;
+        for (uint32_t i = 0; i < total && valid; i++)
+        {
+            mdns::Record record;
+            valid = reader.readRecord(record);
+            if (!valid)
+            {
+                continue;
+            }
+            if (!record.name.equals(mdns::StrRef(kServiceType)))
+            {
+                // 服务枚举的应答可能抑制所有响应方等待发送的应答
+                all = all || (!query && record.name.equals(mdns::StrRef(kServicesName)));
+                select(lookup(record.name), targets);
+                continue;
+            }
+            mdns::NameView instance;
+            if (record.type != mdns::kTypePTR || !reader.readPtr(record, instance))
+            {
+                continue;
+            }
+            size_t responder = lookup(instance);
+            if (query && header.qdcount > 0 && i < header.ancount &&
+                record.recordClass() == mdns::kClassIN &&
+                static_cast<uint64_t>(record.ttl) * 2 >= kPtrTtl)
+            {
+                if (responder != NameIndex::npos)
+                {
+                    suppressed_[responder] = stamp_;
+                }
+            }
+            else
+            {
+                select(responder, targets);
+            }
+        }
+
+        if (!valid || all)
+        {
+            for (size_t i = 0; i < started; i++)
+            {
+                if (!valid || suppressed_[i] != stamp_)
+                {
+                    select(i, targets);
+                }
+            }
+        }
+    }
+
+    void run()
+    {
+        mdns::DatagramBatch batch(64, 9000);
+        std::vector<SOCKET> ready;
+        std::vector<mdns::Responder::Packet> outgoing;
+        std::vector<size_t> targets;
+        Clock::time_point begin = Clock::now();
+        size_t devices = responders_.size();
+        // 第 i 个设备的启动时间
+        auto startTime = [&](size_t i)
+        {
+            return begin + std::chrono::microseconds(
+                static_cast<int64_t>(config_.rampMs) * 1000 * static_cast<int64_t>(i) /
+                static_cast<int64_t>(devices));
+        };
+        size_t started = 0;
+        size_t nextChurnDevice = 0;
+        Clock::time_point nextChurn = Clock::time_point::max();
+
+        while (running_)
+        {
+            Clock::time_point now = Clock::now();
+            while (started < devices && startTime(started) <= now)
+            {
+                startResponder(started, now);
+                started++;
+            }
+
+            uint32_t churn = churn_.load();
+            if (churn == 0)
+            {
+                nextChurn = Clock::time_point::max();
+            }
+            else if (nextChurn == Clock::time_point::max())
+            {
+                nextChurn = now;
+            }
+            Clock::duration churnInterval = churn ? std::chrono::duration_cast<Clock::duration>(
+                std::chrono::seconds(1)) / churn : Clock::duration::zero();
+            while (nextChurn <= now)
+            {
+                size_t device = nextChurnDevice++ % devices;
+                mdns::Responder& responder = *responders_[device];
+                if (responder.state() == mdns::Responder::State::Established &&
+                    responder.setTxt(txtFor(device, nowUs()), now))
+                {
+                    churnSent_++;
+                    rearm(device);
+                }
+                nextChurn += churnInterval;
+            }
+
+            Clock::time_point next = started < devices ? startTime(started) :
+                Clock::time_point::max();
+            next = std::min(next, nextChurn);
+            while (!timers_.empty() && timers_.top().due <= now)
+            {
+                Timer timer = timers_.top();
+                timers_.pop();
+                if (armed_[timer.responder] != timer.due)
+                {
+                    continue;
+                }
+                armed_[timer.responder] = Clock::time_point::max();
+                outgoing.clear();
+                responders_[timer.responder]->poll(now, outgoing);
+                send(timer.responder, outgoing);
+                rearm(timer.responder);
+            }
+            if (!timers_.empty())
+            {
+                next = std::min(next, timers_.top().due);
+            }
+
+            // 最多等待 100 毫秒，及时响应 setChurn() 以外的状态变化
+            int timeoutMs = 100;
+            now = Clock::now();
+            if (next <= now)
+            {
+                timeoutMs = 0;
+            }
+            else if (next - now < std::chrono::milliseconds(timeoutMs))
+            {
+                timeoutMs = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                    next - now).count()) + 1;
+            }
+            if (poller_.wait(timeoutMs, ready) <= 0)
+            {
+                continue;
+            }
+            int count = batch.receive(querySocket_);
+            Clock::time_point received = Clock::now();
+            for (int i = 0; i < count; i++)
+            {
+                const sockaddr_in& sender = reinterpret_cast<const sockaddr_in&>(batch.sender(i));
+                route(batch.data(i), batch.size(i), started, targets);
+                for (size_t j : targets)
+                {
+                    responders_[j]->handlePacket(batch.data(i), batch.size(i),
+                        sender.sin_addr.s_addr, ntohs(sender.sin_port), received);
+                    rearm(j);
+                }
+            }
+        }
+    }
+
+    /// 名称索引的项，名称为响应方的实例名或主机名
+    struct NameEntry {
+        std::string name;
+        size_t responder = 0;
+    };
+    struct NameOf {
+        mdns::StrRef operator()(const NameEntry& entry) const { return entry.name; }
+    };
+    typedef mdns::DeviceIndex<NameEntry, NameOf> NameIndex;
+
+    struct Timer {
+        Clock::time_point due;
+        size_t responder;
+
+        bool operator>(const Timer& other) const { return due > other.due; }
+    };
+    typedef std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> TimerQueue;
+
+    Config config_;
+    // 以下成员在 start() 中初始化，之后只在负载线程中使用
+    std::vector<std::unique_ptr<mdns::Responder>> responders_;
+    NameIndex names_;
+    TimerQueue timers_;
+    std::vector<Clock::time_point> armed_;  ///< 每个响应方在堆中的有效到期时间，未调度为 max()
+    std::vector<uint8_t> isEstablished_;
+    std::vector<uint32_t> selected_;    ///< 等于 stamp_ 时已加入本次 route() 的输出
+    std::vector<uint32_t> suppressed_;  ///< 等于 stamp_ 时本次查询的 PTR 已知答案已抑制应答
+    uint32_t stamp_ = 0;
+    SOCKET querySocket_ = INVALID_SOCKET;
+    std::vector<SOCKET> sendSockets_;
+    mdns::Poller poller_;
+    std::thread thread_;
+    std::atomic<bool> running_{ false };
+    std::atomic<uint32_t> churn_{ 0 };
+    std::atomic<size_t> established_{ 0 };
+    std::atomic<uint64_t> packetsSent_{ 0 };
+    std::atomic<uint64_t> sendErrors_{ 0 };
+    std::atomic<uint64_t> churnSent_{ 0 };
+};
+
+/**
+ * @brief 发现一侧的回调统计，回调可能在多个线程中并发执行
+ */
+struct Observer {
+    std::mutex mutex;
+    std::condition_variable changed;
+    size_t found = 0;
+    std::vector<uint64_t> txtLatencyUs;
+
+    void onFound()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        found++;
+        changed.notify_all();
+    }
+
+    void onEvents(const std::vector<DeviceDiscovery::DeviceEvent>& events)
+    {
+        int64_t now = nowUs();
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& event : events)
+        {
+            if (event.type != DeviceDiscovery::DeviceEvent::Type::Updated)
+            {
+                continue;
+            }
+            auto stamp = event.txtChanged.find("t");
+            if (stamp == event.txtChanged.end())
+            {
+                stamp = event.txtAdded.find("t");
+                if (stamp == event.txtAdded.end())
+                {
+                    continue;
+                }
+            }
+            int64_t sent = std::atoll(stamp->second.c_str());
+            txtLatencyUs.push_back(static_cast<uint64_t>(std::max<int64_t>(now - sent, 0)));
+        }
+    }
+
+    /// 等待发现 count 个设备
+    bool waitFound(size_t count, Clock::time_point deadline)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        return changed.wait_until(lock, deadline, [&] { return found >= count; });
+    }
+};
+
+void runMode(const Mode& mode, size_t devices)
+{
+    DeviceDiscovery::PipelineOptions pipeline;
+    pipeline.workers = mode.workers;
+    DeviceDiscovery::ReceiveOptions receive;
+    receive.socketBufferSize = g_options.rcvbuf;
+    receive.sourceRate = g_options.sourceRate;
+    DeviceDiscovery::QueryOptions query;
+    query.knownAnswers = mode.knownAnswers;
+
+    DeviceDiscovery discovery;
+    Observer observer;
+    discovery.setPipelineOptions(pipeline);
+    discovery.setReceiveOptions(receive);
+    discovery.setQueryOptions(query);
+    discovery.setDeviceEventCallback([&observer](const std::vector<DeviceDiscovery::DeviceEvent>& events)
+    {
+        observer.onEvents(events);
+    });
+
+    LoadGenerator generator;
+    LoadGenerator::Config config;
+    config.devices = devices;
+    config.txtSize = g_options.txtSize;
+    config.rampMs = g_options.rampMs;
+    config.sources = g_options.sources;
+    config.target = inet_addr(g_options.target.c_str());
+    if (!generator.start(config) ||
+        !generator.waitEstablished(g_options.rampMs + g_options.timeoutS * 1000))
+    {
+        std::printf("%-8zu %-14s responders failed to start\n", devices, mode.name);
+        return;
+    }
+    // 同一记录 1 秒内只多播一次(RFC 6762 6.2)，刚宣告完的设备不会应答紧接着的第一次查询
+    std::this_thread::sleep_for(std::chrono::seconds(1));
+    uint64_t generatorCpuStart = generator.cpuUs();
+    uint64_t sentStart = generator.packetsSent();
+    uint64_t processStart = processCpuUs();
+
+    Clock::time_point begin = Clock::now();
+    if (!discovery.subscribe(kServiceType, [&observer](const DeviceDiscovery::DeviceInfo&)
+        {
+            observer.onFound();
+        }))
+    {
+        std::printf("%-8zu %-14s discovery failed to start\n", devices, mode.name);
+        return;
+    }
+    bool complete = observer.waitFound(devices, begin + std::chrono::seconds(g_options.timeoutS));
+    double discoverMs = std::chrono::duration<double, std::milli>(Clock::now() - begin).count();
+
+    generator.setChurn(g_options.churn);
+    std::this_thread::sleep_for(std::chrono::seconds(g_options.durationS));
+    generator.setChurn(0);
+    // 等待最后的更新到达
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    DeviceDiscovery::DiscoveryStats stats = discovery.getStats();
+    uint64_t cpuUs = processCpuUs() - processStart - (generator.cpuUs() - generatorCpuStart);
+    uint64_t sent = generator.packetsSent() - sentStart;
+    uint64_t churnSent = generator.churnSent();
+    discovery.stopDiscovery();
+    generator.stop();
+
+    std::vector<uint64_t> txt;
+    {
+        std::lock_guard<std::mutex> lock(observer.mutex);
+        txt = observer.txtLatencyUs;
+    }
+    std::sort(txt.begin(), txt.end());
+
+    uint64_t drops = stats.socketDrops + stats.pipelineDrops + stats.rateLimited;
+    char discover[32];
+    if (complete)
+    {
+        std::snprintf(discover, sizeof(discover), "%.0f", discoverMs);
+    }
+    else
+    {
+        std::snprintf(discover, sizeof(discover), "- (%zu)", observer.found);
+    }
+    std::printf("%-8zu %-14s %10s %9llu %8.2f %8llu %8llu %8llu %6.2f%% %7llu %7llu %8llu %8llu %6zu/%llu\n",
+        devices, mode.name, discover,
+        static_cast<unsigned long long>(stats.packetsReceived),
+        stats.packetsReceived ? static_cast<double>(cpuUs) / stats.packetsReceived : 0.0,
+        static_cast<unsigned long long>(stats.socketDrops),
+        static_cast<unsigned long long>(stats.pipelineDrops),
+        static_cast<unsigned long long>(stats.rateLimited),
+        sent ? 100.0 * drops / sent : 0.0,
+        static_cast<unsigned long long>(stats.callbackLatency.percentileUs(0.5)),
+        static_cast<unsigned long long>(stats.callbackLatency.percentileUs(0.99)),
+        static_cast<unsigned long long>(percentile(txt, 0.5)),
+        static_cast<unsigned long long>(percentile(txt, 0.99)),
+        txt.size(), static_cast<unsigned long long>(churnSent));
+    std::fflush(stdout);
+}
+
+std::vector<size_t> parseList(const char* text)
+{
+    std::vector<size_t> values;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        size_t value = static_cast<size_t>(std::strtoull(item.c_str(), nullptr, 10));
+        if (value > 0)
+        {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+bool parseOption(const char* arg, const char* name, const char*& value)
+{
+    size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0 || arg[length] != '=')
+    {
+        return false;
+    }
+    value = arg + length + 1;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        const char* value = nullptr;
+        if (parseOption(arg, "--devices", value))
+        {
+            g_options.devices = parseList(value);
+        }
+        else if (parseOption(arg, "--txt-size", value))
+        {
+            g_options.txtSize = static_cast<size_t>(std::atol(value));
+        }
+        else if (parseOption(arg, "--churn", value))
+        {
+            g_options.churn = static_cast<uint32_t>(std::atol(value));
+        }
+        else if (parseOption(arg, "--duration", value))
+        {
+            g_options.durationS = static_cast<uint32_t>(std::atol(value));
+        }
+        else if (parseOption(arg, "--ramp", value))
+        {
+            g_options.rampMs = static_cast<uint32_t>(std::atol(value));
+        }
+        else if (parseOption(arg, "--sources", value))
+        {
+            g_options.sources = static_cast<size_t>(std::atol(value));
+        }
+        else if (parseOption(arg, "--workers", value))
+        {
+            g_options.workers = std::max<size_t>(static_cast<size_t>(std::atol(value)), 1);
+        }
+        else if (parseOption(arg, "--source-rate", value))
+        {
+            g_options.sourceRate = static_cast<uint32_t>(std::atol(value));
+        }
+        else if (parseOption(arg, "--rcvbuf", value))
+        {
+            g_options.rcvbuf = std::atoi(value);
+        }
+        else if (parseOption(arg, "--timeout", value))
+        {
+            g_options.timeoutS = static_cast<uint32_t>(std::atol(value));
+        }
+        else if (parseOption(arg, "--target", value))
+        {
+            g_options.target = value;
+        }
+        else if (std::strcmp(arg, "--help") == 0 || std::strcmp(arg, "-h") == 0)
+        {
+            std::printf("Usage: %s [mode filter] [--devices=100,1000] [--txt-size=bytes] [--churn=per-second]\n"
+                "       [--duration=s] [--ramp=ms] [--sources=n] [--workers=n] [--source-rate=pps]\n"
+                "       [--rcvbuf=bytes] [--timeout=s] [--target=address]\n"
+                "Modes: single, single-noka, pipeline, pipeline-noka\n", argv[0]);
+            return 0;
+        }
+        else
+        {
+            g_options.filter = arg;
+        }
+    }
+    if (g_options.devices.empty())
+    {
+        std::fprintf(stderr, "No device counts given\n");
+        return 1;
+    }
+
+#ifdef _WIN32
+    WSADATA wsaData;
+    if (WSAStartup(MAKEWORD(2, 2), &wsaData) != 0)
+    {
+        std::fprintf(stderr, "WSAStartup failed\n");
+        return 1;
+    }
+#endif
+
+    // 发现的日志只影响耗时，不输出
+    Logger::getInstance().setLevel(LogLevel::LOG_ERROR);
+
+    const Mode modes[] = {
+        { "single", 0, true },
+        { "single-noka", 0, false },
+        { "pipeline", g_options.workers, true },
+        { "pipeline-noka", g_options.workers, false },
+    };
+
+    std::printf("txt=%zu bytes, churn=%u/s for %us, ramp=%ums, %zu sources, source rate %u/s\n",
+        g_options.txtSize, g_options.churn, g_options.durationS, g_options.rampMs,
+        g_options.sources, g_options.sourceRate);
+    std::printf("%-8s %-14s %10s %9s %8s %8s %8s %8s %7s %7s %7s %8s %8s %s\n",
+        "devices", "mode", "discover", "rx", "cpu/pkt", "sockdrop", "pipedrop", "ratelim", "drop",
+        "cb_p50", "cb_p99", "txt_p50", "txt_p99", "updates");
+    for (size_t devices : g_options.devices)
+    {
+        for (const Mode& mode : modes)
+        {
+            if (g_options.filter.empty() || std::strstr(mode.name, g_options.filter.c_str()))
+            {
+                runMode(mode, devices);
+            }
+        }
+    }
+
+#ifdef _WIN32
+    WSACleanup();
+#endif
+    return 0;
+}
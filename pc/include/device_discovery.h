@@ -3,9 +3,22 @@
  * @brief mDNS 设备发现服务接口
  * @details 提供基于 mDNS 协议的设备发现功能，支持:
  *  - 自动发现局域网内的设备
+ *  - 同时订阅多个服务类型，共用一个套接字和接收线程
+ *  - IPv4(224.0.0.251)和 IPv6(ff02::fb)双栈发现，共用解析器和记录缓存
+ *  - 在每个网络接口上加入多播组并发送查询，跟踪接口的增加和移除
  *  - 解析设备信息和服务属性
  *  - 设备状态变更通知
+ *  - 类型化的设备事件(新增/更新及差异/删除)，可按时间窗口批量投递
+ *  - 收发、解析、缓存和回调的运行统计
+ *  - 可选的多线程解析流水线: 设备表按实例名分片，每个分片由一个解析线程处理
+ *  - 接收 9000 字节的 mDNS 报文，报文和套接字接收缓冲区大小可配置
+ *  - 热启动: 记录缓存保存到文件，启动时立即恢复上次的设备(标记为未确认)
+ *  - 阻塞等待指定设备出现，按实例名主动解析(请求单播应答，收齐记录即返回)
+ *  - 从 pcap/pcapng 文件或内存回放报文(全速或按原始时间)，把收到的报文写入抓包文件
+ *  - 按 TTL 维护记录缓存，检测设备离线
  *  - 线程安全的设备列表管理
+ *  - 不可变设备表快照，读取端无需加锁
+ *  - 紧凑的设备记录: TXT 键和常见值驻留共享，每个设备只占一块连续内存
  *  - 支持设备广播和发现双重角色
  * 
  * 工作流程:
@@ -16,20 +29,22 @@
  *    - 通过回调通知发现的设备
  * 
  * 2. 设备广播模式:
- *    - 创建 UDP 套接字
- *    - 定期发送 mDNS 广播
- *    - 响应其他设备的查询
+ *    - 创建 UDP 套接字并加入 mDNS 多播组
+ *    - 探测实例名和主机名是否已被占用，冲突时改名
+ *    - 宣告服务记录，响应其他设备的查询
+ *    - 停止时发送 goodbye 报文
  * 
  * 使用示例:
  * @code
  * // 设备发现模式
  * void onDeviceFound(const DeviceDiscovery::DeviceInfo& device) {
  *     std::cout << "Found device: " << device.name 
- *               << " at " << device.ip << std::endl;
+ *               << " at " << device.ip << ":" << device.port << std::endl;
  * }
  * 
  * DeviceDiscovery discovery;
  * discovery.startDiscovery("_leboremote._tcp.local", onDeviceFound);
+ * discovery.subscribe("_airplay._tcp.local", onDeviceFound);  // 追加订阅
  * 
  * // 设备广播模式
  * std::map<std::string, std::string> txtRecords;
@@ -41,12 +56,15 @@
 
 #pragma once
 
+#include <array>
 #include <string>
 #include <vector>
 #include <map>
 #include <memory>
 #include <functional>
 #include <mutex>
+#include <cstdint>
+#include <cstddef>
 
 /**
  * @brief 设备发现服务类
@@ -60,17 +78,56 @@
  * 
  * 线程安全说明:
  *  - 所有公开方法都是线程安全的
- *  - 回调函数在接收线程中执行
- *  - 设备列表访问通过互斥锁保护
+ *  - 回调函数默认在接收线程中执行，也可以交给专用线程、线程池或调用方的 poll()
+ *    (见 setCallbackOptions())；执行回调时不持有内部锁
+ *  - 设备列表由接收线程写入，每次变化后发布新的不可变快照
+ *  - 读取快照只需一次原子加载，不与接收线程竞争锁
+ *  - 启用解析流水线(见 setPipelineOptions())后，报文由多个解析线程处理，
+ *    ReceiveThread 方式的回调在解析线程中并发执行；同一设备的回调仍按产生顺序，
+ *    设备事件按分片分别合并和投递
  */
 class DeviceDiscovery {
+    // PIMPL模式，隐藏实现细节
+    class Impl;
+
 public:
+    /**
+     * @brief 二进制形式的 IP 地址
+     * @details A/AAAA 记录的数据按网络字节序原样保存，不转换为字符串
+     */
+    struct IpAddress {
+        enum class Family : uint8_t {
+            None,
+            IPv4,
+            IPv6
+        };
+
+        Family family = Family::None;
+        std::array<uint8_t, 16> bytes{};  ///< 网络字节序，IPv4 只使用前 4 字节
+        uint32_t scopeId = 0;             ///< IPv6 链路本地地址所在的接口编号，其余地址为 0
+
+        /// 点分十进制或 IPv6 文本形式，family 为 None 时返回空字符串
+        std::string toString() const;
+
+        bool operator==(const IpAddress& other) const {
+            return family == other.family && bytes == other.bytes && scopeId == other.scopeId;
+        }
+        bool operator!=(const IpAddress& other) const { return !(*this == other); }
+    };
+
     /**
      * @brief 设备信息结构
      * @details 包含从 mDNS 响应中解析的设备信息:
      *  - name: 设备名称，格式为 "<instance>._<service>._<protocol>.local"
-     *  - ip: 设备IP地址，支持 IPv4
+     *  - serviceType: 设备所属的订阅服务类型
+     *  - host/port: SRV 记录中的目标主机名和服务端口
+     *  - ip/ipv6: 目标主机的 A/AAAA 记录地址(文本形式，各取一条)
+     *  - addresses: 目标主机的全部 A/AAAA 记录地址(二进制形式)，IPv4 在前
+     *  - interfaceIndex: 最近一次收到设备 SRV 记录的网络接口
      *  - txtRecords: 设备的 TXT 记录，包含设备属性
+     *
+     * 同一实例的 SRV、TXT 和地址记录可以分布在多个报文中，
+     * 全部收齐后才通过回调报告，回调中的设备信息可以直接用于建立连接。
      * 
      * TXT 记录示例:
      *  - version: 设备版本号
@@ -80,8 +137,15 @@ public:
      */
     struct DeviceInfo {
         std::string name;                              ///< 设备名称
-        std::string ip;                                ///< 设备IP地址
+        std::string serviceType;                       ///< 所属的服务类型
+        std::string ip;                                ///< 设备IPv4地址(A 记录)，没有时为空
+        std::string ipv6;                              ///< 设备IPv6地址(AAAA 记录)，没有时为空
+        std::string host;                              ///< 目标主机名(SRV 记录)
+        uint16_t port = 0;                             ///< 服务端口(SRV 记录)
         std::map<std::string, std::string> txtRecords; ///< 设备TXT记录
+        std::vector<IpAddress> addresses;              ///< 全部地址，IPv4 在前
+        uint32_t interfaceIndex = 0;                   ///< 接收接口编号(设备信息变化时更新)，0 表示未知
+        bool verified = true;                          ///< false 表示从缓存文件恢复，尚未重新收到设备的应答
 
         bool operator==(const DeviceInfo& other) const {
             return name == other.name;  // 使用设备名称作为唯一标识
@@ -91,35 +155,412 @@ public:
     /**
      * @brief 设备发现回调函数类型
      * @details 当发现新设备或设备状态更新时调用
-     * 回调函数在接收线程中执行，注意线程安全
+     * 回调函数按 setCallbackOptions() 选择的方式执行(默认在接收线程中)，注意线程安全
      * 
      * 触发时机:
-     *  - 首次发现新设备
+     *  - 首次发现新设备(SRV、TXT 和至少一条地址记录都已收到)
      *  - 设备 TXT 记录更新
-     *  - 设备 IP 地址变更
+     *  - 设备 IP 地址或端口变更
      */
     using DeviceFoundCallback = std::function<void(const DeviceInfo&)>;
 
+    /**
+     * @brief 设备离线回调函数类型
+     * @details 执行方式与发现回调相同，参数为离线前的最后一份设备信息
+     *
+     * 触发时机:
+     *  - 收到设备的 goodbye 报文(TTL 为 0)后 1 秒
+     *  - 设备记录的 TTL 到期且没有被刷新
+     */
+    using DeviceLostCallback = std::function<void(const DeviceInfo&)>;
+
+    /**
+     * @brief 设备表中保存的紧凑设备记录
+     * @details 每个设备只占一块连续内存，依次存放按键排序的 TXT 项、二进制地址以及名称、
+     * 主机名等字符串。TXT 键、服务类型和不超过 16 字节的 TXT 值驻留在处理该设备的线程的字符串池中，
+     * 所有设备共用一份副本，记录中只保存指针。
+     *
+     * 记录创建后不再修改，可以在任意线程中读取。字符串都以 NUL 结尾，
+     * TXT 值可能包含 NUL，长度以 txtValueLength() 为准。需要 DeviceInfo 时调用 toInfo()。
+     */
+    class DeviceRecord {
+    public:
+        DeviceRecord(const DeviceRecord&) = delete;
+        DeviceRecord& operator=(const DeviceRecord&) = delete;
+
+        const char* name() const { return name_; }
+        size_t nameLength() const { return nameLength_; }
+        const char* serviceType() const { return serviceType_; }
+        const char* host() const { return host_; }
+        uint16_t port() const { return port_; }
+        uint32_t interfaceIndex() const { return interfaceIndex_; }
+        /// 设备的记录已重新收到，从缓存文件恢复后尚未确认时为 false
+        bool verified() const { return verified_; }
+
+        /// 地址个数，顺序与 DeviceInfo::addresses 相同
+        size_t addressCount() const { return addressCount_; }
+        const IpAddress& address(size_t i) const { return addresses()[i]; }
+
+        /// TXT 项个数，按键的字节序排列
+        size_t txtCount() const { return txtCount_; }
+        const char* txtKey(size_t i) const { return entries()[i].key; }
+        size_t txtKeyLength(size_t i) const { return entries()[i].keyLength; }
+        const char* txtValue(size_t i) const { return entries()[i].value; }
+        size_t txtValueLength(size_t i) const { return entries()[i].valueLength; }
+
+        /**
+         * @brief 按键查找 TXT 值(二分查找，区分大小写)
+         *
+         * @param key 键
+         * @param length 不为空时输出值的长度
+         * @return 值，不存在时返回 nullptr
+         */
+        const char* findTxt(const std::string& key, size_t* length = nullptr) const;
+
+        /// 生成兼容的 DeviceInfo
+        DeviceInfo toInfo() const;
+
+    private:
+        friend class Impl;
+
+        struct TxtEntry {
+            const char* key;
+            const char* value;
+            uint16_t keyLength;
+            uint16_t valueLength;
+        };
+
+        DeviceRecord() = default;
+
+        const TxtEntry* entries() const { return reinterpret_cast<const TxtEntry*>(data_.get()); }
+        const IpAddress* addresses() const {
+            return reinterpret_cast<const IpAddress*>(data_.get() + txtCount_ * sizeof(TxtEntry));
+        }
+
+        std::shared_ptr<const void> pool_;  ///< 保证驻留字符串在记录存活期间有效
+        std::unique_ptr<char[]> data_;      ///< TXT 项、地址、内联字符串
+        const char* name_ = "";
+        const char* serviceType_ = "";
+        const char* host_ = "";
+        uint32_t interfaceIndex_ = 0;
+        uint16_t nameLength_ = 0;
+        uint16_t port_ = 0;
+        uint16_t txtCount_ = 0;
+        uint16_t addressCount_ = 0;
+        bool verified_ = true;
+        uint64_t sequence_ = 0;             ///< 设备的发现顺序，用于合并设备表分片
+    };
+
+    using DeviceRecordPtr = std::shared_ptr<const DeviceRecord>;
+
+    /**
+     * @brief 设备表快照
+     * @details 接收线程在设备列表发生变化时发布新的快照，已发布的快照不再修改，
+     * 可以在任意线程中长期持有和遍历。未变化的设备在新旧快照之间共享，
+     * 发布新快照只复制指针。
+     */
+    struct DeviceTable {
+        uint64_t generation = 0;               ///< 发布代数，设备列表每变化一次加 1
+        std::vector<DeviceRecordPtr> devices;  ///< 按发现顺序排列的设备
+    };
+
+    using DeviceTablePtr = std::shared_ptr<const DeviceTable>;
+
+    /// waitFor() 的设备匹配条件，在调用 waitFor() 的线程中执行
+    using DevicePredicate = std::function<bool(const DeviceRecord&)>;
+
+    /**
+     * @brief 设备变化事件
+     * @details 只在设备信息确实变化时产生: 周期性宣告、重复应答和只有接收接口不同的记录
+     * 都不产生事件。合并窗口内同一设备的多次变化合并为一个事件，
+     * 按窗口开始时与结束时的状态比较:
+     *  - 窗口内新增后又删除、或者删除后又以相同信息出现的设备不产生事件
+     *  - 删除后以不同信息出现的设备产生一个 Updated 事件
+     */
+    struct DeviceEvent {
+        enum class Type : uint8_t {
+            Added,    ///< 新发现的设备
+            Updated,  ///< 设备信息变化，changes 和 txt* 给出差异
+            Removed   ///< 设备离线
+        };
+
+        /// Updated 事件中变化的字段
+        enum Change : uint32_t {
+            kChangedHost = 1 << 0,       ///< SRV 目标主机名
+            kChangedPort = 1 << 1,       ///< SRV 端口
+            kChangedAddresses = 1 << 2,  ///< 地址列表(ip/ipv6/addresses)
+            kChangedTxt = 1 << 3,        ///< TXT 记录
+            kChangedVerified = 1 << 4    ///< 从缓存文件恢复的设备已重新收到应答(或相反)
+        };
+
+        Type type = Type::Added;
+        DeviceInfo device;    ///< Added/Updated 为变化后的信息，Removed 为离线前的最后一份信息
+        uint32_t changes = 0; ///< Updated 事件中 Change 的组合，其他事件为 0
+        std::map<std::string, std::string> txtAdded;    ///< 新增的 TXT 项
+        std::map<std::string, std::string> txtChanged;  ///< 值发生变化的 TXT 项(新值)
+        std::vector<std::string> txtRemoved;            ///< 删除的 TXT 键，按字节序排列
+    };
+
+    /**
+     * @brief 设备事件回调函数类型
+     * @details 执行方式与发现回调相同，一次收到一批事件(不合并时每批一个)，
+     * 批内按设备第一次变化的顺序排列
+     */
+    using DeviceEventCallback = std::function<void(const std::vector<DeviceEvent>&)>;
+
+    /**
+     * @brief 回调的执行方式
+     */
+    enum class CallbackExecutor : uint8_t {
+        ReceiveThread,    ///< 在接收线程中执行(默认)，回调耗时会推迟接收报文
+        DedicatedThread,  ///< 在一个专用线程中按产生顺序执行
+        ThreadPool,       ///< 在线程池中并发执行，不保证先后顺序
+        Poll              ///< 调用方调用 poll() 时在调用线程中执行
+    };
+
+    /**
+     * @brief 回调队列已满时的处理方式
+     */
+    enum class OverflowPolicy : uint8_t {
+        DropNewest,  ///< 丢弃新产生的回调
+        DropOldest   ///< 丢弃队列中最早的回调，放入新回调
+    };
+
+    /**
+     * @brief 回调执行选项
+     */
+    struct CallbackOptions {
+        CallbackExecutor executor = CallbackExecutor::ReceiveThread;
+        size_t queueCapacity = 1024;    ///< 队列容量，向上取整为 2 的幂(ReceiveThread 不使用队列)
+        size_t threads = 4;             ///< ThreadPool 的线程数
+        OverflowPolicy overflow = OverflowPolicy::DropNewest;
+    };
+
+    /**
+     * @brief 解析流水线选项
+     * @details 接收线程读出报文后按实例名的哈希交给解析线程，每个解析线程独占一部分设备
+     * (记录缓存、待解析实例和设备表分片)，同一设备的记录始终按到达顺序处理
+     */
+    struct PipelineOptions {
+        size_t workers = 0;             ///< 解析线程数，0 表示在接收线程中解析(默认)，最多 32
+        size_t queueCapacity = 1024;    ///< 报文缓冲区个数，也是每个分片队列的容量
+    };
+
+    /**
+     * @brief 接收选项
+     * @details RFC 6762 17 允许 mDNS 报文最大 9000 字节，TXT 项很多的设备会发送超过以太网 MTU
+     * 的应答(由 IP 分片)。接收缓冲区小于报文时报文被截断，只能解析出截断前的记录。
+     *
+     * 每个来源地址按令牌桶限速，超出的报文在解析前丢弃(计入 DiscoveryStats::rateLimited)，
+     * 网络上异常的主机不能占满接收线程。回放的报文不限速
+     */
+    struct ReceiveOptions {
+        size_t maxPacketSize = 9000;    ///< 每个报文的接收缓冲区(字节)，512 到 65535
+        int socketBufferSize = 0;       ///< 套接字接收缓冲区 SO_RCVBUF(字节)，0 表示使用系统默认值
+        uint32_t sourceRate = 100;      ///< 每个来源地址每秒处理的平均报文数，0 表示不限速
+        uint32_t sourceBurst = 200;     ///< 每个来源地址允许连续到达的报文数
+        size_t maxSources = 1024;       ///< 单独限速的来源地址数，超过后新的来源共用一个令牌桶
+    };
+
+    /**
+     * @brief 查询选项
+     * @details 默认在查询中附带缓存中剩余 TTL 超过一半的 PTR 记录作为已知答案(RFC 6762 7.1)，
+     * 已发现的设备不再应答。关闭后每次查询都得到全部设备的应答，用于对比已知答案抑制的效果
+     */
+    struct QueryOptions {
+        bool knownAnswers = true;       ///< 查询中附带已知答案
+    };
+
+    /**
+     * @brief 回调执行统计
+     */
+    struct CallbackStats {
+        uint64_t queued = 0;    ///< 放入队列的回调数
+        uint64_t executed = 0;  ///< 已执行的回调数
+        uint64_t dropped = 0;   ///< 因队列已满(或切换执行方式时未取出)而丢弃的回调数
+        size_t pending = 0;     ///< 当前排队的回调数(近似值)
+    };
+
+    /**
+     * @brief 对数分桶的延迟直方图
+     */
+    struct LatencyHistogram {
+        static const size_t kBuckets = 24;
+
+        /// buckets[0] 为小于 1 微秒的样本数，buckets[i] 为 [2^(i-1), 2^i) 微秒的样本数，
+        /// 最后一个桶还包含更大的样本
+        std::array<uint64_t, kBuckets> buckets{};
+        uint64_t count = 0;    ///< 样本数
+        uint64_t totalUs = 0;  ///< 样本总和(微秒)
+        uint64_t maxUs = 0;    ///< 最大样本(微秒)
+
+        /**
+         * @brief 近似分位数
+         * @param q 0 到 1 之间，例如 0.99
+         * @return 累计样本数达到 q 的桶的上限(微秒)，没有样本时为 0
+         */
+        uint64_t percentileUs(double q) const;
+    };
+
+    /**
+     * @brief 发现服务运行统计
+     * @details 自创建对象起累计。计数器在各自的工作线程中更新，读取时分别加载，
+     * 彼此之间不保证是同一时刻的值
+     */
+    struct DiscoveryStats {
+        // 收发
+        uint64_t packetsReceived = 0;   ///< 发现套接字收到的报文
+        uint64_t bytesReceived = 0;
+        uint64_t queriesReceived = 0;   ///< 其中的查询报文(包括回环收到的本机查询)
+        uint64_t packetsSent = 0;       ///< 发送的查询报文(每个接口、协议族各计一次)
+        uint64_t bytesSent = 0;
+        uint64_t sendErrors = 0;
+        uint64_t receiveErrors = 0;
+        uint64_t responsesSent = 0;     ///< 广播发送的应答、宣告、探测和 goodbye 报文
+        uint64_t socketDrops = 0;       ///< 内核因接收缓冲区满丢弃的报文(Linux SO_RXQ_OVFL，其他平台为 0)
+        uint64_t oversizePackets = 0;   ///< 超过 ReceiveOptions::maxPacketSize 而被截断的报文
+        uint64_t pipelineDrops = 0;     ///< 解析流水线的缓冲区或分片队列已满而丢弃的报文
+
+        // 解析前丢弃的报文
+        uint64_t rejectedHeader = 0;    ///< 操作码或错误码不为 0，或记录数与报文长度不符
+        uint64_t rejectedPort = 0;      ///< 来源端口不是 5353 的应答(RFC 6762 6)
+        uint64_t rateLimited = 0;       ///< 来源地址超过 ReceiveOptions::sourceRate
+
+        // 解析失败，按原因
+        uint64_t parseTruncated = 0;    ///< 头部、名称或记录数据越界
+        uint64_t parseBadPointer = 0;   ///< 压缩指针未指向之前的位置
+        uint64_t parsePointerLimit = 0; ///< 压缩指针跳转次数超限
+        uint64_t parseLabelLimit = 0;   ///< 标签数量超限
+        uint64_t parseNameTooLong = 0;  ///< 名称超过 255 字节
+        uint64_t parseBadLabelType = 0; ///< 不支持的标签类型
+        uint64_t parseBadRdata = 0;     ///< 记录数据格式与类型不符
+
+        // 应答报文中读出的记录，按类型
+        uint64_t recordsPTR = 0;
+        uint64_t recordsSRV = 0;
+        uint64_t recordsTXT = 0;
+        uint64_t recordsA = 0;
+        uint64_t recordsAAAA = 0;
+        uint64_t recordsOther = 0;
+
+        // 记录缓存
+        uint64_t cacheInserts = 0;      ///< 新记录
+        uint64_t cacheHits = 0;         ///< 已缓存的记录被刷新
+        uint64_t cacheGoodbyes = 0;     ///< 收到 TTL 为 0 的记录
+        uint64_t cacheEvictions = 0;    ///< 到期或被替换后删除的记录
+        uint64_t cacheSize = 0;         ///< 当前缓存的记录数
+
+        CallbackStats callbacks;           ///< 回调队列
+        LatencyHistogram callbackLatency;  ///< 从分发回调到回调返回
+        LatencyHistogram queryLatency;     ///< 从发送查询到收到第一个相关应答
+    };
+
+    /**
+     * @brief 报文来源
+     * @details 代替 UDP 套接字向接收线程提供报文(见 setPacketSource())，
+     * 用于回放现场抓包、离线复现问题和不依赖真实网络的压力测试。内置两种实现:
+     *  - openCaptureFile(): 读取 pcap/pcapng 文件
+     *  - MemoryPacketSource: 由程序写入报文，接收线程运行期间可以持续写入
+     */
+    class PacketSource {
+    public:
+        struct Packet {
+            const uint8_t* data = nullptr;  ///< mDNS 报文(UDP 负载)
+            size_t size = 0;
+            IpAddress sender;               ///< 发送方地址，决定报文按 IPv4 还是 IPv6 统计
+            uint16_t senderPort = 5353;
+            uint32_t interfaceIndex = 0;    ///< 接收接口，0 表示未知
+            int64_t timestampUs = -1;       ///< 收到的时间(Unix 时间，微秒)，-1 表示未知
+        };
+
+        virtual ~PacketSource() {}
+
+        /**
+         * @brief 取出下一个报文，只在接收线程中调用
+         *
+         * @param packet 输出报文，data 在下一次调用 next() 前有效
+         * @param timeoutMs 暂时没有报文时最多等待的毫秒数
+         * @return 1 取得报文，0 超时或被 interrupt() 唤醒，-1 没有更多报文
+         */
+        virtual int next(Packet& packet, int timeoutMs) = 0;
+
+        /// 使阻塞在 next() 中的调用立即返回，可以在任意线程中调用
+        virtual void interrupt() {}
+
+        /// next() 返回 -1 的原因，正常结束时为空
+        virtual std::string error() const { return std::string(); }
+    };
+
+    /**
+     * @brief 内存中的报文流
+     * @details 写入时复制报文数据。写入端和接收线程可以并发，写入的报文按顺序取出，
+     * 调用 close() 后取完剩余报文即结束
+     */
+    class MemoryPacketSource : public PacketSource {
+    public:
+        MemoryPacketSource();
+        ~MemoryPacketSource();
+
+        /// 写入一个报文，已 close() 时返回 false
+        bool push(const Packet& packet);
+
+        /// 不再写入报文
+        void close();
+
+        /// 尚未取出的报文数
+        size_t pending() const;
+
+        int next(Packet& packet, int timeoutMs) override;
+        void interrupt() override;
+
+    private:
+        class State;
+        std::unique_ptr<State> state_;
+    };
+
+    /**
+     * @brief 回放选项
+     */
+    struct ReplayOptions {
+        enum class Timing : uint8_t {
+            FullSpeed,  ///< 逐个报文尽快处理，用于测量吞吐量
+            Original    ///< 按报文的时间戳间隔处理，没有时间戳的报文立即处理
+        };
+        // 显式构造函数使 ReplayOptions() 可以在本类中用作默认参数
+        ReplayOptions() : timing(Timing::FullSpeed), speed(1.0) {}
+
+        Timing timing;
+        double speed;  ///< Original 时的倍速，例如 10 表示用十分之一的时间回放
+    };
+
     DeviceDiscovery();
     ~DeviceDiscovery();
 
     /**
      * @brief 启动设备发现
-     * @details 创建 mDNS 套接字，加入多播组，启动接收线程
+     * @details 等同于 subscribe()。第一次调用时创建 mDNS 套接字，加入多播组，启动接收线程；
+     * 已经启动时只追加一个服务类型订阅
      * 
      * 执行步骤:
      * 1. 创建 UDP 套接字
      * 2. 设置套接字选项(地址重用)
      * 3. 绑定到 mDNS 端口(5353)
-     * 4. 加入多播组(224.0.0.251)
-     * 5. 发送初始查询
-     * 6. 启动接收线程
+     * 4. 在每个已启用、支持多播的网络接口上加入多播组(224.0.0.251)
+     * 5. 再创建一个 IPv6 套接字在每个接口上加入 ff02::fb，没有 IPv6 时跳过
+     * 6. 发送初始查询(每个接口、每个协议族各发送一次)
+     * 7. 启动接收线程
+     *
+     * 只要有一个协议族的套接字创建成功即可启动，两个套接字收到的报文由同一个解析器处理，
+     * 记录存入同一个缓存，并标记收到记录的接口。接收线程运行期间监视网络接口的变化
+     * (Linux 使用 netlink 通知，其他平台每 5 秒重新枚举): 新接口上加入多播组，
+     * 消失的接口上收到的记录在 1 秒后删除，两种情况都立即重新查询。
      * 
      * @param serviceType 要发现的服务类型，例如 "_leboremote._tcp.local"
      * @param callback 设备发现回调函数
      * @return true 启动成功
      * @return false 启动失败，可能原因:
-     *  - 套接字创建失败
+     *  - 已订阅该服务类型或服务类型格式错误
+     *  - IPv4 和 IPv6 套接字都创建失败
      *  - 端口绑定失败
      *  - 加入多播组失败
      *  - 发送查询失败
@@ -128,9 +569,35 @@ public:
     bool startDiscovery(const std::string& serviceType, 
                        const DeviceFoundCallback& callback);
 
+    /**
+     * @brief 订阅服务类型
+     * @details 所有订阅共用一个套接字和接收线程，第一次订阅时启动。
+     * 接收线程运行时追加的订阅会唤醒接收线程，立即生效并发送第一次查询。
+     * 每个服务类型按 RFC 6762 持续查询，间隔从 1 秒开始加倍。
+     *
+     * txtKeys 不为空时设备信息只包含这些 TXT 键，其余的键在记录数据上比较后跳过，不生成字符串。
+     * 设备的 TXT 记录数据与上次相同时(周期性宣告)不再解析
+     *
+     * @param serviceType 服务类型，例如 "_leboremote._tcp.local"(大小写不敏感)
+     * @param callback 该服务类型的设备发现回调函数
+     * @param txtKeys 只保留的 TXT 键(大小写不敏感)，为空时保留全部
+     * @return false 已订阅该服务类型、服务类型格式错误或启动失败
+     */
+    bool subscribe(const std::string& serviceType, const DeviceFoundCallback& callback,
+        const std::vector<std::string>& txtKeys = std::vector<std::string>());
+
+    /**
+     * @brief 取消服务类型订阅
+     * @details 该服务类型的设备从设备表中删除，不触发离线回调；
+     * 接收线程继续运行，直到调用 stopDiscovery()
+     *
+     * @param serviceType 服务类型(大小写不敏感)
+     */
+    void unsubscribe(const std::string& serviceType);
+
     /**
      * @brief 停止设备发现
-     * @details 停止接收线程，关闭套接字，清理资源
+     * @details 取消所有订阅，停止接收线程，关闭套接字，清理资源
      * 
      * 执行步骤:
      * 1. 设置停止标志
@@ -140,9 +607,178 @@ public:
      */
     void stopDiscovery();
 
+    /**
+     * @brief 设置设备离线回调
+     * @details 可以在启动发现之前或之后设置，传入空函数取消回调
+     *
+     * @param callback 设备离线回调函数
+     */
+    void setDeviceLostCallback(const DeviceLostCallback& callback);
+
+    /**
+     * @brief 设置设备事件回调
+     * @details 与 startDiscovery()/subscribe() 的发现回调和离线回调并存，覆盖所有订阅的服务类型。
+     * 取消订阅时删除的设备不产生 Removed 事件(与离线回调相同)。停止发现时投递尚未到期的事件。
+     * 传入空函数取消回调，未投递的事件被丢弃
+     *
+     * @param callback 设备事件回调函数
+     * @param coalesceMs 合并窗口(毫秒)。0 表示每次变化立即投递；大于 0 时从窗口内第一次变化起
+     *                   等待 coalesceMs 毫秒，窗口内的全部变化在一次回调中投递
+     */
+    void setDeviceEventCallback(const DeviceEventCallback& callback, uint32_t coalesceMs = 0);
+
+    /**
+     * @brief 设置回调的执行方式
+     * @details 发现回调、离线回调和设备事件回调都按此方式执行。接收线程在释放内部锁之后
+     * 才执行或排队回调，回调中可以调用本类的查询方法。使用队列时接收线程从不等待回调:
+     * 队列已满按 overflow 丢弃并计数(见 getCallbackStats())，慢的消费者不会造成内核缓冲区丢包。
+     *
+     * 只能在发现未运行时调用。ReceiveThread 方式下不要在回调中调用 stopDiscovery()；
+     * 任何方式下都不要在回调中销毁本对象
+     *
+     * @param options 执行选项
+     * @return false 发现正在运行
+     */
+    bool setCallbackOptions(const CallbackOptions& options);
+
+    /**
+     * @brief 设置解析流水线
+     * @details workers 大于 0 时接收线程只负责收发和分发报文，解析、缓存和设备表更新在
+     * workers 个解析线程中进行，适合设备很多、应答密集的网络。已发现的设备保留并重新分片。
+     * 分片之间不保证回调和 getDeviceTable() 中设备出现的先后，设备表仍按发现顺序排列。
+     * 缓冲区或队列已满时丢弃报文并计入 DiscoveryStats::pipelineDrops
+     *
+     * 只能在发现未运行时调用
+     *
+     * @param options 流水线选项
+     * @return false 发现正在运行
+     */
+    bool setPipelineOptions(const PipelineOptions& options);
+
+    /**
+     * @brief 设置报文接收缓冲区和套接字接收缓冲区
+     * @details 下一次启动发现时生效。流水线模式下缓冲池共有 queueCapacity + 16 个
+     * maxPacketSize 字节的缓冲区，报文直接收到缓冲池中交给解析线程。
+     * 回放的报文同样按 maxPacketSize 截断。socketBufferSize 越大，设备集中宣告时
+     * 越不容易因内核缓冲区满而丢包(见 DiscoveryStats::socketDrops)，系统可能限制上限
+     * (Linux 为 net.core.rmem_max)，实际大小记录在日志中
+     *
+     * 只能在发现未运行时调用
+     *
+     * @param options 接收选项
+     * @return false 发现正在运行
+     */
+    bool setReceiveOptions(const ReceiveOptions& options);
+
+    /**
+     * @brief 设置查询选项
+     * @details 下一次启动发现时生效，只能在发现未运行时调用
+     *
+     * @param options 查询选项
+     * @return false 发现正在运行
+     */
+    bool setQueryOptions(const QueryOptions& options);
+
+    /**
+     * @brief 设置记录缓存文件(热启动)
+     * @details 发现停止时以及运行期间每隔 saveIntervalMs 把记录缓存(名称、SRV、地址、TXT 和
+     * 到期时间)写入文件；启动发现时读取文件，未到期且属于订阅服务类型的记录立即恢复，
+     * 设备随即出现在设备列表中并触发发现回调，DeviceInfo::verified 为 false。
+     *
+     * 恢复的记录不作为已知答案发送，启动后的第一次查询会得到设备的完整应答，
+     * 设备随之更新为已确认(事件的 changes 含 kChangedVerified)。恢复的记录最多保留
+     * 10 秒，期间没有收到应答的设备按离线处理。回放报文时不读写缓存文件
+     *
+     * 只能在发现未运行时调用
+     *
+     * @param path 文件路径，为空时不使用缓存文件
+     * @param saveIntervalMs 运行期间的保存间隔(毫秒)，0 表示只在停止时保存
+     * @return false 发现正在运行
+     */
+    bool setCacheFile(const std::string& path, uint32_t saveIntervalMs = 60000);
+
+    /**
+     * @brief 执行排队的回调
+     * @details 用于 Poll 方式(其他使用队列的方式下也可以调用，与工作线程一起取回调)，
+     * 可以在多个线程中同时调用，不要与 setCallbackOptions() 同时调用
+     *
+     * @param maxCallbacks 最多执行的回调数
+     * @return 执行的回调数
+     */
+    size_t poll(size_t maxCallbacks = SIZE_MAX);
+
+    /**
+     * @brief 获取回调执行统计
+     */
+    CallbackStats getCallbackStats() const;
+
+    /**
+     * @brief 获取运行统计
+     * @details 只读取计数器，不加锁，可以频繁调用
+     */
+    DiscoveryStats getStats() const;
+
+    /**
+     * @brief 打开抓包文件作为报文来源
+     * @details 支持 pcap(微秒/纳秒)和 pcapng，链路类型为 Ethernet、loopback、Raw IP 或
+     * Linux cooked；只取源或目的端口为 5353 的 UDP 报文，其余帧跳过
+     *
+     * @return 文件无法打开或格式不支持时返回空指针
+     */
+    static std::shared_ptr<PacketSource> openCaptureFile(const std::string& path);
+
+    /**
+     * @brief 使用报文来源代替 UDP 套接字
+     * @details 只能在发现未运行时调用，之后的 startDiscovery()/subscribe() 不创建套接字、
+     * 不加入多播组、也不发送查询，接收线程从 source 中取出报文，
+     * 与套接字收到的报文一样经过解析、记录缓存、设备表和回调。
+     * 来源结束后接收线程投递剩余事件，waitForReplay() 返回，设备表保留到 stopDiscovery()。
+     *
+     * 记录缓存按实际时间计算 TTL: 全速回放时抓包中的设备不会在回放期间过期，
+     * 按原始时间回放时与现场一致(倍速回放时 TTL 相对变长)。
+     *
+     * @param source 报文来源，为空时恢复使用套接字
+     * @return false 发现正在运行
+     */
+    bool setPacketSource(const std::shared_ptr<PacketSource>& source,
+                         const ReplayOptions& options = ReplayOptions());
+
+    /**
+     * @brief 等待报文来源中的报文全部处理完毕
+     *
+     * @param timeoutMs 最长等待时间(毫秒)
+     * @return true 来源已结束且剩余事件已投递；没有使用报文来源或超时时返回 false
+     */
+    bool waitForReplay(uint32_t timeoutMs = UINT32_MAX) const;
+
+    /**
+     * @brief 把接收线程收到的报文写入 pcap 文件
+     * @details 每个报文补上 IP/UDP 头部(LINKTYPE_RAW)，目的地址记为 mDNS 多播组。
+     * 可以在运行期间开始或停止；已在写入时先关闭之前的文件
+     *
+     * @return false 文件无法创建
+     */
+    bool startCapture(const std::string& path);
+
+    /// 停止写入并关闭抓包文件
+    void stopCapture();
+
+    /**
+     * @brief 广播的服务实例
+     * @details 实例名为 "<name>.<serviceType>"，SRV 记录指向 host，A 记录为本机地址
+     */
+    struct ServiceAdvertisement {
+        std::string name;                                    ///< 实例名的第一个标签，例如 "MyDevice"
+        std::string serviceType = "_leboremote._tcp.local";  ///< 服务类型
+        uint16_t port = 0;                                   ///< 服务端口(SRV 记录)
+        std::string host;                                    ///< 主机名，为空时使用 "<本机名>.local"
+        std::map<std::string, std::string> txtRecords;       ///< TXT 记录，每项 "key=value" 不超过 255 字节
+    };
+
     /**
      * @brief 开始广播设备
-     * @details 将本机作为设备广播到网络
+     * @details 将本机作为设备广播到网络，等同于 ServiceAdvertisement 使用默认服务类型
+     * "_leboremote._tcp.local"，端口取自 txtRecords 中的 "port" 项(没有时为 0)
      * 
      * @param deviceName 设备名称
      * @param txtRecords 设备属性记录
@@ -152,24 +788,119 @@ public:
     bool startBroadcast(const std::string& deviceName, 
                        const std::map<std::string, std::string>& txtRecords);
 
+    /**
+     * @brief 开始广播服务实例
+     * @details 创建广播套接字和广播线程，按 RFC 6762 工作:
+     *  - 探测: 先发送 3 次探测确认实例名和主机名未被占用，冲突时自动改名为 "Name (2)" 等
+     *  - 宣告: 探测完成后发送 2 次全部记录
+     *  - 应答: 应答其他主机对服务类型、实例和主机名的查询，多播应答随机延迟 20-120 毫秒
+     *    并合并同一时段内的查询，QU 问题单播应答
+     *
+     * 应答报文在记录变化时生成一次，之后每次应答只做查表。
+     *
+     * @param service 要广播的服务实例
+     * @return false 已在广播、名称或 TXT 记录格式错误、没有可用的本机地址或套接字创建失败
+     */
+    bool startBroadcast(const ServiceAdvertisement& service);
+
+    /**
+     * @brief 更新广播的 TXT 记录
+     * @details 唤醒广播线程，立即重新生成应答报文并重新宣告
+     *
+     * @return false 未在广播或 TXT 记录格式错误
+     */
+    bool updateBroadcastTxt(const std::map<std::string, std::string>& txtRecords);
+
     /**
      * @brief 停止设备广播
-     * @details 停止发送 mDNS 广播，关闭广播套接字
+     * @details 发送 goodbye 报文使其他主机删除缓存的记录，停止广播线程，关闭广播套接字
      */
     void stopBroadcast();
 
     /**
      * @brief 获取已发现的设备列表
      * @details 返回当前已发现的所有设备信息
-     * 此方法是线程安全的，通过互斥锁保护
+     * 此方法是线程安全的，基于当前设备表快照构造副本
      * 
-     * @note 返回的是设备列表的副本，调用时会有复制开销
+     * @note 返回的是设备列表的副本，调用时会有复制开销；
+     *       频繁轮询请使用 getDeviceTable()
      * @return std::vector<DeviceInfo> 设备列表的副本
      */
     std::vector<DeviceInfo> getDiscoveredDevices() const;
 
+    /**
+     * @brief 获取当前设备表快照
+     * @details 只做一次原子加载，不复制设备信息，不与接收线程竞争锁。
+     * 快照中是紧凑的 DeviceRecord，按需调用 toInfo() 转换
+     *
+     * @return DeviceTablePtr 不可变快照，始终非空
+     */
+    DeviceTablePtr getDeviceTable() const;
+
+    /**
+     * @brief 获取当前设备表的发布代数
+     * @details 与上次取得的快照 generation 相同时说明设备列表没有变化，可以跳过处理
+     *
+     * 使用示例:
+     * @code
+     * if (discovery.getGeneration() != lastGeneration) {
+     *     auto table = discovery.getDeviceTable();
+     *     lastGeneration = table->generation;
+     *     // 刷新界面
+     * }
+     * @endcode
+     */
+    uint64_t getGeneration() const;
+
+    /**
+     * @brief 等待满足条件的设备出现在设备列表中
+     * @details 先检查当前的设备表，之后每次发布新的快照时重新检查，找到即返回，
+     * 不必按固定时长等待。设备列表中的设备都已收齐 SRV、TXT 和地址记录。
+     * 从缓存文件恢复的设备同样参与匹配，需要已确认的设备时在条件中检查 verified()
+     *
+     * 使用示例:
+     * @code
+     * auto device = discovery.waitFor([](const DeviceDiscovery::DeviceRecord& record) {
+     *     const char* uid = record.findTxt("u");
+     *     return uid && std::strcmp(uid, "12345") == 0;
+     * }, 3000);
+     * @endcode
+     *
+     * @note 不要在 ReceiveThread 方式的回调中调用，接收线程被阻塞时设备表不会更新
+     * @param predicate 匹配条件
+     * @param timeoutMs 最长等待时间(毫秒)
+     * @return 第一个满足条件的设备，超时或发现停止时返回 nullptr
+     */
+    DeviceRecordPtr waitFor(const DevicePredicate& predicate, uint32_t timeoutMs);
+
+    /**
+     * @brief 按实例名解析设备，收齐记录即返回
+     * @details 设备已在设备列表中且已确认时直接返回；否则立即发送该实例的 SRV 和 TXT 问题
+     * (已知主机名时同时发送 A/AAAA 问题)，置 QU 位请求单播应答。应答缺少地址记录时
+     * 立即补充查询，不等待后续报文。等待时间通常只是一次网络往返。
+     *
+     * 实例必须属于已订阅的服务类型，发现需要正在运行
+     *
+     * @note 与 waitFor() 一样不要在 ReceiveThread 方式的回调中调用
+     * @param name 完整的实例名，例如 "TV1._leboremote._tcp.local"，不区分大小写
+     * @param timeoutMs 最长等待时间(毫秒)
+     * @return 已确认的设备，超时、实例不属于订阅的服务或发现未运行时返回 nullptr
+     */
+    DeviceRecordPtr resolveInstance(const std::string& name, uint32_t timeoutMs);
+
+    /**
+     * @brief 选择连接设备时延迟最低的地址
+     * @details 查询同时通过 IPv4 和 IPv6 发送，接收线程按每个协议族从发送查询到收到该设备应答
+     * 的时间计算平滑往返时间。设备同时具有两种地址时返回往返时间较短的协议族的地址；
+     * 只有一个协议族测得过往返时间时选择该协议族，都没有测得时选择 IPv4。
+     * IPv6 优先选择非链路本地地址。
+     *
+     * @param name 设备实例名
+     * @param address 输出的地址
+     * @return false 设备不在设备列表中
+     */
+    bool getPreferredAddress(const std::string& name, IpAddress& address) const;
+
 private:
-    // PIMPL模式，隐藏实现细节
-    class Impl;
     std::unique_ptr<Impl> pImpl;
 }; 
\ No newline at end of file
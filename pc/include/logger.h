@@ -1,12 +1,14 @@
 ﻿/**
  * @file logger.h
- * @brief 日志系统实现
+ * @brief 日志系统接口
  *
  * 提供线程安全的日志记录功能:
  * - 支持文件和控制台输出
  * - 多个日志级别(DEBUG/INFO/WARN/ERROR)
  * - 自动添加时间戳
  * - 线程安全的日志写入
+ * - 运行期和编译期日志级别过滤，过滤发生在格式化之前
+ * - 可选的异步后端: 每个写日志的线程一个无锁环形缓冲区，由后台线程批量写出
  *
  * 使用方式:
  * 1. 初始化日志系统
@@ -21,15 +23,32 @@
  * 3. 日志格式
  *    [时间戳] [日志级别] [文件:行号] 日志内容
  *    例如: [2024-02-20 10:30:15] [INFO] [main.cpp:42] 程序启动
+ *
+ * 4. 级别过滤
+ *    Logger::getInstance().setLevel(LogLevel::LOG_INFO);  // 运行期过滤 DEBUG
+ *    编译时定义 LOG_MIN_LEVEL=1 可以把 LOG_DEBUG 语句整体移除(0=DEBUG ... 3=ERROR)
+ *
+ * 5. 异步输出
+ *    Logger::getInstance().enableAsync();   // 写日志的线程不再等待磁盘 I/O
+ *    Logger::getInstance().disableAsync();  // 写出剩余日志并停止后台线程
+ *
+ * 实现位于 src/logger.cpp，头文件只包含级别判断和日志宏，
+ * 单例只在库中定义一次，以共享库方式链接时各模块使用同一个实例。
  */
 
 #pragma once
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <ctime>
-#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <memory>
+#include <sstream>
+#include <string>
+
+// 编译期最低日志级别，低于该级别的日志语句不参与编译
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
 
  /**
   * @brief 日志级别枚举
@@ -53,10 +72,7 @@ public:
      *
      * @return Logger& 日志系统实例
      */
-    static Logger& getInstance() {
-        static Logger instance;
-        return instance;
-    }
+    static Logger& getInstance();
 
     /**
      * @brief 初始化日志系统
@@ -66,17 +82,47 @@ public:
      * @return true 初始化成功
      * @return false 初始化失败
      */
-    bool init(const std::string& filename, bool console_output = true) {
-        std::lock_guard<std::mutex> lock(mutex_);
-        logFile_.open(filename, std::ios::out | std::ios::app);
-        if (!logFile_.is_open()) {
-            std::cerr << "Failed to open log file: " << filename << std::endl;
-            return false;
-        }
-        consoleOutput_ = console_output;
-        return true;
+    bool init(const std::string& filename, bool console_output = true);
+
+    /**
+     * @brief 设置运行期最低日志级别
+     * @details LOG_* 宏在格式化消息前检查该级别
+     */
+    void setLevel(LogLevel level) {
+        level_.store(static_cast<int>(level), std::memory_order_relaxed);
+    }
+
+    LogLevel getLevel() const {
+        return static_cast<LogLevel>(level_.load(std::memory_order_relaxed));
     }
 
+    /// 判断指定级别的日志是否会被输出
+    bool isEnabled(LogLevel level) const {
+        return static_cast<int>(level) >= level_.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 启用异步输出
+     * @details 每个写日志的线程首次写入时注册一个单生产者环形缓冲区，
+     * 后台线程定期取出所有缓冲区中的日志，批量写入文件和控制台并只刷新一次。
+     * 缓冲区满时丢弃新日志并计数，写日志的线程不会阻塞。
+     *
+     * @param ringCapacity 每个线程的缓冲区条目数，向上取整为 2 的幂
+     * @param flushInterval 后台线程的最长写出间隔
+     * @return true 启用成功(已启用时也返回 true)
+     */
+    bool enableAsync(size_t ringCapacity = 1024,
+                     std::chrono::milliseconds flushInterval = std::chrono::milliseconds(50));
+
+    /**
+     * @brief 停止异步输出
+     * @details 写出所有缓冲区中剩余的日志后停止后台线程，之后恢复同步输出
+     */
+    void disableAsync();
+
+    /// 异步模式下因缓冲区满而丢弃的日志条数
+    uint64_t droppedMessages() const;
+
     /**
      * @brief 写入日志
      *
@@ -85,77 +131,50 @@ public:
      * @param line 行号
      * @param message 日志内容
      */
-    void log(LogLevel level, const char* file, int line, const std::string& message) {
-        std::lock_guard<std::mutex> lock(mutex_);
-
-        // 获取当前时间
-        std::time_t now = std::time(nullptr);
-        char timestamp[32];
-        std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
-
-        // 获取日志级别字符串
-        const char* levelStr;
-        switch (level) {
-        case LogLevel::LOG_DEBUG:   levelStr = "DEBUG"; break;
-        case LogLevel::LOG_INFO:    levelStr = "INFO"; break;
-        case LogLevel::LOG_WARN:    levelStr = "WARN"; break;
-        case LogLevel::LOG_ERROR:   levelStr = "ERROR"; break;
-        }
-
-        // 构建日志消息
-        std::ostringstream logMessage;
-        logMessage << "[" << timestamp << "][" << levelStr << "][" << file << ":" << line << "] "
-            << message << std::endl;
-
-        // 写入文件
-        if (logFile_.is_open()) {
-            logFile_ << logMessage.str();
-            logFile_.flush();
-        }
-
-        // 根据设置决定是否输出到控制台
-        if (consoleOutput_) {
-            std::cout << logMessage.str();
-        }
-    }
+    void log(LogLevel level, const char* file, int line, const std::string& message);
 
-    ~Logger() {
-        if (logFile_.is_open()) {
-            logFile_.close();
-        }
-    }
+    ~Logger();
 
 private:
-    Logger() = default;
+    Logger();
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
-    std::ofstream logFile_;
-    std::mutex mutex_;
-    bool consoleOutput_ = true;  // 控制是否输出到控制台
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+    std::atomic<int> level_{static_cast<int>(LogLevel::LOG_DEBUG)};
 };
 
 // 日志宏定义
-#define LOG_DEBUG(msg) { \
-    std::ostringstream oss; \
-    oss << msg; \
-    Logger::getInstance().log(LogLevel::LOG_DEBUG, __FILE__, __LINE__, oss.str()); \
-}
-
-#define LOG_INFO(msg) { \
-    std::ostringstream oss; \
-    oss << msg; \
-    Logger::getInstance().log(LogLevel::LOG_INFO, __FILE__, __LINE__, oss.str()); \
-}
-
-#define LOG_WARN(msg) { \
-    std::ostringstream oss; \
-    oss << msg; \
-    Logger::getInstance().log(LogLevel::LOG_WARN, __FILE__, __LINE__, oss.str()); \
-}
-
-#define LOG_ERROR(msg)  { \
-    std::ostringstream oss; \
-    oss << msg; \
-    Logger::getInstance().log(LogLevel::LOG_ERROR, __FILE__, __LINE__, oss.str()); \
-}
\ No newline at end of file
+// 先检查编译期和运行期级别，被过滤的日志不会构造 ostringstream
+#define LOG_AT_LEVEL(level, msg) do { \
+    if (Logger::getInstance().isEnabled(level)) { \
+        std::ostringstream oss; \
+        oss << msg; \
+        Logger::getInstance().log(level, __FILE__, __LINE__, oss.str()); \
+    } \
+} while (0)
+
+#if LOG_MIN_LEVEL <= 0
+#define LOG_DEBUG(msg) LOG_AT_LEVEL(LogLevel::LOG_DEBUG, msg)
+#else
+#define LOG_DEBUG(msg) do { } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= 1
+#define LOG_INFO(msg) LOG_AT_LEVEL(LogLevel::LOG_INFO, msg)
+#else
+#define LOG_INFO(msg) do { } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= 2
+#define LOG_WARN(msg) LOG_AT_LEVEL(LogLevel::LOG_WARN, msg)
+#else
+#define LOG_WARN(msg) do { } while (0)
+#endif
+
+#if LOG_MIN_LEVEL <= 3
+#define LOG_ERROR(msg) LOG_AT_LEVEL(LogLevel::LOG_ERROR, msg)
+#else
+#define LOG_ERROR(msg) do { } while (0)
+#endif
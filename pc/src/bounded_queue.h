@@ -0,0 +1,136 @@
+/**
+ * @file bounded_queue.h
+ * @brief 有界无锁队列
+ * @details 固定容量的多生产者多消费者队列(D. Vyukov 的有界 MPMC 队列):
+ *  - 每个槽位带一个序号，生产者和消费者各自用 CAS 推进位置，不使用互斥锁
+ *  - 序号表明槽位是否可写或可读，队列满或空时 tryPush()/tryPop() 立即返回 false
+ *  - 容量向上取整为 2 的幂，位置对容量取模只需一次按位与
+ *
+ * 单生产者单消费者时同样适用，CAS 不会失败。
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+namespace mdns {
+
+template <typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size <<= 1;
+        }
+        mask_ = size - 1;
+        cells_.reset(new Cell[size]);
+        for (size_t i = 0; i < size; i++)
+        {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        enqueue_.store(0, std::memory_order_relaxed);
+        dequeue_.store(0, std::memory_order_relaxed);
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    size_t capacity() const { return mask_ + 1; }
+
+    /// 队列中的元素个数，并发修改时只是近似值
+    size_t sizeApprox() const
+    {
+        size_t head = dequeue_.load(std::memory_order_relaxed);
+        size_t tail = enqueue_.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    /// 放入元素，队列已满时返回 false，value 保持不变
+    bool tryPush(T&& value)
+    {
+        Cell* cell;
+        size_t pos = enqueue_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0)
+            {
+                if (enqueue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = enqueue_.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// 取出最早的元素，队列为空时返回 false
+    bool tryPop(T& value)
+    {
+        Cell* cell;
+        size_t pos = dequeue_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell = &cells_[pos & mask_];
+            size_t sequence = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+            if (diff == 0)
+            {
+                if (dequeue_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = dequeue_.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->value = T();  // 及时释放元素持有的资源
+        cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static const size_t kCacheLine = 64;
+
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> cells_;
+    size_t mask_;
+    // 生产者和消费者的位置放在不同的缓存行，避免伪共享
+    char pad0_[kCacheLine];
+    std::atomic<size_t> enqueue_;
+    char pad1_[kCacheLine - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> dequeue_;
+    char pad2_[kCacheLine - sizeof(std::atomic<size_t>)];
+};
+
+} // namespace mdns
@@ -0,0 +1,352 @@
+/**
+ * @file cache_file.cpp
+ * @brief 记录缓存文件实现
+ */
+
+#include "cache_file.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mdns {
+
+namespace {
+
+const char kMagic[4] = { 'L', 'B', 'M', 'C' };
+const uint16_t kVersion = 1;
+const size_t kFileHeaderSize = 12;  ///< 魔数、版本、保留、记录数
+const size_t kRecordSize = 28;  ///< 每条记录的定长部分
+
+void append16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value));
+    out.push_back(static_cast<uint8_t>(value >> 8));
+}
+
+void append32(std::vector<uint8_t>& out, uint32_t value)
+{
+    append16(out, static_cast<uint16_t>(value));
+    append16(out, static_cast<uint16_t>(value >> 16));
+}
+
+void append64(std::vector<uint8_t>& out, uint64_t value)
+{
+    append32(out, static_cast<uint32_t>(value));
+    append32(out, static_cast<uint32_t>(value >> 32));
+}
+
+uint16_t read16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t read32(const uint8_t* p)
+{
+    return read16(p) | (static_cast<uint32_t>(read16(p + 2)) << 16);
+}
+
+uint64_t read64(const uint8_t* p)
+{
+    return read32(p) | (static_cast<uint64_t>(read32(p + 4)) << 32);
+}
+
+/**
+ * @brief 检查记录数据与类型是否相符，与 RecordCache::decode() 对收到的记录所做的检查相同
+ * @details A/AAAA 为固定长度的地址；PTR/SRV 为非压缩的目标名称(SRV 前有 6 字节的优先级、
+ * 权重和端口)，并且有点分形式的目标
+ */
+bool validRdata(uint16_t type, const uint8_t* rdata, size_t rdataLength, size_t targetLength)
+{
+    switch (type)
+    {
+    case kTypeA:
+        return rdataLength == 4;
+    case kTypeAAAA:
+        return rdataLength == 16;
+    case kTypePTR:
+    case kTypeSRV:
+    {
+        size_t fixed = type == kTypeSRV ? 6 : 0;
+        if (rdataLength <= fixed || targetLength == 0)
+        {
+            return false;
+        }
+        NameView name;
+        size_t next = 0;
+        return NameView::parse(rdata + fixed, rdataLength - fixed, 0, name, &next) == ParseError::None &&
+            next == rdataLength - fixed;
+    }
+    default:
+        return true;
+    }
+}
+
+/// 只读映射整个文件，空文件的 data() 为 nullptr
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+#ifdef _WIN32
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+    HANDLE mapping_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+    const uint8_t* data_ = nullptr;
+    size_t size_ = 0;
+};
+
+MappedFile::~MappedFile()
+{
+#ifdef _WIN32
+    if (data_)
+    {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_)
+    {
+        CloseHandle(mapping_);
+    }
+    if (file_ != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file_);
+    }
+#else
+    if (data_)
+    {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    if (fd_ >= 0)
+    {
+        close(fd_);
+    }
+#endif
+}
+
+bool MappedFile::open(const std::string& path, std::string& error)
+{
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+    {
+        error = "cannot open " + path + " (error " + std::to_string(GetLastError()) + ")";
+        return false;
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size))
+    {
+        error = "cannot stat " + path;
+        return false;
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+    if (size_ == 0)
+    {
+        return true;
+    }
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_)
+    {
+        data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0)
+    {
+        error = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd_, &info) != 0)
+    {
+        error = "cannot stat " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    size_ = static_cast<size_t>(info.st_size);
+    if (size_ == 0)
+    {
+        return true;
+    }
+    void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+    data_ = mapped == MAP_FAILED ? nullptr : static_cast<const uint8_t*>(mapped);
+#endif
+    if (!data_)
+    {
+        error = "cannot map " + path;
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool writeCacheFile(const std::string& path, const std::vector<CachedRecord>& records,
+    CachedRecord::Clock::time_point now, int64_t nowUnixMs, std::string& error)
+{
+    std::vector<uint8_t> out(kFileHeaderSize);
+    uint32_t count = 0;
+    for (const auto& record : records)
+    {
+        if (record.ttl == 0 || record.expires <= now || record.name.size() > 0xFFFF ||
+            record.rdata.size() > 0xFFFF || record.target.size() > 0xFFFF ||
+            !validRdata(record.type, reinterpret_cast<const uint8_t*>(record.rdata.data()),
+                record.rdata.size(), record.target.size()))
+        {
+            continue;
+        }
+        int64_t remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+            record.expires - now).count();
+        append64(out, static_cast<uint64_t>(nowUnixMs + remainingMs));
+        append32(out, record.ttl);
+        append32(out, record.interfaceIndex);
+        append16(out, record.type);
+        append16(out, record.rclass);
+        append16(out, record.port);
+        append16(out, static_cast<uint16_t>(record.name.size()));
+        append16(out, static_cast<uint16_t>(record.rdata.size()));
+        append16(out, static_cast<uint16_t>(record.target.size()));
+        out.insert(out.end(), record.name.begin(), record.name.end());
+        out.insert(out.end(), record.rdata.begin(), record.rdata.end());
+        out.insert(out.end(), record.target.begin(), record.target.end());
+        count++;
+    }
+    std::memcpy(out.data(), kMagic, sizeof(kMagic));
+    out[4] = static_cast<uint8_t>(kVersion);
+    out[5] = static_cast<uint8_t>(kVersion >> 8);
+    out[8] = static_cast<uint8_t>(count);
+    out[9] = static_cast<uint8_t>(count >> 8);
+    out[10] = static_cast<uint8_t>(count >> 16);
+    out[11] = static_cast<uint8_t>(count >> 24);
+
+    std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file)
+    {
+        error = "cannot create " + temporary + ": " + std::strerror(errno);
+        return false;
+    }
+    bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+    written = std::fclose(file) == 0 && written;
+    if (!written)
+    {
+        error = "cannot write " + temporary;
+        std::remove(temporary.c_str());
+        return false;
+    }
+#ifdef _WIN32
+    // Windows 上 rename 不覆盖已有文件
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()) != 0)
+    {
+        error = "cannot rename " + temporary + " to " + path + ": " + std::strerror(errno);
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool readCacheFile(const std::string& path, CachedRecord::Clock::time_point now, int64_t nowUnixMs,
+    std::vector<CachedRecord>& out, std::string& error)
+{
+    MappedFile file;
+    if (!file.open(path, error))
+    {
+        return false;
+    }
+    const uint8_t* p = file.data();
+    size_t size = file.size();
+    if (size < kFileHeaderSize || std::memcmp(p, kMagic, sizeof(kMagic)) != 0)
+    {
+        error = path + " is not a cache file";
+        return false;
+    }
+    if (read16(p + 4) != kVersion)
+    {
+        error = "unsupported cache file version " + std::to_string(read16(p + 4));
+        return false;
+    }
+
+    // 先完整检查一遍，格式错误时不输出任何记录
+    uint32_t count = read32(p + 8);
+    size_t offset = kFileHeaderSize;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (size - offset < kRecordSize)
+        {
+            error = path + " is truncated";
+            return false;
+        }
+        const uint8_t* r = p + offset;
+        uint16_t nameLength = read16(r + 22);
+        uint16_t rdataLength = read16(r + 24);
+        uint16_t targetLength = read16(r + 26);
+        size_t variable = static_cast<size_t>(nameLength) + rdataLength + targetLength;
+        if (size - offset - kRecordSize < variable)
+        {
+            error = path + " is truncated";
+            return false;
+        }
+        // 恢复的记录不再经过 decode()，直接交给记录缓存和设备组装
+        if (!validRdata(read16(r + 16), r + kRecordSize + nameLength, rdataLength, targetLength))
+        {
+            error = path + " has a malformed record";
+            return false;
+        }
+        offset += kRecordSize + variable;
+    }
+
+    offset = kFileHeaderSize;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        const uint8_t* r = p + offset;
+        int64_t expiresMs = static_cast<int64_t>(read64(r));
+        uint16_t nameLength = read16(r + 22);
+        uint16_t rdataLength = read16(r + 24);
+        uint16_t targetLength = read16(r + 26);
+        offset += kRecordSize + nameLength + rdataLength + targetLength;
+
+        int64_t remainingMs = expiresMs - nowUnixMs;
+        int64_t remaining = remainingMs / 1000;
+        if (remaining < 1)
+        {
+            continue;
+        }
+        CachedRecord record;
+        record.ttl = static_cast<uint32_t>(std::min<int64_t>(remaining, read32(r + 8)));
+        record.expires = now + std::chrono::milliseconds(remainingMs);
+        record.interfaceIndex = read32(r + 12);
+        record.type = read16(r + 16);
+        record.rclass = read16(r + 18);
+        record.port = read16(r + 20);
+        const char* text = reinterpret_cast<const char*>(r + kRecordSize);
+        record.name.assign(text, nameLength);
+        record.rdata.assign(text + nameLength, rdataLength);
+        record.target.assign(text + nameLength + rdataLength, targetLength);
+        record.verified = false;
+        out.push_back(std::move(record));
+    }
+    return true;
+}
+
+} // namespace mdns
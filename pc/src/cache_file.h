@@ -0,0 +1,52 @@
+/**
+ * @file cache_file.h
+ * @brief 记录缓存文件(热启动)
+ * @details 把记录缓存保存为紧凑的二进制文件，下次启动时读回，设备列表不必从空开始:
+ *  - 文件头为魔数 "LBMC"、版本和记录数，之后逐条存放记录，整数按小端序
+ *  - 每条记录保存名称、类型、类、TTL、接口编号、记录数据、PTR/SRV 目标和端口，
+ *    到期时间保存为 Unix 时间(毫秒)，读取时换算为剩余 TTL，已到期的记录跳过
+ *  - 写入时先写临时文件再改名，进程中途退出不会留下不完整的文件
+ *  - 读取时把文件映射到内存(mmap/MapViewOfFile)直接解码，长度或格式不符时整个文件作废，
+ *    包括记录数据与类型不符(例如 A 记录不是 4 字节、SRV 没有目标)
+ *
+ * 非线程安全。
+ */
+
+#pragma once
+
+#include "record_cache.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mdns {
+
+/**
+ * @brief 写入缓存文件
+ *
+ * @param path 文件路径，同目录下的 path + ".tmp" 用作临时文件
+ * @param records 要保存的记录，TTL 为 0、已到期或记录数据与类型不符的记录跳过
+ * @param now 与 records 中到期时间对应的当前时间
+ * @param nowUnixMs 当前的 Unix 时间(毫秒)
+ * @param error 失败原因
+ * @return 是否写入成功
+ */
+bool writeCacheFile(const std::string& path, const std::vector<CachedRecord>& records,
+    CachedRecord::Clock::time_point now, int64_t nowUnixMs, std::string& error);
+
+/**
+ * @brief 读取缓存文件
+ * @details 输出记录的 ttl 为剩余的秒数(不足 1 秒的记录跳过)，expires 为换算后的到期时间，
+ * received 未设置，verified 为 false
+ *
+ * @param path 文件路径
+ * @param now 当前时间，用于换算 expires
+ * @param nowUnixMs 当前的 Unix 时间(毫秒)
+ * @param out 追加读出的记录
+ * @param error 失败原因，文件不存在时也返回 false
+ * @return 文件格式正确
+ */
+bool readCacheFile(const std::string& path, CachedRecord::Clock::time_point now, int64_t nowUnixMs,
+    std::vector<CachedRecord>& out, std::string& error);
+
+} // namespace mdns
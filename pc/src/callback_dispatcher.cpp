@@ -0,0 +1,171 @@
+/**
+ * @file callback_dispatcher.cpp
+ * @brief 用户回调的执行实现
+ */
+
+#include "callback_dispatcher.h"
+
+namespace mdns {
+
+typedef DeviceDiscovery::CallbackExecutor Executor;
+
+CallbackDispatcher::CallbackDispatcher()
+{
+}
+
+CallbackDispatcher::~CallbackDispatcher()
+{
+    stopWorkers();
+}
+
+void CallbackDispatcher::configure(const Options& options)
+{
+    stopWorkers();
+    if (queue_)
+    {
+        // 只有 Poll 方式会留下未执行的回调
+        dropped_ += queue_->sizeApprox();
+        queue_.reset();
+    }
+
+    options_ = options;
+    if (options_.executor == Executor::ReceiveThread)
+    {
+        return;
+    }
+    queue_.reset(new BoundedQueue<Job>(options_.queueCapacity));
+
+    size_t threads = 0;
+    if (options_.executor == Executor::DedicatedThread)
+    {
+        threads = 1;
+    }
+    else if (options_.executor == Executor::ThreadPool)
+    {
+        threads = options_.threads ? options_.threads : 1;
+    }
+    stopping_ = false;
+    for (size_t i = 0; i < threads; i++)
+    {
+        workers_.push_back(std::thread(&CallbackDispatcher::workerLoop, this));
+    }
+}
+
+void CallbackDispatcher::dispatch(Task&& task)
+{
+    Job job;
+    job.task = std::move(task);
+    job.dispatched = Clock::now();
+    if (!queue_)
+    {
+        run(job);
+        return;
+    }
+
+    if (!queue_->tryPush(std::move(job)))
+    {
+        Job oldest;
+        if (options_.overflow == DeviceDiscovery::OverflowPolicy::DropOldest && queue_->tryPop(oldest))
+        {
+            dropped_++;
+            if (!queue_->tryPush(std::move(job)))
+            {
+                dropped_++;
+                return;
+            }
+        }
+        else
+        {
+            dropped_++;
+            return;
+        }
+    }
+    queued_++;
+
+    // 与 workerLoop() 中的栅栏配对: 工作线程要么看到新元素，要么被这里看到正在休眠
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers_.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        wake_.notify_one();
+    }
+}
+
+size_t CallbackDispatcher::poll(size_t maxTasks)
+{
+    size_t count = 0;
+    while (count < maxTasks && runOne())
+    {
+        count++;
+    }
+    return count;
+}
+
+DeviceDiscovery::CallbackStats CallbackDispatcher::stats() const
+{
+    Stats stats;
+    stats.queued = queued_.load(std::memory_order_relaxed);
+    stats.executed = executed_.load(std::memory_order_relaxed);
+    stats.dropped = dropped_.load(std::memory_order_relaxed);
+    stats.pending = queue_ ? queue_->sizeApprox() : 0;
+    return stats;
+}
+
+void CallbackDispatcher::run(Job& job)
+{
+    job.task();
+    executed_++;
+    latency_.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        Clock::now() - job.dispatched).count()));
+}
+
+bool CallbackDispatcher::runOne()
+{
+    Job job;
+    if (!queue_ || !queue_->tryPop(job))
+    {
+        return false;
+    }
+    run(job);
+    return true;
+}
+
+void CallbackDispatcher::workerLoop()
+{
+    for (;;)
+    {
+        if (runOne())
+        {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex_);
+        sleepers_++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        wake_.wait(lock, [this] { return stopping_ || queue_->sizeApprox() > 0; });
+        sleepers_--;
+        if (stopping_ && queue_->sizeApprox() == 0)
+        {
+            return;
+        }
+    }
+}
+
+void CallbackDispatcher::stopWorkers()
+{
+    if (workers_.empty())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex_);
+        stopping_ = true;
+        wake_.notify_all();
+    }
+    for (auto& worker : workers_)
+    {
+        worker.join();
+    }
+    workers_.clear();
+}
+
+} // namespace mdns
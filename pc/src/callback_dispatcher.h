@@ -0,0 +1,99 @@
+/**
+ * @file callback_dispatcher.h
+ * @brief 用户回调的执行
+ * @details 接收线程不直接执行用户回调(或只在释放内部锁之后执行)，而是交给分发器:
+ *  - ReceiveThread: 在调用 dispatch() 的线程中立即执行
+ *  - DedicatedThread/ThreadPool: 放入有界无锁队列(见 bounded_queue.h)，由工作线程取出执行
+ *  - Poll: 放入队列，由调用方在 poll() 中执行
+ *
+ * 队列已满时按溢出策略丢弃最新或最早的回调并计数，接收线程从不因为回调而阻塞。
+ * 工作线程空闲时在条件变量上休眠，生产者只在有线程休眠时才加锁唤醒。
+ */
+
+#pragma once
+
+#include "device_discovery.h"
+#include "bounded_queue.h"
+#include "metrics.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace mdns {
+
+class CallbackDispatcher {
+public:
+    typedef std::function<void()> Task;
+    typedef DeviceDiscovery::CallbackOptions Options;
+    typedef DeviceDiscovery::CallbackStats Stats;
+
+    CallbackDispatcher();
+
+    /// 停止工作线程，已排队的回调先执行完；Poll 方式下未取出的回调被丢弃
+    ~CallbackDispatcher();
+
+    CallbackDispatcher(const CallbackDispatcher&) = delete;
+    CallbackDispatcher& operator=(const CallbackDispatcher&) = delete;
+
+    /**
+     * @brief 更换执行方式
+     * @details 旧的工作线程执行完已排队的回调后退出，Poll 方式下未取出的回调计为丢弃。
+     * 不能与 dispatch()、poll() 并发调用
+     */
+    void configure(const Options& options);
+
+    const Options& options() const { return options_; }
+
+    /**
+     * @brief 执行或排队一个回调
+     * @details 在接收线程或解析流水线的解析线程中调用，可以并发调用，不阻塞
+     */
+    void dispatch(Task&& task);
+
+    /**
+     * @brief 在调用线程中执行排队的回调
+     * @details 可以在多个线程中同时调用
+     *
+     * @param maxTasks 最多执行的个数
+     * @return 执行的个数，ReceiveThread 方式下始终为 0
+     */
+    size_t poll(size_t maxTasks);
+
+    Stats stats() const;
+
+    /// 从 dispatch() 到回调返回的时间
+    const Histogram& latency() const { return latency_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    /// 排队的回调和分发时间
+    struct Job {
+        Task task;
+        Clock::time_point dispatched;
+    };
+
+    void run(Job& job);
+    bool runOne();
+    void workerLoop();
+    void stopWorkers();
+
+    Options options_;
+    std::unique_ptr<BoundedQueue<Job>> queue_;  ///< ReceiveThread 方式下为空
+    std::vector<std::thread> workers_;
+    std::atomic<bool> stopping_{ false };
+    std::mutex sleepMutex_;                      ///< 只用于休眠和唤醒
+    std::condition_variable wake_;
+    std::atomic<int> sleepers_{ 0 };
+    std::atomic<uint64_t> queued_{ 0 };
+    std::atomic<uint64_t> executed_{ 0 };
+    std::atomic<uint64_t> dropped_{ 0 };
+    Histogram latency_;
+};
+
+} // namespace mdns
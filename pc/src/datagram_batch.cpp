@@ -0,0 +1,266 @@
+/**
+ * @file datagram_batch.cpp
+ * @brief 批量接收 UDP 报文实现
+ */
+
+#include "datagram_batch.h"
+
+namespace mdns {
+
+namespace {
+
+const size_t kControlSize = 128;  ///< 足够容纳一个 IP_PKTINFO 或 IPV6_PKTINFO 控制消息
+
+#ifndef _WIN32
+/// 从控制消息取出接收接口编号，携带丢包计数时写入 drops
+uint32_t controlInterface(struct msghdr& message, uint32_t& drops, bool& hasDrops)
+{
+    uint32_t index = 0;
+    for (struct cmsghdr* control = CMSG_FIRSTHDR(&message); control;
+        control = CMSG_NXTHDR(&message, control))
+    {
+#ifdef IP_PKTINFO
+        if (control->cmsg_level == IPPROTO_IP && control->cmsg_type == IP_PKTINFO)
+        {
+            struct in_pktinfo info;
+            std::memcpy(&info, CMSG_DATA(control), sizeof(info));
+            index = static_cast<uint32_t>(info.ipi_ifindex);
+        }
+#endif
+        if (control->cmsg_level == IPPROTO_IPV6 && control->cmsg_type == IPV6_PKTINFO)
+        {
+            struct in6_pktinfo info;
+            std::memcpy(&info, CMSG_DATA(control), sizeof(info));
+            index = static_cast<uint32_t>(info.ipi6_ifindex);
+        }
+#ifdef SO_RXQ_OVFL
+        if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SO_RXQ_OVFL)
+        {
+            std::memcpy(&drops, CMSG_DATA(control), sizeof(drops));
+            hasDrops = true;
+        }
+#endif
+    }
+    return index;
+}
+#else
+uint32_t controlInterface(WSAMSG& message)
+{
+    for (WSACMSGHDR* control = WSA_CMSG_FIRSTHDR(&message); control;
+        control = WSA_CMSG_NXTHDR(&message, control))
+    {
+        if (control->cmsg_level == IPPROTO_IP && control->cmsg_type == IP_PKTINFO)
+        {
+            IN_PKTINFO info;
+            std::memcpy(&info, WSA_CMSG_DATA(control), sizeof(info));
+            return static_cast<uint32_t>(info.ipi_ifindex);
+        }
+        if (control->cmsg_level == IPPROTO_IPV6 && control->cmsg_type == IPV6_PKTINFO)
+        {
+            IN6_PKTINFO info;
+            std::memcpy(&info, WSA_CMSG_DATA(control), sizeof(info));
+            return static_cast<uint32_t>(info.ipi6_ifindex);
+        }
+    }
+    return 0;
+}
+#endif
+
+} // namespace
+
+DatagramBatch::DatagramBatch(size_t capacity, size_t bufferSize)
+    : capacity_(capacity), bufferSize_(bufferSize), storage_(capacity * bufferSize),
+      buffers_(capacity), sizes_(capacity), senders_(capacity), interfaces_(capacity),
+      truncated_(capacity), control_(capacity * kControlSize)
+{
+    for (size_t i = 0; i < capacity; i++)
+    {
+        buffers_[i] = &storage_[i * bufferSize];
+    }
+#ifdef __linux__
+    headers_.resize(capacity);
+    iov_.resize(capacity);
+    for (size_t i = 0; i < capacity; i++)
+    {
+        iov_[i].iov_base = buffers_[i];
+        iov_[i].iov_len = bufferSize;
+        struct msghdr& header = headers_[i].msg_hdr;
+        header = msghdr();
+        header.msg_name = &senders_[i];
+        header.msg_iov = &iov_[i];
+        header.msg_iovlen = 1;
+        header.msg_control = &control_[i * kControlSize];
+    }
+#endif
+}
+
+void DatagramBatch::setBuffer(size_t i, uint8_t* buffer)
+{
+    buffers_[i] = buffer ? buffer : &storage_[i * bufferSize_];
+#ifdef __linux__
+    iov_[i].iov_base = buffers_[i];
+#endif
+}
+
+bool DatagramBatch::enablePacketInfo(SOCKET sock, int family)
+{
+    int enable = 1;
+    if (family == AF_INET6)
+    {
+#ifdef _WIN32
+        return setsockopt(sock, IPPROTO_IPV6, IPV6_PKTINFO, (char*)&enable, sizeof(enable)) == 0;
+#else
+        return setsockopt(sock, IPPROTO_IPV6, IPV6_RECVPKTINFO, (char*)&enable, sizeof(enable)) == 0;
+#endif
+    }
+#ifdef IP_PKTINFO
+    return setsockopt(sock, IPPROTO_IP, IP_PKTINFO, (char*)&enable, sizeof(enable)) == 0;
+#else
+    (void)sock;
+    return false;
+#endif
+}
+
+bool DatagramBatch::enableDropCounter(SOCKET sock)
+{
+#ifdef SO_RXQ_OVFL
+    int enable = 1;
+    return setsockopt(sock, SOL_SOCKET, SO_RXQ_OVFL, (char*)&enable, sizeof(enable)) == 0;
+#else
+    (void)sock;
+    return false;
+#endif
+}
+
+int DatagramBatch::receive(SOCKET sock)
+{
+    hasDrops_ = false;
+#ifdef __linux__
+    for (size_t i = 0; i < capacity_; i++)
+    {
+        headers_[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+        headers_[i].msg_hdr.msg_controllen = kControlSize;
+    }
+    int count = recvmmsg(sock, headers_.data(), static_cast<unsigned int>(capacity_),
+        MSG_DONTWAIT, nullptr);
+    if (count < 0)
+    {
+        error_ = errno;
+        return (wouldBlock(error_) || error_ == EINTR) ? 0 : -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        sizes_[i] = headers_[i].msg_len;
+        truncated_[i] = (headers_[i].msg_hdr.msg_flags & MSG_TRUNC) != 0;
+        interfaces_[i] = controlInterface(headers_[i].msg_hdr, drops_, hasDrops_);
+        if (interfaces_[i] == 0 && senders_[i].ss_family == AF_INET6)
+        {
+            interfaces_[i] = reinterpret_cast<const sockaddr_in6&>(senders_[i]).sin6_scope_id;
+        }
+    }
+    return count;
+#else
+    int count = 0;
+    while (static_cast<size_t>(count) < capacity_)
+    {
+        int bytes = receiveOne(sock, count);
+        if (bytes < 0)
+        {
+            error_ = lastSocketError();
+#ifdef _WIN32
+            if (error_ == WSAEMSGSIZE)
+            {
+                // 报文超出缓冲区，内容已截断
+                truncated_[count] = 1;
+                sizes_[count++] = bufferSize_;
+                continue;
+            }
+#else
+            if (error_ == EINTR)
+            {
+                continue;
+            }
+#endif
+            if (wouldBlock(error_) || count > 0)
+            {
+                return count;
+            }
+            return -1;
+        }
+        sizes_[count++] = static_cast<size_t>(bytes);
+    }
+    return count;
+#endif
+}
+
+#ifndef __linux__
+int DatagramBatch::receiveOne(SOCKET sock, size_t i)
+{
+    interfaces_[i] = 0;
+    truncated_[i] = 0;
+#ifdef _WIN32
+    if (!recvMsg_)
+    {
+        GUID guid = WSAID_WSARECVMSG;
+        DWORD length = 0;
+        if (WSAIoctl(sock, SIO_GET_EXTENSION_FUNCTION_POINTER, &guid, sizeof(guid),
+            &recvMsg_, sizeof(recvMsg_), &length, nullptr, nullptr) != 0)
+        {
+            recvMsg_ = nullptr;
+        }
+    }
+    if (!recvMsg_)
+    {
+        int length = sizeof(sockaddr_storage);
+        return recvfrom(sock, (char*)buffers_[i], static_cast<int>(bufferSize_), 0,
+            (struct sockaddr*)&senders_[i], &length);
+    }
+    WSABUF buffer;
+    buffer.buf = (CHAR*)buffers_[i];
+    buffer.len = static_cast<ULONG>(bufferSize_);
+    WSAMSG message;
+    std::memset(&message, 0, sizeof(message));
+    message.name = (LPSOCKADDR)&senders_[i];
+    message.namelen = sizeof(sockaddr_storage);
+    message.lpBuffers = &buffer;
+    message.dwBufferCount = 1;
+    message.Control.buf = (CHAR*)&control_[i * kControlSize];
+    message.Control.len = static_cast<ULONG>(kControlSize);
+    DWORD bytes = 0;
+    if (recvMsg_(sock, &message, &bytes, nullptr, nullptr) != 0)
+    {
+        if (WSAGetLastError() == WSAEMSGSIZE)
+        {
+            interfaces_[i] = controlInterface(message);
+        }
+        return -1;
+    }
+    interfaces_[i] = controlInterface(message);
+#else
+    struct iovec iov;
+    iov.iov_base = buffers_[i];
+    iov.iov_len = bufferSize_;
+    struct msghdr message = msghdr();
+    message.msg_name = &senders_[i];
+    message.msg_namelen = sizeof(sockaddr_storage);
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = &control_[i * kControlSize];
+    message.msg_controllen = kControlSize;
+    ssize_t bytes = recvmsg(sock, &message, 0);
+    if (bytes < 0)
+    {
+        return -1;
+    }
+    truncated_[i] = (message.msg_flags & MSG_TRUNC) != 0;
+    interfaces_[i] = controlInterface(message, drops_, hasDrops_);
+#endif
+    if (interfaces_[i] == 0 && senders_[i].ss_family == AF_INET6)
+    {
+        interfaces_[i] = reinterpret_cast<const sockaddr_in6&>(senders_[i]).sin6_scope_id;
+    }
+    return static_cast<int>(bytes);
+}
+#endif
+
+} // namespace mdns
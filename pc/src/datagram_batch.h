@@ -0,0 +1,120 @@
+/**
+ * @file datagram_batch.h
+ * @brief 批量接收 UDP 报文
+ * @details 一次调用读取套接字中已排队的多个报文，存入预先分配的缓冲区:
+ *  - Linux 使用 recvmmsg，一次系统调用读取一批
+ *  - 其他 POSIX 平台在非阻塞套接字上循环调用 recvmsg，Windows 使用 WSARecvMsg，
+ *    直到没有数据或缓冲区用完
+ *  - 套接字开启 enablePacketInfo() 后，从控制消息(IP_PKTINFO/IPV6_PKTINFO)取得
+ *    每个报文的接收接口
+ *  - 开启 enableDropCounter() 后(Linux SO_RXQ_OVFL)，从控制消息取得内核因接收缓冲区满
+ *    而丢弃的报文累计数
+ *
+ * 设备集中宣告时会在短时间内收到大量报文，批量读取减少系统调用次数。
+ * 缓冲区在构造时分配，接收过程不分配内存。也可以用 setBuffer() 让某个位置直接接收到
+ * 调用方的缓冲区(例如解析流水线的缓冲池)，报文交给其他线程时不需要复制。
+ */
+
+#pragma once
+
+#include "socket_platform.h"
+#include <cstdint>
+#include <vector>
+
+#ifdef _WIN32
+#include <mswsock.h>
+#else
+#include <sys/uio.h>
+#endif
+
+namespace mdns {
+
+class DatagramBatch {
+public:
+    /**
+     * @param capacity 一批最多读取的报文数
+     * @param bufferSize 每个报文的缓冲区大小，超出的部分被截断
+     */
+    explicit DatagramBatch(size_t capacity, size_t bufferSize = 1500);
+
+    /**
+     * @brief 从非阻塞套接字读取已排队的报文
+     * @return 读取的报文数，没有报文时为 0，出错时为 -1(错误码见 error())
+     */
+    int receive(SOCKET sock);
+
+    /**
+     * @brief 开启接收接口信息(IP_PKTINFO 或 IPV6_RECVPKTINFO)
+     * @param family 套接字的协议族，AF_INET 或 AF_INET6
+     */
+    static bool enablePacketInfo(SOCKET sock, int family);
+
+    /**
+     * @brief 开启内核丢包计数(Linux SO_RXQ_OVFL)
+     * @return false 平台不支持或设置失败
+     */
+    static bool enableDropCounter(SOCKET sock);
+
+    size_t capacity() const { return capacity_; }
+    size_t bufferSize() const { return bufferSize_; }
+
+    /**
+     * @brief 设置第 i 个报文的接收缓冲区
+     *
+     * @param buffer 至少 bufferSize() 字节，在下一次 setBuffer(i) 之前保持有效；
+     *               nullptr 表示恢复使用内部缓冲区
+     */
+    void setBuffer(size_t i, uint8_t* buffer);
+
+    const uint8_t* data(size_t i) const { return buffers_[i]; }
+    size_t size(size_t i) const { return sizes_[i]; }
+    /// 发送方地址，ss_family 为 AF_INET 或 AF_INET6
+    const sockaddr_storage& sender(size_t i) const { return senders_[i]; }
+
+    /// 接收报文的接口编号，套接字未开启接收接口信息时为 0
+    uint32_t interfaceIndex(size_t i) const { return interfaces_[i]; }
+
+    /// 报文是否超出缓冲区而被截断
+    bool truncated(size_t i) const { return truncated_[i] != 0; }
+
+    /**
+     * @brief 最近一次 receive() 中读到的内核丢包累计数
+     * @details 计数属于套接字，从开启时起累计，32 位回绕
+     * @return false 本次接收的报文都没有携带丢包计数
+     */
+    bool dropCount(uint32_t& count) const
+    {
+        count = drops_;
+        return hasDrops_;
+    }
+
+    /// 最近一次失败的错误码
+    int error() const { return error_; }
+
+private:
+#ifndef __linux__
+    /// 读取一个报文到第 i 个缓冲区，返回字节数，出错时为 -1
+    int receiveOne(SOCKET sock, size_t i);
+#endif
+
+    size_t capacity_;
+    size_t bufferSize_;
+    std::vector<uint8_t> storage_;
+    std::vector<uint8_t*> buffers_;  ///< 每个报文的接收缓冲区，默认指向 storage_
+    std::vector<size_t> sizes_;
+    std::vector<sockaddr_storage> senders_;
+    std::vector<uint32_t> interfaces_;
+    std::vector<uint8_t> truncated_;
+    std::vector<uint8_t> control_;  ///< 每个报文的控制消息缓冲区
+    int error_ = 0;
+    uint32_t drops_ = 0;
+    bool hasDrops_ = false;
+#if defined(__linux__)
+    std::vector<struct mmsghdr> headers_;
+    std::vector<struct iovec> iov_;
+#elif defined(_WIN32)
+    LPFN_WSARECVMSG recvMsg_ = nullptr;  ///< 第一次接收时通过 WSAIoctl 取得
+#endif
+};
+
+} // namespace mdns
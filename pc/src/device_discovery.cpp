@@ -36,15 +36,15 @@
  * 1) 解析 DNS 头部
  *    - 验证消息长度 >= DNS头部长度(12字节)
  *    - 检查消息类型(QR位)是否为响应
- *    - 获取问题数(QDCOUNT)和应答数(ANCOUNT)
+ *    - 获取问题数(QDCOUNT)、应答数(ANCOUNT)、授权记录数(NSCOUNT)和附加记录数(ARCOUNT)
  *
  * 2) 跳过问题部分
  *    - 对每个问题记录:
  *      > 解析名称(按照长度+数据格式)
  *      > 跳过类型(QTYPE)和类(QCLASS)字段(共4字节)
  *
- * 3) 解析应答记录
- *    - 对每个应答记录:
+ * 3) 解析应答、授权和附加记录
+ *    - 对每个记录:
  *      > 解析记录名称(支持压缩指针)
  *      > 读取类型(TYPE)、类(CLASS)、TTL和数据长度
  *      > 根据类型解析记录数据:
@@ -58,10 +58,94 @@
  *    - 获取14位偏移值
  *    - 跳转到偏移位置继续解析
  *    - 支持多级压缩引用
+ *    - 指针必须指向当前名称片段之前，并限制跳转次数、标签数和名称长度
+ *    - 解析在接收缓冲区上进行，名称以视图形式比较，不分配内存(见 mdns_packet.h)
  *
  * 5) TXT记录解析
  *    - 按照 <length><key>=<value> 格式解析
  *    - 存储到设备信息的 txtRecords 映射中
+ *    - 订阅指定了键过滤时，其余的键在记录数据上比较后跳过
+ *    - 记录数据的哈希与设备表中的相同时不解析
+ *
+ * 6) 记录缓存与设备离线
+ *    - 属于订阅服务的记录按 (名称, 类型, 类) 存入缓存，按 TTL 到期
+ *    - TTL 为 0 的 goodbye 记录在 1 秒后删除
+ *    - 实例的 PTR 记录到期，或 TXT/SRV 全部到期且没有 PTR 时，设备离线并通知
+ *
+ * 7) 跨报文组装设备信息
+ *    - 实例的 SRV、TXT 记录和 SRV 目标主机的 A/AAAA 记录可以在不同报文中到达
+ *    - 每个报文处理完后，从缓存中组装涉及的实例，记录齐全时才回调
+ *    - 记录不完整时等待 200 毫秒，之后只针对缺失的记录发送补充查询，最多 3 次
+ *
+ * 8) 查询流量抑制
+ *    - 已知答案: 查询附带剩余 TTL 超过一半的 PTR 记录，报文放不下时置 TC 位拆分
+ *    - 重复问题: 其他主机刚发出相同的 QM 问题且已知答案覆盖本机时，本机查询视为已发送
+ *    - 多播回环收到的自身查询按报文内容识别，不计入重复问题
+ *
+ * 9) 持续查询
+ *    - 订阅的服务类型立即查询一次，之后间隔 1、2、4……秒加倍，最长 60 分钟
+ *    - 缓存记录到达 TTL 的 80%、85%、90%、95% 时查询该记录，收到应答后不再继续
+ *    - 同时到期的问题(包括补充查询)合并在一个报文中发送
+ *
+ * 10) 服务广播
+ *    - 广播使用单独的套接字和线程，协议逻辑在 mdns::Responder 中(见 responder.h)
+ *    - 探测 3 次确认名称未被占用，之后宣告 2 次，停止时发送 goodbye
+ *    - 应答报文在记录变化时生成一次，应答查询时直接发送缓存的报文
+ *
+ * 11) 接收循环
+ *    - 套接字为非阻塞模式，线程在 mdns::Poller(epoll/WSAPoll/poll)上等待可读或下一个定时任务
+ *    - 可读时一次取出多个报文(Linux 使用 recvmmsg，见 datagram_batch.h)
+ *    - 停止、订阅变化和 TXT 更新通过 wakeup() 立即唤醒线程，线程退出后才关闭套接字
+ *
+ * 12) 双栈
+ *    - 发现同时使用 IPv4(224.0.0.251)和 IPv6(ff02::fb)两个套接字，在同一个 Poller 上等待
+ *    - 查询在两个套接字上各发送一次，两边收到的报文使用同一个解析器和记录缓存
+ *    - 地址记录以二进制形式保存在 DeviceInfo::addresses 中
+ *    - 每个设备按协议族记录查询到应答的平滑往返时间，用于选择连接地址
+ *
+ * 13) 多网络接口
+ *    - 在每个已启用、支持多播的接口上分别加入多播组，查询逐个接口发送(IP_MULTICAST_IF/scope id)
+ *    - 通过 IP_PKTINFO/IPV6_PKTINFO 取得报文的接收接口，缓存记录标记该接口，
+ *      cache-flush 只作用于同一接口收到的记录
+ *    - 接口变化(netlink 通知或定期枚举)时加入新接口，移除的接口上的记录 1 秒后删除，并重新查询
+ *    - 枚举不到接口时退回到系统默认接口
+ *
+ * 14) 紧凑设备表
+ *    - 设备表保存 DeviceRecord: TXT 项按键排序，与地址、名称一起放在一块连续内存中
+ *    - TXT 键、服务类型和短值驻留在 mdns::StringPool 中，设备之间共享(见 string_pool.h)
+ *    - 回调和 getDiscoveredDevices() 仍使用 DeviceInfo，按需从记录生成
+ *
+ * 15) 设备事件
+ *    - 设备表的每次变化(新增、替换、删除)交给 mdns::DeviceEventCoalescer(见 device_events.h)
+ *    - 合并窗口到期时比较窗口前后的记录，只为确实变化的设备生成 Added/Updated/Removed 事件，
+ *      Updated 事件带有字段和 TXT 差异
+ *
+ * 16) 回调执行
+ *    - 接收线程持有 devicesMutex 时只把回调(连同参数副本)追加到待执行列表，
+ *      释放锁之后再交给 mdns::CallbackDispatcher(见 callback_dispatcher.h)
+ *    - 分发器在接收线程中直接执行，或放入有界无锁队列由专用线程、线程池或 poll() 执行，
+ *      队列满时按溢出策略丢弃并计数
+ *
+ * 17) 运行统计
+ *    - 收发、解析失败原因、记录类型、缓存、内核丢包(SO_RXQ_OVFL)和截断报文按计数器累计
+ *    - 计数器只由接收线程(广播计数由广播线程)写入，使用 relaxed 加载和存储(见 metrics.h)
+ *    - 回调延迟和查询到第一个应答的延迟记录在对数分桶的直方图中，getStats() 读取快照
+ *
+ * 18) 报文回放与抓包
+ *    - setPacketSource() 后接收线程不创建套接字，从 PacketSource 取出报文(见 packet_source.h)，
+ *      经过与套接字报文相同的解析、缓存、设备表和回调；回放期间不发送查询
+ *    - 按原始时间回放时，以第一个报文的时间戳为起点按倍速等待，等待期间照常投递事件
+ *    - startCapture() 后接收线程把每批报文写入 pcap 文件(见 packet_capture.h)，
+ *      未开启时每批只多一次原子加载
+ *
+ * 19) 解析流水线(setPipelineOptions() 设置 workers 后启用)
+ *    - 记录缓存、设备表、事件合并和待执行回调按实例名哈希分成 N 个分片(Shard)，每个分片由一个
+ *      解析线程处理，同一设备的记录始终在同一个线程中按到达顺序处理；没有全局的 devicesMutex
+ *    - 接收线程读出报文和记录头部，由 mdns::PacketRouter 计算涉及的分片(见 packet_router.h)，
+ *      把报文复制到缓冲池中交给这些分片的队列，缓冲池或队列已满时丢弃并计数
+ *    - 解析线程需要的补充查询和主机关联变化通过请求列表交给接收线程，查询仍由接收线程合并发送；
+ *      接收线程发送已知答案、应用订阅和接口变化时依次锁定全部分片
+ *    - 每个分片发布自己的设备表快照，getDeviceTable() 在代数变化后按发现顺序合并一次
  */
 
  /**
@@ -76,6 +160,25 @@
 
 #include "device_discovery.h"
 #include "logger.h"
+#include "mdns_packet.h"
+#include "device_index.h"
+#include "fnv1a.h"
+#include "record_cache.h"
+#include "query_scheduler.h"
+#include "service_matcher.h"
+#include "responder.h"
+#include "poller.h"
+#include "datagram_batch.h"
+#include "network_interfaces.h"
+#include "string_pool.h"
+#include "device_events.h"
+#include "callback_dispatcher.h"
+#include "metrics.h"
+#include "packet_capture.h"
+#include "packet_source.h"
+#include "packet_router.h"
+#include "cache_file.h"
+#include "packet_filter.h"
 #include <thread>
 #include <atomic>
 #include <chrono>
@@ -83,26 +186,31 @@
 #include <cstring>
 #include <vector>
 #include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
 #include <algorithm>
 #include <map>
+#include <unordered_map>
+#include <cstdlib>
 
-#ifdef _WIN32
-#include <WinSock2.h>
-#include <WS2tcpip.h>
-#pragma comment(lib, "Ws2_32.lib")
-#else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <unistd.h>
-#define SOCKET int
-#define INVALID_SOCKET (-1)
-#define closesocket close
-#endif
+#include "socket_platform.h"
 
   // mDNS 协议常量定义
 #define MDNS_PORT 5353
 #define MDNS_GROUP "224.0.0.251"
+#define MDNS_GROUP6 "ff02::fb"
+#define MDNS_RECV_TIMEOUT_MS 250  // 最长等待时间，用于驱动记录到期检查
+#define MDNS_RECV_BATCH 16        // 每次批量读取的最大报文数
+#define MDNS_RESOLVE_DELAY_MS 200 // 记录不完整时等待后续报文的时间
+#define MDNS_RESOLVE_ATTEMPTS 3   // 每个实例最多发送的补充查询次数
+#define MDNS_MAX_PACKET_SIZE 1472 // 以太网 MTU 下的 UDP 负载上限，已知答案超出时拆分报文
+#define MDNS_QUERY_SUPPRESS_MS 1000 // 其他主机发送相同问题后，本机查询被抑制的时间
+#define MDNS_RTT_WINDOW_MS 2000   // 查询后该时间内收到的应答计入往返时间
+#define MDNS_INTERFACE_SCAN_MS 5000 // 重新枚举网络接口的间隔(Linux 上另有 netlink 通知)
+#define MDNS_INTERNED_VALUE_MAX 16  // 不超过该长度的 TXT 值驻留到字符串池，更长的值大多各不相同
+#define MDNS_MIN_RECV_SIZE 512      // 接收缓冲区下限，单播 DNS 报文的最大长度
+#define MDNS_MAX_RECV_SIZE 65535    // 接收缓冲区上限，UDP 报文的最大长度
+#define MDNS_WARM_CONFIRM_S 10      // 从缓存文件恢复的记录最长保留时间，期间没有应答的设备按离线处理
 
 /**
  * @brief DNS 消息头部结构
@@ -132,6 +240,17 @@ struct DNSHeader
  */
 class DeviceDiscovery::Impl
 {
+    struct Shard;  // 设备表的一个分片，定义见下文
+
+    /// 应用报文时需要的接收信息，由接收线程在收到报文时取得
+    struct PacketInfo
+    {
+        uint32_t interfaceIndex;                        // 接收接口编号，0 表示未知
+        int family;                                     // kIPv4 或 kIPv6
+        std::chrono::steady_clock::time_point received;  // 接收线程读出报文的时间
+        std::chrono::steady_clock::time_point querySent; // 当时该协议族最近一次查询的时间
+    };
+
 public:
     /**
      * @brief 构造函数
@@ -140,7 +259,10 @@ public:
      * - 初始化网络环境
      * - 初始化内部状态
      */
-    Impl() : running(false), socket_(INVALID_SOCKET)
+    Impl() : shards_(makeShards(1)), snapshot_(std::make_shared<DeviceTable>()), generation_(0),
+        running(false), socket_(INVALID_SOCKET), socket6_(INVALID_SOCKET),
+        responder_(MDNS_MAX_PACKET_SIZE),
+        broadcasting_(false), broadcastSocket_(INVALID_SOCKET)
     {
         LOG_INFO("初始化设备发现服务");
 #ifdef _WIN32
@@ -155,6 +277,7 @@ public:
     ~Impl()
     {
         LOG_INFO("清理设备发现服务");
+        stopBroadcast();
         stopDiscovery();
 #ifdef _WIN32
         WSACleanup();
@@ -172,540 +295,4439 @@ public:
     bool startDiscovery(const std::string& serviceType, const DeviceFoundCallback& callback)
     {
         LOG_INFO("开始mDNS服务发现，服务类型: " << serviceType);
+        return subscribe(serviceType, callback, std::vector<std::string>());
+    }
 
-        if (running)
+    /**
+     * @brief 订阅服务类型，接收线程未运行时启动
+     */
+    bool subscribe(const std::string& serviceType, const DeviceFoundCallback& callback,
+        const std::vector<std::string>& txtKeys)
+    {
+        std::string type = serviceType;
+        if (!type.empty() && type.back() == '.')
         {
-            LOG_WARN("发现服务已在运行");
+            type.pop_back();
+        }
+        mdns::ServiceMatcher check;
+        if (!check.add(type, 0))
+        {
+            LOG_ERROR("无效的服务类型: " << serviceType);
             return false;
         }
 
-        socket_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-        if (socket_ == INVALID_SOCKET)
+        std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
         {
-#ifdef _WIN32
-            auto err = WSAGetLastError();
-#else
-            auto err = strerror(errno);
-#endif
+            std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+            for (const auto& subscription : subscriptions_)
+            {
+                if (mdns::StrRef(subscription.serviceType).equalsIgnoreCase(type))
+                {
+                    LOG_WARN("服务类型已订阅: " << serviceType);
+                    return false;
+                }
+            }
+            subscriptions_.push_back(Subscription{ type, callback, txtKeys });
+            subscriptionsChanged_ = true;
+        }
 
-            LOG_ERROR("Failed to create socket, error: " << err);
+        if (running)
+        {
+            LOG_INFO("添加服务类型订阅: " << type);
+            poller_.wakeup();
+            return true;
+        }
+        if (!startReceiver())
+        {
+            std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+            subscriptions_.clear();
             return false;
         }
+        return true;
+    }
+
+    void unsubscribe(const std::string& serviceType)
+    {
+        // 与 subscribe() 相同，去掉结尾的一个 '.'
+        mdns::StrRef type(serviceType);
+        if (!type.empty() && type[type.size() - 1] == '.')
+        {
+            type = type.substr(0, type.size() - 1);
+        }
+        std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+        for (size_t i = 0; i < subscriptions_.size(); i++)
+        {
+            if (mdns::StrRef(subscriptions_[i].serviceType).equalsIgnoreCase(type))
+            {
+                LOG_INFO("取消服务类型订阅: " << subscriptions_[i].serviceType);
+                subscriptions_.erase(subscriptions_.begin() + i);
+                subscriptionsChanged_ = true;
+                poller_.wakeup();
+                return;
+            }
+        }
+        LOG_WARN("服务类型未订阅: " << serviceType);
+    }
+
+    /**
+     * @brief 创建 UDP 套接字，绑定到 mDNS 端口并加入多播组
+     * @details 发现和广播各用一个套接字，地址重用使两者(以及本机其他 mDNS 程序)都能收到多播报文。
+     * IPv6 套接字设置 IPV6_V6ONLY，与同端口的 IPv4 套接字分别绑定
+     *
+     * @param family AF_INET 加入 224.0.0.251，AF_INET6 加入 ff02::fb
+     * @param joinDefault 是否在系统默认接口上加入多播组，为 false 时由调用方按接口加入
+     * @return 失败时返回 INVALID_SOCKET
+     */
+    SOCKET openMulticastSocket(int family = AF_INET, bool joinDefault = true)
+    {
+        const char* group = family == AF_INET6 ? MDNS_GROUP6 : MDNS_GROUP;
+        SOCKET sock = socket(family, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock == INVALID_SOCKET)
+        {
+            LOG_ERROR("Failed to create socket for " << group << ", error: "
+                << mdns::socketErrorString(mdns::lastSocketError()));
+            return INVALID_SOCKET;
+        }
         LOG_DEBUG("Socket created successfully");
 
         // 设置套接字选项
         int reuse = 1;
-        if (setsockopt(socket_, SOL_SOCKET, SO_REUSEADDR,
+        if (setsockopt(sock, SOL_SOCKET, SO_REUSEADDR,
             (char*)&reuse, sizeof(reuse)) < 0)
         {
             LOG_ERROR("设置SO_REUSEADDR失败");
-            closesocket(socket_);
-            return false;
+            closesocket(sock);
+            return INVALID_SOCKET;
         }
         LOG_DEBUG("套接字选项SO_REUSEADDR设置成功");
 
-        struct sockaddr_in addr;
-        addr.sin_family = AF_INET;
-        addr.sin_port = htons(MDNS_PORT);
-        addr.sin_addr.s_addr = INADDR_ANY;
-
-        if (bind(socket_, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+        bool bound = false;
+        if (family == AF_INET6)
         {
-            LOG_ERROR("Failed to bind socket to port " << MDNS_PORT);
-            closesocket(socket_);
-            return false;
-        }
-        LOG_DEBUG("Socket bound to port " << MDNS_PORT);
+            int v6only = 1;
+            setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, (char*)&v6only, sizeof(v6only));
+
+            struct sockaddr_in6 addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sin6_family = AF_INET6;
+            addr.sin6_port = htons(MDNS_PORT);
+            addr.sin6_addr = in6addr_any;
+            bound = bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0;
 
-        struct ip_mreq mreq;
-        mreq.imr_multiaddr.s_addr = inet_addr(MDNS_GROUP);
-        mreq.imr_interface.s_addr = INADDR_ANY;
-        if (setsockopt(socket_, IPPROTO_IP, IP_ADD_MEMBERSHIP,
-            (char*)&mreq, sizeof(mreq)) < 0)
+            // RFC 6762 11: 多播报文的跳数限制为 255
+            int hops = 255;
+            setsockopt(sock, IPPROTO_IPV6, IPV6_MULTICAST_HOPS, (char*)&hops, sizeof(hops));
+        }
+        else
         {
-            LOG_ERROR("Failed to join multicast group " << MDNS_GROUP);
-            closesocket(socket_);
-            return false;
+            struct sockaddr_in addr;
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(MDNS_PORT);
+            addr.sin_addr.s_addr = INADDR_ANY;
+            bound = bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0;
         }
-        LOG_DEBUG("Joined multicast group " << MDNS_GROUP);
 
-        // 发送初始查询
-        if (!sendQuery(serviceType))
+        if (!bound)
         {
-            LOG_ERROR("发送初始查询失败");
-            closesocket(socket_);
-            return false;
+            LOG_ERROR("Failed to bind socket to port " << MDNS_PORT << " (" << group << ")");
+            closesocket(sock);
+            return INVALID_SOCKET;
         }
-        LOG_DEBUG("初始查询已发送，服务类型: " << serviceType);
-
-        running = true;
-        receiveThread = std::thread([this, callback]()
+        LOG_DEBUG("Socket bound to port " << MDNS_PORT);
+        if (joinDefault)
+        {
+            if (!setMembership(sock, family, nullptr, true))
             {
-                LOG_INFO("Receive thread started");
-                std::array<uint8_t, 1500> buffer;
-                struct sockaddr_in sender;
-                socklen_t senderLen = sizeof(sender);
-
-                while (running) {
-                    int bytes = recvfrom(socket_, (char*)buffer.data(), buffer.size(), 0,
-                        (struct sockaddr*)&sender, &senderLen);
-                    if (bytes < 0) {
-#ifdef _WIN32
-                        auto err = WSAGetLastError();
-#else
-                        auto err = strerror(errno);
-#endif
-
-                        LOG_ERROR("Error receiving data: " << err);
-                        continue;
-                    }
-                    if (bytes > 0) {
-                        LOG_DEBUG("Received " << bytes << " bytes from " <<
-                            inet_ntoa(sender.sin_addr));
-                        parseMDNSResponse(buffer.data(), bytes, sender, callback);
-                    }
-                }
-                LOG_INFO("Receive thread stopped"); });
+                LOG_ERROR("Failed to join multicast group " << group);
+                closesocket(sock);
+                return INVALID_SOCKET;
+            }
+            LOG_DEBUG("Joined multicast group " << group);
+        }
 
-        LOG_INFO("Discovery started successfully");
-        return true;
+        return sock;
     }
 
-    void stopDiscovery()
+    /**
+     * @brief 按接收选项设置套接字接收缓冲区(SO_RCVBUF)
+     * @details 系统可能调整请求的大小(Linux 加倍后受 net.core.rmem_max 限制)，读回实际值记录到日志
+     */
+    void applyReceiveBuffer(SOCKET sock)
     {
-        if (!running)
+        int requested = receive_.socketBufferSize;
+        if (requested <= 0)
         {
-            LOG_DEBUG("Discovery already stopped");
             return;
         }
-
-        LOG_INFO("Stopping discovery");
-        running = false;
-
-        if (socket_ != INVALID_SOCKET)
+        if (setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char*)&requested, sizeof(requested)) != 0)
         {
-            LOG_DEBUG("Closing socket");
-            closesocket(socket_);
-            socket_ = INVALID_SOCKET;
+            LOG_WARN("设置SO_RCVBUF失败: " << mdns::socketErrorString(mdns::lastSocketError()));
+            return;
         }
-
-        if (receiveThread.joinable())
+        int actual = 0;
+        socklen_t length = sizeof(actual);
+        if (getsockopt(sock, SOL_SOCKET, SO_RCVBUF, (char*)&actual, &length) == 0)
         {
-            LOG_DEBUG("Waiting for receive thread to finish");
-            receiveThread.join();
+            LOG_INFO("Socket receive buffer: requested " << requested << " bytes, got " << actual);
+            if (actual < requested)
+            {
+                LOG_WARN("套接字接收缓冲区被系统限制为 " << actual << " 字节");
+            }
         }
-
-        LOG_INFO("Discovery stopped");
     }
 
-    // 获取当前发现的所有设备
-    std::vector<DeviceInfo> getDiscoveredDevices() const
+    /**
+     * @brief 在接口上加入或离开 mDNS 多播组
+     * @details IPv4 按接口地址、IPv6 按接口编号指定接口；已在该接口上加入时视为成功
+     *
+     * @param iface 接口，为 nullptr 时使用系统默认接口
+     */
+    static bool setMembership(SOCKET sock, int family, const mdns::NetworkInterface* iface, bool join)
     {
-        std::lock_guard<std::mutex> lock(devicesMutex);
-        return discoveredDevices;
+        int result;
+        if (family == AF_INET6)
+        {
+            struct ipv6_mreq mreq;
+            std::memset(&mreq, 0, sizeof(mreq));
+            inet_pton(AF_INET6, MDNS_GROUP6, &mreq.ipv6mr_multiaddr);
+            mreq.ipv6mr_interface = iface ? iface->index : 0;
+            result = setsockopt(sock, IPPROTO_IPV6, join ? IPV6_JOIN_GROUP : IPV6_LEAVE_GROUP,
+                (char*)&mreq, sizeof(mreq));
+        }
+        else
+        {
+            struct ip_mreq mreq;
+            mreq.imr_multiaddr.s_addr = inet_addr(MDNS_GROUP);
+            mreq.imr_interface.s_addr = iface ? iface->ipv4.front() : INADDR_ANY;
+            result = setsockopt(sock, IPPROTO_IP, join ? IP_ADD_MEMBERSHIP : IP_DROP_MEMBERSHIP,
+                (char*)&mreq, sizeof(mreq));
+        }
+        return result == 0 || (join && mdns::addressInUse(mdns::lastSocketError()));
     }
 
-private:
-    bool sendQuery(const std::string& serviceType)
+    /**
+     * @brief 重新枚举网络接口，在新接口上加入多播组，离开已消失的接口
+     * @details 消失的接口上最近收到的记录在 1 秒后删除，调用方应重新查询，
+     * 仍能从其他接口收到的记录会被刷新
+     *
+     * @return 接口是否有变化
+     */
+    bool updateInterfaces(mdns::RecordCache::Clock::time_point now)
     {
-        LOG_DEBUG("Preparing mDNS query for " << serviceType);
-
-        std::vector<uint8_t> query;
-        DNSHeader header = { 0 };
-        header.flags = htons(0x0100);
-        header.qdcount = htons(1);
-
-        query.insert(query.end(), (uint8_t*)&header, (uint8_t*)(&header + 1));
-        addDNSName(query, serviceType);
-
-        uint16_t type = htons(12);  // PTR
-        uint16_t qclass = htons(1); // IN
-        query.insert(query.end(), (uint8_t*)&type, (uint8_t*)(&type + 1));
-        query.insert(query.end(), (uint8_t*)&qclass, (uint8_t*)(&qclass + 1));
-
-        struct sockaddr_in addr;
-        addr.sin_family = AF_INET;
-        addr.sin_port = htons(MDNS_PORT);
-        addr.sin_addr.s_addr = inet_addr(MDNS_GROUP);
-
-        int sent = sendto(socket_, (char*)query.data(), query.size(), 0,
-            (struct sockaddr*)&addr, sizeof(addr));
-
-        if (sent < 0)
+        nextInterfaceScan_ = now + std::chrono::milliseconds(MDNS_INTERFACE_SCAN_MS);
+        std::vector<mdns::NetworkInterface> current;
+        if (!mdns::listInterfaces(current) || current == interfaces_)
         {
-#ifdef _WIN32
-            auto err = WSAGetLastError();
-#else
-            auto err = strerror(errno);
-#endif
-
-            LOG_ERROR("Failed to send query: " << err);
             return false;
         }
 
-        LOG_DEBUG("Query sent successfully, " << sent << " bytes");
+        for (const auto& old : interfaces_)
+        {
+            const mdns::NetworkInterface* same = findInterface(current, old.index);
+            if (same && *same == old)
+            {
+                continue;
+            }
+            // 接口已消失时离开多播组会失败，忽略
+            setInterfaceMembership(old, false);
+            if (!same)
+            {
+                size_t records = 0;
+                ShardsLock lock(*this);
+                for (const auto& shard : shards())
+                {
+                    records += shard->recordCache.expireInterface(old.index, now);
+                }
+                LOG_INFO("网络接口已移除: " << old.name << "，" << records << " 条记录将在 1 秒后删除");
+            }
+        }
+        for (const auto& iface : current)
+        {
+            const mdns::NetworkInterface* before = findInterface(interfaces_, iface.index);
+            if (before && *before == iface)
+            {
+                continue;
+            }
+            setInterfaceMembership(iface, true);
+            LOG_INFO((before ? "网络接口地址变化: " : "使用网络接口: ") << iface.name
+                << " (index " << iface.index << ", IPv4 " << iface.ipv4.size()
+                << (iface.ipv6 ? ", IPv6" : "") << ")");
+        }
+        interfaces_.swap(current);
         return true;
     }
 
-    void addDNSName(std::vector<uint8_t>& packet, const std::string& name)
+    static const mdns::NetworkInterface* findInterface(
+        const std::vector<mdns::NetworkInterface>& list, uint32_t index)
     {
-        size_t start = 0;
-        size_t end = name.find('.');
-
-        while (end != std::string::npos)
+        for (const auto& iface : list)
         {
-            std::string label = name.substr(start, end - start);
-            packet.push_back(static_cast<uint8_t>(label.length()));
-            packet.insert(packet.end(), label.begin(), label.end());
-
-            start = end + 1;
-            end = name.find('.', start);
+            if (iface.index == index)
+            {
+                return &iface;
+            }
         }
+        return nullptr;
+    }
 
-        std::string label = name.substr(start);
-        if (!label.empty())
+    void setInterfaceMembership(const mdns::NetworkInterface& iface, bool join)
+    {
+        if (socket_ != INVALID_SOCKET && !iface.ipv4.empty() &&
+            !setMembership(socket_, AF_INET, &iface, join) && join)
         {
-            packet.push_back(static_cast<uint8_t>(label.length()));
-            packet.insert(packet.end(), label.begin(), label.end());
+            LOG_WARN("Failed to join " << MDNS_GROUP << " on " << iface.name << ": "
+                << mdns::socketErrorString(mdns::lastSocketError()));
+        }
+        if (socket6_ != INVALID_SOCKET && iface.ipv6 &&
+            !setMembership(socket6_, AF_INET6, &iface, join) && join)
+        {
+            LOG_WARN("Failed to join " << MDNS_GROUP6 << " on " << iface.name << ": "
+                << mdns::socketErrorString(mdns::lastSocketError()));
         }
-
-        packet.push_back(0); // 终止符
     }
 
-    // 添加一个临时缓存来存储未完成的设备信息
-    std::map<std::string, DeviceInfo> deviceCache;
-
-    void parseMDNSResponse(const uint8_t* data, int size,
-        const sockaddr_in& sender,
-        const DeviceFoundCallback& callback)
+    /**
+     * @brief 接口变化后重新开始持续查询，新链路上的设备不必等待退避间隔
+     */
+    void restartQueries(mdns::RecordCache::Clock::time_point now)
     {
-        LOG_DEBUG("Parsing mDNS response from " << inet_ntoa(sender.sin_addr)
-            << ", size: " << size << " bytes");
-        const uint8_t* basePtr = data;
-        if (size < sizeof(DNSHeader))
+        for (const auto& service : services_)
         {
-            LOG_ERROR("Response too small: " << size << " bytes (minimum "
-                << sizeof(DNSHeader) << " bytes required)");
-            return;
+            scheduler_.remove(service->type, mdns::kTypePTR);
+            scheduler_.add(service->type, mdns::kTypePTR, now);
+            service->peerQueried = false;
         }
+    }
 
-        const DNSHeader* header = reinterpret_cast<const DNSHeader*>(data);
-        uint16_t flags = ntohs(header->flags);
-        bool isResponse = (flags & 0x8000) != 0;
-
-        if (!isResponse)
+    /**
+     * @brief 创建套接字，发送初始查询并启动接收线程
+     * @details 调用方持有 lifecycleMutex_，此时接收线程未运行，可以直接访问接收线程的状态
+     */
+    bool startReceiver()
+    {
+        if (source_)
         {
-            LOG_DEBUG("Ignoring non-response packet (flags: 0x"
-                << std::hex << flags << std::dec << ")");
-            return;
+            return startReplay();
         }
 
-        uint16_t qdcount = ntohs(header->qdcount);
-        uint16_t ancount = ntohs(header->ancount);
-
-        LOG_DEBUG("Response contains " << qdcount << " questions and "
-            << ancount << " answers");
-
-        const uint8_t* ptr = data + sizeof(DNSHeader);
-        const uint8_t* end = data + size;
-
-        // Skip questions
-        for (uint16_t i = 0; i < qdcount; i++)
+        // 只有一个协议族可用时(例如纯 IPv6 网段)只使用该协议族
+        socket_ = openMulticastSocket(AF_INET, false);
+        socket6_ = openMulticastSocket(AF_INET6, false);
+        if (socket_ == INVALID_SOCKET && socket6_ == INVALID_SOCKET)
         {
-            std::string qname;
-            if (parseDNSName(basePtr, ptr, end, qname))
-            {
-                ptr += 4; // Skip QTYPE and QCLASS
-            }
+            return false;
         }
-
-        try
+        if (socket_ == INVALID_SOCKET)
+        {
+            LOG_WARN("IPv4 不可用，只使用 IPv6 发现设备");
+        }
+        else if (socket6_ == INVALID_SOCKET)
         {
-            DeviceInfo tempInfo;
-            tempInfo.ip = inet_ntoa(sender.sin_addr);
-            bool isTargetService = false;
+            LOG_WARN("IPv6 不可用，只使用 IPv4 发现设备");
+        }
 
-            // Parse answer records
-            for (uint16_t i = 0; i < ancount; i++)
+        // 接收线程在 poller_ 上等待，套接字可读时一次读出所有排队的报文
+        if ((socket_ != INVALID_SOCKET && !mdns::setNonBlocking(socket_)) ||
+            (socket6_ != INVALID_SOCKET && !mdns::setNonBlocking(socket6_)))
+        {
+            LOG_ERROR("设置非阻塞模式失败");
+            closeSockets();
+            return false;
+        }
+        for (SOCKET sock : { socket_, socket6_ })
+        {
+            if (sock != INVALID_SOCKET &&
+                !mdns::DatagramBatch::enablePacketInfo(sock, sock == socket6_ ? AF_INET6 : AF_INET))
             {
-                std::string name;
-                uint16_t type;
-                uint16_t rdlength;
-                const uint8_t* rdata;
-
-                if (!parseRecordHeader(basePtr, ptr, end, name, type, rdlength, rdata))
-                {
-                    LOG_WARN("Failed to parse record header");
-                    continue;
-                }
-
-                // 检查是否是我们感兴趣的服务
-                if (name.find("_leboremote._tcp.local") != std::string::npos)
-                {
-                    isTargetService = true;
-                    tempInfo.name = name;
-                }
-
-                switch (type)
-                {
-                case 16: // TXT
-                {
-                    if (isTargetService) {
-                        auto tempPtr = rdata;
-                        parseTXT(tempPtr, rdlength, tempInfo.txtRecords);
-                        LOG_DEBUG("Found TXT records, count: " << tempInfo.txtRecords.size());
-                        for (const auto& txt : tempInfo.txtRecords) {
-                            LOG_DEBUG("  " << txt.first << " = " << txt.second);
-                        }
-                        //
-                    }
-                }
-                break;
-                }
-
-                ptr = rdata + rdlength;
+                LOG_WARN("无法取得报文的接收接口，记录不标记接口");
             }
-
-            // 只有当设备信息完整且是目标服务时才通知
-            if (!tempInfo.name.empty() && isTargetService)
+            if (sock != INVALID_SOCKET && mdns::DatagramBatch::enableDropCounter(sock))
+            {
+                lastDrops_[sock == socket6_ ? kIPv6 : kIPv4] = 0;
+            }
+            if (sock != INVALID_SOCKET)
             {
-                std::lock_guard<std::mutex> lock(devicesMutex);
-                auto it = std::find_if(discoveredDevices.begin(),
-                    discoveredDevices.end(),
-                    [&](const DeviceInfo& d) {
-                        return d.name == tempInfo.name;
-                    });
+                applyReceiveBuffer(sock);
+            }
+        }
 
-                if (it == discoveredDevices.end())
-                {
-                    discoveredDevices.push_back(tempInfo);
-                    LOG_INFO("Device Information [" << discoveredDevices.size() - 1 << "]:");
-                    LOG_INFO("  Name: " << tempInfo.name);
-                    LOG_INFO("  IP: " << tempInfo.ip);
-                    LOG_INFO("  TXT Records: " << tempInfo.txtRecords.size());
-                    for (const auto& txt : tempInfo.txtRecords) {
-                        LOG_INFO("    " << txt.first << " = " << txt.second);
-                    }
-                    callback(tempInfo);
-                }
-                else
+        resetReceiverState();
+        limiter_.configure(receive_.sourceRate, receive_.sourceBurst, receive_.maxSources);
+
+        // 在每个接口上加入多播组，枚举不到接口时使用系统默认接口
+        mdns::RecordCache::Clock::time_point now = mdns::RecordCache::Clock::now();
+        interfaces_.clear();
+        updateInterfaces(now);
+        if (interfaces_.empty())
+        {
+            LOG_WARN("没有枚举到可用的网络接口，使用系统默认接口");
+            for (SOCKET sock : { socket_, socket6_ })
+            {
+                int family = sock == socket6_ ? AF_INET6 : AF_INET;
+                if (sock != INVALID_SOCKET && !setMembership(sock, family, nullptr, true))
                 {
-                    size_t index = std::distance(discoveredDevices.begin(), it);
-                    if (!tempInfo.txtRecords.empty())
-                    {
-                        // 只在有新的TXT记录时更新
-                        it->txtRecords = tempInfo.txtRecords;
-                        it->ip = tempInfo.ip;
-                        LOG_INFO("Device Updated [" << index << "]:");
-                        LOG_INFO("  Name: " << it->name);
-                        LOG_INFO("  IP: " << it->ip);
-                        LOG_INFO("  TXT Records: " << it->txtRecords.size());
-                        for (const auto& txt : it->txtRecords) {
-                            LOG_INFO("    " << txt.first << " = " << txt.second);
-                        }
-                        callback(*it);
-                    }
+                    LOG_ERROR("Failed to join multicast group "
+                        << (family == AF_INET6 ? MDNS_GROUP6 : MDNS_GROUP));
                 }
             }
         }
-        catch (const std::exception& e)
-        {
-            LOG_ERROR("Exception while parsing response: " << e.what());
-        }
-    }
 
-    bool parseRecordHeader(const uint8_t*& basePtr, const uint8_t*& ptr, const uint8_t* end,
-        std::string& name, uint16_t& type,
-        uint16_t& rdlength, const uint8_t*& rdata)
-    {
-        if (!parseDNSName(basePtr, ptr, end, name))
+        // 建立订阅并立即发送初始查询，之后由调度器持续查询。缓存文件中的记录在查询前恢复，
+        // 不作为已知答案，设备会完整应答一次
+        applySubscriptions(now);
+        restoreCache(now);
+        nextCacheSave_ = now + std::chrono::milliseconds(cacheSaveInterval_);
+        if (!runScheduler(now))
         {
-            LOG_ERROR("Failed to parse DNS name in record header");
+            LOG_ERROR("发送初始查询失败");
+            closeSockets();
             return false;
         }
+        LOG_DEBUG("初始查询已发送，订阅数: " << services_.size());
 
-        if (ptr + 10 > end)
+        if (!poller_.valid() || (socket_ != INVALID_SOCKET && !poller_.add(socket_)) ||
+            (socket6_ != INVALID_SOCKET && !poller_.add(socket6_)))
         {
-            LOG_ERROR("Record header parse failed: insufficient data for header (need 10 bytes)");
+            LOG_ERROR("创建事件等待失败");
+            closeSockets();
             return false;
         }
+        // 没有接口变化通知时只靠定期枚举
+        if (interfaceMonitor_.handle() != INVALID_SOCKET)
+        {
+            interfaceMonitor_.drain();
+            poller_.add(interfaceMonitor_.handle());
+        }
 
-        type = (ptr[0] << 8) | ptr[1];
-        uint16_t rclass = (ptr[2] << 8) | ptr[3];
-        uint32_t ttl = (ptr[4] << 24) | (ptr[5] << 16) | (ptr[6] << 8) | ptr[7];
-        rdlength = (ptr[8] << 8) | ptr[9];
-        ptr += 10;
+        startWorkers();
+        running = true;
+        receiveThread = std::thread([this]() { runReceiver(); });
 
-        LOG_DEBUG("Record header - Type: " << type << ", Class: " << rclass
-            << ", TTL: " << ttl << ", Length: " << rdlength);
+        LOG_INFO("Discovery started successfully");
+        return true;
+    }
 
-        if (ptr + rdlength > end)
+    /// 上一次发现留下的记录和订阅状态不再有效，接收线程未运行时调用
+    void resetReceiverState()
+    {
+        for (const auto& shard : shards())
         {
-            LOG_ERROR("Record data parse failed: data length " << rdlength << " exceeds buffer");
-            return false;
+            shard->recordCache.clear();
+            shard->hostInstances.clear();
+            shard->pending.clear();
+            shard->requests.clear();
         }
-
-        rdata = ptr;
-        return true;
+        router_.clear();
+        scheduler_.clear();
+        services_.clear();
+        matcher_.clear();
+        querySent_.fill(mdns::RecordCache::Clock::time_point());
     }
 
     /**
-     * @brief 解析 DNS 名称
-     *
-     * 支持 DNS 消息压缩，处理以下情况:
-     * - 普通名称标签序列
-     * - 压缩指针引用
-     * - 混合压缩形式
-     *
-     * @param basePtr 消息起始位置
-     * @param ptr 当前解析位置
-     * @param end 消息结束位置
-     * @param name 解析得到的名称
-     * @return true 解析成功
-     * @return false 解析失败
+     * @brief 启动回放线程，代替套接字从 source_ 中取出报文
+     * @details 调用方持有 lifecycleMutex_
      */
-    bool parseDNSName(const uint8_t*& basePtr, const uint8_t*& ptr, const uint8_t* end, std::string& name)
+    bool startReplay()
     {
-        name.clear();
-        bool first = true;
-
-        while (ptr < end)
+        resetReceiverState();
+        interfaces_.clear();
+        applySubscriptions(mdns::RecordCache::Clock::now());
         {
-            uint8_t len = *ptr++;
-
-            // Check for DNS name compression (high 2 bits set)
-            if (len & 0xC0)
-            {
+            std::lock_guard<std::mutex> lock(replayMutex_);
+            replayActive_ = true;
+            replayFinished_ = false;
+        }
 
-                // Calculate offset from compression pointer
-                uint16_t offset = ((len & 0x3F) << 8) | *ptr;
-                const uint8_t* newPtr = basePtr + offset;
+        startWorkers();
+        running = true;
+        receiveThread = std::thread([this]() { runReplay(); });
+        LOG_INFO("Replay started ("
+            << (replayOptions_.timing == ReplayOptions::Timing::Original ? "original timing" : "full speed")
+            << ", speed " << replayOptions_.speed << ")");
+        return true;
+    }
 
-                if (newPtr >= end || newPtr < basePtr)
+    /// 接收线程中与报文无关的定时任务，回放时不发送查询
+    void replayHousekeeping(mdns::RecordCache::Clock::time_point now)
+    {
+        if (subscriptionsChanged_)
+        {
+            applySubscriptions(now);
+        }
+        if (pipelined_)
+        {
+            drainShardRequests(now);
+            return;
+        }
+        Shard& shard = *shards().front();
+        expireRecords(shard, now);
+        resolvePending(shard, now);
+        deliverEvents(shard, now, false);
+        runDeferredCallbacks(shard);
+        shard.metrics.cacheSize.set(shard.recordCache.size());
+    }
+
+    /**
+     * @brief 回放线程: 逐个取出报文并解析，来源结束或停止时退出
+     */
+    void runReplay()
+    {
+        LOG_INFO("Replay thread started");
+        typedef mdns::RecordCache::Clock Clock;
+        PacketSource::Packet packet;
+        bool original = replayOptions_.timing == ReplayOptions::Timing::Original;
+        int64_t firstTimestamp = -1;
+        Clock::time_point start;
+        uint64_t packets = 0;
+        bool ended = false;
+        std::vector<SOCKET> ready;
+
+        while (running)
+        {
+            Clock::time_point now = Clock::now();
+            replayHousekeeping(now);
+            int result = source_->next(packet, waitTimeout(receiverDeadline(), now));
+            if (result < 0)
+            {
+                ended = true;
+                break;
+            }
+            if (result == 0)
+            {
+                continue;
+            }
+
+            if (original && packet.timestampUs >= 0)
+            {
+                if (firstTimestamp < 0)
+                {
+                    firstTimestamp = packet.timestampUs;
+                    start = now;
+                }
+                Clock::time_point due = start + std::chrono::microseconds(static_cast<int64_t>(
+                    (packet.timestampUs - firstTimestamp) / replayOptions_.speed));
+                // 等待期间照常处理到期的事件，stopDiscovery() 通过 poller_ 唤醒
+                while (running && (now = Clock::now()) < due)
+                {
+                    replayHousekeeping(now);
+                    poller_.wait(waitTimeout(std::min(due, receiverDeadline()), now), ready);
+                }
+                if (!running)
+                {
+                    break;
+                }
+            }
+            processReplayed(packet);
+            packets++;
+        }
+
+        // 来源结束时解析线程先处理完队列中的报文，waitForReplay() 返回时事件已全部投递
+        finishReceiver(ended);
+        std::string error = source_->error();
+        if (!error.empty())
+        {
+            LOG_ERROR("Packet source failed: " << error);
+        }
+        LOG_INFO("Replay thread stopped, " << packets << " packets" << (ended ? "" : " (interrupted)"));
+        {
+            std::lock_guard<std::mutex> lock(replayMutex_);
+            replayActive_ = false;
+            replayFinished_ = ended;
+        }
+        replayDone_.notify_all();
+    }
+
+    /// 处理报文来源中的一个报文
+    void processReplayed(const PacketSource::Packet& packet)
+    {
+        metrics_.packetsReceived.add();
+        metrics_.bytesReceived.add(packet.size);
+        // 与套接字接收相同，超过接收缓冲区的部分被截断
+        size_t size = packet.size;
+        if (size > receive_.maxPacketSize)
+        {
+            metrics_.oversizePackets.add();
+            size = receive_.maxPacketSize;
+        }
+        if (capturing_.load(std::memory_order_relaxed))
+        {
+            std::lock_guard<std::mutex> lock(captureMutex_);
+            if (capture_)
+            {
+                capture_->write(packet.data, packet.size, packet.sender, packet.senderPort,
+                    packet.timestampUs >= 0 ? packet.timestampUs : unixMicros());
+            }
+        }
+        sockaddr_storage sender = toSockaddr(packet.sender, packet.senderPort);
+        parseMDNSResponse(packet.data, static_cast<int>(size), sender, packet.interfaceIndex);
+    }
+
+    bool setPacketSource(const std::shared_ptr<PacketSource>& source, const ReplayOptions& options)
+    {
+        std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+        if (running)
+        {
+            LOG_WARN("发现正在运行，不能更换报文来源");
+            return false;
+        }
+        source_ = source;
+        replayOptions_ = options;
+        if (!(replayOptions_.speed > 0))
+        {
+            replayOptions_.speed = 1.0;
+        }
+        return true;
+    }
+
+    bool waitForReplay(uint32_t timeoutMs) const
+    {
+        std::unique_lock<std::mutex> lock(replayMutex_);
+        auto done = [this] { return !replayActive_; };
+        if (timeoutMs == UINT32_MAX)
+        {
+            replayDone_.wait(lock, done);
+        }
+        else if (!replayDone_.wait_for(lock, std::chrono::milliseconds(timeoutMs), done))
+        {
+            return false;
+        }
+        return replayFinished_;
+    }
+
+    bool startCapture(const std::string& path)
+    {
+        std::unique_ptr<mdns::CaptureWriter> writer(new mdns::CaptureWriter());
+        if (!writer->open(path))
+        {
+            LOG_ERROR("无法创建抓包文件: " << path << ": " << std::strerror(errno));
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(captureMutex_);
+        capture_ = std::move(writer);
+        capturing_ = true;
+        LOG_INFO("开始写入抓包文件: " << path);
+        return true;
+    }
+
+    void stopCapture()
+    {
+        std::lock_guard<std::mutex> lock(captureMutex_);
+        if (!capture_)
+        {
+            return;
+        }
+        capturing_ = false;
+        capture_.reset();
+        LOG_INFO("抓包文件已关闭");
+    }
+
+    /// 把一批收到的报文写入抓包文件
+    void captureBatch(const mdns::DatagramBatch& batch, int count)
+    {
+        std::lock_guard<std::mutex> lock(captureMutex_);
+        if (!capture_)
+        {
+            return;
+        }
+        int64_t now = unixMicros();
+        for (int i = 0; i < count; i++)
+        {
+            uint16_t port = 0;
+            IpAddress sender = toIpAddress(batch.sender(i), &port);
+            capture_->write(batch.data(i), batch.size(i), sender, port, now);
+        }
+        capture_->flush();
+    }
+
+    static int64_t unixMicros()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /// 套接字地址转换为二进制地址和端口
+    static IpAddress toIpAddress(const sockaddr_storage& address, uint16_t* port)
+    {
+        IpAddress ip;
+        if (address.ss_family == AF_INET6)
+        {
+            const sockaddr_in6& in6 = reinterpret_cast<const sockaddr_in6&>(address);
+            ip.family = IpAddress::Family::IPv6;
+            std::memcpy(ip.bytes.data(), &in6.sin6_addr, 16);
+            ip.scopeId = in6.sin6_scope_id;
+            *port = ntohs(in6.sin6_port);
+        }
+        else
+        {
+            const sockaddr_in& in4 = reinterpret_cast<const sockaddr_in&>(address);
+            ip.family = IpAddress::Family::IPv4;
+            std::memcpy(ip.bytes.data(), &in4.sin_addr, 4);
+            *port = ntohs(in4.sin_port);
+        }
+        return ip;
+    }
+
+    static sockaddr_storage toSockaddr(const IpAddress& ip, uint16_t port)
+    {
+        sockaddr_storage address;
+        std::memset(&address, 0, sizeof(address));
+        if (ip.family == IpAddress::Family::IPv6)
+        {
+            sockaddr_in6& in6 = reinterpret_cast<sockaddr_in6&>(address);
+            in6.sin6_family = AF_INET6;
+            in6.sin6_port = htons(port);
+            std::memcpy(&in6.sin6_addr, ip.bytes.data(), 16);
+            in6.sin6_scope_id = ip.scopeId;
+        }
+        else
+        {
+            sockaddr_in& in4 = reinterpret_cast<sockaddr_in&>(address);
+            in4.sin_family = AF_INET;
+            in4.sin_port = htons(port);
+            std::memcpy(&in4.sin_addr, ip.bytes.data(), 4);
+        }
+        return address;
+    }
+
+    /**
+     * @brief 接收线程: 在 poller_ 上等待报文、下一次查询时间或唤醒
+     * @details 每次唤醒先处理订阅变化和定时任务，套接字可读时用一次批量读取取出排队的报文
+     */
+    void runReceiver()
+    {
+        LOG_INFO("Receive thread started");
+        mdns::DatagramBatch batch(MDNS_RECV_BATCH, receive_.maxPacketSize);
+        // 流水线模式下批量接收的每个位置收到缓冲池的缓冲区中，交给分片后再取一个新的
+        std::vector<mdns::PooledPacket*> slots(pipelined_ ? batch.capacity() : 0, nullptr);
+        std::vector<SOCKET> ready;
+
+        while (running)
+        {
+            mdns::RecordCache::Clock::time_point now = mdns::RecordCache::Clock::now();
+            if (subscriptionsChanged_)
+            {
+                applySubscriptions(now);
+            }
+            if (now >= nextInterfaceScan_ && updateInterfaces(now))
+            {
+                restartQueries(now);
+            }
+            // 流水线模式下分片的定时任务由各自的解析线程执行
+            Shard& shard = *shards().front();
+            if (pipelined_)
+            {
+                drainShardRequests(now);
+            }
+            else
+            {
+                expireRecords(shard, now);
+                resolvePending(shard, now);
+            }
+            drainResolveRequests(now);
+            runScheduler(now);
+            if (cacheSaveInterval_ > 0 && now >= nextCacheSave_)
+            {
+                saveCache(now);
+                nextCacheSave_ = now + std::chrono::milliseconds(cacheSaveInterval_);
+            }
+            if (!pipelined_)
+            {
+                deliverEvents(shard, now, false);
+                runDeferredCallbacks(shard);
+                shard.metrics.cacheSize.set(shard.recordCache.size());
+            }
+
+            mdns::RecordCache::Clock::time_point deadline =
+                std::min(scheduler_.nextDue(), receiverDeadline());
+            if (poller_.wait(waitTimeout(deadline, now), ready) < 0)
+            {
+                LOG_ERROR("Poll failed: " << mdns::socketErrorString(mdns::lastSocketError()));
+                break;
+            }
+            for (SOCKET sock : ready)
+            {
+                if (sock == interfaceMonitor_.handle())
+                {
+                    // 在下一次循环中重新枚举
+                    if (interfaceMonitor_.drain())
+                    {
+                        nextInterfaceScan_ = now;
+                    }
+                    continue;
+                }
+                fillSlots(batch, slots);
+                int count = batch.receive(sock);
+                if (count < 0)
+                {
+                    logReceiveError(batch.error());
+                    continue;
+                }
+                receiveErrors_ = 0;
+                countReceived(batch, count, sock == socket6_ ? kIPv6 : kIPv4);
+                if (capturing_.load(std::memory_order_relaxed))
+                {
+                    captureBatch(batch, count);
+                }
+                mdns::RecordCache::Clock::time_point received = mdns::RecordCache::Clock::now();
+                for (int i = 0; i < count; i++)
+                {
+                    LOG_DEBUG("Received " << batch.size(i) << " bytes from " <<
+                        addressString(batch.sender(i)) << " on interface " << batch.interfaceIndex(i));
+                    if (!admitSource(batch.sender(i), received))
+                    {
+                        continue;
+                    }
+                    parseMDNSResponse(batch.data(i), static_cast<int>(batch.size(i)),
+                        batch.sender(i), batch.interfaceIndex(i), slots.empty() ? nullptr : &slots[i]);
+                }
+            }
+        }
+        // 未交给分片的缓冲区随缓冲池一起释放
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            batch.setBuffer(i, nullptr);
+        }
+        finishReceiver(false);
+        LOG_INFO("Receive thread stopped");
+    }
+
+    /// 为已交给分片的位置取新的缓冲区，缓冲池为空时使用批量接收的内部缓冲区
+    void fillSlots(mdns::DatagramBatch& batch, std::vector<mdns::PooledPacket*>& slots)
+    {
+        for (size_t i = 0; i < slots.size(); i++)
+        {
+            if (!slots[i])
+            {
+                slots[i] = pool_->acquire();
+                batch.setBuffer(i, slots[i] ? slots[i]->data : nullptr);
+            }
+        }
+    }
+
+    /// 等待到 deadline，最多 MDNS_RECV_TIMEOUT_MS 毫秒
+    static int waitTimeout(mdns::RecordCache::Clock::time_point deadline,
+        mdns::RecordCache::Clock::time_point now)
+    {
+        if (deadline <= now)
+        {
+            return 0;
+        }
+        if (deadline >= now + std::chrono::milliseconds(MDNS_RECV_TIMEOUT_MS))
+        {
+            return MDNS_RECV_TIMEOUT_MS;
+        }
+        return static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - now).count()) + 1;
+    }
+
+    /// 接收线程需要处理的事件合并窗口的截止时间，流水线模式下由解析线程处理
+    mdns::RecordCache::Clock::time_point receiverDeadline() const
+    {
+        return pipelined_ ? mdns::RecordCache::Clock::time_point::max() :
+            eventDeadline(*shards().front());
+    }
+
+    /**
+     * @brief 接收线程退出前投递合并窗口尚未到期的事件
+     *
+     * @param drain 流水线模式下解析线程是否先处理完队列中的报文，为 false 时丢弃
+     */
+    void finishReceiver(bool drain)
+    {
+        if (pipelined_)
+        {
+            stopWorkers(drain);
+            return;
+        }
+        Shard& shard = *shards().front();
+        deliverEvents(shard, mdns::RecordCache::Clock::now(), true);
+        runDeferredCallbacks(shard);
+    }
+
+    /**
+     * @brief 记录接收错误
+     * @details 套接字错误在读取后清除，接收线程回到等待而不是空转；
+     * 连续的错误只记录第一次和之后每 100 次
+     */
+    void logReceiveError(int error)
+    {
+        metrics_.receiveErrors.add();
+        if (receiveErrors_++ % 100 == 0)
+        {
+            LOG_ERROR("Error receiving data: " << mdns::socketErrorString(error)
+                << " (" << receiveErrors_ << " consecutive)");
+        }
+    }
+
+    /// 统计一批收到的报文和套接字的内核丢包数
+    void countReceived(const mdns::DatagramBatch& batch, int count, int family)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            metrics_.packetsReceived.add();
+            metrics_.bytesReceived.add(batch.size(i));
+            if (batch.truncated(i))
+            {
+                metrics_.oversizePackets.add();
+            }
+        }
+        uint32_t drops = 0;
+        if (batch.dropCount(drops))
+        {
+            // 累计值按 32 位回绕，差值即本次新增的丢包数
+            uint32_t added = drops - lastDrops_[family];
+            lastDrops_[family] = drops;
+            if (added != 0)
+            {
+                metrics_.socketDrops.add(added);
+                LOG_WARN("Kernel dropped " << added << " packet(s): receive buffer full");
+            }
+        }
+    }
+
+    /**
+     * @brief 按来源地址限速
+     * @details 在解析之前调用，回放的报文不限速。来源开始被限速时记录一次日志
+     */
+    bool admitSource(const sockaddr_storage& sender, mdns::RecordCache::Clock::time_point now)
+    {
+        bool firstDrop = false;
+        if (limiter_.allow(sender, now, firstDrop))
+        {
+            return true;
+        }
+        metrics_.rateLimited.add();
+        if (firstDrop)
+        {
+            LOG_WARN("来源 " << addressString(sender) << " 发送过快，超出 "
+                << receive_.sourceRate << " 个报文/秒的部分被丢弃");
+        }
+        return false;
+    }
+
+    /// 统计头部检查拒绝的报文
+    void countRejected(mdns::HeaderCheck check)
+    {
+        if (check == mdns::HeaderCheck::BadPort)
+        {
+            metrics_.rejectedPort.add();
+        }
+        else
+        {
+            metrics_.rejectedHeader.add();
+        }
+    }
+
+    void countParseError(mdns::ParseError error)
+    {
+        countParseError(metrics_.parseErrors, error);
+    }
+
+    static void countParseError(std::array<mdns::Counter, mdns::kParseErrorCount>& counters,
+        mdns::ParseError error)
+    {
+        size_t index = static_cast<size_t>(error);
+        if (index < counters.size())
+        {
+            counters[index].add();
+        }
+    }
+
+    void countRecord(uint16_t type)
+    {
+        switch (type)
+        {
+        case mdns::kTypePTR: metrics_.recordsPTR.add(); break;
+        case mdns::kTypeSRV: metrics_.recordsSRV.add(); break;
+        case mdns::kTypeTXT: metrics_.recordsTXT.add(); break;
+        case mdns::kTypeA: metrics_.recordsA.add(); break;
+        case mdns::kTypeAAAA: metrics_.recordsAAAA.add(); break;
+        default: metrics_.recordsOther.add(); break;
+        }
+    }
+
+    DiscoveryStats getStats() const
+    {
+        DiscoveryStats stats;
+        stats.packetsReceived = metrics_.packetsReceived.load();
+        stats.bytesReceived = metrics_.bytesReceived.load();
+        stats.queriesReceived = metrics_.queriesReceived.load();
+        stats.packetsSent = metrics_.packetsSent.load();
+        stats.bytesSent = metrics_.bytesSent.load();
+        stats.sendErrors = metrics_.sendErrors.load();
+        stats.receiveErrors = metrics_.receiveErrors.load();
+        stats.responsesSent = metrics_.responsesSent.load();
+        stats.socketDrops = metrics_.socketDrops.load();
+        stats.oversizePackets = metrics_.oversizePackets.load();
+        stats.rejectedHeader = metrics_.rejectedHeader.load();
+        stats.rejectedPort = metrics_.rejectedPort.load();
+        stats.rateLimited = metrics_.rateLimited.load();
+
+        // 记录数据的解析失败和缓存统计由各分片分别计数
+        ShardSetPtr shards = std::atomic_load(&shards_);
+        typedef mdns::ParseError E;
+        auto parseErrors = [this, &shards](E error)
+        {
+            size_t index = static_cast<size_t>(error);
+            uint64_t count = metrics_.parseErrors[index].load();
+            for (const auto& shard : *shards)
+            {
+                count += shard->metrics.parseErrors[index].load();
+            }
+            return count;
+        };
+        stats.parseTruncated = parseErrors(E::Truncated);
+        stats.parseBadPointer = parseErrors(E::BadPointer);
+        stats.parsePointerLimit = parseErrors(E::PointerLimit);
+        stats.parseLabelLimit = parseErrors(E::LabelLimit);
+        stats.parseNameTooLong = parseErrors(E::NameTooLong);
+        stats.parseBadLabelType = parseErrors(E::BadLabelType);
+        stats.parseBadRdata = parseErrors(E::BadRdata);
+
+        stats.recordsPTR = metrics_.recordsPTR.load();
+        stats.recordsSRV = metrics_.recordsSRV.load();
+        stats.recordsTXT = metrics_.recordsTXT.load();
+        stats.recordsA = metrics_.recordsA.load();
+        stats.recordsAAAA = metrics_.recordsAAAA.load();
+        stats.recordsOther = metrics_.recordsOther.load();
+
+        for (const auto& shard : *shards)
+        {
+            stats.cacheInserts += shard->metrics.cacheInserts.load();
+            stats.cacheHits += shard->metrics.cacheHits.load();
+            stats.cacheGoodbyes += shard->metrics.cacheGoodbyes.load();
+            stats.cacheEvictions += shard->metrics.cacheEvictions.load();
+            stats.cacheSize += shard->metrics.cacheSize.load();
+        }
+        stats.pipelineDrops = metrics_.pipelineDrops.load();
+
+        stats.callbacks = dispatcher_.stats();
+        dispatcher_.latency().snapshot(stats.callbackLatency);
+        metrics_.queryLatency.snapshot(stats.queryLatency);
+        return stats;
+    }
+
+    void stopDiscovery()
+    {
+        std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+        {
+            std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+            subscriptions_.clear();
+            subscriptionsChanged_ = true;
+        }
+
+        if (!running)
+        {
+            LOG_DEBUG("Discovery already stopped");
+            return;
+        }
+
+        LOG_INFO("Stopping discovery");
+        running = false;
+        notifyTableWaiters();
+        poller_.wakeup();
+        if (source_)
+        {
+            source_->interrupt();
+        }
+
+        // 接收线程退出后再关闭套接字，避免线程仍在使用已关闭(可能已被复用)的描述符
+        if (receiveThread.joinable())
+        {
+            LOG_DEBUG("Waiting for receive thread to finish");
+            receiveThread.join();
+        }
+        if (!source_)
+        {
+            saveCache(mdns::RecordCache::Clock::now());
+        }
+
+        LOG_DEBUG("Closing socket");
+        closeSockets();
+
+        LOG_INFO("Discovery stopped");
+    }
+
+    // 关闭发现使用的套接字，接收线程未运行时调用
+    void closeSockets()
+    {
+        poller_.remove(interfaceMonitor_.handle());
+        for (SOCKET* sock : { &socket_, &socket6_ })
+        {
+            if (*sock != INVALID_SOCKET)
+            {
+                poller_.remove(*sock);
+                closesocket(*sock);
+                *sock = INVALID_SOCKET;
+            }
+        }
+    }
+
+    /// 套接字地址的文本形式
+    static std::string addressString(const sockaddr_storage& address)
+    {
+        char text[INET6_ADDRSTRLEN] = { 0 };
+        if (address.ss_family == AF_INET6)
+        {
+            inet_ntop(AF_INET6, (void*)&reinterpret_cast<const sockaddr_in6&>(address).sin6_addr,
+                text, sizeof(text));
+        }
+        else
+        {
+            inet_ntop(AF_INET, (void*)&reinterpret_cast<const sockaddr_in&>(address).sin_addr,
+                text, sizeof(text));
+        }
+        return text;
+    }
+
+    /**
+     * @brief 开始广播设备，服务类型使用默认值，端口取自 TXT 记录的 "port" 项
+     */
+    bool startBroadcast(const std::string& deviceName,
+        const std::map<std::string, std::string>& txtRecords)
+    {
+        ServiceAdvertisement advertisement;
+        advertisement.name = deviceName;
+        advertisement.txtRecords = txtRecords;
+        auto port = txtRecords.find("port");
+        if (port != txtRecords.end())
+        {
+            char* end = nullptr;
+            unsigned long value = std::strtoul(port->second.c_str(), &end, 10);
+            if (end != port->second.c_str() && *end == '\0' && value <= 0xFFFF)
+            {
+                advertisement.port = static_cast<uint16_t>(value);
+            }
+        }
+        return startBroadcast(advertisement);
+    }
+
+    /**
+     * @brief 生成记录，创建广播套接字并启动广播线程
+     */
+    bool startBroadcast(const ServiceAdvertisement& advertisement)
+    {
+        std::lock_guard<std::mutex> lifecycle(broadcastLifecycleMutex_);
+        if (broadcasting_)
+        {
+            LOG_WARN("设备广播已在运行");
+            return false;
+        }
+        LOG_INFO("开始设备广播: " << advertisement.name << "." << advertisement.serviceType);
+
+        mdns::Responder::Service service;
+        service.name = advertisement.name;
+        service.serviceType = advertisement.serviceType;
+        service.host = advertisement.host.empty() ? localHostName() : advertisement.host;
+        service.port = advertisement.port;
+        service.txtRecords = advertisement.txtRecords;
+        uint32_t address = 0;
+        if (!localAddress(address))
+        {
+            LOG_ERROR("没有可用的本机IPv4地址，无法广播");
+            return false;
+        }
+        service.addresses.push_back(address);
+
+        mdns::Responder::Clock::time_point now = mdns::Responder::Clock::now();
+        if (!responder_.start(service, now))
+        {
+            LOG_ERROR("广播的实例名、服务类型或TXT记录格式错误");
+            return false;
+        }
+
+        broadcastSocket_ = openMulticastSocket();
+        if (broadcastSocket_ == INVALID_SOCKET || !mdns::setNonBlocking(broadcastSocket_) ||
+            !broadcastPoller_.valid() || !broadcastPoller_.add(broadcastSocket_))
+        {
+            LOG_ERROR("创建广播套接字失败");
+            if (broadcastSocket_ != INVALID_SOCKET)
+            {
+                closesocket(broadcastSocket_);
+                broadcastSocket_ = INVALID_SOCKET;
+            }
+            outgoing_.clear();
+            responder_.stop(now, outgoing_);
+            return false;
+        }
+        // RFC 6762 11: 多播报文的 IP TTL 为 255
+        int ttl = 255;
+        if (setsockopt(broadcastSocket_, IPPROTO_IP, IP_MULTICAST_TTL,
+            (char*)&ttl, sizeof(ttl)) < 0)
+        {
+            LOG_WARN("设置IP_MULTICAST_TTL失败");
+        }
+
+        char text[INET_ADDRSTRLEN];
+        LOG_INFO("广播主机: " << service.host << " 地址: "
+            << inet_ntop(AF_INET, &address, text, sizeof(text)) << " 端口: " << service.port);
+
+        broadcastChanged_ = false;
+        broadcasting_ = true;
+        broadcastThread_ = std::thread([this]() { runBroadcast(); });
+        return true;
+    }
+
+    bool updateBroadcastTxt(const std::map<std::string, std::string>& txtRecords)
+    {
+        std::string rdata;
+        if (!mdns::Responder::encodeTxt(txtRecords, rdata))
+        {
+            LOG_ERROR("TXT记录格式错误");
+            return false;
+        }
+        std::lock_guard<std::mutex> lifecycle(broadcastLifecycleMutex_);
+        if (!broadcasting_)
+        {
+            LOG_WARN("设备广播未运行");
+            return false;
+        }
+        std::lock_guard<std::mutex> lock(broadcastMutex_);
+        pendingTxt_ = txtRecords;
+        broadcastChanged_ = true;
+        broadcastPoller_.wakeup();
+        return true;
+    }
+
+    void stopBroadcast()
+    {
+        std::lock_guard<std::mutex> lifecycle(broadcastLifecycleMutex_);
+        if (!broadcasting_)
+        {
+            return;
+        }
+
+        LOG_INFO("Stopping broadcast");
+        broadcasting_ = false;
+        broadcastPoller_.wakeup();
+        if (broadcastThread_.joinable())
+        {
+            broadcastThread_.join();
+        }
+
+        // 广播线程已退出，在此发送 goodbye
+        outgoing_.clear();
+        responder_.stop(mdns::Responder::Clock::now(), outgoing_);
+        sendResponses(outgoing_);
+
+        broadcastPoller_.remove(broadcastSocket_);
+        closesocket(broadcastSocket_);
+        broadcastSocket_ = INVALID_SOCKET;
+        LOG_INFO("Broadcast stopped");
+    }
+
+    // 获取当前发现的所有设备
+    std::vector<DeviceInfo> getDiscoveredDevices() const
+    {
+        DeviceTablePtr table = getDeviceTable();
+        std::vector<DeviceInfo> devices;
+        devices.reserve(table->devices.size());
+        for (const auto& device : table->devices)
+        {
+            devices.push_back(device->toInfo());
+        }
+        return devices;
+    }
+
+    void setDeviceLostCallback(const DeviceLostCallback& callback)
+    {
+        std::lock_guard<std::mutex> settings(callbackSettingsMutex_);
+        lostCallback_ = callback;
+        for (const auto& shard : *std::atomic_load(&shards_))
+        {
+            std::lock_guard<std::shared_mutex> lock(shard->devicesMutex);
+            shard->lostCallback = callback;
+        }
+    }
+
+    bool setPipelineOptions(const PipelineOptions& options)
+    {
+        std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+        if (running)
+        {
+            LOG_ERROR("发现运行期间不能更改解析流水线");
+            return false;
+        }
+        PipelineOptions applied = options;
+        applied.workers = std::min(applied.workers, mdns::PacketRouter::kMaxShards);
+        applied.queueCapacity = std::max<size_t>(applied.queueCapacity, 1);
+        reshard(std::max<size_t>(applied.workers, 1));
+        pipeline_ = applied;
+        pipelined_ = applied.workers > 0;
+        if (pipelined_)
+        {
+            LOG_INFO("Parse pipeline enabled: " << applied.workers << " worker(s), "
+                << applied.queueCapacity << " packets in flight");
+        }
+        else
+        {
+            LOG_INFO("Parse pipeline disabled");
+        }
+        return true;
+    }
+
+    bool setReceiveOptions(const ReceiveOptions& options)
+    {
+        std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+        if (running)
+        {
+            LOG_ERROR("发现运行期间不能更改接收选项");
+            return false;
+        }
+        receive_ = options;
+        receive_.maxPacketSize = std::min<size_t>(std::max<size_t>(receive_.maxPacketSize,
+            MDNS_MIN_RECV_SIZE), MDNS_MAX_RECV_SIZE);
+        receive_.socketBufferSize = std::max(receive_.socketBufferSize, 0);
+        receive_.maxSources = std::max<size_t>(receive_.maxSources, 1);
+        return true;
+    }
+
+    bool setQueryOptions(const QueryOptions& options)
+    {
+        std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+        if (running)
+        {
+            LOG_ERROR("发现运行期间不能更改查询选项");
+            return false;
+        }
+        query_ = options;
+        LOG_INFO("Known-answer suppression " << (query_.knownAnswers ? "enabled" : "disabled"));
+        return true;
+    }
+
+    bool setCacheFile(const std::string& path, uint32_t saveIntervalMs)
+    {
+        std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+        if (running)
+        {
+            LOG_ERROR("发现运行期间不能更改缓存文件");
+            return false;
+        }
+        cacheFile_ = path;
+        cacheSaveInterval_ = path.empty() ? 0 : saveIntervalMs;
+        return true;
+    }
+
+    /**
+     * @brief 从缓存文件恢复记录并组装设备，接收线程启动前调用
+     * @details 先恢复订阅服务的 PTR 和实例记录(按实例名分片并关联主机)，再把地址记录
+     * 恢复到关联了该主机的分片。恢复的记录未确认，TTL 不超过 MDNS_WARM_CONFIRM_S 秒
+     */
+    void restoreCache(mdns::RecordCache::Clock::time_point now)
+    {
+        if (cacheFile_.empty())
+        {
+            return;
+        }
+        std::vector<mdns::CachedRecord> records;
+        std::string error;
+        if (!mdns::readCacheFile(cacheFile_, now, unixMicros() / 1000, records, error))
+        {
+            LOG_INFO("Cache file not loaded: " << error);
+            return;
+        }
+        // 恢复后记录的接收时间相同，find() 取先插入的一条: 按到期时间从晚到早插入，
+        // 同一集合中最近刷新的记录(例如 cache-flush 替换后的 SRV)优先
+        std::stable_sort(records.begin(), records.end(),
+            [](const mdns::CachedRecord& a, const mdns::CachedRecord& b) { return a.expires > b.expires; });
+
+        const ShardSet& all = shards();
+        for (const auto& shard : all)
+        {
+            shard->touched.clear();
+        }
+        size_t restored = 0;
+        for (auto& record : records)
+        {
+            record.ttl = std::min<uint32_t>(record.ttl, MDNS_WARM_CONFIRM_S);
+            if (record.type == mdns::kTypeA || record.type == mdns::kTypeAAAA)
+            {
+                continue;
+            }
+            const std::string& instance = record.type == mdns::kTypePTR ? record.target : record.name;
+            if (record.type == mdns::kTypePTR ? !serviceNamed(mdns::StrRef(record.name)) :
+                !serviceOf(record.name))
+            {
+                continue;
+            }
+            Shard& shard = *all[mdns::shardOf(mdns::nameHash(mdns::StrRef(instance)), all.size())];
+            shard.recordCache.insert(record, false, now);
+            shard.metrics.cacheInserts.add();
+            if (record.type == mdns::kTypeSRV)
+            {
+                linkHost(shard, record.name, record.target);
+            }
+            touchInstance(shard, instance);
+            restored++;
+        }
+        for (const auto& record : records)
+        {
+            if (record.type != mdns::kTypeA && record.type != mdns::kTypeAAAA)
+            {
+                continue;
+            }
+            for (const auto& shard : all)
+            {
+                if (hostLinks(*shard, record.name))
+                {
+                    shard->recordCache.insert(record, false, now);
+                    shard->metrics.cacheInserts.add();
+                    restored++;
+                }
+            }
+        }
+
+        for (const auto& shard : all)
+        {
+            for (const auto& instance : shard->touched)
+            {
+                syncDevice(*shard, instance, now);
+            }
+            shard->touched.clear();
+            std::lock_guard<std::shared_mutex> lock(shard->devicesMutex);
+            publishChanges(*shard);
+        }
+        LOG_INFO("Restored " << restored << " record(s) from " << cacheFile_);
+    }
+
+    /// 把全部分片的记录缓存写入缓存文件
+    void saveCache(mdns::RecordCache::Clock::time_point now)
+    {
+        if (cacheFile_.empty())
+        {
+            return;
+        }
+        std::vector<mdns::CachedRecord> records;
+        {
+            ShardsLock lock(*this);
+            for (const auto& shard : shards())
+            {
+                shard->recordCache.snapshot(records);
+            }
+        }
+        std::string error;
+        if (!mdns::writeCacheFile(cacheFile_, records, now, unixMicros() / 1000, error))
+        {
+            LOG_WARN("保存缓存文件失败: " << error);
+            return;
+        }
+        LOG_DEBUG("Saved " << records.size() << " cached record(s) to " << cacheFile_);
+    }
+
+    bool setCallbackOptions(const CallbackOptions& options)
+    {
+        std::lock_guard<std::mutex> lifecycle(lifecycleMutex_);
+        if (running)
+        {
+            LOG_ERROR("发现运行期间不能更改回调执行方式");
+            return false;
+        }
+        dispatcher_.configure(options);
+        LOG_INFO("Callback executor set to " << static_cast<int>(options.executor)
+            << ", queue capacity " << options.queueCapacity);
+        return true;
+    }
+
+    size_t poll(size_t maxCallbacks)
+    {
+        return dispatcher_.poll(maxCallbacks);
+    }
+
+    CallbackStats getCallbackStats() const
+    {
+        return dispatcher_.stats();
+    }
+
+    /**
+     * @brief 推迟执行用户回调，调用方需持有分片的 devicesMutex
+     * @details 回调连同参数副本追加到分片的待执行列表，释放锁后由 runDeferredCallbacks() 分发
+     */
+    void deferCallback(Shard& shard, mdns::CallbackDispatcher::Task&& task)
+    {
+        shard.deferred.push_back(std::move(task));
+    }
+
+    /**
+     * @brief 发布本批变化的快照并分发分片中待执行的回调
+     * @details 只在处理该分片的线程中、不持有任何内部锁时调用，每批报文和每轮定时任务之后各一次。
+     * 先发布快照，回调中读取的设备表已包含回调对应的变化
+     */
+    void runDeferredCallbacks(Shard& shard)
+    {
+        std::vector<mdns::CallbackDispatcher::Task> tasks;
+        {
+            std::lock_guard<std::shared_mutex> lock(shard.devicesMutex);
+            publishChanges(shard);
+            tasks.swap(shard.deferred);
+        }
+        for (auto& task : tasks)
+        {
+            dispatcher_.dispatch(std::move(task));
+        }
+    }
+
+    void setDeviceEventCallback(const DeviceEventCallback& callback, uint32_t coalesceMs)
+    {
+        std::lock_guard<std::mutex> settings(callbackSettingsMutex_);
+        eventCallback_ = callback;
+        eventWindow_ = std::chrono::milliseconds(coalesceMs);
+        for (const auto& shard : *std::atomic_load(&shards_))
+        {
+            std::lock_guard<std::shared_mutex> lock(shard->devicesMutex);
+            shard->eventCallback = callback;
+            shard->events.setWindow(eventWindow_);
+            if (!callback)
+            {
+                shard->events.clear();
+            }
+        }
+    }
+
+    /**
+     * @brief 记录设备表的一次变化，调用方需持有分片的 devicesMutex
+     *
+     * @param before 变化前的记录，新增时为空
+     * @param after 变化后的记录，删除时为空
+     */
+    void noteChange(Shard& shard, const DeviceRecordPtr& before, const DeviceRecordPtr& after)
+    {
+        if (!shard.eventCallback)
+        {
+            return;
+        }
+        mdns::RecordCache::Clock::time_point now = mdns::RecordCache::Clock::now();
+        shard.events.record(before, after, now);
+        if (shard.events.window() == mdns::RecordCache::Clock::duration::zero())
+        {
+            takeAndDeliverEvents(shard);
+        }
+    }
+
+    // 调用方需持有分片的 devicesMutex
+    void takeAndDeliverEvents(Shard& shard)
+    {
+        std::vector<DeviceEvent> batch;
+        shard.events.take(batch);
+        if (!batch.empty() && shard.eventCallback)
+        {
+            LOG_DEBUG("Delivering " << batch.size() << " device event(s)");
+            DeviceEventCallback callback = shard.eventCallback;
+            deferCallback(shard, [callback, batch]() { callback(batch); });
+        }
+    }
+
+    /**
+     * @brief 投递分片中合并窗口已到期的事件
+     *
+     * @param force 不等待窗口到期，投递全部未投递的事件
+     */
+    void deliverEvents(Shard& shard, mdns::RecordCache::Clock::time_point now, bool force)
+    {
+        std::lock_guard<std::shared_mutex> lock(shard.devicesMutex);
+        if (!shard.events.empty() && (force || now >= shard.events.deadline()))
+        {
+            takeAndDeliverEvents(shard);
+        }
+    }
+
+    mdns::RecordCache::Clock::time_point eventDeadline(const Shard& shard) const
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.devicesMutex);
+        return shard.events.deadline();
+    }
+
+    /**
+     * @brief 当前设备表快照
+     * @details 单个分片时直接返回该分片发布的快照。多个分片时 snapshot_ 缓存最近一次合并的结果，
+     * 发布代数没有变化时同样只做一次原子加载，否则重新合并
+     */
+    DeviceTablePtr getDeviceTable() const
+    {
+        DeviceTablePtr table = std::atomic_load(&snapshot_);
+        if (shardCount_.load(std::memory_order_acquire) <= 1)
+        {
+            return table;
+        }
+        uint64_t generation = generation_.load(std::memory_order_acquire);
+        return table->generation >= generation ? table : mergeSnapshots(generation);
+    }
+
+    /**
+     * @brief 按发现顺序合并各分片的快照
+     * @details 分片先发布快照再增加 generation_，读到代数 generation 后加载的分片快照
+     * 至少包含该代数之前的全部变化。每个分片的设备已按发现顺序排列，逐个归并
+     */
+    DeviceTablePtr mergeSnapshots(uint64_t generation) const
+    {
+        std::lock_guard<std::mutex> lock(mergeMutex_);
+        DeviceTablePtr cached = std::atomic_load(&snapshot_);
+        if (cached->generation >= generation)
+        {
+            return cached;
+        }
+        std::shared_ptr<DeviceTable> table = std::make_shared<DeviceTable>();
+        table->generation = generation;
+        auto discoveredFirst = [](const DeviceRecordPtr& a, const DeviceRecordPtr& b)
+        {
+            return a->sequence_ < b->sequence_;
+        };
+        for (const auto& shard : *std::atomic_load(&shards_))
+        {
+            DeviceTablePtr part = std::atomic_load(&shard->snapshot);
+            size_t middle = table->devices.size();
+            table->devices.insert(table->devices.end(), part->devices.begin(), part->devices.end());
+            std::inplace_merge(table->devices.begin(), table->devices.begin() + middle,
+                table->devices.end(), discoveredFirst);
+        }
+        std::atomic_store(&snapshot_, DeviceTablePtr(table));
+        return table;
+    }
+
+    uint64_t getGeneration() const
+    {
+        return generation_.load(std::memory_order_acquire);
+    }
+
+    DeviceRecordPtr waitFor(const DevicePredicate& predicate, uint32_t timeoutMs)
+    {
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+        for (;;)
+        {
+            uint64_t seen = generation_.load(std::memory_order_acquire);
+            DeviceTablePtr table = getDeviceTable();
+            for (const auto& device : table->devices)
+            {
+                if (predicate(*device))
+                {
+                    return device;
+                }
+            }
+
+            std::unique_lock<std::mutex> lock(tableWaitMutex_);
+            tableWaiters_++;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            bool changed = tableChanged_.wait_until(lock, deadline, [this, seen]
+            {
+                return generation_.load(std::memory_order_relaxed) != seen || !running;
+            });
+            tableWaiters_--;
+            if (!changed || generation_.load(std::memory_order_relaxed) == seen)
+            {
+                return nullptr;
+            }
+        }
+    }
+
+    DeviceRecordPtr resolveInstance(const std::string& name, uint32_t timeoutMs)
+    {
+        auto matches = [&name](const DeviceRecord& record)
+        {
+            return record.verified() &&
+                mdns::StrRef(record.name(), record.nameLength()).equalsIgnoreCase(mdns::StrRef(name));
+        };
+        DeviceRecordPtr device = waitFor(matches, 0);
+        if (device || !running)
+        {
+            return device;
+        }
+        if (!subscribedInstance(name))
+        {
+            LOG_WARN("Cannot resolve " << name << ": service type not subscribed");
+            return nullptr;
+        }
+
+        // 登记后再请求查询，应答缺少记录时分片立即发送单播补充查询
+        std::string key = lowerName(name);
+        {
+            std::lock_guard<std::mutex> lock(resolveMutex_);
+            resolving_.push_back(key);
+            resolveRequests_.push_back(name);
+        }
+        poller_.wakeup();
+        LOG_DEBUG("Resolving " << name << " (QU), timeout " << timeoutMs << " ms");
+        device = waitFor(matches, timeoutMs);
+        {
+            std::lock_guard<std::mutex> lock(resolveMutex_);
+            resolving_.erase(std::find(resolving_.begin(), resolving_.end(), key));
+        }
+        return device;
+    }
+
+    bool getPreferredAddress(const std::string& name, IpAddress& address) const
+    {
+        ShardSetPtr shards = std::atomic_load(&shards_);
+        const Shard& shard = *(*shards)[mdns::shardOf(mdns::nameHash(mdns::StrRef(name)), shards->size())];
+        std::shared_lock<std::shared_mutex> lock(shard.devicesMutex);
+        const DeviceRecordPtr* device = shard.devices.get(mdns::StrRef(name));
+        if (!device)
+        {
+            return false;
+        }
+        const DeviceRecord& record = **device;
+        bool hasV4 = false;
+        bool hasV6 = false;
+        for (size_t i = 0; i < record.addressCount(); i++)
+        {
+            const IpAddress& candidate = record.address(i);
+            hasV4 |= candidate.family == IpAddress::Family::IPv4;
+            hasV6 |= candidate.family == IpAddress::Family::IPv6;
+        }
+
+        IpAddress::Family family = hasV4 ? IpAddress::Family::IPv4 : IpAddress::Family::IPv6;
+        auto path = shard.latency.find(lowerName(name));
+        if (hasV4 && hasV6 && path != shard.latency.end())
+        {
+            int64_t v4 = path->second.srttUs[kIPv4];
+            int64_t v6 = path->second.srttUs[kIPv6];
+            if (v6 >= 0 && (v4 < 0 || v6 < v4))
+            {
+                family = IpAddress::Family::IPv6;
+            }
+        }
+
+        // 链路本地地址(fe80::/10)只在一条链路上有效，有其他地址时不选
+        address = IpAddress();
+        for (size_t i = 0; i < record.addressCount(); i++)
+        {
+            const IpAddress& candidate = record.address(i);
+            if (candidate.family != family)
+            {
+                continue;
+            }
+            bool linkLocal = family == IpAddress::Family::IPv6 && candidate.bytes[0] == 0xFE &&
+                (candidate.bytes[1] & 0xC0) == 0x80;
+            if (address.family == IpAddress::Family::None || !linkLocal)
+            {
+                address = candidate;
+            }
+            if (!linkLocal)
+            {
+                break;
+            }
+        }
+        return true;
+    }
+
+private:
+    typedef mdns::QueryScheduler::Question QueryQuestion;
+
+    /**
+     * @brief 一个订阅的服务类型，只在接收线程中访问
+     */
+    struct Service
+    {
+        std::string type;                // 点分形式，不含结尾的点
+        std::vector<uint8_t> wire;       // wire 格式，用于查询报文和已知答案
+        mdns::NameView name;             // 指向 wire 的名称视图
+        DeviceFoundCallback callback;
+        std::vector<std::string> txtKeys;  // 只保留的 TXT 键(大小写不敏感)，为空时保留全部
+        uint64_t txtSeed = 0;            // TXT 哈希的初值，由 txtKeys 决定
+        bool peerQueried = false;        // 是否收到过其他主机的相同问题
+        mdns::RecordCache::Clock::time_point lastPeerQuery;
+        size_t nameOffset = 0;           // 组装查询时服务类型名称在报文中的偏移
+    };
+
+    /**
+     * @brief 订阅请求，由 API 线程写入，接收线程在下一次循环时应用
+     */
+    struct Subscription
+    {
+        std::string serviceType;
+        DeviceFoundCallback callback;
+        std::vector<std::string> txtKeys;
+    };
+
+    /**
+     * @brief 应用订阅变化
+     * @details 新订阅加入持续查询，取消的订阅停止查询并从设备表中删除其设备，
+     * 最后重建名称匹配表
+     */
+    void applySubscriptions(mdns::RecordCache::Clock::time_point now)
+    {
+        std::vector<Subscription> subscriptions;
+        {
+            std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+            subscriptionsChanged_ = false;
+            subscriptions = subscriptions_;
+        }
+
+        // 解析线程在持有分片锁时读取 services_ 和 matcher_
+        ShardsLock lock(*this);
+        std::vector<std::unique_ptr<Service>> services;
+        for (const auto& subscription : subscriptions)
+        {
+            std::unique_ptr<Service> service;
+            for (auto& existing : services_)
+            {
+                if (existing && mdns::StrRef(existing->type).equalsIgnoreCase(subscription.serviceType))
+                {
+                    service = std::move(existing);
+                    break;
+                }
+            }
+            if (!service)
+            {
+                service.reset(new Service());
+                service->type = subscription.serviceType;
+                addDNSName(service->wire, service->type);
+                mdns::NameView::parse(service->wire.data(), service->wire.size(), 0, service->name);
+                scheduler_.add(service->type, mdns::kTypePTR, now);
+                LOG_DEBUG("Subscribed to " << service->type);
+            }
+            service->callback = subscription.callback;
+            service->txtKeys = subscription.txtKeys;
+            // 键过滤改变后设备表中的 TXT 哈希不再匹配，下一次收到 TXT 记录时重新解析
+            service->txtSeed = txtHash(nullptr, 0, mdns::kFnvOffsetBasis);
+            for (const auto& key : service->txtKeys)
+            {
+                std::string lower = lowerName(key);
+                service->txtSeed = txtHash(lower.data(), lower.size() + 1, service->txtSeed);
+            }
+            services.push_back(std::move(service));
+        }
+
+        for (const auto& removed : services_)
+        {
+            if (removed)
+            {
+                scheduler_.remove(removed->type, mdns::kTypePTR);
+                for (const auto& shard : shards())
+                {
+                    dropServiceDevices(*shard, *removed);
+                }
+                LOG_DEBUG("Unsubscribed from " << removed->type);
+            }
+        }
+
+        services_ = std::move(services);
+        matcher_.clear();
+        for (size_t i = 0; i < services_.size(); i++)
+        {
+            matcher_.add(services_[i]->type, static_cast<uint32_t>(i));
+        }
+    }
+
+    /**
+     * @brief 取消订阅时删除分片中该服务类型的设备，不触发离线回调
+     */
+    void dropServiceDevices(Shard& shard, const Service& service)
+    {
+        for (auto it = shard.pending.begin(); it != shard.pending.end();)
+        {
+            if (belongsTo(it->second.instance, service))
+            {
+                it = shard.pending.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+
+        std::lock_guard<std::shared_mutex> lock(shard.devicesMutex);
+        std::vector<std::string> names;
+        for (const auto& device : shard.devices.values())
+        {
+            std::string name(device->name(), device->nameLength());
+            if (belongsTo(name, service))
+            {
+                names.push_back(name);
+            }
+        }
+        for (const auto& name : names)
+        {
+            shard.devices.erase(mdns::StrRef(name));
+            shard.latency.erase(lowerName(name));
+            shard.txtHashes.erase(mdns::StrRef(name));
+            shard.events.discard(mdns::StrRef(name));
+        }
+        if (!names.empty())
+        {
+            publishSnapshot(shard);
+            LOG_INFO("取消订阅 " << service.type << "，删除 " << names.size() << " 个设备");
+        }
+    }
+
+    // 实例名是否属于服务类型: "<实例>.<服务类型>"
+    static bool belongsTo(const std::string& instance, const Service& service)
+    {
+        size_t length = service.type.size();
+        return instance.size() > length + 1 && instance[instance.size() - length - 1] == '.' &&
+            mdns::StrRef(instance).substr(instance.size() - length, length)
+                .equalsIgnoreCase(service.type);
+    }
+
+    /// 实例名所属的订阅服务，未订阅时返回 nullptr
+    Service* serviceOf(const std::string& instance) const
+    {
+        mdns::ServiceMatcher::Match match;
+        if (!matcher_.match(mdns::StrRef(instance), match) || match.exact)
+        {
+            return nullptr;
+        }
+        return services_[match.id].get();
+    }
+
+    /// 名称恰好是某个订阅的服务类型时返回该服务
+    Service* serviceNamed(const mdns::StrRef& name) const
+    {
+        mdns::ServiceMatcher::Match match;
+        if (!matcher_.match(name, match) || !match.exact)
+        {
+            return nullptr;
+        }
+        return services_[match.id].get();
+    }
+
+    /**
+     * @brief 发送一个查询，包含调度器中同时到期的所有问题
+     * @details 订阅服务的 PTR 问题按 RFC 6762 7.1 在应答部分附带已知答案: 缓存中剩余 TTL
+     * 超过一半的 PTR 记录，响应方不会再为这些实例应答。已知答案放不下时置 TC 位，
+     * 剩余记录放在紧随其后的报文中。
+     * 按 RFC 6762 7.3，如果刚有其他主机发送了相同的 PTR 问题，且其已知答案包含我们的全部已知答案，
+     * 该问题视为已经发送，从本次查询中去掉。
+     *
+     * @param questions 要发送的问题
+     * @param now 当前时间
+     * @return false 发送失败
+     */
+    bool sendQuery(const std::vector<QueryQuestion>& questions,
+        mdns::RecordCache::Clock::time_point now)
+    {
+        askedServices_.clear();
+        uint16_t count = 0;
+        for (const auto& question : questions)
+        {
+            Service* service = question.type == mdns::kTypePTR ?
+                serviceNamed(question.name) : nullptr;
+            if (service)
+            {
+                if (service->peerQueried &&
+                    now - service->lastPeerQuery < std::chrono::milliseconds(MDNS_QUERY_SUPPRESS_MS))
+                {
+                    LOG_DEBUG("Query for " << service->type
+                        << " suppressed, same question asked by another host");
+                    continue;
+                }
+                askedServices_.push_back(service);
+            }
+            count++;
+        }
+        if (count == 0)
+        {
+            return true;
+        }
+
+        // 已知答案分布在各分片的记录缓存中
+        ShardsLock lock(*this);
+        std::vector<uint8_t> query;
+        beginPacket(query, count);
+        for (const auto& question : questions)
+        {
+            Service* service = question.type == mdns::kTypePTR ?
+                serviceNamed(question.name) : nullptr;
+            if (service)
+            {
+                if (std::find(askedServices_.begin(), askedServices_.end(), service) ==
+                    askedServices_.end())
+                {
+                    continue;
+                }
+                service->nameOffset = query.size();
+                query.insert(query.end(), service->wire.begin(), service->wire.end());
+            }
+            else
+            {
+                addDNSName(query, question.name);
+            }
+            appendU16(query, question.type);
+            appendU16(query, question.unicast ?
+                static_cast<uint16_t>(mdns::kClassIN | mdns::kUnicastResponseBit) : mdns::kClassIN);
+        }
+
+        std::vector<uint8_t> answer;
+        uint16_t answers = 0;
+        for (auto* service : askedServices_)
+        {
+            knownAnswers_.clear();
+            collectKnownAnswers(*service, now, knownAnswers_);
+            LOG_DEBUG("Query for " << service->type << " with "
+                << knownAnswers_.size() << " known answers");
+            for (const auto* record : knownAnswers_)
+            {
+                size_t offset = service->nameOffset;
+                encodeKnownAnswer(*service, *record, now, query.size(), offset, answer);
+                if (answers > 0 && query.size() + answer.size() > MDNS_MAX_PACKET_SIZE)
+                {
+                    finishPacket(query, true, answers);
+                    if (!sendPacket(query))
+                    {
+                        return false;
+                    }
+                    beginPacket(query, 0);
+                    answers = 0;
+                    for (auto* other : askedServices_)
+                    {
+                        other->nameOffset = 0;
+                    }
+                    offset = 0;
+                    encodeKnownAnswer(*service, *record, now, query.size(), offset, answer);
+                }
+                service->nameOffset = offset;
+                query.insert(query.end(), answer.begin(), answer.end());
+                answers++;
+            }
+        }
+        finishPacket(query, false, answers);
+        return sendPacket(query);
+    }
+
+    /**
+     * @brief 发送调度器中到期的问题
+     */
+    bool runScheduler(mdns::RecordCache::Clock::time_point now)
+    {
+        dueQuestions_.clear();
+        if (scheduler_.collect(now, dueQuestions_) == 0)
+        {
+            return true;
+        }
+        return sendQuery(dueQuestions_, now);
+    }
+
+    /**
+     * @brief 收集可作为已知答案的 PTR 记录: 剩余 TTL 超过原始 TTL 的一半，从缓存文件恢复的记录除外
+     * @details 流水线模式下调用方需持有 ShardsLock，直到不再使用返回的记录。
+     * QueryOptions::knownAnswers 关闭时不收集
+     */
+    void collectKnownAnswers(const Service& service, mdns::RecordCache::Clock::time_point now,
+        std::vector<const mdns::CachedRecord*>& out) const
+    {
+        if (!query_.knownAnswers)
+        {
+            return;
+        }
+        std::vector<const mdns::CachedRecord*> records;
+        for (const auto& shard : shards())
+        {
+            records.clear();
+            shard->recordCache.findAll(service.type, mdns::kTypePTR, records);
+            for (const auto* record : records)
+            {
+                if (record->verified && record->ttl != 0 &&
+                    (record->expires - now) * 2 > std::chrono::seconds(record->ttl))
+                {
+                    out.push_back(record);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief 编码一条已知答案 PTR 记录
+     *
+     * @param service 记录所属的服务
+     * @param record 缓存中的 PTR 记录
+     * @param now 当前时间，用于计算剩余 TTL
+     * @param position 记录将要写入的报文偏移
+     * @param nameOffset 报文中服务类型名称的偏移，为 0 时写出完整名称并更新为 position
+     * @param out 输出的记录
+     */
+    void encodeKnownAnswer(const Service& service, const mdns::CachedRecord& record,
+        mdns::RecordCache::Clock::time_point now, size_t position, size_t& nameOffset,
+        std::vector<uint8_t>& out) const
+    {
+        out.clear();
+        if (nameOffset == 0)
+        {
+            nameOffset = position;
+            out.insert(out.end(), service.wire.begin(), service.wire.end());
+        }
+        else
+        {
+            out.push_back(static_cast<uint8_t>(0xC0 | (nameOffset >> 8)));
+            out.push_back(static_cast<uint8_t>(nameOffset & 0xFF));
+        }
+        appendU16(out, mdns::kTypePTR);
+        appendU16(out, mdns::kClassIN);
+        uint32_t ttl = static_cast<uint32_t>(
+            std::chrono::duration_cast<std::chrono::seconds>(record.expires - now).count());
+        appendU16(out, static_cast<uint16_t>(ttl >> 16));
+        appendU16(out, static_cast<uint16_t>(ttl & 0xFFFF));
+
+        // 目标是 "<实例>.<服务类型>"，服务类型部分压缩为指向 nameOffset 的指针
+        const std::string& rdata = record.rdata;
+        size_t label = rdata.empty() ? 0 : 1u + static_cast<uint8_t>(rdata[0]);
+        mdns::StrRef wire(reinterpret_cast<const char*>(service.wire.data()), service.wire.size());
+        bool compress = label > 1 && label < rdata.size() &&
+            mdns::StrRef(rdata).substr(label, rdata.size()).equalsIgnoreCase(wire);
+        uint16_t length = static_cast<uint16_t>(compress ? label + 2 : rdata.size());
+        appendU16(out, length);
+        if (compress)
+        {
+            out.insert(out.end(), rdata.begin(), rdata.begin() + label);
+            out.push_back(static_cast<uint8_t>(0xC0 | (nameOffset >> 8)));
+            out.push_back(static_cast<uint8_t>(nameOffset & 0xFF));
+        }
+        else
+        {
+            out.insert(out.end(), rdata.begin(), rdata.end());
+        }
+    }
+
+    /**
+     * @brief 记录查询到第一个相关应答的延迟，只在接收线程中调用
+     * @details 只计入查询发出后 MDNS_RTT_WINDOW_MS 内收到的应答，每次查询只计入第一个应答
+     */
+    void recordQueryLatency(int family, mdns::RecordCache::Clock::time_point now)
+    {
+        mdns::RecordCache::Clock::time_point sent = querySent_[family];
+        if (sent == mdns::RecordCache::Clock::time_point() ||
+            now - sent > std::chrono::milliseconds(MDNS_RTT_WINDOW_MS) || firstAnswer_[family] == sent)
+        {
+            return;
+        }
+        firstAnswer_[family] = sent;
+        metrics_.queryLatency.record(static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - sent).count()));
+    }
+
+    /**
+     * @brief 更新本次应答涉及的设备在该协议族上的平滑往返时间
+     * @details 窗口与 recordQueryLatency() 相同，每个设备每次查询只取第一个应答，
+     * 平滑方式与 TCP 的 SRTT 相同(新样本权重 1/8)
+     */
+    void sampleLatency(Shard& shard, const PacketInfo& packet)
+    {
+        mdns::RecordCache::Clock::time_point sent = packet.querySent;
+        if (shard.touched.empty() || sent == mdns::RecordCache::Clock::time_point() ||
+            packet.received - sent > std::chrono::milliseconds(MDNS_RTT_WINDOW_MS))
+        {
+            return;
+        }
+        int64_t sample = std::chrono::duration_cast<std::chrono::microseconds>(
+            packet.received - sent).count();
+        int family = packet.family;
+
+        std::lock_guard<std::shared_mutex> lock(shard.devicesMutex);
+        for (const auto& instance : shard.touched)
+        {
+            if (shard.devices.find(mdns::StrRef(instance)) == DeviceList::npos)
+            {
+                continue;
+            }
+            PathLatency& path = shard.latency[lowerName(instance)];
+            if (path.sampled[family] == sent)
+            {
+                continue;
+            }
+            path.sampled[family] = sent;
+            int64_t& srtt = path.srttUs[family];
+            srtt = srtt < 0 ? sample : srtt + (sample - srtt) / 8;
+        }
+    }
+
+    static void appendU16(std::vector<uint8_t>& packet, uint16_t value)
+    {
+        packet.push_back(static_cast<uint8_t>(value >> 8));
+        packet.push_back(static_cast<uint8_t>(value & 0xFF));
+    }
+
+    // 写入查询报文头部，应答数由 finishPacket() 填写
+    static void beginPacket(std::vector<uint8_t>& packet, uint16_t questions)
+    {
+        packet.clear();
+        DNSHeader header = { 0 };
+        header.flags = htons(0x0100);
+        header.qdcount = htons(questions);
+        packet.insert(packet.end(), (uint8_t*)&header, (uint8_t*)(&header + 1));
+    }
+
+    static void finishPacket(std::vector<uint8_t>& packet, bool truncated, uint16_t answers)
+    {
+        if (truncated)
+        {
+            packet[2] |= 0x02;  // TC: 已知答案在下一个报文中继续
+        }
+        packet[6] = static_cast<uint8_t>(answers >> 8);
+        packet[7] = static_cast<uint8_t>(answers & 0xFF);
+    }
+
+    /**
+     * @brief 发送报文到 IPv4 和 IPv6 的 mDNS 多播组，并记下报文内容用于识别回环的自身查询
+     * @return false 两个协议族都发送失败
+     */
+    bool sendPacket(const std::vector<uint8_t>& packet)
+    {
+        mdns::RecordCache::Clock::time_point now = mdns::RecordCache::Clock::now();
+        bool sent = false;
+        if (socket_ != INVALID_SOCKET)
+        {
+            struct sockaddr_in addr;
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(MDNS_PORT);
+            addr.sin_addr.s_addr = inet_addr(MDNS_GROUP);
+            bool any = interfaces_.empty() &&
+                sendMulticast(socket_, packet, (struct sockaddr*)&addr, sizeof(addr), "default");
+            for (const auto& iface : interfaces_)
+            {
+                if (iface.ipv4.empty())
+                {
+                    continue;
+                }
+                struct in_addr local;
+                local.s_addr = iface.ipv4.front();
+                if (setsockopt(socket_, IPPROTO_IP, IP_MULTICAST_IF, (char*)&local, sizeof(local)) == 0 &&
+                    sendMulticast(socket_, packet, (struct sockaddr*)&addr, sizeof(addr), iface.name))
+                {
+                    any = true;
+                }
+            }
+            if (any)
+            {
+                querySent_[kIPv4] = now;
+                sent = true;
+            }
+        }
+        if (socket6_ != INVALID_SOCKET)
+        {
+            struct sockaddr_in6 addr;
+            std::memset(&addr, 0, sizeof(addr));
+            addr.sin6_family = AF_INET6;
+            addr.sin6_port = htons(MDNS_PORT);
+            inet_pton(AF_INET6, MDNS_GROUP6, &addr.sin6_addr);
+            bool any = interfaces_.empty() &&
+                sendMulticast(socket6_, packet, (struct sockaddr*)&addr, sizeof(addr), "default");
+            for (const auto& iface : interfaces_)
+            {
+                if (!iface.ipv6)
+                {
+                    continue;
+                }
+                // 链路本地多播地址的作用域即发送接口
+                addr.sin6_scope_id = iface.index;
+                if (sendMulticast(socket6_, packet, (struct sockaddr*)&addr, sizeof(addr), iface.name))
+                {
+                    any = true;
+                }
+            }
+            if (any)
+            {
+                querySent_[kIPv6] = now;
+                sent = true;
+            }
+        }
+        if (!sent)
+        {
+            return false;
+        }
+
+        SentPacket& slot = sentPackets_[sentNext_];
+        sentNext_ = (sentNext_ + 1) % sentPackets_.size();
+        slot.data = packet;
+        slot.sent = now;
+        return true;
+    }
+
+    bool sendMulticast(SOCKET sock, const std::vector<uint8_t>& packet,
+        const struct sockaddr* addr, socklen_t length, const std::string& iface)
+    {
+        int sent = sendto(sock, (const char*)packet.data(), packet.size(), 0, addr, length);
+        if (sent < 0)
+        {
+            metrics_.sendErrors.add();
+            LOG_ERROR("Failed to send query to " << (addr->sa_family == AF_INET6 ? MDNS_GROUP6 : MDNS_GROUP)
+                << " on " << iface << ": " << mdns::socketErrorString(mdns::lastSocketError()));
+            return false;
+        }
+        metrics_.packetsSent.add();
+        metrics_.bytesSent.add(static_cast<uint64_t>(sent));
+        LOG_DEBUG("Query sent successfully on " << iface << ", " << sent << " bytes");
+        return true;
+    }
+
+    /**
+     * @brief 判断收到的查询是否是自己刚发出的(多播回环)
+     */
+    bool isOwnPacket(const uint8_t* data, size_t size, mdns::RecordCache::Clock::time_point now) const
+    {
+        for (const auto& slot : sentPackets_)
+        {
+            if (slot.data.size() == size && now - slot.sent < std::chrono::seconds(2) &&
+                std::memcmp(slot.data.data(), data, size) == 0)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 处理其他主机的查询，用于重复问题抑制
+     * @details 只有 QM 问题计入；带 TC 位的查询其已知答案还在后续报文中，不作判断
+     */
+    void handleQuery(mdns::PacketReader& reader, const mdns::Header& header,
+        mdns::RecordCache::Clock::time_point now)
+    {
+        if (isOwnPacket(reader.data(), reader.size(), now))
+        {
+            return;
+        }
+
+        askedServices_.clear();
+        for (uint16_t i = 0; i < header.qdcount; i++)
+        {
+            mdns::Question question;
+            if (!reader.readQuestion(question))
+            {
+                return;
+            }
+            mdns::ServiceMatcher::Match match;
+            if ((question.type == mdns::kTypePTR || question.type == mdns::kTypeANY) &&
+                question.recordClass() == mdns::kClassIN && !question.unicastResponse() &&
+                matcher_.match(question.name, match) && match.exact)
+            {
+                askedServices_.push_back(services_[match.id].get());
+            }
+        }
+        if (askedServices_.empty() || header.isTruncated())
+        {
+            return;
+        }
+
+        peerAnswers_.clear();
+        for (uint16_t i = 0; i < header.ancount; i++)
+        {
+            mdns::Record record;
+            mdns::NameView target;
+            if (!reader.readRecord(record))
+            {
+                return;
+            }
+            if (record.type == mdns::kTypePTR && reader.readPtr(record, target))
+            {
+                peerAnswers_.push_back(std::make_pair(record.name, target));
+            }
+        }
+
+        // 对方的已知答案必须覆盖我们的已知答案，否则缺少的实例不会在响应中出现
+        ShardsLock lock(*this);
+        for (auto* service : askedServices_)
+        {
+            knownAnswers_.clear();
+            collectKnownAnswers(*service, now, knownAnswers_);
+            bool covered = true;
+            for (const auto* record : knownAnswers_)
+            {
+                bool listed = false;
+                for (const auto& answer : peerAnswers_)
+                {
+                    if (answer.second.equals(mdns::StrRef(record->target)) &&
+                        answer.first.equals(service->name))
+                    {
+                        listed = true;
+                        break;
+                    }
+                }
+                if (!listed)
+                {
+                    covered = false;
+                    break;
+                }
+            }
+            if (covered)
+            {
+                LOG_DEBUG("Same question for " << service->type
+                    << " asked by another host, next query suppressed");
+                service->peerQueried = true;
+                service->lastPeerQuery = now;
+            }
+        }
+    }
+
+    /**
+     * @brief 广播线程: 在 broadcastPoller_ 上等待报文或响应方的下一个发送时间，发送探测、宣告和应答
+     */
+    void runBroadcast()
+    {
+        LOG_INFO("Broadcast thread started");
+        mdns::DatagramBatch batch(MDNS_RECV_BATCH);
+        std::vector<SOCKET> ready;
+        mdns::Responder::State state = responder_.state();
+        std::string instance = responder_.instanceName();
+        LOG_INFO("探测实例名: " << instance);
+
+        while (broadcasting_)
+        {
+            mdns::Responder::Clock::time_point now = mdns::Responder::Clock::now();
+            if (broadcastChanged_)
+            {
+                std::map<std::string, std::string> txtRecords;
+                {
+                    std::lock_guard<std::mutex> lock(broadcastMutex_);
+                    broadcastChanged_ = false;
+                    txtRecords.swap(pendingTxt_);
+                }
+                if (responder_.setTxt(txtRecords, now))
+                {
+                    LOG_INFO("广播TXT记录已更新，重新宣告");
+                }
+                else
+                {
+                    LOG_ERROR("广播TXT记录过长，保持原记录");
+                }
+            }
+
+            outgoing_.clear();
+            responder_.poll(now, outgoing_);
+            sendResponses(outgoing_);
+            logResponderState(state, instance);
+
+            // 等待报文或响应方的下一个发送时间，停止和 TXT 更新通过 wakeup() 唤醒
+            if (broadcastPoller_.wait(waitTimeout(responder_.nextDeadline(), now), ready) < 0)
+            {
+                LOG_ERROR("Poll failed: " << mdns::socketErrorString(mdns::lastSocketError()));
+                break;
+            }
+            if (ready.empty())
+            {
+                continue;
+            }
+            int count = batch.receive(broadcastSocket_);
+            if (count < 0)
+            {
+                LOG_WARN("Error receiving data: " << mdns::socketErrorString(batch.error()));
+                continue;
+            }
+            mdns::Responder::Clock::time_point received = mdns::Responder::Clock::now();
+            for (int i = 0; i < count; i++)
+            {
+                // 广播套接字只使用 IPv4
+                const sockaddr_in& sender = reinterpret_cast<const sockaddr_in&>(batch.sender(i));
+                responder_.handlePacket(batch.data(i), batch.size(i),
+                    sender.sin_addr.s_addr, ntohs(sender.sin_port), received);
+            }
+        }
+        LOG_INFO("Broadcast thread stopped");
+    }
+
+    // 记录响应方的状态变化: 冲突改名、探测完成
+    void logResponderState(mdns::Responder::State& state, std::string& instance)
+    {
+        if (responder_.instanceName() != instance)
+        {
+            LOG_WARN("名称冲突，改名为: " << responder_.instanceName()
+                << " 主机: " << responder_.service().host);
+            instance = responder_.instanceName();
+        }
+        if (responder_.state() == state)
+        {
+            return;
+        }
+        state = responder_.state();
+        if (state == mdns::Responder::State::Announcing)
+        {
+            LOG_INFO("宣告服务: " << instance);
+        }
+        else if (state == mdns::Responder::State::Probing)
+        {
+            LOG_INFO("重新探测实例名: " << instance);
+        }
+        else if (state == mdns::Responder::State::Established)
+        {
+            LOG_DEBUG("Service established: " << instance);
+        }
+    }
+
+    /**
+     * @brief 发送响应方输出的报文，多播报文发往 mDNS 多播组
+     */
+    void sendResponses(const std::vector<mdns::Responder::Packet>& packets)
+    {
+        for (const auto& packet : packets)
+        {
+            struct sockaddr_in addr;
+            addr.sin_family = AF_INET;
+            if (packet.multicast)
+            {
+                addr.sin_port = htons(MDNS_PORT);
+                addr.sin_addr.s_addr = inet_addr(MDNS_GROUP);
+            }
+            else
+            {
+                addr.sin_port = htons(packet.port);
+                addr.sin_addr.s_addr = packet.address;
+            }
+
+            char text[INET_ADDRSTRLEN];
+            int sent = sendto(broadcastSocket_, (const char*)packet.data->data(),
+                packet.data->size(), 0, (struct sockaddr*)&addr, sizeof(addr));
+            if (sent < 0)
+            {
+                metrics_.sendErrors.add();
+                LOG_WARN("Failed to send response to "
+                    << inet_ntop(AF_INET, &addr.sin_addr, text, sizeof(text)) << ": "
+                    << mdns::socketErrorString(mdns::lastSocketError()));
+                continue;
+            }
+            metrics_.responsesSent.add();
+            LOG_DEBUG("Response sent to " << inet_ntop(AF_INET, &addr.sin_addr, text, sizeof(text))
+                << ", " << sent << " bytes");
+        }
+    }
+
+    /**
+     * @brief 本机主机名，转换为 mDNS 主机名 "<name>.local"
+     * @details 只保留第一个标签，字母、数字和 '-' 以外的字符替换为 '-'
+     */
+    static std::string localHostName()
+    {
+        char name[256] = { 0 };
+        std::string label;
+        if (gethostname(name, sizeof(name) - 1) == 0)
+        {
+            for (const char* p = name; *p && *p != '.' && label.size() < 63; p++)
+            {
+                char c = *p;
+                bool valid = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                    (c >= '0' && c <= '9') || c == '-';
+                label += valid ? c : '-';
+            }
+        }
+        if (label.empty())
+        {
+            label = "lebo-pc";
+        }
+        return label + ".local";
+    }
+
+    /**
+     * @brief 取得发送多播报文使用的本机 IPv4 地址
+     * @details 对多播组地址 connect 一个 UDP 套接字(不发送数据)，由路由表选出出口地址
+     *
+     * @param address 输出的地址，网络字节序
+     * @return false 没有可用的非回环地址
+     */
+    static bool localAddress(uint32_t& address)
+    {
+        SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (sock == INVALID_SOCKET)
+        {
+            return false;
+        }
+        struct sockaddr_in addr;
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(MDNS_PORT);
+        addr.sin_addr.s_addr = inet_addr(MDNS_GROUP);
+        struct sockaddr_in local;
+        socklen_t length = sizeof(local);
+        bool found = connect(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0 &&
+            getsockname(sock, (struct sockaddr*)&local, &length) == 0;
+        closesocket(sock);
+        if (!found || local.sin_addr.s_addr == INADDR_ANY ||
+            (ntohl(local.sin_addr.s_addr) >> 24) == 127)
+        {
+            return false;
+        }
+        address = local.sin_addr.s_addr;
+        return true;
+    }
+
+    void addDNSName(std::vector<uint8_t>& packet, const std::string& name)
+    {
+        size_t start = 0;
+        size_t end = name.find('.');
+
+        while (end != std::string::npos)
+        {
+            std::string label = name.substr(start, end - start);
+            packet.push_back(static_cast<uint8_t>(label.length()));
+            packet.insert(packet.end(), label.begin(), label.end());
+
+            start = end + 1;
+            end = name.find('.', start);
+        }
+
+        std::string label = name.substr(start);
+        if (!label.empty())
+        {
+            packet.push_back(static_cast<uint8_t>(label.length()));
+            packet.insert(packet.end(), label.begin(), label.end());
+        }
+
+        packet.push_back(0); // 终止符
+    }
+
+    std::vector<mdns::Record> records_;        // 接收线程复用的报文记录列表
+
+    // 查询调度、发送与重复问题抑制，只在接收线程(以及线程启动前的初始查询)中访问
+    mdns::QueryScheduler scheduler_;
+    std::vector<mdns::QueryScheduler::Question> dueQuestions_;
+    struct SentPacket
+    {
+        std::vector<uint8_t> data;
+        mdns::RecordCache::Clock::time_point sent;
+    };
+    std::array<SentPacket, 8> sentPackets_;      // 最近发送的报文，用于识别多播回环
+    size_t sentNext_ = 0;
+    enum
+    {
+        kIPv4,
+        kIPv6,
+        kFamilyCount
+    };
+    std::array<mdns::RecordCache::Clock::time_point, kFamilyCount> querySent_;  // 各协议族最近一次查询的时间
+    std::vector<const mdns::CachedRecord*> knownAnswers_;
+    std::vector<std::pair<mdns::NameView, mdns::NameView>> peerAnswers_;  // 对方已知答案的所有者和目标
+    std::vector<Service*> askedServices_;
+
+    // 订阅的服务类型，matcher_ 中的编号为 services_ 的下标
+    std::vector<std::unique_ptr<Service>> services_;
+    mdns::ServiceMatcher matcher_;
+
+    /**
+     * @brief 记录不完整的实例的补充查询状态
+     */
+    struct PendingResolve
+    {
+        std::string instance;                           // 实例名
+        mdns::RecordCache::Clock::time_point due;       // 下次发送补充查询的时间
+        int attempts;                                   // 已发送的补充查询次数
+        bool unicast;                                   // 实例正被 resolveInstance() 解析，请求单播应答
+    };
+
+    // assembleDevice() 返回的缺失记录标志
+    enum
+    {
+        kMissingSrv = 1,
+        kMissingTxt = 2,
+        kMissingAddress = 4
+    };
+
+    static std::string lowerName(const std::string& name)
+    {
+        std::string out(name);
+        for (auto& c : out)
+        {
+            c = mdns::asciiLower(c);
+        }
+        return out;
+    }
+
+    /**
+     * @brief 解析 mDNS 响应
+     *
+     * 直接在接收缓冲区上读取应答、授权和附加部分的记录，名称以视图形式与订阅的服务类型比较:
+     * - 服务类型的 PTR 记录以及实例的 SRV/TXT 记录存入缓存
+     * - A/AAAA 记录只有在其主机是某个实例的 SRV 目标时才存入缓存
+     * - 报文处理完后，对涉及的每个实例从缓存中组装设备信息
+     *
+     * @param data 报文数据
+     * @param size 报文长度
+     * @param sender 发送方地址，协议族决定往返时间计入 IPv4 还是 IPv6
+     * @param interfaceIndex 接收接口编号，存入缓存的记录标记该接口，0 表示未知
+     * @param pooled 流水线模式下 data 所在的缓冲池缓冲区，交给分片后置为 nullptr；
+     *               为空或指向 nullptr 时需要复制报文
+     */
+    void parseMDNSResponse(const uint8_t* data, int size, const sockaddr_storage& sender,
+        uint32_t interfaceIndex, mdns::PooledPacket** pooled = nullptr)
+    {
+        LOG_DEBUG("Parsing mDNS response from " << addressString(sender)
+            << ", size: " << size << " bytes");
+
+        mdns::PacketReader reader(data, size);
+        mdns::Header header;
+        if (!reader.readHeader(header))
+        {
+            countParseError(reader.error());
+            LOG_ERROR("Response too small: " << size << " bytes (minimum "
+                << mdns::kHeaderSize << " bytes required)");
+            return;
+        }
+
+        // 只看头部和来源端口，不读取任何名称
+        uint16_t port = 0;
+        toIpAddress(sender, &port);
+        mdns::HeaderCheck check = mdns::checkHeader(header, static_cast<size_t>(size), port);
+        if (check != mdns::HeaderCheck::Ok)
+        {
+            countRejected(check);
+            LOG_DEBUG("Rejected packet from " << addressString(sender) << ": "
+                << (check == mdns::HeaderCheck::BadPort ? "response not from port 5353" : "invalid header"));
+            return;
+        }
+
+        if (!header.isResponse())
+        {
+            // 其他主机的查询只用于重复问题抑制
+            metrics_.queriesReceived.add();
+            handleQuery(reader, header, mdns::RecordCache::Clock::now());
+            return;
+        }
+
+        LOG_DEBUG("Response contains " << header.qdcount << " questions, "
+            << header.ancount << " answers, " << header.nscount << " authority and "
+            << header.arcount << " additional records");
+
+        // Skip questions
+        for (uint16_t i = 0; i < header.qdcount; i++)
+        {
+            mdns::Question question;
+            if (!reader.readQuestion(question))
+            {
+                countParseError(reader.error());
+                LOG_WARN("Failed to parse question: " << mdns::parseErrorString(reader.error()));
+                return;
+            }
+        }
+
+        // 三个部分的记录格式相同，先全部读出，附加部分的地址记录才能与前面的 SRV 记录关联
+        records_.clear();
+        uint32_t total = static_cast<uint32_t>(header.ancount) + header.nscount + header.arcount;
+        for (uint32_t i = 0; i < total; i++)
+        {
+            mdns::Record record;
+            if (!reader.readRecord(record))
+            {
+                // 记录边界已不可信，后续记录无法继续读取
+                countParseError(reader.error());
+                LOG_WARN("Failed to parse record header: "
+                    << mdns::parseErrorString(reader.error()));
+                break;
+            }
+            countRecord(record.type);
+            records_.push_back(record);
+        }
+
+        mdns::RecordCache::Clock::time_point now = mdns::RecordCache::Clock::now();
+        int family = sender.ss_family == AF_INET6 ? kIPv6 : kIPv4;
+        if (pipelined_)
+        {
+            dispatchPacket(reader, data, size, sender, interfaceIndex, family, now, pooled);
+            return;
+        }
+        Shard& shard = *shards().front();
+        PacketInfo packet = { interfaceIndex, family, now, querySent_[family] };
+        applyResponse(shard, reader, records_, packet);
+        if (!shard.touched.empty())
+        {
+            recordQueryLatency(family, now);
+        }
+    }
+
+    /**
+     * @brief 把与订阅相关的报文交给涉及的分片
+     * @details 报文已在缓冲池中时直接交出，否则(回放或缓冲池曾经为空)复制到缓冲池中，
+     * 引用计数为涉及的分片数。缓冲池为空或分片队列已满时丢弃报文(对该分片)并计数，
+     * 接收线程不等待解析线程
+     */
+    void dispatchPacket(mdns::PacketReader& reader, const uint8_t* data, int size,
+        const sockaddr_storage& sender, uint32_t interfaceIndex, int family,
+        mdns::RecordCache::Clock::time_point now, mdns::PooledPacket** pooled)
+    {
+        uint32_t mask = router_.route(reader, records_, matcher_);
+        if (mask == 0)
+        {
+            return;
+        }
+        recordQueryLatency(family, now);
+
+        mdns::PooledPacket* packet = pooled ? *pooled : nullptr;
+        if (packet)
+        {
+            *pooled = nullptr;
+        }
+        else
+        {
+            packet = pool_->acquire();
+            if (!packet)
+            {
+                countPipelineDrop(static_cast<size_t>(mdns::popCount(mask)));
+                return;
+            }
+            std::memcpy(packet->data, data, size);
+        }
+        packet->size = size;
+        packet->sender = sender;
+        packet->interfaceIndex = interfaceIndex;
+        packet->received = now;
+        packet->querySent = querySent_[family];
+        packet->refs.store(mdns::popCount(mask), std::memory_order_relaxed);
+
+        const ShardSet& all = shards();
+        for (size_t i = 0; i < all.size(); i++)
+        {
+            if (!(mask & (1u << i)))
+            {
+                continue;
+            }
+            Shard& shard = *all[i];
+            mdns::PooledPacket* queued = packet;
+            if (!shard.queue->tryPush(std::move(queued)))
+            {
+                countPipelineDrop(1);
+                pool_->release(packet);
+                continue;
+            }
+            wakeWorker(shard);
+        }
+    }
+
+    /// 流水线丢弃的报文，连续丢弃时只记录第一次和之后每 1000 次
+    void countPipelineDrop(size_t count)
+    {
+        uint64_t before = metrics_.pipelineDrops.load();
+        metrics_.pipelineDrops.add(count);
+        if (before / 1000 != (before + count) / 1000 || before == 0)
+        {
+            LOG_WARN("Parse pipeline full, " << before + count << " packet(s) dropped so far");
+        }
+    }
+
+    /**
+     * @brief 把报文中的记录应用到一个分片
+     *
+     * - 服务类型的 PTR 记录以及实例的 SRV/TXT 记录存入缓存，多个分片时只处理属于本分片的实例
+     * - A/AAAA 记录只有在其主机是本分片中某个实例的 SRV 目标时才存入缓存
+     * - 报文处理完后，对涉及的每个实例从缓存中组装设备信息
+     *
+     * @param reader 读出 records 的读取器，用于解码记录数据
+     * @param records 报文中的全部记录
+     * @param packet 接收接口和时间
+     */
+    void applyResponse(Shard& shard, mdns::PacketReader& reader,
+        const std::vector<mdns::Record>& records, const PacketInfo& packet)
+    {
+        try
+        {
+            mdns::RecordCache::Clock::time_point now = packet.received;
+            uint32_t interfaceIndex = packet.interfaceIndex;
+            bool partitioned = shardCount_.load(std::memory_order_relaxed) > 1;
+            mdns::CachedRecord cached;
+            shard.touched.clear();
+
+            // 第一遍: 订阅服务类型的 PTR 记录和实例记录，其余记录不生成任何字符串
+            for (const auto& record : records)
+            {
+                mdns::ServiceMatcher::Match match;
+                if (!matcher_.match(record.name, match))
+                {
+                    continue;
+                }
+                bool servicePtr = match.exact && record.type == mdns::kTypePTR;
+                if (match.exact && !servicePtr)
+                {
+                    continue;
+                }
+                if (partitioned && router_.recordShard(reader, record, servicePtr) != shard.index)
+                {
+                    continue;
+                }
+                if (!cacheRecord(shard, reader, record, interfaceIndex, now, cached))
+                {
+                    continue;
+                }
+
+                if (record.type == mdns::kTypeSRV && record.ttl != 0)
+                {
+                    linkHost(shard, cached.name, cached.target);
+                }
+                // goodbye 记录只用于删除缓存
+                if (record.ttl != 0)
+                {
+                    touchInstance(shard, servicePtr ? cached.target : cached.name);
+                }
+            }
+
+            // 第二遍: 已知 SRV 目标主机的地址记录
+            for (const auto& record : records)
+            {
+                if ((record.type != mdns::kTypeA && record.type != mdns::kTypeAAAA) ||
+                    shard.hostInstances.empty())
+                {
+                    continue;
+                }
+                const std::vector<std::string>* instances = hostLinks(shard, record.name);
+                if (!instances ||
+                    !cacheRecord(shard, reader, record, interfaceIndex, now, cached) || record.ttl == 0)
+                {
+                    continue;
+                }
+                for (const auto& instance : *instances)
+                {
+                    touchInstance(shard, instance);
+                }
+            }
+
+            for (const auto& instance : shard.touched)
+            {
+                syncDevice(shard, instance, now);
+            }
+            sampleLatency(shard, packet);
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR("Exception while parsing response: " << e.what());
+        }
+    }
+
+    /**
+     * @brief 解码记录并存入缓存
+     * @return false 记录数据格式错误
+     */
+    bool cacheRecord(Shard& shard, mdns::PacketReader& reader, const mdns::Record& record,
+        uint32_t interfaceIndex, mdns::RecordCache::Clock::time_point now, mdns::CachedRecord& cached)
+    {
+        if (!mdns::RecordCache::decode(reader, record, cached))
+        {
+            countParseError(shard.metrics.parseErrors, reader.error() == mdns::ParseError::None ?
+                mdns::ParseError::BadRdata : reader.error());
+            LOG_WARN("Malformed rdata, type " << record.type << ": "
+                << mdns::parseErrorString(reader.error()));
+            return false;
+        }
+        cached.interfaceIndex = interfaceIndex;
+        mdns::RecordCache::Update update = shard.recordCache.insert(cached, record.cacheFlush(), now);
+        switch (update)
+        {
+        case mdns::RecordCache::Update::Added:
+            shard.metrics.cacheInserts.add();
+            break;
+        case mdns::RecordCache::Update::Refreshed:
+            shard.metrics.cacheHits.add();
+            break;
+        case mdns::RecordCache::Update::Goodbye:
+            shard.metrics.cacheGoodbyes.add();
+            LOG_DEBUG("Goodbye received: " << cached.name << " type " << cached.type);
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    // 记录本次报文涉及的实例，同一实例只组装一次
+    void touchInstance(Shard& shard, const std::string& instance)
+    {
+        for (const auto& name : shard.touched)
+        {
+            if (mdns::StrRef(name).equalsIgnoreCase(instance))
+            {
+                return;
+            }
+        }
+        shard.touched.push_back(instance);
+    }
+
+    /**
+     * @brief 以 host 为 SRV 目标的实例名
+     * @return 没有关联的实例时为 nullptr
+     */
+    static const std::vector<std::string>* hostLinks(const Shard& shard, const mdns::NameView& host)
+    {
+        auto it = shard.hostInstances.find(mdns::nameHash(host));
+        if (it != shard.hostInstances.end())
+        {
+            for (const auto& link : it->second)
+            {
+                if (host.equals(mdns::StrRef(link.host)))
+                {
+                    return &link.instances;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    static const std::vector<std::string>* hostLinks(const Shard& shard, const std::string& host)
+    {
+        auto it = shard.hostInstances.find(mdns::nameHash(mdns::StrRef(host)));
+        if (it != shard.hostInstances.end())
+        {
+            for (const auto& link : it->second)
+            {
+                if (mdns::StrRef(host).equalsIgnoreCase(link.host))
+                {
+                    return &link.instances;
+                }
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief 关联 SRV 目标主机与实例
+     * @details 流水线模式下主机名的哈希第一次出现在分片中时通知接收线程，
+     * 之后只有该主机的地址记录交给本分片
+     */
+    void linkHost(Shard& shard, const std::string& instance, const std::string& host)
+    {
+        uint64_t hash = mdns::nameHash(mdns::StrRef(host));
+        auto it = shard.hostInstances.find(hash);
+        if (it == shard.hostInstances.end())
+        {
+            it = shard.hostInstances.insert(std::make_pair(hash, std::vector<Shard::HostLink>())).first;
+            if (pipelined_)
+            {
+                pushRequest(shard, ShardRequest{ ShardRequest::HostLinked, std::string(), 0, hash });
+            }
+        }
+        Shard::HostLink* link = nullptr;
+        for (auto& candidate : it->second)
+        {
+            if (mdns::StrRef(host).equalsIgnoreCase(candidate.host))
+            {
+                link = &candidate;
+                break;
+            }
+        }
+        if (!link)
+        {
+            it->second.push_back(Shard::HostLink{ lowerName(host), std::vector<std::string>() });
+            link = &it->second.back();
+        }
+        for (const auto& name : link->instances)
+        {
+            if (mdns::StrRef(name).equalsIgnoreCase(instance))
+            {
+                return;
+            }
+        }
+        link->instances.push_back(instance);
+    }
+
+    void unlinkHost(Shard& shard, const std::string& instance, const std::string& host)
+    {
+        uint64_t hash = mdns::nameHash(mdns::StrRef(host));
+        auto it = shard.hostInstances.find(hash);
+        if (it == shard.hostInstances.end())
+        {
+            return;
+        }
+        std::vector<Shard::HostLink>& links = it->second;
+        for (size_t i = 0; i < links.size(); i++)
+        {
+            if (!mdns::StrRef(host).equalsIgnoreCase(links[i].host))
+            {
+                continue;
+            }
+            std::vector<std::string>& instances = links[i].instances;
+            for (size_t j = 0; j < instances.size(); j++)
+            {
+                if (mdns::StrRef(instances[j]).equalsIgnoreCase(instance))
+                {
+                    instances.erase(instances.begin() + j);
+                    break;
+                }
+            }
+            if (instances.empty())
+            {
+                links.erase(links.begin() + i);
+            }
+            break;
+        }
+        if (links.empty())
+        {
+            if (pipelined_)
+            {
+                pushRequest(shard, ShardRequest{ ShardRequest::HostUnlinked, std::string(), 0, hash });
+            }
+            shard.hostInstances.erase(it);
+        }
+    }
+
+    /**
+     * @brief 组装设备时 TXT 记录的处理结果
+     * @details 设备的 TXT 记录数据(连同服务的键过滤)与设备表中记录的哈希相同时不解析，
+     * 设备周期性宣告时多数报文只刷新 TTL
+     */
+    struct TxtState
+    {
+        uint64_t knownHash = 0;   // 设备表中记录的哈希，0 表示没有
+        uint64_t hash = 0;        // 本次组装的 TXT 记录数据的哈希，0 表示没有 TXT 记录
+        bool unchanged = false;   // 与 knownHash 相同，info.txtRecords 没有填写
+    };
+
+    /// FNV-1a，结果不为 0
+    static uint64_t txtHash(const void* data, size_t size, uint64_t seed)
+    {
+        uint64_t hash = mdns::fnv1a(data, size, seed);
+        return hash != 0 ? hash : 1;
+    }
+
+    /**
+     * @brief 从缓存中组装设备信息
+     *
+     * @param instance 实例名
+     * @param info 输出的设备信息，缺失的字段保持为空
+     * @param service 实例所属的服务，不为空时按其键过滤 TXT 项
+     * @param txtState 不为空时记录 TXT 哈希，与 knownHash 相同时跳过 TXT 解析
+     * @return 缺失记录标志的组合，0 表示设备信息完整
+     */
+    int assembleDevice(Shard& shard, const std::string& instance, DeviceInfo& info,
+        const Service* service = nullptr, TxtState* txtState = nullptr)
+    {
+        int missing = 0;
+        info.name = instance;
+        const mdns::RecordCache& recordCache = shard.recordCache;
+        std::vector<const mdns::CachedRecord*>& addressRecords = shard.addressRecords;
+
+        const mdns::CachedRecord* txt = recordCache.find(instance, mdns::kTypeTXT);
+        if (txt)
+        {
+            const std::vector<std::string>* keys = service && !service->txtKeys.empty() ?
+                &service->txtKeys : nullptr;
+            if (txtState && service)
+            {
+                txtState->hash = txtHash(txt->rdata.data(), txt->rdata.size(), service->txtSeed);
+                txtState->unchanged = txtState->hash == txtState->knownHash;
+            }
+            if (!txtState || !txtState->unchanged)
+            {
+                parseTXT(reinterpret_cast<const uint8_t*>(txt->rdata.data()),
+                    static_cast<uint16_t>(txt->rdata.size()), info.txtRecords, keys);
+            }
+        }
+        else
+        {
+            missing |= kMissingTxt;
+        }
+
+        const mdns::CachedRecord* srv = recordCache.find(instance, mdns::kTypeSRV);
+        if (!srv)
+        {
+            return missing | kMissingSrv | kMissingAddress;
+        }
+        info.host = srv->target;
+        info.port = srv->port;
+        info.interfaceIndex = srv->interfaceIndex;
+        info.verified = srv->verified && (!txt || txt->verified);
+
+        // 收到的记录在缓存解码时、恢复的记录在读取缓存文件时已检查 A/AAAA 记录的长度。
+        // 每个协议族中最近收到的记录排在最前，ip/ipv6 取自该记录，
+        // DeviceRecord::toInfo() 按同样的规则从地址列表还原
+        addressRecords.clear();
+        recordCache.findAll(srv->target, mdns::kTypeA, addressRecords);
+        size_t v4 = addressRecords.size();
+        recordCache.findAll(srv->target, mdns::kTypeAAAA, addressRecords);
+        if (addressRecords.empty())
+        {
+            return missing | kMissingAddress;
+        }
+        const mdns::CachedRecord* a = recordCache.find(srv->target, mdns::kTypeA);
+        const mdns::CachedRecord* aaaa = recordCache.find(srv->target, mdns::kTypeAAAA);
+        for (size_t i = 0; i < addressRecords.size(); i++)
+        {
+            if (i < v4 && addressRecords[i] == a)
+            {
+                std::swap(addressRecords[i], addressRecords[0]);
+            }
+            else if (i >= v4 && addressRecords[i] == aaaa)
+            {
+                std::swap(addressRecords[i], addressRecords[v4]);
+            }
+        }
+        info.addresses.resize(addressRecords.size());
+        for (size_t i = 0; i < addressRecords.size(); i++)
+        {
+            const std::string& rdata = addressRecords[i]->rdata;
+            IpAddress& address = info.addresses[i];
+            address.family = i < v4 ? IpAddress::Family::IPv4 : IpAddress::Family::IPv6;
+            std::memcpy(address.bytes.data(), rdata.data(), rdata.size());
+            // fe80::/10 只在收到记录的链路上有效
+            bool linkLocal = address.family == IpAddress::Family::IPv6 &&
+                address.bytes[0] == 0xFE && (address.bytes[1] & 0xC0) == 0x80;
+            address.scopeId = linkLocal ? addressRecords[i]->interfaceIndex : 0;
+        }
+        if (v4 > 0)
+        {
+            info.ip = info.addresses.front().toString();
+        }
+        if (v4 < info.addresses.size())
+        {
+            info.ipv6 = info.addresses[v4].toString();
+        }
+        return missing;
+    }
+
+    /**
+     * @brief 组装实例的设备信息，完整时更新设备列表，否则安排补充查询
+     */
+    void syncDevice(Shard& shard, const std::string& instance, mdns::RecordCache::Clock::time_point now)
+    {
+        Service* service = serviceOf(instance);
+        if (!service)
+        {
+            return;
+        }
+
+        DeviceInfo info;
+        info.serviceType = service->type;
+        TxtState txt;
+        txt.knownHash = knownTxtHash(shard, instance);
+        int missing = assembleDevice(shard, instance, info, service, &txt);
+        std::string key = lowerName(instance);
+        if (missing == 0)
+        {
+            shard.pending.erase(key);
+            updateDevice(shard, info, *service, txt);
+            return;
+        }
+
+        LOG_DEBUG("Device incomplete: " << instance << " (missing 0x"
+            << std::hex << missing << std::dec << ")");
+        if (shard.pending.find(key) == shard.pending.end())
+        {
+            // 响应方可能把记录拆成几个连续的报文，稍等片刻再补充查询；
+            // 正在解析的实例有调用方等待，立即查询
+            PendingResolve resolve;
+            resolve.instance = instance;
+            resolve.unicast = isResolving(key);
+            resolve.due = resolve.unicast ? now : now + std::chrono::milliseconds(MDNS_RESOLVE_DELAY_MS);
+            resolve.attempts = 0;
+            shard.pending.insert(std::make_pair(key, resolve));
+        }
+    }
+
+    /**
+     * @brief 为记录不完整的实例发送补充查询
+     * @details 只查询缺失的记录，间隔按 1 秒、2 秒递增，
+     * 达到次数上限后不再查询，直到设备重新发送记录
+     */
+    void resolvePending(Shard& shard, mdns::RecordCache::Clock::time_point now)
+    {
+        for (auto& entry : shard.pending)
+        {
+            PendingResolve& resolve = entry.second;
+            if (resolve.attempts >= MDNS_RESOLVE_ATTEMPTS || now < resolve.due)
+            {
+                continue;
+            }
+
+            DeviceInfo info;
+            int missing = assembleDevice(shard, resolve.instance, info);
+            resolve.due = now + std::chrono::seconds(1 << resolve.attempts);
+            resolve.attempts++;
+            LOG_DEBUG("Resolving " << resolve.instance << ", attempt " << resolve.attempts);
+
+            // 补充查询交给调度器，与同时到期的其他问题合并发送
+            if (missing & kMissingSrv)
+            {
+                requestQuery(shard, resolve.instance, mdns::kTypeSRV, now, resolve.unicast);
+            }
+            if (missing & kMissingTxt)
+            {
+                requestQuery(shard, resolve.instance, mdns::kTypeTXT, now, resolve.unicast);
+            }
+            if ((missing & kMissingAddress) && !info.host.empty())
+            {
+                requestQuery(shard, info.host, mdns::kTypeA, now, resolve.unicast);
+                requestQuery(shard, info.host, mdns::kTypeAAAA, now, resolve.unicast);
+            }
+        }
+    }
+
+    /**
+     * @brief 设备表中的记录与新组装的设备信息是否相同
+     * @details 直接在紧凑记录上比较，不生成 DeviceInfo。ip/ipv6 由地址列表决定，不单独比较；
+     * 接收接口不参与比较: 同时在多条链路上的设备交替刷新记录时不产生更新通知
+     *
+     * @param compareTxt TXT 哈希与记录相同时为 false，b 中没有 TXT 项
+     */
+    static bool sameDevice(const DeviceRecord& a, const DeviceInfo& b, bool compareTxt = true)
+    {
+        if (mdns::StrRef(a.name(), a.nameLength()) != mdns::StrRef(b.name) ||
+            b.serviceType != a.serviceType() || b.host != a.host() || a.port() != b.port ||
+            a.addressCount() != b.addresses.size() || a.verified() != b.verified ||
+            (compareTxt && a.txtCount() != b.txtRecords.size()))
+        {
+            return false;
+        }
+        for (size_t i = 0; i < a.addressCount(); i++)
+        {
+            if (a.address(i) != b.addresses[i])
+            {
+                return false;
+            }
+        }
+        if (!compareTxt)
+        {
+            return true;
+        }
+        // 记录中的 TXT 项与 std::map 的迭代顺序相同
+        size_t i = 0;
+        for (const auto& txt : b.txtRecords)
+        {
+            if (mdns::StrRef(a.txtKey(i), a.txtKeyLength(i)) != mdns::StrRef(txt.first) ||
+                mdns::StrRef(a.txtValue(i), a.txtValueLength(i)) != mdns::StrRef(txt.second))
+            {
+                return false;
+            }
+            i++;
+        }
+        return true;
+    }
+
+    /// 驻留的字符串，池已满或不驻留时返回 nullptr，由记录内联保存
+    static const char* internText(Shard& shard, const std::string& text, bool intern)
+    {
+        return intern ? shard.stringPool->intern(mdns::StrRef(text)) : nullptr;
+    }
+
+    /**
+     * @brief 生成设备表中保存的紧凑记录
+     * @details 先确定每个字符串是否驻留，再按照 TXT 项、地址、内联字符串的顺序
+     * 一次分配全部内存。只在处理该分片的线程中调用(字符串池不加锁)
+     *
+     * @param sequence 发现顺序，替换已有设备时沿用原记录的值
+     */
+    static DeviceRecordPtr makeRecord(Shard& shard, const DeviceInfo& info, uint64_t sequence)
+    {
+        typedef DeviceRecord::TxtEntry TxtEntry;
+        std::vector<const char*>& pooledText = shard.pooledText;
+        std::shared_ptr<DeviceRecord> record(new DeviceRecord());
+        record->pool_ = shard.stringPool;
+        record->sequence_ = sequence;
+        record->txtCount_ = static_cast<uint16_t>(info.txtRecords.size());
+        record->addressCount_ = static_cast<uint16_t>(info.addresses.size());
+        record->port_ = info.port;
+        record->interfaceIndex_ = info.interfaceIndex;
+        record->verified_ = info.verified;
+        record->nameLength_ = static_cast<uint16_t>(info.name.size());
+
+        // 第一遍: 驻留键和短值，统计需要内联保存的字节数
+        pooledText.clear();
+        const char* serviceType = internText(shard, info.serviceType, true);
+        size_t inlineBytes = info.name.size() + 1 + info.host.size() + 1 +
+            (serviceType ? 0 : info.serviceType.size() + 1);
+        for (const auto& txt : info.txtRecords)
+        {
+            const char* key = internText(shard, txt.first, true);
+            const char* value = internText(shard, txt.second, txt.second.size() <= MDNS_INTERNED_VALUE_MAX);
+            inlineBytes += (key ? 0 : txt.first.size() + 1) + (value ? 0 : txt.second.size() + 1);
+            pooledText.push_back(key);
+            pooledText.push_back(value);
+        }
+
+        size_t entryBytes = info.txtRecords.size() * sizeof(TxtEntry);
+        size_t addressBytes = info.addresses.size() * sizeof(IpAddress);
+        record->data_.reset(new char[entryBytes + addressBytes + inlineBytes]);
+        char* base = record->data_.get();
+        char* text = base + entryBytes + addressBytes;
+        auto place = [&text](const std::string& value, const char* pooled) -> const char*
+        {
+            if (pooled)
+            {
+                return pooled;
+            }
+            char* copy = text;
+            std::memcpy(copy, value.data(), value.size());
+            copy[value.size()] = '\0';
+            text += value.size() + 1;
+            return copy;
+        };
+
+        // 第二遍: 填写 TXT 项、地址和内联字符串
+        TxtEntry* entries = reinterpret_cast<TxtEntry*>(base);
+        size_t i = 0;
+        for (const auto& txt : info.txtRecords)
+        {
+            TxtEntry* entry = new (&entries[i]) TxtEntry();
+            entry->key = place(txt.first, pooledText[2 * i]);
+            entry->value = place(txt.second, pooledText[2 * i + 1]);
+            entry->keyLength = static_cast<uint16_t>(txt.first.size());
+            entry->valueLength = static_cast<uint16_t>(txt.second.size());
+            i++;
+        }
+        IpAddress* addresses = reinterpret_cast<IpAddress*>(base + entryBytes);
+        for (i = 0; i < info.addresses.size(); i++)
+        {
+            new (&addresses[i]) IpAddress(info.addresses[i]);
+        }
+        record->name_ = place(info.name, nullptr);
+        record->host_ = place(info.host, nullptr);
+        record->serviceType_ = place(info.serviceType, serviceType);
+        return record;
+    }
+
+    static void logDevice(const DeviceInfo& device)
+    {
+        LOG_INFO("  Name: " << device.name);
+        LOG_INFO("  Host: " << device.host << ":" << device.port);
+        LOG_INFO("  IP: " << device.ip);
+        if (!device.ipv6.empty())
+        {
+            LOG_INFO("  IPv6: " << device.ipv6);
+        }
+        LOG_INFO("  TXT Records: " << device.txtRecords.size());
+        for (const auto& txt : device.txtRecords) {
+            LOG_INFO("    " << txt.first << " = " << txt.second);
+        }
+    }
+
+    /**
+     * @brief 把组装完整的设备信息合并到设备列表并通知
+     * @details 与列表中已有的信息完全相同时不发布快照，也不回调
+     *
+     * @param tempInfo 从缓存组装的设备信息
+     * @param service 设备所属的订阅服务
+     */
+    void updateDevice(Shard& shard, const DeviceInfo& assembled, const Service& service,
+        const TxtState& txt)
+    {
+        std::lock_guard<std::shared_mutex> lock(shard.devicesMutex);
+        DeviceList& devices = shard.devices;
+        size_t index = devices.find(mdns::StrRef(assembled.name));
+        bool txtUnchanged = txt.unchanged && index != DeviceList::npos;
+        if (txtUnchanged && sameDevice(*devices.at(index), assembled, false))
+        {
+            return;
+        }
+
+        // TXT 没有解析时从原记录复制，回调和新记录需要完整的设备信息
+        DeviceInfo copied;
+        if (txtUnchanged)
+        {
+            copied = assembled;
+            copyTxt(*devices.at(index), copied);
+        }
+        const DeviceInfo& tempInfo = txtUnchanged ? copied : assembled;
+
+        if (index == DeviceList::npos)
+        {
+            DeviceRecordPtr record = makeRecord(shard, tempInfo,
+                deviceSequence_.fetch_add(1, std::memory_order_relaxed));
+            devices.insert(record);
+            shard.snapshotDirty = true;
+            LOG_INFO("Device Information [" << devices.size() - 1 << "]:");
+            logDevice(tempInfo);
+            if (service.callback)
+            {
+                DeviceFoundCallback callback = service.callback;
+                deferCallback(shard, [callback, tempInfo]() { callback(tempInfo); });
+            }
+            noteChange(shard, nullptr, record);
+        }
+        else if (txtUnchanged || !sameDevice(*devices.at(index), tempInfo))
+        {
+            // 已发布的快照不可修改，替换为新记录
+            DeviceRecordPtr previous = devices.at(index);
+            DeviceRecordPtr record = makeRecord(shard, tempInfo, previous->sequence_);
+            devices.at(index) = record;
+            shard.snapshotDirty = true;
+            LOG_INFO("Device Updated [" << index << "]:");
+            logDevice(tempInfo);
+            if (service.callback)
+            {
+                DeviceFoundCallback callback = service.callback;
+                deferCallback(shard, [callback, tempInfo]() { callback(tempInfo); });
+            }
+            noteChange(shard, previous, record);
+        }
+        // 保留的项相同而记录数据不同(例如只有过滤掉的键变化)时设备不变，只更新哈希，下次可以跳过解析
+        setTxtHash(shard, assembled.name, txt.hash);
+    }
+
+    /// 设备表中实例的 TXT 哈希，不在设备表中时为 0
+    static uint64_t knownTxtHash(const Shard& shard, const std::string& name)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.devicesMutex);
+        const TxtHashEntry* entry = shard.txtHashes.get(mdns::StrRef(name));
+        return entry ? entry->hash : 0;
+    }
+
+    // 调用方需持有分片的 devicesMutex
+    static void setTxtHash(Shard& shard, const std::string& name, uint64_t hash)
+    {
+        TxtHashEntry* entry = shard.txtHashes.get(mdns::StrRef(name));
+        if (entry)
+        {
+            entry->hash = hash;
+        }
+        else
+        {
+            shard.txtHashes.insert(TxtHashEntry{ name, hash });
+        }
+    }
+
+    static void copyTxt(const DeviceRecord& record, DeviceInfo& info)
+    {
+        for (size_t i = 0; i < record.txtCount(); i++)
+        {
+            info.txtRecords.emplace_hint(info.txtRecords.end(),
+                std::string(record.txtKey(i), record.txtKeyLength(i)),
+                std::string(record.txtValue(i), record.txtValueLength(i)));
+        }
+    }
+
+    static bool isKnownDevice(const Shard& shard, const std::string& name)
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.devicesMutex);
+        return shard.devices.find(mdns::StrRef(name)) != DeviceList::npos;
+    }
+
+    /**
+     * @brief 处理到期的缓存记录
+     * @details 实例的 PTR 记录到期时设备离线；TXT/SRV 到期时，
+     * 如果该实例已没有 PTR、TXT 和 SRV 记录，设备同样离线。
+     * 其余 SRV/TXT/地址记录到期时，仍在线的相关设备重新组装，记录缺失时补充查询
+     */
+    void expireRecords(Shard& shard, mdns::RecordCache::Clock::time_point now)
+    {
+        mdns::RecordCache& recordCache = shard.recordCache;
+        std::vector<mdns::CachedRecord>& expired = shard.expired;
+        expired.clear();
+        shard.refresh.clear();
+        if (!recordCache.advance(now, expired, shard.refresh))
+        {
+            return;
+        }
+        shard.metrics.cacheEvictions.add(expired.size());
+
+        // 到达 TTL 80%/85%/90%/95% 的记录: 查询同名同类型的记录，收到应答后重新开始计时
+        for (const auto& record : shard.refresh)
+        {
+            // 已取消订阅的记录不再刷新，等待到期删除
+            bool wanted = record.type == mdns::kTypePTR ? serviceNamed(record.name) != nullptr :
+                (record.type == mdns::kTypeA || record.type == mdns::kTypeAAAA) ?
+                hostLinks(shard, record.name) != nullptr : serviceOf(record.name) != nullptr;
+            if (!wanted)
+            {
+                continue;
+            }
+            LOG_DEBUG("Refreshing record: " << record.name << " type " << record.type);
+            requestQuery(shard, record.name, record.type, now);
+        }
+
+        for (const auto& record : expired)
+        {
+            LOG_DEBUG("Record expired: " << record.name << " type " << record.type);
+            if (record.type == mdns::kTypePTR)
+            {
+                shard.pending.erase(lowerName(record.target));
+                removeDevice(shard, record.target);
+                continue;
+            }
+            if (record.type == mdns::kTypeSRV && !hasSrvTarget(shard, record.name, record.target))
+            {
+                unlinkHost(shard, record.name, record.target);
+            }
+            Service* service = serviceOf(record.name);
+            if ((record.type == mdns::kTypeTXT || record.type == mdns::kTypeSRV) &&
+                !recordCache.find(record.name, mdns::kTypeTXT) &&
+                !recordCache.find(record.name, mdns::kTypeSRV) &&
+                !(service && recordCache.hasPtr(service->type, record.name)))
+            {
+                shard.pending.erase(lowerName(record.name));
+                removeDevice(shard, record.name);
+            }
+        }
+
+        // 离线处理完成后再重新组装仍在线的设备，避免为已离线的设备发送查询
+        shard.touched.clear();
+        for (const auto& record : expired)
+        {
+            if (record.type == mdns::kTypeSRV || record.type == mdns::kTypeTXT)
+            {
+                touchInstance(shard, record.name);
+            }
+            else if (record.type == mdns::kTypeA || record.type == mdns::kTypeAAAA)
+            {
+                const std::vector<std::string>* instances = hostLinks(shard, record.name);
+                if (instances)
                 {
-                    LOG_ERROR("Invalid compression pointer offset: " << offset);
-                    return false;
+                    for (const auto& instance : *instances)
+                    {
+                        touchInstance(shard, instance);
+                    }
                 }
+            }
+        }
+        for (const auto& instance : shard.touched)
+        {
+            if (isKnownDevice(shard, instance))
+            {
+                syncDevice(shard, instance, now);
+            }
+        }
+    }
+
+    // 实例是否还有指向 host 的 SRV 记录(cache-flush 替换端口时目标主机不变)
+    static bool hasSrvTarget(const Shard& shard, const std::string& instance, const std::string& host)
+    {
+        std::vector<const mdns::CachedRecord*> records;
+        shard.recordCache.findAll(instance, mdns::kTypeSRV, records);
+        for (const auto* record : records)
+        {
+            if (mdns::StrRef(record->target).equalsIgnoreCase(host))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 从设备列表中删除设备并通知
+     *
+     * @param name 设备实例名
+     */
+    void removeDevice(Shard& shard, const std::string& name)
+    {
+        std::lock_guard<std::shared_mutex> lock(shard.devicesMutex);
+        DeviceRecordPtr* device = shard.devices.get(mdns::StrRef(name));
+        if (!device)
+        {
+            return;
+        }
+        DeviceRecordPtr removed = *device;
+        shard.devices.erase(mdns::StrRef(name));
+        shard.latency.erase(lowerName(name));
+        shard.txtHashes.erase(mdns::StrRef(name));
+        shard.snapshotDirty = true;
+        LOG_INFO("Device Lost: " << removed->name());
+        if (shard.lostCallback)
+        {
+            DeviceLostCallback callback = shard.lostCallback;
+            DeviceInfo info = removed->toInfo();
+            deferCallback(shard, [callback, info]() { callback(info); });
+        }
+        noteChange(shard, removed, nullptr);
+    }
+
+    /// 键是否在订阅的键过滤中
+    static bool wantedTxtKey(const std::vector<std::string>& keys, const mdns::StrRef& key)
+    {
+        for (const auto& wanted : keys)
+        {
+            if (key.equalsIgnoreCase(mdns::StrRef(wanted)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief 解析 TXT 记录
+     *
+     * 解析 DNS TXT 记录中的键值对信息
+     * 格式: <length><key>=<value>
+     * 键值视图直接指向记录数据，写入映射时才生成字符串
+     *
+     * @param ptr 记录数据起始位置
+     * @param length 记录总长度
+     * @param txtRecords 解析得到的键值对
+     * @param keys 不为空时只保留这些键(大小写不敏感)，其余的键在记录数据上比较后跳过，不生成字符串
+     */
+    void parseTXT(const uint8_t* ptr, uint16_t length,
+        std::map<std::string, std::string>& txtRecords, const std::vector<std::string>* keys = nullptr)
+    {
+        mdns::TxtReader txt(ptr, length);
+        mdns::StrRef key, value;
+        bool hasValue = false;
+        while (txt.next(key, value, hasValue))
+        {
+            if (keys && !wantedTxtKey(*keys, key))
+            {
+                continue;
+            }
+            if (!hasValue || key.empty())
+            {
+                LOG_WARN("Invalid TXT record format (missing '='): " << key.str());
+                continue;
+            }
+            // RFC 6763 6.4: 同一个键出现多次时只保留第一次出现的值
+            txtRecords.insert(std::make_pair(key.str(), value.str()));
+        }
+        if (txt.malformed())
+        {
+            LOG_ERROR("TXT record parse failed: length exceeds buffer");
+        }
+    }
+
+    // 添加设备列表相关成员
+    struct DeviceNameOf {
+        mdns::StrRef operator()(const DeviceRecordPtr& device) const
+        {
+            return mdns::StrRef(device->name(), device->nameLength());
+        }
+    };
+    typedef mdns::DeviceIndex<DeviceRecordPtr, DeviceNameOf> DeviceList;
+
+    /**
+     * @brief 设备的 TXT 记录数据的哈希(含键过滤)，与快照中的设备记录分开保存，受分片的 devicesMutex 保护
+     */
+    struct TxtHashEntry
+    {
+        std::string name;  // 实例名
+        uint64_t hash;
+    };
+    struct TxtHashNameOf {
+        mdns::StrRef operator()(const TxtHashEntry& entry) const { return mdns::StrRef(entry.name); }
+    };
+    typedef mdns::DeviceIndex<TxtHashEntry, TxtHashNameOf> TxtHashList;
+
+    /**
+     * @brief 设备在每个协议族上的平滑往返时间，受分片的 devicesMutex 保护
+     */
+    struct PathLatency
+    {
+        std::array<int64_t, kFamilyCount> srttUs{ { -1, -1 } };  // 微秒，-1 表示没有样本
+        std::array<mdns::RecordCache::Clock::time_point, kFamilyCount> sampled;  // 已计入的查询时间
+    };
+
+    /**
+     * @brief 分片交给接收线程的请求
+     */
+    struct ShardRequest
+    {
+        enum Kind : uint8_t
+        {
+            Query,         // 补充查询或刷新查询，交给调度器
+            UnicastQuery,  // 主动解析的实例的补充查询，请求单播应答
+            HostLinked,    // 主机成为分片中实例的 SRV 目标
+            HostUnlinked   // 分片中已没有以该主机为 SRV 目标的实例
+        };
+
+        Kind kind;
+        std::string name;
+        uint16_t type;
+        uint64_t hostHash;
+    };
+
+    /**
+     * @brief 分片的运行统计，只由处理该分片的线程写入
+     */
+    struct ShardMetrics
+    {
+        std::array<mdns::Counter, mdns::kParseErrorCount> parseErrors;  // 记录数据的解码失败
+        mdns::Counter cacheInserts;
+        mdns::Counter cacheHits;
+        mdns::Counter cacheGoodbyes;
+        mdns::Counter cacheEvictions;
+        mdns::Counter cacheSize;
+    };
+
+    /**
+     * @brief 设备表的一个分片: 按实例名哈希分配的设备及其记录缓存、解析和事件状态
+     * @details 单线程模式下只有一个分片，由接收线程处理。流水线模式下每个分片由一个解析线程处理，
+     * 除 devicesMutex 保护的部分外只在持有 mutex 时访问: 解析线程处理报文和定时任务时持有，
+     * 接收线程读取已知答案、应用订阅和接口变化时依次锁定全部分片(见 ShardsLock)
+     */
+    struct Shard
+    {
+        explicit Shard(size_t index) : index(index), stringPool(std::make_shared<mdns::StringPool>()),
+            snapshot(std::make_shared<DeviceTable>()) {}
+
+        size_t index;
+
+        // 属于本分片实例的记录缓存
+        mdns::RecordCache recordCache;
+        std::vector<mdns::CachedRecord> expired;  // 复用的到期记录列表
+        std::vector<mdns::CachedRecord> refresh;  // 复用的待刷新记录列表
+        std::vector<mdns::Record> records;        // 解析线程复用的报文记录列表
+        std::vector<const mdns::CachedRecord*> addressRecords;  // 复用的地址记录列表
+        std::vector<std::string> touched;         // 本次报文涉及的实例名
+
+        // 以某个主机为 SRV 目标的实例名，用于关联单独到达的地址记录
+        struct HostLink {
+            std::string host;                    // 主机名(小写)
+            std::vector<std::string> instances;
+        };
+        // 按主机名的 nameHash() 索引，解析地址记录时不构造字符串；哈希相同的主机放在同一个列表中
+        std::unordered_map<uint64_t, std::vector<HostLink>> hostInstances;
+        std::unordered_map<std::string, PendingResolve> pending;  // 键为小写实例名
+
+        // TXT 键、服务类型和短值的驻留池，设备记录持有引用，只在处理本分片的线程中写入
+        std::shared_ptr<mdns::StringPool> stringPool;
+        std::vector<const char*> pooledText;      // makeRecord() 的临时数组，避免重复分配
+
+        mutable std::shared_mutex devicesMutex;   // 处理本分片的线程独占写入，按名称查询共享读取
+        DeviceList devices;                       // 按实例名哈希索引，保持发现顺序
+        std::unordered_map<std::string, PathLatency> latency;  // 键为小写实例名
+        TxtHashList txtHashes;                    // 只由处理本分片的线程读写
+        DeviceTablePtr snapshot;                  // 多个分片时本分片发布的快照，不使用 generation
+        bool snapshotDirty = false;               // 设备有未发布的变化，受 devicesMutex 保护
+
+        DeviceLostCallback lostCallback;          // 受 devicesMutex 保护
+        DeviceEventCallback eventCallback;        // 受 devicesMutex 保护
+        mdns::DeviceEventCoalescer events;        // 未投递的设备变化，受 devicesMutex 保护
+        std::vector<mdns::CallbackDispatcher::Task> deferred;  // 待分发的回调，受 devicesMutex 保护
+
+        ShardMetrics metrics;
+
+        // 流水线模式
+        std::mutex mutex;                         // 见上文
+        std::unique_ptr<mdns::BoundedQueue<mdns::PooledPacket*>> queue;  // 待处理的报文
+        std::thread thread;                       // 解析线程
+        std::mutex wakeMutex;                     // 只用于休眠和唤醒
+        std::condition_variable wake;
+        std::atomic<int> sleepers{ 0 };
+        std::mutex requestMutex;                  // 保护 requests
+        std::vector<ShardRequest> requests;
+    };
+
+    typedef std::vector<std::unique_ptr<Shard>> ShardSet;
+    typedef std::shared_ptr<const ShardSet> ShardSetPtr;
+
+    static ShardSetPtr makeShards(size_t count)
+    {
+        std::shared_ptr<ShardSet> shards = std::make_shared<ShardSet>();
+        for (size_t i = 0; i < count; i++)
+        {
+            shards->emplace_back(new Shard(i));
+        }
+        return shards;
+    }
+
+    /// 接收线程和解析线程使用的分片，发现运行期间不变
+    const ShardSet& shards() const { return *shards_; }
+
+    /**
+     * @brief 流水线模式下依次锁定全部分片的 mutex，单线程模式下不加锁
+     * @details 锁的顺序: 分片 mutex(按下标) -> devicesMutex -> requestMutex
+     */
+    class ShardsLock
+    {
+    public:
+        explicit ShardsLock(const Impl& impl)
+        {
+            if (!impl.pipelined_)
+            {
+                return;
+            }
+            for (const auto& shard : impl.shards())
+            {
+                locks_.emplace_back(shard->mutex);
+            }
+        }
+
+    private:
+        std::vector<std::unique_lock<std::mutex>> locks_;
+    };
+
+    /**
+     * @brief 按新的分片数重建分片，已发现的设备按实例名哈希重新分配
+     * @details 发现未运行时调用，调用方持有 lifecycleMutex_
+     */
+    void reshard(size_t count)
+    {
+        ShardSetPtr shards = makeShards(count);
+        ShardSetPtr previous = std::atomic_load(&shards_);
+
+        // 按发现顺序重新插入，每个分片中的设备仍按发现顺序排列
+        std::vector<DeviceRecordPtr> devices;
+        std::unordered_map<std::string, PathLatency> latency;
+        TxtHashList txtHashes;
+        for (const auto& shard : *previous)
+        {
+            std::lock_guard<std::shared_mutex> lock(shard->devicesMutex);
+            devices.insert(devices.end(), shard->devices.values().begin(), shard->devices.values().end());
+            latency.insert(shard->latency.begin(), shard->latency.end());
+            for (const auto& entry : shard->txtHashes.values())
+            {
+                txtHashes.insert(entry);
+            }
+        }
+        std::sort(devices.begin(), devices.end(), [](const DeviceRecordPtr& a, const DeviceRecordPtr& b)
+        {
+            return a->sequence_ < b->sequence_;
+        });
+        for (const auto& device : devices)
+        {
+            std::string name(device->name(), device->nameLength());
+            Shard& shard = *(*shards)[mdns::shardOf(mdns::nameHash(mdns::StrRef(name)), count)];
+            shard.devices.insert(device);
+            auto path = latency.find(lowerName(name));
+            if (path != latency.end())
+            {
+                shard.latency.insert(*path);
+            }
+            const TxtHashEntry* txt = txtHashes.get(mdns::StrRef(name));
+            if (txt)
+            {
+                shard.txtHashes.insert(*txt);
+            }
+        }
+
+        std::lock_guard<std::mutex> settings(callbackSettingsMutex_);
+        for (const auto& shard : *shards)
+        {
+            shard->lostCallback = lostCallback_;
+            shard->eventCallback = eventCallback_;
+            shard->events.setWindow(eventWindow_);
+        }
+        router_.configure(count);
+        shardCount_.store(count, std::memory_order_release);
+        std::atomic_store(&shards_, shards);
+        for (const auto& shard : *shards)
+        {
+            std::lock_guard<std::shared_mutex> lock(shard->devicesMutex);
+            publishSnapshot(*shard);
+        }
+    }
+
+    /**
+     * @brief 创建缓冲池和分片队列，启动解析线程
+     * @details 调用方持有 lifecycleMutex_，接收线程尚未启动
+     */
+    void startWorkers()
+    {
+        if (!pipelined_)
+        {
+            return;
+        }
+        // 接收线程的批量接收另外占用 MDNS_RECV_BATCH 个缓冲区
+        pool_.reset(new mdns::PacketPool(pipeline_.queueCapacity + MDNS_RECV_BATCH,
+            receive_.maxPacketSize));
+        workersStopping_ = false;
+        workersDrain_ = false;
+        for (const auto& shard : shards())
+        {
+            Shard* target = shard.get();
+            target->queue.reset(new mdns::BoundedQueue<mdns::PooledPacket*>(pipeline_.queueCapacity));
+            target->thread = std::thread([this, target]() { runWorker(*target); });
+        }
+    }
 
-                // Parse the rest of the name from the new location
-                std::string remainingName;
-                const uint8_t* tempPtr = newPtr;
-                if (!parseDNSName(basePtr, tempPtr, end, remainingName))
-                {
-                    return false;
-                }
+    /**
+     * @brief 停止解析线程，只在接收线程退出前调用
+     *
+     * @param drain 为 true 时先处理完队列中的报文(回放结束)，否则丢弃
+     */
+    void stopWorkers(bool drain)
+    {
+        workersDrain_ = drain;
+        for (const auto& shard : shards())
+        {
+            std::lock_guard<std::mutex> lock(shard->wakeMutex);
+            workersStopping_ = true;
+            shard->wake.notify_one();
+        }
+        for (const auto& shard : shards())
+        {
+            if (shard->thread.joinable())
+            {
+                shard->thread.join();
+            }
+            shard->queue.reset();
+        }
+        pool_.reset();
+    }
 
-                if (!first)
-                {
-                    name += '.';
-                }
-                name += remainingName;
-                ptr++; // Move past the second byte of the compression pointer
-                return true;
+    /**
+     * @brief 解析线程: 处理分片队列中的报文和分片的定时任务
+     * @details 每处理一批报文(最多 MDNS_RECV_BATCH 个)后释放分片锁，再分发这批报文产生的回调
+     */
+    void runWorker(Shard& shard)
+    {
+        typedef mdns::RecordCache::Clock Clock;
+        LOG_DEBUG("Parser thread " << shard.index << " started");
+        std::vector<mdns::PooledPacket*> batch;
+        batch.reserve(MDNS_RECV_BATCH);
+
+        for (;;)
+        {
+            Clock::time_point now = Clock::now();
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                expireRecords(shard, now);
+                resolvePending(shard, now);
+                deliverEvents(shard, now, false);
+                shard.metrics.cacheSize.set(shard.recordCache.size());
             }
+            runDeferredCallbacks(shard);
 
-            // Zero length means end of name
-            if (len == 0)
+            bool stopping = workersStopping_.load(std::memory_order_acquire);
+            if (!stopping)
+            {
+                waitForPackets(shard, waitTimeout(eventDeadline(shard), now));
+                stopping = workersStopping_.load(std::memory_order_acquire);
+            }
+            if (stopping && !workersDrain_.load(std::memory_order_acquire))
             {
                 break;
             }
 
-            if (ptr + len > end)
+            batch.clear();
+            mdns::PooledPacket* packet = nullptr;
+            while (batch.size() < MDNS_RECV_BATCH && shard.queue->tryPop(packet))
             {
-                LOG_ERROR("DNS name parse failed: length " << (int)len << " exceeds buffer");
-                return false;
+                batch.push_back(packet);
             }
-
-            // Add dot between labels, except for the first one
-            if (!first)
+            if (batch.empty())
             {
-                name += '.';
+                if (stopping)
+                {
+                    break;
+                }
+                continue;
             }
-            first = false;
-
-            // Append this label
-            name.append(reinterpret_cast<const char*>(ptr), len);
-            ptr += len;
+            {
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                for (auto* queued : batch)
+                {
+                    processPacket(shard, *queued);
+                    pool_->release(queued);
+                }
+            }
+            runDeferredCallbacks(shard);
         }
 
-        if (name.empty())
+        // 丢弃未处理的报文，投递合并窗口尚未到期的事件
+        mdns::PooledPacket* packet = nullptr;
+        while (shard.queue->tryPop(packet))
         {
-            LOG_ERROR("DNS name parse failed: empty name");
-            return false;
+            pool_->release(packet);
+        }
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            deliverEvents(shard, Clock::now(), true);
         }
+        runDeferredCallbacks(shard);
+        LOG_DEBUG("Parser thread " << shard.index << " stopped");
+    }
 
-        LOG_DEBUG("Parsed DNS name: " << name << ", total length: " << name.length());
-        return true;
+    /// 队列为空时休眠，直到有新报文、停止或超时
+    void waitForPackets(Shard& shard, int timeoutMs)
+    {
+        std::unique_lock<std::mutex> lock(shard.wakeMutex);
+        shard.sleepers++;
+        // 与 wakeWorker() 中的栅栏配对: 要么这里看到新报文，要么接收线程看到正在休眠
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        shard.wake.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this, &shard]
+        {
+            return workersStopping_.load(std::memory_order_relaxed) || shard.queue->sizeApprox() > 0;
+        });
+        shard.sleepers--;
+    }
+
+    /// 接收线程放入报文后调用，只在解析线程休眠时加锁唤醒
+    static void wakeWorker(Shard& shard)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (shard.sleepers.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(shard.wakeMutex);
+            shard.wake.notify_one();
+        }
     }
 
     /**
-     * @brief 解析 TXT 记录
-     *
-     * 解析 DNS TXT 记录中的键值对信息
-     * 格式: <length><key>=<value>
-     *
-     * @param ptr 记录数据起始位置
-     * @param length 记录总长度
-     * @param txtRecords 解析得到的键值对
+     * @brief 解析线程重新读出报文中的记录并应用到分片
+     * @details 接收线程已经读过一遍并统计了头部和记录的解析失败，这里遇到失败时直接停止
      */
-    void parseTXT(const uint8_t* ptr, uint16_t length,
-        std::map<std::string, std::string>& txtRecords)
+    void processPacket(Shard& shard, const mdns::PooledPacket& packet)
     {
-        const uint8_t* end = ptr + length;
-        while (ptr < end)
+        mdns::PacketReader reader(packet.data, packet.size);
+        mdns::Header header;
+        if (!reader.readHeader(header))
+        {
+            return;
+        }
+        for (uint16_t i = 0; i < header.qdcount; i++)
+        {
+            mdns::Question question;
+            if (!reader.readQuestion(question))
+            {
+                return;
+            }
+        }
+        shard.records.clear();
+        uint32_t total = static_cast<uint32_t>(header.ancount) + header.nscount + header.arcount;
+        for (uint32_t i = 0; i < total; i++)
         {
-            uint8_t len = *ptr++;
-            if (ptr + len > end)
+            mdns::Record record;
+            if (!reader.readRecord(record))
             {
-                LOG_ERROR("TXT record parse failed: length " << (int)len << " exceeds buffer");
                 break;
             }
+            shard.records.push_back(record);
+        }
+        PacketInfo info = { packet.interfaceIndex, packet.sender.ss_family == AF_INET6 ? kIPv6 : kIPv4,
+            packet.received, packet.querySent };
+        applyResponse(shard, reader, shard.records, info);
+    }
+
+    /// 分片需要的查询: 单线程模式下直接交给调度器，流水线模式下交给接收线程
+    void requestQuery(Shard& shard, const std::string& name, uint16_t type,
+        mdns::RecordCache::Clock::time_point now, bool unicast = false)
+    {
+        if (!pipelined_)
+        {
+            scheduler_.once(name, type, now, unicast);
+            return;
+        }
+        pushRequest(shard, ShardRequest{ unicast ? ShardRequest::UnicastQuery : ShardRequest::Query,
+            name, type, 0 });
+    }
+
+    /// 实例名(小写)是否正被 resolveInstance() 解析
+    bool isResolving(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(resolveMutex_);
+        return std::find(resolving_.begin(), resolving_.end(), key) != resolving_.end();
+    }
+
+    /// 实例是否属于订阅的服务类型，在 API 线程中按订阅列表判断
+    bool subscribedInstance(const std::string& name)
+    {
+        mdns::ServiceMatcher matcher;
+        {
+            std::lock_guard<std::mutex> lock(subscriptionsMutex_);
+            for (size_t i = 0; i < subscriptions_.size(); i++)
+            {
+                matcher.add(mdns::StrRef(subscriptions_[i].serviceType), static_cast<uint32_t>(i));
+            }
+        }
+        mdns::ServiceMatcher::Match match;
+        return matcher.match(mdns::StrRef(name), match) && !match.exact;
+    }
 
-            std::string record(reinterpret_cast<const char*>(ptr), len);
-            size_t sep = record.find('=');
-            if (sep != std::string::npos)
+    /**
+     * @brief 为 resolveInstance() 请求的实例立即安排 QU 问题
+     * @details 问题与同时到期的其他问题合并，在本次循环中发送。缓存中已有该实例的 SRV 记录时
+     * 同时询问目标主机的地址
+     */
+    void drainResolveRequests(mdns::RecordCache::Clock::time_point now)
+    {
+        std::vector<std::string> names;
+        {
+            std::lock_guard<std::mutex> lock(resolveMutex_);
+            if (resolveRequests_.empty())
             {
-                std::string key = record.substr(0, sep);
-                std::string value = record.substr(sep + 1);
-                txtRecords[key] = value;
-                LOG_DEBUG("Parsed TXT record - " << key << ": " << value);
+                return;
             }
-            else
+            names.swap(resolveRequests_);
+        }
+        ShardsLock lock(*this);
+        for (const auto& name : names)
+        {
+            scheduler_.once(name, mdns::kTypeSRV, now, true);
+            scheduler_.once(name, mdns::kTypeTXT, now, true);
+            const Shard& shard = *shards()[mdns::shardOf(mdns::nameHash(mdns::StrRef(name)), shards().size())];
+            const mdns::CachedRecord* srv = shard.recordCache.find(mdns::StrRef(name), mdns::kTypeSRV);
+            if (srv)
             {
-                LOG_WARN("Invalid TXT record format (missing '='): " << record);
+                scheduler_.once(srv->target, mdns::kTypeA, now, true);
+                scheduler_.once(srv->target, mdns::kTypeAAAA, now, true);
             }
-            ptr += len;
         }
     }
 
-    // 添加设备列表相关成员
-    mutable std::mutex devicesMutex;
-    std::vector<DeviceInfo> discoveredDevices;
+    /// 追加分片请求，列表原本为空时唤醒接收线程
+    void pushRequest(Shard& shard, ShardRequest&& request)
+    {
+        bool wake;
+        {
+            std::lock_guard<std::mutex> lock(shard.requestMutex);
+            wake = shard.requests.empty();
+            shard.requests.push_back(std::move(request));
+        }
+        if (wake)
+        {
+            poller_.wakeup();
+        }
+    }
+
+    /// 接收线程处理各分片的请求
+    void drainShardRequests(mdns::RecordCache::Clock::time_point now)
+    {
+        for (const auto& shard : shards())
+        {
+            {
+                std::lock_guard<std::mutex> lock(shard->requestMutex);
+                if (shard->requests.empty())
+                {
+                    continue;
+                }
+                requests_.swap(shard->requests);
+            }
+            for (const auto& request : requests_)
+            {
+                switch (request.kind)
+                {
+                case ShardRequest::Query:
+                case ShardRequest::UnicastQuery:
+                    scheduler_.once(request.name, request.type, now,
+                        request.kind == ShardRequest::UnicastQuery);
+                    break;
+                case ShardRequest::HostLinked:
+                    router_.linkHost(request.hostHash, shard->index);
+                    break;
+                case ShardRequest::HostUnlinked:
+                    router_.unlinkHost(request.hostHash, shard->index);
+                    break;
+                }
+            }
+            requests_.clear();
+        }
+    }
 
-    // 添加设备到列表
-    void addDevice(const DeviceInfo& device)
+    // 设备表分片，只在发现未运行时替换(API 线程通过 std::atomic_load 访问)
+    ShardSetPtr shards_;
+    std::atomic<size_t> shardCount_{ 1 };
+
+    // 已发布的设备表快照，通过 std::atomic_load/atomic_store 访问。
+    // 多个分片时为最近一次合并的结果，受 mergeMutex_ 串行化
+    mutable DeviceTablePtr snapshot_;
+    std::atomic<uint64_t> generation_;
+    mutable std::mutex mergeMutex_;
+    std::atomic<uint64_t> deviceSequence_{ 0 };  // 下一个新设备的发现顺序
+
+    /**
+     * @brief 发布分片的设备表快照
+     * @details 调用方需持有分片的 devicesMutex。只复制设备指针，未变化的设备在新旧快照间共享。
+     * 单个分片时直接发布为整个设备表；多个分片时先发布分片快照再增加代数，由读取端合并
+     */
+    void publishSnapshot(Shard& shard)
     {
-        std::lock_guard<std::mutex> lock(devicesMutex);
-        // 检查设备是否已存在
-        auto it = std::find(discoveredDevices.begin(), discoveredDevices.end(), device);
-        if (it == discoveredDevices.end())
+        shard.snapshotDirty = false;
+        std::shared_ptr<DeviceTable> table = std::make_shared<DeviceTable>();
+        table->devices = shard.devices.values();
+        if (shardCount_.load(std::memory_order_relaxed) > 1)
         {
-            LOG_INFO("添加新设备到列表: " << device.name << " 位于 " << device.ip);
-            discoveredDevices.push_back(device);
+            std::atomic_store(&shard.snapshot, DeviceTablePtr(table));
+            generation_.fetch_add(1, std::memory_order_release);
         }
         else
         {
-            LOG_DEBUG("设备已在列表中: " << device.name << " 位于 " << device.ip);
-            // 更新TXT记录
-            it->txtRecords = device.txtRecords;
+            table->generation = generation_.load(std::memory_order_relaxed) + 1;
+            std::atomic_store(&snapshot_, DeviceTablePtr(table));
+            generation_.store(table->generation, std::memory_order_release);
         }
+        notifyTableWaiters();
     }
 
+    /**
+     * @brief 有未发布的变化时发布快照，调用方需持有分片的 devicesMutex
+     * @details 设备变化只标记分片，处理完一批报文或一轮到期检查后发布一次，
+     * 一批报文中的多个变化只复制一次设备数组
+     */
+    void publishChanges(Shard& shard)
+    {
+        if (shard.snapshotDirty)
+        {
+            publishSnapshot(shard);
+        }
+    }
+
+    /// 发布快照或停止发现后调用，只在有线程等待时加锁唤醒
+    void notifyTableWaiters()
+    {
+        // 与 waitFor() 中的栅栏配对: 要么等待方看到新的代数，要么这里看到有线程在等待
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (tableWaiters_.load(std::memory_order_relaxed) > 0)
+        {
+            std::lock_guard<std::mutex> lock(tableWaitMutex_);
+            tableChanged_.notify_all();
+        }
+    }
+
+    // 离线和事件回调的设置，新建的分片从这里复制，受 callbackSettingsMutex_ 保护
+    std::mutex callbackSettingsMutex_;
+    DeviceLostCallback lostCallback_;
+    DeviceEventCallback eventCallback_;
+    mdns::RecordCache::Clock::duration eventWindow_{ mdns::RecordCache::Clock::duration::zero() };
+
+    // 解析流水线，受 lifecycleMutex_ 保护，接收线程运行期间不变
+    PipelineOptions pipeline_;
+    bool pipelined_ = false;
+    mdns::PacketRouter router_;                      // 只在接收线程中修改
+    std::unique_ptr<mdns::PacketPool> pool_;
+    std::atomic<bool> workersStopping_{ false };
+    std::atomic<bool> workersDrain_{ false };
+    std::vector<ShardRequest> requests_;             // 接收线程复用的请求列表
+    ReceiveOptions receive_;                         // 受 lifecycleMutex_ 保护，接收线程运行期间不变
+    mdns::SourceRateLimiter limiter_;                // 只在接收线程中使用
+    QueryOptions query_;                             // 受 lifecycleMutex_ 保护，接收线程运行期间不变
+    std::string cacheFile_;                          // 缓存文件，同样受 lifecycleMutex_ 保护
+    uint32_t cacheSaveInterval_ = 0;                 // 运行期间的保存间隔(毫秒)，0 表示只在停止时保存
+    mdns::RecordCache::Clock::time_point nextCacheSave_;
+
+    // 订阅请求，API 线程写入后置位 subscriptionsChanged_，接收线程应用
+    std::mutex lifecycleMutex_;          // 串行化启动、停止和订阅
+    std::mutex subscriptionsMutex_;
+    std::vector<Subscription> subscriptions_;
+    std::atomic<bool> subscriptionsChanged_{ false };
+
+    // waitFor() 的等待方，发布快照时唤醒
+    std::mutex tableWaitMutex_;
+    std::condition_variable tableChanged_;
+    std::atomic<int> tableWaiters_{ 0 };
+
+    // resolveInstance() 正在解析的实例(小写，同名可重复)和待发送的查询，受 resolveMutex_ 保护
+    std::mutex resolveMutex_;
+    std::vector<std::string> resolving_;
+    std::vector<std::string> resolveRequests_;
+
     std::atomic<bool> running;
-    SOCKET socket_;
+    SOCKET socket_;                      // IPv4，224.0.0.251
+    SOCKET socket6_;                     // IPv6，ff02::fb
     std::thread receiveThread;
+    mdns::Poller poller_;                // 接收线程等待套接字和唤醒
+
+    // 报文来源，受 lifecycleMutex_ 保护，接收线程运行期间不变
+    std::shared_ptr<PacketSource> source_;
+    ReplayOptions replayOptions_;
+    mutable std::mutex replayMutex_;     // 保护下面两个回放状态
+    mutable std::condition_variable replayDone_;
+    bool replayActive_ = false;          // 回放线程正在运行
+    bool replayFinished_ = false;        // 来源中的报文已全部处理
+
+    // 抓包写入: capture_ 受 captureMutex_ 保护，capturing_ 使未开启时接收线程不加锁
+    std::mutex captureMutex_;
+    std::unique_ptr<mdns::CaptureWriter> capture_;
+    std::atomic<bool> capturing_{ false };
+    std::vector<mdns::NetworkInterface> interfaces_;  // 已加入多播组的接口，只在接收线程中访问
+    mdns::InterfaceMonitor interfaceMonitor_;
+    mdns::RecordCache::Clock::time_point nextInterfaceScan_;
+    uint32_t receiveErrors_ = 0;         // 连续的接收错误数，只在接收线程中访问
+
+    // 设备广播，广播线程运行时 responder_ 只在广播线程中访问
+    mdns::Responder responder_;
+    std::vector<mdns::Responder::Packet> outgoing_;
+    std::mutex broadcastLifecycleMutex_;  // 串行化启动、停止广播和 TXT 更新
+    std::mutex broadcastMutex_;           // 保护 pendingTxt_
+    std::map<std::string, std::string> pendingTxt_;
+    std::atomic<bool> broadcastChanged_{ false };
+    std::atomic<bool> broadcasting_;
+    SOCKET broadcastSocket_;
+    std::thread broadcastThread_;
+    mdns::Poller broadcastPoller_;
+
+    /**
+     * @brief 运行统计，计数器由接收线程写入(responsesSent 由广播线程写入)
+     * @details 记录数据的解码失败和记录缓存的统计在各分片的 ShardMetrics 中
+     */
+    struct Metrics
+    {
+        mdns::Counter packetsReceived;
+        mdns::Counter bytesReceived;
+        mdns::Counter queriesReceived;
+        mdns::Counter packetsSent;
+        mdns::Counter bytesSent;
+        mdns::Counter sendErrors;
+        mdns::Counter receiveErrors;
+        mdns::Counter responsesSent;
+        mdns::Counter socketDrops;
+        mdns::Counter oversizePackets;
+        mdns::Counter rejectedHeader;  // 头部检查拒绝的报文
+        mdns::Counter rejectedPort;    // 来源端口不是 5353 的应答
+        mdns::Counter rateLimited;     // 来源超过速率限制而丢弃的报文
+        std::array<mdns::Counter, mdns::kParseErrorCount> parseErrors;  // 下标为 mdns::ParseError
+        mdns::Counter recordsPTR;
+        mdns::Counter recordsSRV;
+        mdns::Counter recordsTXT;
+        mdns::Counter recordsA;
+        mdns::Counter recordsAAAA;
+        mdns::Counter recordsOther;
+        mdns::Counter pipelineDrops;   // 缓冲池或分片队列已满而丢弃的报文
+        mdns::Histogram queryLatency;
+    };
+    Metrics metrics_;
+    std::array<uint32_t, kFamilyCount> lastDrops_{ { 0, 0 } };  // 套接字上次报告的内核丢包累计数
+    std::array<mdns::RecordCache::Clock::time_point, kFamilyCount> firstAnswer_;  // 已计入延迟的查询时间
+
+    // 最后声明，最先析构: 工作线程执行完排队的回调后退出
+    mdns::CallbackDispatcher dispatcher_;
 };
 
+const size_t DeviceDiscovery::LatencyHistogram::kBuckets;
+
+uint64_t DeviceDiscovery::LatencyHistogram::percentileUs(double q) const
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    uint64_t target = static_cast<uint64_t>(q * static_cast<double>(count) + 0.5);
+    target = std::max<uint64_t>(target, 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < kBuckets; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+        {
+            // 最后一个桶没有上限，以最大样本代替
+            return i + 1 == kBuckets ? maxUs : std::min<uint64_t>(uint64_t(1) << i, maxUs);
+        }
+    }
+    return maxUs;
+}
+
+std::string DeviceDiscovery::IpAddress::toString() const
+{
+    char text[INET6_ADDRSTRLEN];
+    int af = family == Family::IPv4 ? AF_INET : AF_INET6;
+    if (family == Family::None || !inet_ntop(af, (void*)bytes.data(), text, sizeof(text)))
+    {
+        return std::string();
+    }
+    return text;
+}
+
+const char* DeviceDiscovery::DeviceRecord::findTxt(const std::string& key, size_t* length) const
+{
+    const TxtEntry* first = entries();
+    size_t count = txtCount_;
+    while (count > 0)
+    {
+        size_t half = count / 2;
+        const TxtEntry& middle = first[half];
+        int order = mdns::StrRef(middle.key, middle.keyLength).compare(mdns::StrRef(key));
+        if (order == 0)
+        {
+            if (length)
+            {
+                *length = middle.valueLength;
+            }
+            return middle.value;
+        }
+        if (order < 0)
+        {
+            first += half + 1;
+            count -= half + 1;
+        }
+        else
+        {
+            count = half;
+        }
+    }
+    return nullptr;
+}
+
+DeviceDiscovery::DeviceInfo DeviceDiscovery::DeviceRecord::toInfo() const
+{
+    DeviceInfo info;
+    info.name.assign(name_, nameLength_);
+    info.serviceType = serviceType_;
+    info.host = host_;
+    info.port = port_;
+    info.interfaceIndex = interfaceIndex_;
+    info.verified = verified_;
+    info.addresses.assign(addresses(), addresses() + addressCount_);
+    // 每个协议族的第一个地址是最近收到的记录，与组装时的 ip/ipv6 一致
+    for (const auto& address : info.addresses)
+    {
+        std::string& text = address.family == IpAddress::Family::IPv4 ? info.ip : info.ipv6;
+        if (text.empty())
+        {
+            text = address.toString();
+        }
+    }
+    for (size_t i = 0; i < txtCount_; i++)
+    {
+        const TxtEntry& entry = entries()[i];
+        info.txtRecords.emplace_hint(info.txtRecords.end(), std::string(entry.key, entry.keyLength),
+            std::string(entry.value, entry.valueLength));
+    }
+    return info;
+}
+
 // 实现接口方法
 DeviceDiscovery::DeviceDiscovery() : pImpl(new Impl()) {}
 DeviceDiscovery::~DeviceDiscovery() = default;
@@ -716,6 +4738,17 @@ bool DeviceDiscovery::startDiscovery(const std::string& serviceType,
     return pImpl->startDiscovery(serviceType, callback);
 }
 
+bool DeviceDiscovery::subscribe(const std::string& serviceType,
+    const DeviceFoundCallback& callback, const std::vector<std::string>& txtKeys)
+{
+    return pImpl->subscribe(serviceType, callback, txtKeys);
+}
+
+void DeviceDiscovery::unsubscribe(const std::string& serviceType)
+{
+    pImpl->unsubscribe(serviceType);
+}
+
 void DeviceDiscovery::stopDiscovery()
 {
     pImpl->stopDiscovery();
@@ -725,4 +4758,136 @@ void DeviceDiscovery::stopDiscovery()
 std::vector<DeviceDiscovery::DeviceInfo> DeviceDiscovery::getDiscoveredDevices() const
 {
     return pImpl->getDiscoveredDevices();
-}
\ No newline at end of file
+}
+
+bool DeviceDiscovery::setCallbackOptions(const CallbackOptions& options)
+{
+    return pImpl->setCallbackOptions(options);
+}
+
+bool DeviceDiscovery::setPipelineOptions(const PipelineOptions& options)
+{
+    return pImpl->setPipelineOptions(options);
+}
+
+bool DeviceDiscovery::setReceiveOptions(const ReceiveOptions& options)
+{
+    return pImpl->setReceiveOptions(options);
+}
+
+bool DeviceDiscovery::setQueryOptions(const QueryOptions& options)
+{
+    return pImpl->setQueryOptions(options);
+}
+
+bool DeviceDiscovery::setCacheFile(const std::string& path, uint32_t saveIntervalMs)
+{
+    return pImpl->setCacheFile(path, saveIntervalMs);
+}
+
+size_t DeviceDiscovery::poll(size_t maxCallbacks)
+{
+    return pImpl->poll(maxCallbacks);
+}
+
+DeviceDiscovery::CallbackStats DeviceDiscovery::getCallbackStats() const
+{
+    return pImpl->getCallbackStats();
+}
+
+DeviceDiscovery::DiscoveryStats DeviceDiscovery::getStats() const
+{
+    return pImpl->getStats();
+}
+
+std::shared_ptr<DeviceDiscovery::PacketSource> DeviceDiscovery::openCaptureFile(const std::string& path)
+{
+    std::shared_ptr<mdns::CaptureFileSource> source = std::make_shared<mdns::CaptureFileSource>();
+    if (!source->open(path))
+    {
+        LOG_ERROR("无法打开抓包文件: " << source->error());
+        return nullptr;
+    }
+    LOG_INFO("打开抓包文件: " << path);
+    return source;
+}
+
+bool DeviceDiscovery::setPacketSource(const std::shared_ptr<PacketSource>& source,
+    const ReplayOptions& options)
+{
+    return pImpl->setPacketSource(source, options);
+}
+
+bool DeviceDiscovery::waitForReplay(uint32_t timeoutMs) const
+{
+    return pImpl->waitForReplay(timeoutMs);
+}
+
+bool DeviceDiscovery::startCapture(const std::string& path)
+{
+    return pImpl->startCapture(path);
+}
+
+void DeviceDiscovery::stopCapture()
+{
+    pImpl->stopCapture();
+}
+
+DeviceDiscovery::DeviceTablePtr DeviceDiscovery::getDeviceTable() const
+{
+    return pImpl->getDeviceTable();
+}
+
+uint64_t DeviceDiscovery::getGeneration() const
+{
+    return pImpl->getGeneration();
+}
+
+DeviceDiscovery::DeviceRecordPtr DeviceDiscovery::waitFor(const DevicePredicate& predicate,
+    uint32_t timeoutMs)
+{
+    return pImpl->waitFor(predicate, timeoutMs);
+}
+
+DeviceDiscovery::DeviceRecordPtr DeviceDiscovery::resolveInstance(const std::string& name,
+    uint32_t timeoutMs)
+{
+    return pImpl->resolveInstance(name, timeoutMs);
+}
+
+bool DeviceDiscovery::getPreferredAddress(const std::string& name, IpAddress& address) const
+{
+    return pImpl->getPreferredAddress(name, address);
+}
+
+void DeviceDiscovery::setDeviceLostCallback(const DeviceLostCallback& callback)
+{
+    pImpl->setDeviceLostCallback(callback);
+}
+
+void DeviceDiscovery::setDeviceEventCallback(const DeviceEventCallback& callback,
+    uint32_t coalesceMs)
+{
+    pImpl->setDeviceEventCallback(callback, coalesceMs);
+}
+
+bool DeviceDiscovery::startBroadcast(const std::string& deviceName,
+    const std::map<std::string, std::string>& txtRecords)
+{
+    return pImpl->startBroadcast(deviceName, txtRecords);
+}
+
+bool DeviceDiscovery::startBroadcast(const ServiceAdvertisement& service)
+{
+    return pImpl->startBroadcast(service);
+}
+
+bool DeviceDiscovery::updateBroadcastTxt(const std::map<std::string, std::string>& txtRecords)
+{
+    return pImpl->updateBroadcastTxt(txtRecords);
+}
+
+void DeviceDiscovery::stopBroadcast()
+{
+    pImpl->stopBroadcast();
+}
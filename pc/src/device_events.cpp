@@ -0,0 +1,203 @@
+/**
+ * @file device_events.cpp
+ * @brief 设备变化事件的差异计算与合并实现
+ */
+
+#include "device_events.h"
+
+namespace mdns {
+
+namespace {
+
+StrRef nameOf(const DeviceDiscovery::DeviceRecord& record)
+{
+    return StrRef(record.name(), record.nameLength());
+}
+
+StrRef keyAt(const DeviceDiscovery::DeviceRecord& record, size_t i)
+{
+    return StrRef(record.txtKey(i), record.txtKeyLength(i));
+}
+
+StrRef valueAt(const DeviceDiscovery::DeviceRecord& record, size_t i)
+{
+    return StrRef(record.txtValue(i), record.txtValueLength(i));
+}
+
+} // namespace
+
+std::string DeviceEventCoalescer::keyOf(const StrRef& name)
+{
+    std::string key(name.data(), name.size());
+    for (auto& c : key)
+    {
+        c = asciiLower(c);
+    }
+    return key;
+}
+
+void DeviceEventCoalescer::record(const RecordPtr& before, const RecordPtr& after,
+    Clock::time_point now)
+{
+    const RecordPtr& known = after ? after : before;
+    if (!known)
+    {
+        return;
+    }
+    std::string key = keyOf(nameOf(*known));
+    auto it = index_.find(key);
+    if (it != index_.end())
+    {
+        pending_[it->second].after = after;
+        return;
+    }
+    if (pending_.empty())
+    {
+        started_ = now;
+    }
+    index_.insert(std::make_pair(key, pending_.size()));
+    Pending change;
+    change.before = before;
+    change.after = after;
+    pending_.push_back(change);
+}
+
+void DeviceEventCoalescer::discard(const StrRef& name)
+{
+    auto it = index_.find(keyOf(name));
+    if (it == index_.end())
+    {
+        return;
+    }
+    // 保持其余设备的顺序，之后的下标前移
+    size_t pos = it->second;
+    index_.erase(it);
+    pending_.erase(pending_.begin() + pos);
+    for (auto& entry : index_)
+    {
+        if (entry.second > pos)
+        {
+            entry.second--;
+        }
+    }
+}
+
+void DeviceEventCoalescer::clear()
+{
+    pending_.clear();
+    index_.clear();
+}
+
+DeviceEventCoalescer::Clock::time_point DeviceEventCoalescer::deadline() const
+{
+    return pending_.empty() ? Clock::time_point::max() : started_ + window_;
+}
+
+void DeviceEventCoalescer::take(std::vector<Event>& out)
+{
+    for (const auto& change : pending_)
+    {
+        if (!change.before && change.after)
+        {
+            out.push_back(Event());
+            out.back().type = Event::Type::Added;
+            out.back().device = change.after->toInfo();
+        }
+        else if (change.before && !change.after)
+        {
+            out.push_back(Event());
+            out.back().type = Event::Type::Removed;
+            out.back().device = change.before->toInfo();
+        }
+        else if (change.before && change.after)
+        {
+            Event event;
+            if (diff(*change.before, *change.after, event))
+            {
+                event.type = Event::Type::Updated;
+                event.device = change.after->toInfo();
+                out.push_back(std::move(event));
+            }
+        }
+    }
+    clear();
+}
+
+bool DeviceEventCoalescer::diff(const DeviceDiscovery::DeviceRecord& before,
+    const DeviceDiscovery::DeviceRecord& after, Event& event)
+{
+    event.changes = 0;
+    event.txtAdded.clear();
+    event.txtChanged.clear();
+    event.txtRemoved.clear();
+
+    if (StrRef(before.host()) != StrRef(after.host()))
+    {
+        event.changes |= Event::kChangedHost;
+    }
+    if (before.port() != after.port())
+    {
+        event.changes |= Event::kChangedPort;
+    }
+    bool sameAddresses = before.addressCount() == after.addressCount();
+    for (size_t i = 0; sameAddresses && i < before.addressCount(); i++)
+    {
+        sameAddresses = before.address(i) == after.address(i);
+    }
+    if (!sameAddresses)
+    {
+        event.changes |= Event::kChangedAddresses;
+    }
+    if (before.verified() != after.verified())
+    {
+        event.changes |= Event::kChangedVerified;
+    }
+
+    // 两边的 TXT 项都按键排序，归并一遍得到差异
+    size_t i = 0;
+    size_t j = 0;
+    while (i < before.txtCount() || j < after.txtCount())
+    {
+        int order;
+        if (i == before.txtCount())
+        {
+            order = 1;
+        }
+        else if (j == after.txtCount())
+        {
+            order = -1;
+        }
+        else
+        {
+            order = keyAt(before, i).compare(keyAt(after, j));
+        }
+
+        if (order < 0)
+        {
+            event.txtRemoved.push_back(keyAt(before, i).str());
+            i++;
+        }
+        else if (order > 0)
+        {
+            event.txtAdded.insert(std::make_pair(keyAt(after, j).str(), valueAt(after, j).str()));
+            j++;
+        }
+        else
+        {
+            if (valueAt(before, i) != valueAt(after, j))
+            {
+                event.txtChanged.insert(std::make_pair(keyAt(after, j).str(),
+                    valueAt(after, j).str()));
+            }
+            i++;
+            j++;
+        }
+    }
+    if (!event.txtAdded.empty() || !event.txtChanged.empty() || !event.txtRemoved.empty())
+    {
+        event.changes |= Event::kChangedTxt;
+    }
+    return event.changes != 0;
+}
+
+} // namespace mdns
@@ -0,0 +1,88 @@
+/**
+ * @file device_events.h
+ * @brief 设备变化事件的差异计算与合并
+ * @details 设备表中的记录不可修改，每次变化都会替换为新记录。合并器为每个发生变化的设备
+ * 保存窗口开始时和当前的记录，窗口到期时比较两者生成事件:
+ *  - 开始时不存在、当前存在: Added
+ *  - 开始时存在、当前不存在: Removed
+ *  - 两者都存在且内容不同: Updated，TXT 差异在两个按键排序的数组上归并得到
+ *  - 其余情况(包括窗口内新增后又删除)不产生事件
+ *
+ * 只保存记录指针，窗口内的多次变化不复制设备信息。非线程安全。
+ */
+
+#pragma once
+
+#include "device_discovery.h"
+#include "mdns_packet.h"
+#include <chrono>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mdns {
+
+class DeviceEventCoalescer {
+public:
+    typedef std::chrono::steady_clock Clock;
+    typedef DeviceDiscovery::DeviceRecordPtr RecordPtr;
+    typedef DeviceDiscovery::DeviceEvent Event;
+
+    /// 设置合并窗口，0 表示每次变化后立即到期
+    void setWindow(Clock::duration window) { window_ = window; }
+    Clock::duration window() const { return window_; }
+
+    /**
+     * @brief 记录一次设备变化
+     *
+     * @param before 变化前的记录，新增设备时为空
+     * @param after 变化后的记录，删除设备时为空
+     * @param now 当前时间，窗口内的第一次变化开始计时
+     */
+    void record(const RecordPtr& before, const RecordPtr& after, Clock::time_point now);
+
+    /// 丢弃设备未投递的变化(例如取消订阅时删除的设备)
+    void discard(const StrRef& name);
+
+    /// 丢弃全部未投递的变化
+    void clear();
+
+    bool empty() const { return pending_.empty(); }
+
+    /// 下一次需要投递的时间，没有未投递的变化时为 Clock::time_point::max()
+    Clock::time_point deadline() const;
+
+    /**
+     * @brief 取出全部合并后的事件
+     * @details 按设备第一次变化的顺序输出，没有实际变化的设备不产生事件
+     *
+     * @param out 追加输出的事件
+     */
+    void take(std::vector<Event>& out);
+
+    /**
+     * @brief 比较同一设备的两条记录
+     *
+     * @param before 旧记录
+     * @param after 新记录
+     * @param event 输出 changes 和 TXT 差异
+     * @return 是否有差异(接收接口不参与比较)
+     */
+    static bool diff(const DeviceDiscovery::DeviceRecord& before,
+        const DeviceDiscovery::DeviceRecord& after, Event& event);
+
+private:
+    struct Pending {
+        RecordPtr before;  ///< 窗口开始时的记录
+        RecordPtr after;   ///< 当前记录
+    };
+
+    static std::string keyOf(const StrRef& name);
+
+    Clock::duration window_ = Clock::duration::zero();
+    Clock::time_point started_;
+    std::vector<Pending> pending_;                     ///< 按第一次变化的顺序
+    std::unordered_map<std::string, size_t> index_;    ///< 小写实例名 -> pending_ 下标
+};
+
+} // namespace mdns
@@ -0,0 +1,254 @@
+/**
+ * @file device_index.h
+ * @brief 按实例名索引的有序设备表
+ * @details 设备按插入顺序保存在连续数组中，另外维护一个开放寻址哈希索引:
+ *  - 查找使用 StrRef 作为键，不需要构造 std::string，也不分配内存
+ *  - 名称比较和哈希都按 DNS 规则忽略 ASCII 大小写
+ *  - 遍历顺序与插入顺序一致，删除后其余设备保持原有相对顺序
+ *
+ * 索引槽位保存数组下标和哈希值的高 32 位，比较名称前先比较哈希值。
+ * 删除只把数组位置标记为空位并从索引中移除，不移动其余元素；values() 或空位多于设备时
+ * 一次性压缩数组并重建索引，大批设备同时离线时总开销与设备数成线性关系。
+ */
+
+#pragma once
+
+#include "fnv1a.h"
+#include "mdns_packet.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace mdns {
+
+/// 忽略 ASCII 大小写的 FNV-1a 64 位哈希
+inline uint64_t hashNameIgnoreCase(const StrRef& name)
+{
+    return fnv1aLower(name);
+}
+
+/**
+ * @brief 有序设备表
+ *
+ * @tparam Value 设备类型
+ * @tparam KeyOf 从设备取出实例名的函数对象，返回 StrRef
+ */
+template <typename Value, typename KeyOf>
+class DeviceIndex {
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    DeviceIndex() : slots_(kInitialSlots), removed_(0) {}
+
+    size_t size() const { return values_.size() - removed_; }
+    bool empty() const { return size() == 0; }
+
+    /// 按插入顺序排列的全部设备，有空位时先压缩
+    const std::vector<Value>& values()
+    {
+        compact();
+        return values_;
+    }
+
+    Value& at(size_t pos) { return values_[pos]; }
+    const Value& at(size_t pos) const { return values_[pos]; }
+
+    /**
+     * @brief 查找设备位置
+     * @return 设备在内部数组中的下标，供 at() 使用，不存在时返回 npos。
+     * 下标在下一次 insert()、erase() 或 values() 之前有效
+     */
+    size_t find(const StrRef& name) const
+    {
+        uint64_t hash = hashNameIgnoreCase(name);
+        size_t slot = findSlot(name, hash);
+        return slots_[slot].index ? slots_[slot].index - 1 : npos;
+    }
+
+    /// 查找设备，不存在时返回 nullptr
+    Value* get(const StrRef& name)
+    {
+        size_t pos = find(name);
+        return pos == npos ? nullptr : &values_[pos];
+    }
+
+    const Value* get(const StrRef& name) const
+    {
+        size_t pos = find(name);
+        return pos == npos ? nullptr : &values_[pos];
+    }
+
+    /**
+     * @brief 插入设备
+     * @return first 为设备下标，second 表示是否新插入；已存在时不修改原设备
+     */
+    std::pair<size_t, bool> insert(const Value& value)
+    {
+        StrRef name = keyOf_(value);
+        uint64_t hash = hashNameIgnoreCase(name);
+        size_t slot = findSlot(name, hash);
+        if (slots_[slot].index)
+        {
+            return std::make_pair(static_cast<size_t>(slots_[slot].index - 1), false);
+        }
+
+        if (removed_ > size())
+        {
+            compact();
+            slot = findSlot(name, hash);
+        }
+        values_.push_back(value);
+        live_.push_back(1);
+        slots_[slot].index = static_cast<uint32_t>(values_.size());
+        slots_[slot].tag = static_cast<uint32_t>(hash >> 32);
+        if (values_.size() * 2 > slots_.size())
+        {
+            rehash(slots_.size() * 2);
+        }
+        return std::make_pair(values_.size() - 1, true);
+    }
+
+    /**
+     * @brief 删除设备
+     * @details 设备所在位置变为空位并立即释放设备，其余设备的下标不变
+     */
+    bool erase(const StrRef& name)
+    {
+        uint64_t hash = hashNameIgnoreCase(name);
+        size_t slot = findSlot(name, hash);
+        if (!slots_[slot].index)
+        {
+            return false;
+        }
+        size_t pos = slots_[slot].index - 1;
+        eraseSlot(slot);
+        values_[pos] = Value();
+        live_[pos] = 0;
+        removed_++;
+        // 末尾的空位直接去掉
+        while (!live_.empty() && !live_.back())
+        {
+            values_.pop_back();
+            live_.pop_back();
+            removed_--;
+        }
+        return true;
+    }
+
+    void clear()
+    {
+        values_.clear();
+        live_.clear();
+        removed_ = 0;
+        slots_.assign(kInitialSlots, Slot());
+    }
+
+private:
+    static const size_t kInitialSlots = 16;
+
+    struct Slot {
+        Slot() : index(0), tag(0) {}
+        uint32_t index;  ///< values_ 下标加 1，0 表示空槽
+        uint32_t tag;    ///< 哈希值高 32 位
+    };
+
+    /// 线性探测，返回匹配的槽位或第一个空槽
+    size_t findSlot(const StrRef& name, uint64_t hash) const
+    {
+        size_t mask = slots_.size() - 1;
+        uint32_t tag = static_cast<uint32_t>(hash >> 32);
+        for (size_t slot = hash & mask;; slot = (slot + 1) & mask)
+        {
+            const Slot& s = slots_[slot];
+            if (!s.index)
+            {
+                return slot;
+            }
+            if (s.tag == tag && keyOf_(values_[s.index - 1]).equalsIgnoreCase(name))
+            {
+                return slot;
+            }
+        }
+    }
+
+    /// 删除槽位并回移后续元素，避免使用墓碑标记
+    void eraseSlot(size_t slot)
+    {
+        size_t mask = slots_.size() - 1;
+        size_t hole = slot;
+        for (size_t next = (hole + 1) & mask; slots_[next].index; next = (next + 1) & mask)
+        {
+            size_t home = hashNameIgnoreCase(keyOf_(values_[slots_[next].index - 1])) & mask;
+            // home 不在 (hole, next] 区间内时，元素可以移动到空洞处
+            bool movable = (next > hole) ? (home <= hole || home > next)
+                                         : (home <= hole && home > next);
+            if (movable)
+            {
+                slots_[hole] = slots_[next];
+                hole = next;
+            }
+        }
+        slots_[hole] = Slot();
+    }
+
+    /// 去掉空位，保持其余设备的相对顺序，并按新下标重建索引
+    void compact()
+    {
+        if (!removed_)
+        {
+            return;
+        }
+        size_t kept = 0;
+        for (size_t i = 0; i < values_.size(); i++)
+        {
+            if (live_[i])
+            {
+                if (kept != i)
+                {
+                    values_[kept] = std::move(values_[i]);
+                }
+                kept++;
+            }
+        }
+        values_.resize(kept);
+        live_.assign(kept, 1);
+        removed_ = 0;
+        rehash(slots_.size());
+    }
+
+    void rehash(size_t count)
+    {
+        std::vector<Slot> slots(count);
+        size_t mask = count - 1;
+        for (size_t i = 0; i < values_.size(); i++)
+        {
+            if (!live_[i])
+            {
+                continue;
+            }
+            uint64_t hash = hashNameIgnoreCase(keyOf_(values_[i]));
+            size_t slot = hash & mask;
+            while (slots[slot].index)
+            {
+                slot = (slot + 1) & mask;
+            }
+            slots[slot].index = static_cast<uint32_t>(i + 1);
+            slots[slot].tag = static_cast<uint32_t>(hash >> 32);
+        }
+        slots_.swap(slots);
+    }
+
+    std::vector<Value> values_;
+    std::vector<uint8_t> live_;  ///< 与 values_ 对应，0 表示已删除的空位
+    std::vector<Slot> slots_;
+    size_t removed_;             ///< 空位数
+    KeyOf keyOf_;
+};
+
+template <typename Value, typename KeyOf>
+const size_t DeviceIndex<Value, KeyOf>::npos;
+
+template <typename Value, typename KeyOf>
+const size_t DeviceIndex<Value, KeyOf>::kInitialSlots;
+
+} // namespace mdns
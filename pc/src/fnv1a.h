@@ -0,0 +1,42 @@
+/**
+ * @file fnv1a.h
+ * @brief FNV-1a 64 位哈希
+ * @details 设备表索引、名称分片、服务匹配、驻留字符串、来源限速和 TXT 哈希共用同一个实现。
+ * 可以分段计算: 把上一段的结果作为下一段的初值
+ */
+
+#pragma once
+
+#include "mdns_packet.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace mdns {
+
+const uint64_t kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64_t kFnvPrime = 1099511628211ULL;
+
+/// 按字节计算
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t hash = kFnvOffsetBasis)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+/// 按 ASCII 小写计算，用于大小写不敏感的 DNS 名称
+inline uint64_t fnv1aLower(const StrRef& text, uint64_t hash = kFnvOffsetBasis)
+{
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        hash ^= static_cast<uint8_t>(asciiLower(text[i]));
+        hash *= kFnvPrime;
+    }
+    return hash;
+}
+
+} // namespace mdns
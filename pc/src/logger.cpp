@@ -0,0 +1,381 @@
+/**
+ * @file logger.cpp
+ * @brief 日志系统实现
+ * @details 同步模式下每条日志在互斥锁内格式化并写出；
+ * 异步模式下写入线程本地的环形缓冲区，由后台线程批量写出。
+ */
+
+#include "logger.h"
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+enum { kMaxAsyncMessage = 256 };  ///< 异步模式下单条日志的最大长度，超出部分截断
+
+/**
+ * @brief 单生产者单消费者环形缓冲区
+ * @details 生产者为写日志的线程，消费者为后台写线程，只使用原子下标同步
+ */
+struct ProducerRing
+{
+    struct Entry
+    {
+        LogLevel level;
+        int line;
+        const char* file;
+        std::time_t time;
+        size_t length;
+        char text[kMaxAsyncMessage];
+    };
+
+    explicit ProducerRing(size_t capacity)
+        : entries(capacity), mask(capacity - 1), head(0), tail(0), closed(false) {}
+
+    bool push(LogLevel level, const char* file, int line, std::time_t time,
+              const std::string& message)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) > mask)
+        {
+            return false;
+        }
+        Entry& e = entries[t & mask];
+        e.level = level;
+        e.line = line;
+        e.file = file;
+        e.time = time;
+        e.length = message.size() < static_cast<size_t>(kMaxAsyncMessage)
+            ? message.size() : static_cast<size_t>(kMaxAsyncMessage);
+        std::memcpy(e.text, message.data(), e.length);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    std::vector<Entry> entries;
+    size_t mask;
+    std::atomic<size_t> head;   ///< 消费者读取位置
+    std::atomic<size_t> tail;   ///< 生产者写入位置
+    std::atomic<bool> closed;   ///< 所属线程已退出
+};
+
+/// 线程退出时标记缓冲区，剩余日志仍由后台线程写出
+struct RingHolder
+{
+    std::shared_ptr<ProducerRing> ring;
+    ~RingHolder()
+    {
+        if (ring)
+        {
+            ring->closed.store(true, std::memory_order_release);
+        }
+    }
+};
+
+const char* levelString(LogLevel level)
+{
+    switch (level)
+    {
+    case LogLevel::LOG_DEBUG:   return "DEBUG";
+    case LogLevel::LOG_INFO:    return "INFO";
+    case LogLevel::LOG_WARN:    return "WARN";
+    case LogLevel::LOG_ERROR:   return "ERROR";
+    }
+    return "UNKNOWN";
+}
+
+} // namespace
+
+class Logger::Impl
+{
+public:
+    ~Impl()
+    {
+        disableAsync();
+        if (logFile_.is_open())
+        {
+            logFile_.close();
+        }
+    }
+
+    bool init(const std::string& filename, bool console_output)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        logFile_.open(filename, std::ios::out | std::ios::app);
+        if (!logFile_.is_open())
+        {
+            std::cerr << "Failed to open log file: " << filename << std::endl;
+            return false;
+        }
+        consoleOutput_ = console_output;
+        return true;
+    }
+
+    bool enableAsync(size_t ringCapacity, std::chrono::milliseconds flushInterval)
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        if (async_.load(std::memory_order_acquire))
+        {
+            return true;
+        }
+        size_t capacity = 1;
+        while (capacity < ringCapacity)
+        {
+            capacity <<= 1;
+        }
+        ringCapacity_ = capacity;
+        flushInterval_ = flushInterval;
+        stopWriter_ = false;
+        writer_ = std::thread(&Impl::writerLoop, this);
+        async_.store(true, std::memory_order_release);
+        return true;
+    }
+
+    void disableAsync()
+    {
+        std::lock_guard<std::mutex> lock(asyncMutex_);
+        if (!async_.load(std::memory_order_acquire))
+        {
+            return;
+        }
+        async_.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> wakeLock(wakeMutex_);
+            stopWriter_ = true;
+        }
+        wakeCond_.notify_one();
+        writer_.join();
+    }
+
+    uint64_t droppedMessages() const
+    {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    void log(LogLevel level, const char* file, int line, const std::string& message)
+    {
+        if (async_.load(std::memory_order_acquire))
+        {
+            if (!localRing().push(level, file, line, std::time(nullptr), message))
+            {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        std::string logMessage;
+        formatLine(logMessage, level, file, line, std::time(nullptr),
+                   message.data(), message.size());
+
+        // 写入文件
+        if (logFile_.is_open())
+        {
+            logFile_ << logMessage;
+            logFile_.flush();
+        }
+
+        // 根据设置决定是否输出到控制台
+        if (consoleOutput_)
+        {
+            std::cout << logMessage;
+        }
+    }
+
+private:
+    ProducerRing& localRing()
+    {
+        static thread_local RingHolder holder;
+        if (!holder.ring)
+        {
+            holder.ring = std::make_shared<ProducerRing>(ringCapacity_);
+            std::lock_guard<std::mutex> lock(ringsMutex_);
+            rings_.push_back(holder.ring);
+        }
+        return *holder.ring;
+    }
+
+    /**
+     * @brief 格式化一行日志，时间戳每秒只格式化一次
+     * @details 调用方需持有 mutex_ 或处于后台写线程中
+     */
+    void formatLine(std::string& out, LogLevel level, const char* file, int line,
+                    std::time_t time, const char* text, size_t length)
+    {
+        if (time != cachedTime_)
+        {
+            std::tm tm;
+#ifdef _WIN32
+            localtime_s(&tm, &time);
+#else
+            localtime_r(&time, &tm);
+#endif
+            std::strftime(cachedTimestamp_, sizeof(cachedTimestamp_), "%Y-%m-%d %H:%M:%S", &tm);
+            cachedTime_ = time;
+        }
+        char lineStr[16];
+        std::snprintf(lineStr, sizeof(lineStr), "%d", line);
+
+        out += '[';
+        out += cachedTimestamp_;
+        out += "][";
+        out += levelString(level);
+        out += "][";
+        out += file;
+        out += ':';
+        out += lineStr;
+        out += "] ";
+        out.append(text, length);
+        out += '\n';
+    }
+
+    /// 后台写线程: 取出所有缓冲区中的日志，批量写出
+    void writerLoop()
+    {
+        std::string batch;
+        std::vector<std::shared_ptr<ProducerRing>> rings;
+        uint64_t reportedDropped = dropped_.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            bool stopping;
+            {
+                std::unique_lock<std::mutex> lock(wakeMutex_);
+                if (!stopWriter_)
+                {
+                    wakeCond_.wait_for(lock, flushInterval_);
+                }
+                stopping = stopWriter_;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(ringsMutex_);
+                rings = rings_;
+            }
+
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch.clear();
+            for (const auto& ring : rings)
+            {
+                size_t h = ring->head.load(std::memory_order_relaxed);
+                size_t t = ring->tail.load(std::memory_order_acquire);
+                for (; h != t; h++)
+                {
+                    const ProducerRing::Entry& e = ring->entries[h & ring->mask];
+                    formatLine(batch, e.level, e.file, e.line, e.time, e.text, e.length);
+                }
+                ring->head.store(h, std::memory_order_release);
+            }
+
+            uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+            if (dropped != reportedDropped)
+            {
+                std::string note = std::to_string(dropped - reportedDropped) +
+                    " log messages dropped (async buffer full)";
+                reportedDropped = dropped;
+                formatLine(batch, LogLevel::LOG_WARN, __FILE__, __LINE__, std::time(nullptr),
+                           note.data(), note.size());
+            }
+
+            if (!batch.empty())
+            {
+                if (logFile_.is_open())
+                {
+                    logFile_ << batch;
+                    logFile_.flush();
+                }
+                if (consoleOutput_)
+                {
+                    std::cout << batch << std::flush;
+                }
+            }
+
+            // 移除所属线程已退出且已取空的缓冲区
+            {
+                std::lock_guard<std::mutex> ringsLock(ringsMutex_);
+                for (size_t i = 0; i < rings_.size();)
+                {
+                    ProducerRing& ring = *rings_[i];
+                    if (ring.closed.load(std::memory_order_acquire) &&
+                        ring.head.load(std::memory_order_relaxed) ==
+                            ring.tail.load(std::memory_order_acquire))
+                    {
+                        rings_.erase(rings_.begin() + i);
+                    }
+                    else
+                    {
+                        i++;
+                    }
+                }
+            }
+
+            if (stopping)
+            {
+                break;
+            }
+        }
+    }
+
+    std::ofstream logFile_;
+    std::mutex mutex_;
+    bool consoleOutput_ = true;  // 控制是否输出到控制台
+
+    // 时间戳缓存，受 mutex_ 保护
+    std::time_t cachedTime_ = 0;
+    char cachedTimestamp_[32] = {0};
+
+    // 异步后端
+    std::atomic<bool> async_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::mutex asyncMutex_;
+    std::mutex ringsMutex_;
+    std::vector<std::shared_ptr<ProducerRing>> rings_;
+    size_t ringCapacity_ = 1024;
+    std::chrono::milliseconds flushInterval_{50};
+    std::mutex wakeMutex_;
+    std::condition_variable wakeCond_;
+    bool stopWriter_ = false;
+    std::thread writer_;
+};
+
+Logger& Logger::getInstance()
+{
+    static Logger instance;
+    return instance;
+}
+
+Logger::Logger() : impl_(new Impl()) {}
+
+Logger::~Logger() = default;
+
+bool Logger::init(const std::string& filename, bool console_output)
+{
+    return impl_->init(filename, console_output);
+}
+
+bool Logger::enableAsync(size_t ringCapacity, std::chrono::milliseconds flushInterval)
+{
+    return impl_->enableAsync(ringCapacity, flushInterval);
+}
+
+void Logger::disableAsync()
+{
+    impl_->disableAsync();
+}
+
+uint64_t Logger::droppedMessages() const
+{
+    return impl_->droppedMessages();
+}
+
+void Logger::log(LogLevel level, const char* file, int line, const std::string& message)
+{
+    impl_->log(level, file, line, message);
+}
@@ -17,7 +17,7 @@
  * 3. 设备发现过程
  *    - 接收线程监听 mDNS 响应
  *    - 解析收到的 DNS 消息
- *    - 提取设备信息(名称、IP、服务)
+ *    - 提取设备信息(名称、主机、端口、IP、服务)
  *    - 解析 TXT 记录获取设备属性
  * 
  * 4. 设备列表管理
@@ -35,6 +35,13 @@
  *    - 停止接收线程
  *    - 关闭网络连接
  *    - 释放系统资源
+ *
+ * 命令行参数:
+ *    --capture <文件>   把收到的报文写入 pcap 文件
+ *    --replay <文件>    不使用网络，回放 pcap/pcapng 文件中的报文
+ *    --original-timing  回放时按报文的原始时间间隔
+ *    --cache <文件>     记录缓存文件，启动时恢复上次发现的设备
+ *    --txt-keys <键,...> 只保留这些 TXT 键，例如 u,a,version
  */
 
 #include "device_discovery.h"
@@ -43,6 +50,9 @@
 #include <chrono>
 #include <thread>
 #include <iomanip>
+#include <cstring>
+#include <sstream>
+#include <vector>
 
 // 辅助函数：打印设备信息
 void printDeviceInfo(const DeviceDiscovery::DeviceInfo& device) {
@@ -52,6 +62,10 @@ void printDeviceInfo(const DeviceDiscovery::DeviceInfo& device) {
     
     std::cout << "Name: " << device.name << std::endl;
     std::cout << "IP:   " << device.ip << std::endl;
+    if (!device.ipv6.empty()) {
+        std::cout << "IPv6: " << device.ipv6 << std::endl;
+    }
+    std::cout << "Host: " << device.host << ":" << device.port << std::endl;
     
     if (!device.txtRecords.empty()) {
         std::cout << "TXT Records:" << std::endl;
@@ -73,13 +87,54 @@ void onDeviceFound(const DeviceDiscovery::DeviceInfo& device) {
     LOG_INFO("发现设备:");
     LOG_INFO("  名称: " << device.name);
     LOG_INFO("  IP: " << device.ip);
+    LOG_INFO("  主机: " << device.host << ":" << device.port);
     LOG_INFO("  TXT记录数: " << device.txtRecords.size());
+    if (!device.verified) {
+        LOG_INFO("  (从缓存文件恢复，尚未确认)");
+    }
     for (const auto& txt : device.txtRecords) {
         LOG_INFO("    " << txt.first << " = " << txt.second);
     }
 }
 
-int main() {
+/**
+ * @brief 设备离线回调函数
+ *
+ * 处理设备 goodbye 或记录 TTL 到期事件
+ */
+void onDeviceLost(const DeviceDiscovery::DeviceInfo& device) {
+    LOG_INFO("设备离线: " << device.name);
+}
+
+int main(int argc, char* argv[]) {
+    std::string captureFile;
+    std::string replayFile;
+    std::string cacheFile;
+    std::vector<std::string> txtKeys;
+    DeviceDiscovery::ReplayOptions replayOptions;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            captureFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cacheFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--txt-keys") == 0 && i + 1 < argc) {
+            std::stringstream keys(argv[++i]);
+            for (std::string key; std::getline(keys, key, ',');) {
+                if (!key.empty()) {
+                    txtKeys.push_back(key);
+                }
+            }
+        } else if (std::strcmp(argv[i], "--original-timing") == 0) {
+            replayOptions.timing = DeviceDiscovery::ReplayOptions::Timing::Original;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--capture file.pcap] [--replay file.pcap [--original-timing]] [--cache file] [--txt-keys u,a]" << std::endl;
+            return 1;
+        }
+    }
+
     try {
         // 生成日志文件名（使用当前时间）
         std::time_t now = std::time(nullptr);
@@ -92,22 +147,46 @@ int main() {
             std::cerr << "Failed to initialize logger" << std::endl;
             return 1;
         }
+        // 日志由后台线程批量写入文件，接收线程不等待磁盘 I/O
+        Logger::getInstance().enableAsync();
 
         LOG_INFO("mDNS Discovery application started");
         std::cout << "Starting mDNS discovery..." << std::endl;
         
         DeviceDiscovery discovery;
+        discovery.setDeviceLostCallback(onDeviceLost);
+        if (!cacheFile.empty()) {
+            discovery.setCacheFile(cacheFile);
+        }
+
+        if (!replayFile.empty()) {
+            auto source = DeviceDiscovery::openCaptureFile(replayFile);
+            if (!source) {
+                std::cerr << "Cannot read capture file: " << replayFile << std::endl;
+                return 1;
+            }
+            discovery.setPacketSource(source, replayOptions);
+        }
+        if (!captureFile.empty() && !discovery.startCapture(captureFile)) {
+            std::cerr << "Cannot create capture file: " << captureFile << std::endl;
+            return 1;
+        }
         
         // 启动设备发现
-        if (!discovery.startDiscovery("_leboremote._tcp.local", onDeviceFound)) {
+        if (!discovery.subscribe("_leboremote._tcp.local", onDeviceFound, txtKeys)) {
             LOG_ERROR("启动设备发现失败");
             return 1;
         }
 
-        // 等待10秒
-        LOG_INFO("等待10秒搜索设备...");
-        std::cout << "Searching for devices (10 seconds)..." << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(10));
+        if (!replayFile.empty()) {
+            std::cout << "Replaying " << replayFile << "..." << std::endl;
+            discovery.waitForReplay();
+        } else {
+            // 等待10秒
+            LOG_INFO("等待10秒搜索设备...");
+            std::cout << "Searching for devices (10 seconds)..." << std::endl;
+            std::this_thread::sleep_for(std::chrono::seconds(10));
+        }
 
         // 停止设备发现
         discovery.stopDiscovery();
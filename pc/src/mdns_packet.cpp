@@ -0,0 +1,465 @@
+/**
+ * @file mdns_packet.cpp
+ * @brief mDNS 报文零拷贝解析实现
+ *
+ * 名称校验规则:
+ * 1) 普通标签: 长度字节 0x01-0x3F，后跟标签内容，必须完整位于报文内
+ * 2) 压缩指针: 高两位为 11，14 位偏移必须小于当前名称片段的起始位置，
+ *    因此每次跳转都严格向报文开头移动，不可能形成环
+ * 3) 0x40/0x80 开头的扩展标签类型直接拒绝
+ * 4) 标签数不超过 kMaxLabels，总长度不超过 kMaxNameLength，
+ *    跳转次数不超过 kMaxPointerJumps
+ */
+
+#include "mdns_packet.h"
+
+namespace mdns {
+
+bool StrRef::equalsIgnoreCase(const StrRef& other) const
+{
+    if (size_ != other.size_)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < size_; i++)
+    {
+        if (asciiLower(data_[i]) != asciiLower(other.data_[i]))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* parseErrorString(ParseError error)
+{
+    switch (error)
+    {
+    case ParseError::None:          return "none";
+    case ParseError::Truncated:     return "truncated";
+    case ParseError::BadPointer:    return "bad compression pointer";
+    case ParseError::PointerLimit:  return "too many compression pointers";
+    case ParseError::LabelLimit:    return "too many labels";
+    case ParseError::NameTooLong:   return "name too long";
+    case ParseError::BadLabelType:  return "unsupported label type";
+    case ParseError::BadRdata:      return "malformed rdata";
+    }
+    return "unknown";
+}
+
+// ---------------------------------------------------------------------------
+// NameView
+// ---------------------------------------------------------------------------
+
+ParseError NameView::parse(const uint8_t* data, size_t size, size_t offset,
+    NameView& name, size_t* next)
+{
+    size_t pos = offset;
+    size_t segmentStart = offset;  // 当前名称片段的起始位置，指针只能指向它之前
+    size_t after = 0;
+    bool jumped = false;
+    size_t jumps = 0;
+    size_t labels = 0;
+    size_t length = 0;
+
+    for (;;)
+    {
+        if (pos >= size)
+        {
+            return ParseError::Truncated;
+        }
+
+        uint8_t len = data[pos];
+        if ((len & 0xC0) == 0xC0)
+        {
+            if (pos + 1 >= size)
+            {
+                return ParseError::Truncated;
+            }
+            size_t target = (static_cast<size_t>(len & 0x3F) << 8) | data[pos + 1];
+            if (target >= segmentStart)
+            {
+                return ParseError::BadPointer;
+            }
+            if (++jumps > kMaxPointerJumps)
+            {
+                return ParseError::PointerLimit;
+            }
+            if (!jumped)
+            {
+                after = pos + 2;
+                jumped = true;
+            }
+            pos = target;
+            segmentStart = target;
+            continue;
+        }
+        if (len & 0xC0)
+        {
+            return ParseError::BadLabelType;
+        }
+        if (len == 0)
+        {
+            if (!jumped)
+            {
+                after = pos + 1;
+            }
+            break;
+        }
+        if (len > size - pos - 1)
+        {
+            return ParseError::Truncated;
+        }
+        if (++labels > kMaxLabels)
+        {
+            return ParseError::LabelLimit;
+        }
+        length += len + 1u;
+        if (length > kMaxNameLength)
+        {
+            return ParseError::NameTooLong;
+        }
+        pos += 1u + len;
+    }
+
+    name.base_ = data;
+    name.size_ = size;
+    name.offset_ = offset;
+    name.labels_ = labels;
+    name.length_ = length;
+    if (next)
+    {
+        *next = after;
+    }
+    return ParseError::None;
+}
+
+bool NameView::LabelIterator::next(StrRef& label)
+{
+    if (remaining_ == 0)
+    {
+        return false;
+    }
+    // 名称在创建时已完成校验，这里只需跟随指针
+    while ((base_[pos_] & 0xC0) == 0xC0)
+    {
+        pos_ = (static_cast<size_t>(base_[pos_] & 0x3F) << 8) | base_[pos_ + 1];
+    }
+    uint8_t len = base_[pos_];
+    label = StrRef(reinterpret_cast<const char*>(base_ + pos_ + 1), len);
+    pos_ += 1u + len;
+    remaining_--;
+    return true;
+}
+
+std::string NameView::toString() const
+{
+    std::string out;
+    appendTo(out);
+    return out;
+}
+
+void NameView::appendTo(std::string& out) const
+{
+    out.reserve(out.size() + textLength());
+    LabelIterator it(*this);
+    StrRef label;
+    bool first = true;
+    while (it.next(label))
+    {
+        if (!first)
+        {
+            out += '.';
+        }
+        first = false;
+        out.append(label.data(), label.size());
+    }
+}
+
+void NameView::appendWire(std::string& out) const
+{
+    out.reserve(out.size() + length_ + 1);
+    LabelIterator it(*this);
+    StrRef label;
+    while (it.next(label))
+    {
+        out += static_cast<char>(label.size());
+        out.append(label.data(), label.size());
+    }
+    out += '\0';
+}
+
+size_t NameView::copyTo(char* buffer, size_t capacity) const
+{
+    size_t total = textLength();
+    if (total > capacity)
+    {
+        return 0;
+    }
+    LabelIterator it(*this);
+    StrRef label;
+    size_t pos = 0;
+    while (it.next(label))
+    {
+        if (pos)
+        {
+            buffer[pos++] = '.';
+        }
+        std::memcpy(buffer + pos, label.data(), label.size());
+        pos += label.size();
+    }
+    return pos;
+}
+
+bool NameView::equals(const NameView& other) const
+{
+    if (labels_ != other.labels_ || length_ != other.length_)
+    {
+        return false;
+    }
+    LabelIterator a(*this);
+    LabelIterator b(other);
+    StrRef la, lb;
+    while (a.next(la) && b.next(lb))
+    {
+        if (!la.equalsIgnoreCase(lb))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NameView::equals(const StrRef& dotted) const
+{
+    StrRef rest = dotted;
+    if (!rest.empty() && rest[rest.size() - 1] == '.')
+    {
+        rest = rest.substr(0, rest.size() - 1);
+    }
+    if (rest.size() != textLength())
+    {
+        return false;
+    }
+
+    LabelIterator it(*this);
+    StrRef label;
+    size_t pos = 0;
+    while (it.next(label))
+    {
+        if (pos)
+        {
+            if (rest[pos] != '.')
+            {
+                return false;
+            }
+            pos++;
+        }
+        if (!label.equalsIgnoreCase(rest.substr(pos, label.size())))
+        {
+            return false;
+        }
+        pos += label.size();
+    }
+    return pos == rest.size();
+}
+
+bool NameView::endsWith(const NameView& suffix) const
+{
+    if (suffix.labels_ > labels_)
+    {
+        return false;
+    }
+    NameView tail = dropLabels(labels_ - suffix.labels_);
+    return tail.equals(suffix);
+}
+
+NameView NameView::dropLabels(size_t count) const
+{
+    NameView out(*this);
+    if (count > labels_)
+    {
+        count = labels_;
+    }
+    size_t pos = offset_;
+    for (size_t i = 0; i < count; i++)
+    {
+        while ((base_[pos] & 0xC0) == 0xC0)
+        {
+            pos = (static_cast<size_t>(base_[pos] & 0x3F) << 8) | base_[pos + 1];
+        }
+        out.length_ -= base_[pos] + 1u;
+        pos += 1u + base_[pos];
+    }
+    out.offset_ = pos;
+    out.labels_ -= count;
+    return out;
+}
+
+StrRef NameView::firstLabel() const
+{
+    LabelIterator it(*this);
+    StrRef label;
+    it.next(label);
+    return label;
+}
+
+// ---------------------------------------------------------------------------
+// PacketReader
+// ---------------------------------------------------------------------------
+
+static inline uint16_t readU16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static inline uint32_t readU32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+        (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+bool PacketReader::readHeader(Header& header)
+{
+    if (size_ < kHeaderSize)
+    {
+        return fail(ParseError::Truncated);
+    }
+    header.id = readU16(data_);
+    header.flags = readU16(data_ + 2);
+    header.qdcount = readU16(data_ + 4);
+    header.ancount = readU16(data_ + 6);
+    header.nscount = readU16(data_ + 8);
+    header.arcount = readU16(data_ + 10);
+    pos_ = kHeaderSize;
+    return true;
+}
+
+bool PacketReader::readName(NameView& name)
+{
+    size_t next = 0;
+    ParseError err = NameView::parse(data_, size_, pos_, name, &next);
+    if (err != ParseError::None)
+    {
+        return fail(err);
+    }
+    pos_ = next;
+    return true;
+}
+
+bool PacketReader::readQuestion(Question& question)
+{
+    if (!readName(question.name))
+    {
+        return false;
+    }
+    if (size_ - pos_ < 4)
+    {
+        return fail(ParseError::Truncated);
+    }
+    question.type = readU16(data_ + pos_);
+    question.qclass = readU16(data_ + pos_ + 2);
+    pos_ += 4;
+    return true;
+}
+
+bool PacketReader::readRecord(Record& record)
+{
+    size_t start = pos_;
+    if (!readName(record.name))
+    {
+        return false;
+    }
+    if (size_ - pos_ < 10)
+    {
+        pos_ = start;
+        return fail(ParseError::Truncated);
+    }
+    const uint8_t* p = data_ + pos_;
+    record.type = readU16(p);
+    record.rclass = readU16(p + 2);
+    record.ttl = readU32(p + 4);
+    record.rdlength = readU16(p + 8);
+    if (size_ - pos_ - 10 < record.rdlength)
+    {
+        pos_ = start;
+        return fail(ParseError::Truncated);
+    }
+    record.rdataOffset = pos_ + 10;
+    record.rdata = data_ + record.rdataOffset;
+    pos_ = record.rdataOffset + record.rdlength;
+    return true;
+}
+
+bool PacketReader::readPtr(const Record& record, NameView& target)
+{
+    size_t next = 0;
+    ParseError err = NameView::parse(data_, size_, record.rdataOffset, target, &next);
+    if (err != ParseError::None)
+    {
+        return fail(err);
+    }
+    if (next > record.rdataOffset + record.rdlength)
+    {
+        return fail(ParseError::BadRdata);
+    }
+    return true;
+}
+
+bool PacketReader::readSrv(const Record& record, SrvData& srv)
+{
+    if (record.rdlength < 7)
+    {
+        return fail(ParseError::BadRdata);
+    }
+    srv.priority = readU16(record.rdata);
+    srv.weight = readU16(record.rdata + 2);
+    srv.port = readU16(record.rdata + 4);
+
+    size_t next = 0;
+    ParseError err = NameView::parse(data_, size_, record.rdataOffset + 6, srv.target, &next);
+    if (err != ParseError::None)
+    {
+        return fail(err);
+    }
+    if (next > record.rdataOffset + record.rdlength)
+    {
+        return fail(ParseError::BadRdata);
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// TxtReader
+// ---------------------------------------------------------------------------
+
+bool TxtReader::next(StrRef& key, StrRef& value, bool& hasValue)
+{
+    while (ptr_ < end_)
+    {
+        uint8_t len = *ptr_++;
+        if (static_cast<size_t>(end_ - ptr_) < len)
+        {
+            malformed_ = true;
+            ptr_ = end_;
+            return false;
+        }
+        if (len == 0)
+        {
+            // 空字符串(例如没有任何属性时的单个 0 字节)直接跳过
+            continue;
+        }
+
+        StrRef entry(reinterpret_cast<const char*>(ptr_), len);
+        ptr_ += len;
+
+        size_t sep = entry.find('=');
+        key = entry.substr(0, sep);
+        hasValue = sep < entry.size();
+        value = hasValue ? entry.substr(sep + 1, entry.size()) : StrRef();
+        return true;
+    }
+    return false;
+}
+
+} // namespace mdns
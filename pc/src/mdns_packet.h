@@ -0,0 +1,345 @@
+/**
+ * @file mdns_packet.h
+ * @brief mDNS 报文零拷贝解析
+ * @details 直接在接收缓冲区上解析 DNS 报文，解析过程不分配内存:
+ *  - StrRef: 非拥有的字节串视图
+ *  - NameView: 指向报文内部的域名视图，支持压缩指针
+ *  - PacketReader: 按顺序读取头部、问题和资源记录
+ *  - TxtReader: 逐条读取 TXT 记录中的键值对
+ *
+ * 安全限制:
+ *  - 所有读取都做边界检查，越界即失败
+ *  - 压缩指针必须严格向前跳转(指向当前名称片段之前)，从根本上杜绝指针环
+ *  - 限制指针跳转次数、标签数量和名称总长度
+ *
+ * 视图只在接收缓冲区有效期内可用，需要保存时调用 toString() 生成拥有所有权的字符串。
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace mdns {
+
+// DNS 记录类型
+const uint16_t kTypeA = 1;
+const uint16_t kTypePTR = 12;
+const uint16_t kTypeTXT = 16;
+const uint16_t kTypeAAAA = 28;
+const uint16_t kTypeSRV = 33;
+const uint16_t kTypeANY = 255;
+
+const uint16_t kClassIN = 1;
+const uint16_t kClassANY = 255;          ///< 问题中的任意类(QCLASS *)
+const uint16_t kClassMask = 0x7FFF;      ///< 去掉 cache-flush / unicast-response 位
+const uint16_t kCacheFlushBit = 0x8000;  ///< 资源记录中的 cache-flush 位
+const uint16_t kUnicastResponseBit = 0x8000; ///< 问题中的 QU 位
+
+const size_t kHeaderSize = 12;
+const size_t kMaxNameLength = 255;   ///< RFC 1035 规定的名称最大长度
+const size_t kMaxLabels = 128;       ///< 名称最多包含的标签数
+const size_t kMaxPointerJumps = 16;  ///< 单个名称最多跟随的压缩指针数
+
+/**
+ * @brief 非拥有的字节串视图
+ * @details 只保存指针和长度，可以与 std::string_view 互相转换
+ */
+class StrRef {
+public:
+    StrRef() : data_(nullptr), size_(0) {}
+    StrRef(const char* data, size_t size) : data_(data), size_(size) {}
+    StrRef(const char* str) : data_(str), size_(str ? std::strlen(str) : 0) {}
+    StrRef(const std::string& str) : data_(str.data()), size_(str.size()) {}
+    StrRef(std::string_view str) : data_(str.data()), size_(str.size()) {}
+
+    operator std::string_view() const { return std::string_view(data_, size_); }
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    char operator[](size_t i) const { return data_[i]; }
+
+    std::string str() const { return std::string(data_, size_); }
+
+    /// 查找字符，找不到返回 size()
+    size_t find(char c) const
+    {
+        const void* hit = size_ ? std::memchr(data_, c, size_) : nullptr;
+        return hit ? static_cast<const char*>(hit) - data_ : size_;
+    }
+
+    StrRef substr(size_t pos, size_t count) const
+    {
+        if (pos > size_) pos = size_;
+        if (count > size_ - pos) count = size_ - pos;
+        return StrRef(data_ + pos, count);
+    }
+
+    bool operator==(const StrRef& other) const
+    {
+        return size_ == other.size_ && (size_ == 0 || std::memcmp(data_, other.data_, size_) == 0);
+    }
+    bool operator!=(const StrRef& other) const { return !(*this == other); }
+
+    /// 按字节(无符号)比较，与 std::string::compare 的顺序相同
+    int compare(const StrRef& other) const
+    {
+        size_t common = size_ < other.size_ ? size_ : other.size_;
+        int result = common ? std::memcmp(data_, other.data_, common) : 0;
+        if (result != 0)
+        {
+            return result;
+        }
+        return size_ < other.size_ ? -1 : (size_ > other.size_ ? 1 : 0);
+    }
+
+    /// ASCII 大小写不敏感比较(DNS 名称比较规则)
+    bool equalsIgnoreCase(const StrRef& other) const;
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+/// ASCII 小写转换，DNS 名称只对 ASCII 字母做大小写折叠
+inline char asciiLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/**
+ * @brief 解析失败原因
+ */
+enum class ParseError {
+    None,           ///< 无错误
+    Truncated,      ///< 数据不足(头部、名称或记录数据越界)
+    BadPointer,     ///< 压缩指针未指向当前名称之前的位置
+    PointerLimit,   ///< 压缩指针跳转次数超限
+    LabelLimit,     ///< 标签数量超限
+    NameTooLong,    ///< 名称总长度超过 255 字节
+    BadLabelType,   ///< 不支持的标签类型(0x40/0x80)
+    BadRdata        ///< 记录数据格式与类型不符
+};
+
+/// ParseError 的取值个数
+const size_t kParseErrorCount = static_cast<size_t>(ParseError::BadRdata) + 1;
+
+/// 返回解析错误的可读描述
+const char* parseErrorString(ParseError error);
+
+/**
+ * @brief 报文内部的域名视图
+ * @details 只记录名称在报文中的起始偏移和校验结果，
+ * 通过 PacketReader 创建，创建时已完成所有边界和指针校验。
+ * 名称中的标签按原始大小写保存，比较时大小写不敏感。
+ */
+class NameView {
+public:
+    NameView() : base_(nullptr), size_(0), offset_(0), labels_(0), length_(0) {}
+
+    /**
+     * @brief 在一段 wire 格式名称上创建视图并校验
+     * @details 用于把本地编码好的名称(例如订阅的服务类型)与报文中的名称比较
+     *
+     * @param data 数据起始位置(压缩指针以此为基准)
+     * @param size 数据长度
+     * @param offset 名称起始偏移
+     * @param name 输出的名称视图
+     * @param next 名称之后第一个字节的偏移，可为空
+     * @return ParseError::None 表示成功
+     */
+    static ParseError parse(const uint8_t* data, size_t size, size_t offset,
+        NameView& name, size_t* next = nullptr);
+
+    /**
+     * @brief 标签迭代器，按从左到右的顺序返回标签
+     */
+    class LabelIterator {
+    public:
+        explicit LabelIterator(const NameView& name)
+            : base_(name.base_), pos_(name.offset_), remaining_(name.labels_) {}
+
+        /// 读取下一个标签，没有更多标签时返回 false
+        bool next(StrRef& label);
+
+    private:
+        const uint8_t* base_;
+        size_t pos_;
+        size_t remaining_;
+    };
+
+    bool valid() const { return base_ != nullptr; }
+    size_t labelCount() const { return labels_; }
+
+    /// 点分形式的文本长度(不含结尾的点)，根名称为 0
+    size_t textLength() const { return length_ ? length_ - 1 : 0; }
+
+    /// 生成点分形式的字符串，例如 "MyTV._leboremote._tcp.local"
+    std::string toString() const;
+
+    /// 追加点分形式的字符串
+    void appendTo(std::string& out) const;
+
+    /// 追加非压缩的 wire 格式(含结尾的 0 字节)
+    void appendWire(std::string& out) const;
+
+    /**
+     * @brief 把点分形式写入调用方提供的缓冲区，不分配内存
+     * @return 写入的字节数，缓冲区不足时返回 0
+     */
+    size_t copyTo(char* buffer, size_t capacity) const;
+
+    /// 与另一个名称逐标签比较(大小写不敏感)
+    bool equals(const NameView& other) const;
+
+    /// 与点分形式的名称比较(大小写不敏感)，不分配内存
+    bool equals(const StrRef& dotted) const;
+
+    /// 判断名称是否以 suffix 结尾(按标签对齐，大小写不敏感)
+    bool endsWith(const NameView& suffix) const;
+
+    /// 判断名称是否是 parent 的真子域，例如实例名是服务类型的子域
+    bool isSubdomainOf(const NameView& parent) const
+    {
+        return labels_ > parent.labels_ && endsWith(parent);
+    }
+
+    /// 返回去掉前 count 个标签之后的名称
+    NameView dropLabels(size_t count) const;
+
+    /// 返回第一个标签(例如服务实例名中的实例部分)
+    StrRef firstLabel() const;
+
+private:
+    const uint8_t* base_;
+    size_t size_;
+    size_t offset_;  ///< 第一个标签(或指向它的指针)的偏移
+    size_t labels_;
+    size_t length_;  ///< 所有标签长度加分隔符
+};
+
+/**
+ * @brief DNS 消息头部
+ */
+struct Header {
+    uint16_t id;
+    uint16_t flags;
+    uint16_t qdcount;
+    uint16_t ancount;
+    uint16_t nscount;
+    uint16_t arcount;
+
+    bool isResponse() const { return (flags & 0x8000) != 0; }
+    bool isTruncated() const { return (flags & 0x0200) != 0; }
+};
+
+/**
+ * @brief 问题记录视图
+ */
+struct Question {
+    NameView name;
+    uint16_t type;
+    uint16_t qclass;  ///< 原始类字段，包含 QU 位
+
+    bool unicastResponse() const { return (qclass & kUnicastResponseBit) != 0; }
+    uint16_t recordClass() const { return qclass & kClassMask; }
+};
+
+/**
+ * @brief 资源记录视图
+ */
+struct Record {
+    NameView name;
+    uint16_t type;
+    uint16_t rclass;     ///< 原始类字段，包含 cache-flush 位
+    uint32_t ttl;
+    uint16_t rdlength;
+    const uint8_t* rdata;
+    size_t rdataOffset;  ///< 记录数据在报文中的偏移，用于解析其中的压缩名称
+
+    bool cacheFlush() const { return (rclass & kCacheFlushBit) != 0; }
+    uint16_t recordClass() const { return rclass & kClassMask; }
+};
+
+/**
+ * @brief SRV 记录数据
+ */
+struct SrvData {
+    uint16_t priority;
+    uint16_t weight;
+    uint16_t port;
+    NameView target;
+};
+
+/**
+ * @brief DNS 报文读取器
+ * @details 顺序读取报文的各个部分，失败后 error() 返回原因，
+ * 读取位置不再前进，调用方应停止读取当前报文。
+ */
+class PacketReader {
+public:
+    PacketReader(const uint8_t* data, size_t size)
+        : data_(data), size_(size), pos_(0), error_(ParseError::None) {}
+
+    bool readHeader(Header& header);
+    bool readName(NameView& name);
+    bool readQuestion(Question& question);
+    bool readRecord(Record& record);
+
+    /// 解析 PTR 记录数据中的目标名称
+    bool readPtr(const Record& record, NameView& target);
+
+    /// 解析 SRV 记录数据
+    bool readSrv(const Record& record, SrvData& srv);
+
+    const uint8_t* data() const { return data_; }
+    size_t size() const { return size_; }
+    size_t offset() const { return pos_; }
+    ParseError error() const { return error_; }
+
+private:
+    bool fail(ParseError error)
+    {
+        error_ = error;
+        return false;
+    }
+
+    const uint8_t* data_;
+    size_t size_;
+    size_t pos_;
+    ParseError error_;
+};
+
+/**
+ * @brief TXT 记录读取器
+ * @details 按 <length><key>=<value> 格式逐条读取，键和值都是指向记录数据的视图
+ */
+class TxtReader {
+public:
+    TxtReader(const uint8_t* data, size_t size)
+        : ptr_(data), end_(data + size), malformed_(false) {}
+
+    /**
+     * @brief 读取下一条字符串
+     *
+     * @param key 键
+     * @param value 值，没有 '=' 时为空
+     * @param hasValue 是否包含 '='
+     * @return false 没有更多条目或数据越界
+     */
+    bool next(StrRef& key, StrRef& value, bool& hasValue);
+
+    /// 是否因长度越界提前结束
+    bool malformed() const { return malformed_; }
+
+private:
+    const uint8_t* ptr_;
+    const uint8_t* end_;
+    bool malformed_;
+};
+
+} // namespace mdns
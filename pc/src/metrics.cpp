@@ -0,0 +1,45 @@
+/**
+ * @file metrics.cpp
+ * @brief 运行统计的延迟直方图实现
+ */
+
+#include "metrics.h"
+
+namespace mdns {
+
+const size_t Histogram::kBuckets;
+
+size_t Histogram::bucketOf(uint64_t micros)
+{
+    size_t bucket = 0;
+    while (micros != 0 && bucket < kBuckets - 1)
+    {
+        micros >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+void Histogram::record(uint64_t micros)
+{
+    buckets_[bucketOf(micros)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_.fetch_add(micros, std::memory_order_relaxed);
+    uint64_t max = max_.load(std::memory_order_relaxed);
+    while (micros > max && !max_.compare_exchange_weak(max, micros, std::memory_order_relaxed))
+    {
+    }
+}
+
+void Histogram::snapshot(Snapshot& out) const
+{
+    for (size_t i = 0; i < kBuckets; i++)
+    {
+        out.buckets[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    out.count = count_.load(std::memory_order_relaxed);
+    out.totalUs = total_.load(std::memory_order_relaxed);
+    out.maxUs = max_.load(std::memory_order_relaxed);
+}
+
+} // namespace mdns
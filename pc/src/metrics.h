@@ -0,0 +1,58 @@
+/**
+ * @file metrics.h
+ * @brief 运行统计的计数器和延迟直方图
+ * @details 统计在接收路径上更新，不能加锁，也尽量避免原子读改写:
+ *  - Counter 只有一个写线程(例如接收线程)，增加操作是 relaxed 加载加存储，
+ *    与普通变量自增的开销相同；任意线程可以读取
+ *  - Histogram 可以在多个线程中记录(例如线程池中的回调)，使用 relaxed fetch_add
+ *
+ * 读取端得到的是各计数器分别读出的值，彼此之间不保证是同一时刻的快照。
+ */
+
+#pragma once
+
+#include "device_discovery.h"
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace mdns {
+
+class Counter {
+public:
+    /// 只在写线程中调用
+    void add(uint64_t n = 1)
+    {
+        value_.store(value_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    /// 只在写线程中调用，用于记录当前值(例如缓存大小)
+    void set(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+
+    uint64_t load() const { return value_.load(std::memory_order_relaxed); }
+
+private:
+    std::atomic<uint64_t> value_{ 0 };
+};
+
+class Histogram {
+public:
+    typedef DeviceDiscovery::LatencyHistogram Snapshot;
+    static const size_t kBuckets = Snapshot::kBuckets;
+
+    /// 记录一个样本(微秒)，可以在任意线程中调用
+    void record(uint64_t micros);
+
+    void snapshot(Snapshot& out) const;
+
+    /// 样本所在的桶: 0 为小于 1 微秒，i 为 [2^(i-1), 2^i) 微秒，超出范围的归入最后一个桶
+    static size_t bucketOf(uint64_t micros);
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+    std::atomic<uint64_t> count_{ 0 };
+    std::atomic<uint64_t> total_{ 0 };
+    std::atomic<uint64_t> max_{ 0 };
+};
+
+} // namespace mdns
@@ -0,0 +1,226 @@
+/**
+ * @file network_interfaces.cpp
+ * @brief 网络接口枚举与变化通知实现
+ */
+
+#include "network_interfaces.h"
+#include <algorithm>
+
+#ifdef _WIN32
+#include <iphlpapi.h>
+#pragma comment(lib, "iphlpapi.lib")
+#else
+#include <ifaddrs.h>
+#include <net/if.h>
+#endif
+
+#ifdef __linux__
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#endif
+
+namespace mdns {
+
+namespace {
+
+NetworkInterface& interfaceNamed(std::vector<NetworkInterface>& list, const std::string& name,
+    uint32_t index)
+{
+    for (auto& existing : list)
+    {
+        if (existing.name == name)
+        {
+            return existing;
+        }
+    }
+    list.push_back(NetworkInterface());
+    list.back().name = name;
+    list.back().index = index;
+    return list.back();
+}
+
+} // namespace
+
+#ifdef _WIN32
+
+bool listInterfaces(std::vector<NetworkInterface>& out)
+{
+    out.clear();
+    ULONG flags = GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER;
+    ULONG size = 15 * 1024;
+    std::vector<uint8_t> buffer;
+    ULONG result = ERROR_BUFFER_OVERFLOW;
+    for (int attempt = 0; attempt < 3 && result == ERROR_BUFFER_OVERFLOW; attempt++)
+    {
+        buffer.resize(size);
+        result = GetAdaptersAddresses(AF_UNSPEC, flags, nullptr,
+            reinterpret_cast<IP_ADAPTER_ADDRESSES*>(buffer.data()), &size);
+    }
+    if (result != NO_ERROR)
+    {
+        return false;
+    }
+
+    for (auto* adapter = reinterpret_cast<IP_ADAPTER_ADDRESSES*>(buffer.data()); adapter;
+        adapter = adapter->Next)
+    {
+        if (adapter->OperStatus != IfOperStatusUp || (adapter->Flags & IP_ADAPTER_NO_MULTICAST) ||
+            adapter->IfType == IF_TYPE_SOFTWARE_LOOPBACK)
+        {
+            continue;
+        }
+        char name[256] = { 0 };
+        WideCharToMultiByte(CP_UTF8, 0, adapter->FriendlyName, -1, name, sizeof(name) - 1,
+            nullptr, nullptr);
+        uint32_t index = adapter->IfIndex ? adapter->IfIndex : adapter->Ipv6IfIndex;
+        for (auto* unicast = adapter->FirstUnicastAddress; unicast; unicast = unicast->Next)
+        {
+            const sockaddr* address = unicast->Address.lpSockaddr;
+            if (address->sa_family == AF_INET)
+            {
+                interfaceNamed(out, name, index).ipv4.push_back(
+                    reinterpret_cast<const sockaddr_in*>(address)->sin_addr.s_addr);
+            }
+            else if (address->sa_family == AF_INET6)
+            {
+                interfaceNamed(out, name, index).ipv6 = true;
+            }
+        }
+    }
+    std::sort(out.begin(), out.end(),
+        [](const NetworkInterface& a, const NetworkInterface& b) { return a.index < b.index; });
+    return true;
+}
+
+#else
+
+bool listInterfaces(std::vector<NetworkInterface>& out)
+{
+    out.clear();
+    struct ifaddrs* list = nullptr;
+    if (getifaddrs(&list) != 0)
+    {
+        return false;
+    }
+    for (struct ifaddrs* entry = list; entry; entry = entry->ifa_next)
+    {
+        // IFF_RUNNING: 链路已连通(例如无线网络已关联)，与 Windows 的 IfOperStatusUp 对应
+        if (!entry->ifa_addr || !(entry->ifa_flags & IFF_UP) || !(entry->ifa_flags & IFF_RUNNING) ||
+            !(entry->ifa_flags & IFF_MULTICAST) || (entry->ifa_flags & IFF_LOOPBACK))
+        {
+            continue;
+        }
+        int family = entry->ifa_addr->sa_family;
+        if (family != AF_INET && family != AF_INET6)
+        {
+            continue;
+        }
+        uint32_t index = if_nametoindex(entry->ifa_name);
+        if (index == 0)
+        {
+            continue;
+        }
+        NetworkInterface& iface = interfaceNamed(out, entry->ifa_name, index);
+        if (family == AF_INET)
+        {
+            iface.ipv4.push_back(reinterpret_cast<const sockaddr_in*>(entry->ifa_addr)->sin_addr.s_addr);
+        }
+        else
+        {
+            iface.ipv6 = true;
+        }
+    }
+    freeifaddrs(list);
+    std::sort(out.begin(), out.end(),
+        [](const NetworkInterface& a, const NetworkInterface& b) { return a.index < b.index; });
+    return true;
+}
+
+#endif
+
+#ifdef __linux__
+
+InterfaceMonitor::InterfaceMonitor()
+{
+    handle_ = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK, NETLINK_ROUTE);
+    if (handle_ == INVALID_SOCKET)
+    {
+        return;
+    }
+    struct sockaddr_nl addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.nl_family = AF_NETLINK;
+    addr.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(handle_, (struct sockaddr*)&addr, sizeof(addr)) != 0)
+    {
+        close(handle_);
+        handle_ = INVALID_SOCKET;
+    }
+}
+
+InterfaceMonitor::~InterfaceMonitor()
+{
+    if (handle_ != INVALID_SOCKET)
+    {
+        close(handle_);
+    }
+}
+
+bool InterfaceMonitor::drain()
+{
+    bool changed = false;
+    alignas(struct nlmsghdr) char buffer[8192];
+    for (;;)
+    {
+        ssize_t bytes = recv(handle_, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (bytes < 0)
+        {
+            // ENOBUFS: 通知队列溢出，丢失的通知中可能有变化
+            changed |= errno == ENOBUFS;
+            if (errno == EINTR || errno == ENOBUFS)
+            {
+                continue;
+            }
+            return changed;
+        }
+        if (bytes == 0)
+        {
+            return changed;
+        }
+        int length = static_cast<int>(bytes);
+        for (struct nlmsghdr* message = reinterpret_cast<struct nlmsghdr*>(buffer);
+            NLMSG_OK(message, length); message = NLMSG_NEXT(message, length))
+        {
+            switch (message->nlmsg_type)
+            {
+            case RTM_NEWLINK:
+            case RTM_DELLINK:
+            case RTM_NEWADDR:
+            case RTM_DELADDR:
+                changed = true;
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+#else
+
+InterfaceMonitor::InterfaceMonitor()
+{
+}
+
+InterfaceMonitor::~InterfaceMonitor()
+{
+}
+
+bool InterfaceMonitor::drain()
+{
+    return false;
+}
+
+#endif
+
+} // namespace mdns
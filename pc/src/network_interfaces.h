@@ -0,0 +1,68 @@
+/**
+ * @file network_interfaces.h
+ * @brief 网络接口枚举与变化通知
+ * @details 多宿主主机(有线、无线、VPN)需要在每个接口上分别加入 mDNS 多播组并发送查询，
+ * 否则只有系统默认接口所在的网段可见:
+ *  - listInterfaces() 列出已启用、已连通、支持多播的非回环接口及其地址
+ *  - InterfaceMonitor 在 Linux 上通过 netlink 通知接口和地址的变化，
+ *    其他平台没有通知句柄，由调用方定期重新枚举
+ */
+
+#pragma once
+
+#include "socket_platform.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mdns {
+
+/**
+ * @brief 一个可用于 mDNS 的网络接口
+ */
+struct NetworkInterface {
+    uint32_t index = 0;           ///< 接口编号，IPv6 多播和链路本地地址的作用域
+    std::string name;             ///< 系统接口名，例如 "eth0"
+    std::vector<uint32_t> ipv4;   ///< IPv4 地址，网络字节序，按枚举顺序
+    bool ipv6 = false;            ///< 是否配置了 IPv6 地址
+
+    bool operator==(const NetworkInterface& other) const
+    {
+        return index == other.index && name == other.name && ipv4 == other.ipv4 &&
+            ipv6 == other.ipv6;
+    }
+    bool operator!=(const NetworkInterface& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief 列出已启用、已连通、支持多播的非回环接口
+ *
+ * @param out 输出的接口，按接口编号排序
+ * @return false 系统接口查询失败
+ */
+bool listInterfaces(std::vector<NetworkInterface>& out);
+
+/**
+ * @brief 接口变化通知
+ * @details Linux 上订阅 netlink 的链路和地址变化，handle() 可读时调用 drain() 清空通知后重新枚举接口。
+ * 其他平台 handle() 返回 INVALID_SOCKET。只在一个线程中使用。
+ */
+class InterfaceMonitor {
+public:
+    InterfaceMonitor();
+    ~InterfaceMonitor();
+
+    InterfaceMonitor(const InterfaceMonitor&) = delete;
+    InterfaceMonitor& operator=(const InterfaceMonitor&) = delete;
+
+    /// 可加入 Poller 等待的通知句柄，不支持时为 INVALID_SOCKET
+    SOCKET handle() const { return handle_; }
+
+    /// 读出所有排队的通知，返回是否有链路或地址变化
+    bool drain();
+
+private:
+    SOCKET handle_ = INVALID_SOCKET;
+};
+
+} // namespace mdns
@@ -0,0 +1,673 @@
+/**
+ * @file packet_capture.cpp
+ * @brief 抓包文件的读取和写入实现
+ */
+
+#include "packet_capture.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace mdns {
+
+namespace {
+
+const uint32_t kPcapMagicMicro = 0xA1B2C3D4;
+const uint32_t kPcapMagicNano = 0xA1B23C4D;
+const uint32_t kPcapngSectionHeader = 0x0A0D0D0A;
+const uint32_t kPcapngByteOrder = 0x1A2B3C4D;
+
+// pcapng 块类型
+const uint32_t kBlockInterface = 1;
+const uint32_t kBlockPacketObsolete = 2;
+const uint32_t kBlockSimplePacket = 3;
+const uint32_t kBlockEnhancedPacket = 6;
+
+// 链路类型
+const uint32_t kLinkNull = 0;
+const uint32_t kLinkEthernet = 1;
+const uint32_t kLinkRaw = 101;
+const uint32_t kLinkLoop = 108;
+const uint32_t kLinkLinuxSll = 113;
+const uint32_t kLinkIPv4 = 228;
+const uint32_t kLinkIPv6 = 229;
+const uint32_t kLinkLinuxSll2 = 276;
+
+const uint16_t kEtherIPv4 = 0x0800;
+const uint16_t kEtherIPv6 = 0x86DD;
+const uint16_t kEtherVlan = 0x8100;
+const uint16_t kEtherQinQ = 0x88A8;
+
+const uint8_t kProtoUdp = 17;
+const uint16_t kMdnsPort = 5353;
+
+/// 块或记录的长度上限，超过时视为文件损坏
+const uint32_t kMaxBlockSize = 16 * 1024 * 1024;
+
+uint16_t readBE16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t swap32(uint32_t v)
+{
+    return (v >> 24) | ((v >> 8) & 0xFF00) | ((v << 8) & 0xFF0000) | (v << 24);
+}
+
+uint32_t readNative32(const uint8_t* p)
+{
+    uint32_t v;
+    std::memcpy(&v, p, 4);
+    return v;
+}
+
+void appendBE16(std::vector<uint8_t>& out, uint16_t v)
+{
+    out.push_back(static_cast<uint8_t>(v >> 8));
+    out.push_back(static_cast<uint8_t>(v));
+}
+
+void appendNative32(std::vector<uint8_t>& out, uint32_t v)
+{
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(&v);
+    out.insert(out.end(), p, p + 4);
+}
+
+/// 16 位反码求和(IP/UDP 校验和)，返回未取反的累加值
+uint32_t checksumAdd(uint32_t sum, const uint8_t* data, size_t size)
+{
+    for (size_t i = 0; i + 1 < size; i += 2)
+    {
+        sum += readBE16(data + i);
+    }
+    if (size & 1)
+    {
+        sum += static_cast<uint32_t>(data[size - 1]) << 8;
+    }
+    return sum;
+}
+
+uint16_t checksumFinish(uint32_t sum)
+{
+    while (sum >> 16)
+    {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(~sum);
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// CaptureReader
+
+CaptureReader::~CaptureReader()
+{
+    if (file_)
+    {
+        std::fclose(file_);
+    }
+}
+
+bool CaptureReader::open(const std::string& path)
+{
+    if (file_)
+    {
+        std::fclose(file_);
+    }
+    error_.clear();
+    skipped_ = 0;
+    interfaces_.clear();
+    file_ = std::fopen(path.c_str(), "rb");
+    if (!file_)
+    {
+        error_ = "cannot open " + path + ": " + std::strerror(errno);
+        return false;
+    }
+
+    uint8_t head[24];
+    if (!readExact(head, 8))
+    {
+        error_ = "file too short for a capture header";
+        return false;
+    }
+    uint32_t magic = readNative32(head);
+    if (magic == kPcapngSectionHeader)
+    {
+        pcapng_ = true;
+        return readSectionHeader(head);
+    }
+
+    pcapng_ = false;
+    if (magic == kPcapMagicMicro || magic == kPcapMagicNano)
+    {
+        swapped_ = false;
+    }
+    else if (swap32(magic) == kPcapMagicMicro || swap32(magic) == kPcapMagicNano)
+    {
+        swapped_ = true;
+        magic = swap32(magic);
+    }
+    else
+    {
+        error_ = "not a pcap or pcapng file";
+        return false;
+    }
+    nanoseconds_ = magic == kPcapMagicNano;
+    if (!readExact(head + 8, 16))
+    {
+        error_ = "truncated pcap header";
+        return false;
+    }
+    // 高 16 位在新版格式中用于 FCS 标志
+    linkType_ = u32(head + 20) & 0xFFFF;
+    return true;
+}
+
+bool CaptureReader::next(CapturedPacket& packet)
+{
+    if (!file_ || !error_.empty())
+    {
+        return false;
+    }
+    return pcapng_ ? nextPcapng(packet) : nextPcap(packet);
+}
+
+bool CaptureReader::readExact(void* buffer, size_t size)
+{
+    return std::fread(buffer, 1, size, file_) == size;
+}
+
+uint16_t CaptureReader::u16(const uint8_t* p) const
+{
+    uint16_t v;
+    std::memcpy(&v, p, 2);
+    return swapped_ ? static_cast<uint16_t>((v >> 8) | (v << 8)) : v;
+}
+
+uint32_t CaptureReader::u32(const uint8_t* p) const
+{
+    uint32_t v = readNative32(p);
+    return swapped_ ? swap32(v) : v;
+}
+
+bool CaptureReader::nextPcap(CapturedPacket& packet)
+{
+    for (;;)
+    {
+        uint8_t record[16];
+        size_t got = std::fread(record, 1, sizeof(record), file_);
+        if (got == 0)
+        {
+            return false;
+        }
+        if (got != sizeof(record))
+        {
+            error_ = "truncated pcap record header";
+            return false;
+        }
+        uint32_t seconds = u32(record);
+        uint32_t fraction = u32(record + 4);
+        uint32_t captured = u32(record + 8);
+        if (captured > kMaxBlockSize)
+        {
+            error_ = "pcap record too large";
+            return false;
+        }
+        buffer_.resize(captured);
+        if (captured != 0 && !readExact(buffer_.data(), captured))
+        {
+            error_ = "truncated pcap record";
+            return false;
+        }
+        packet.timestampUs = static_cast<int64_t>(seconds) * 1000000 +
+            (nanoseconds_ ? fraction / 1000 : fraction);
+        if (decodeFrame(linkType_, buffer_.data(), captured, packet))
+        {
+            return true;
+        }
+        skipped_++;
+    }
+}
+
+bool CaptureReader::readSectionHeader(const uint8_t* head)
+{
+    // head 中已有块类型和(尚未确定字节序的)块长度
+    uint8_t order[4];
+    if (!readExact(order, sizeof(order)))
+    {
+        error_ = "truncated pcapng section header";
+        return false;
+    }
+    uint32_t magic = readNative32(order);
+    if (magic == kPcapngByteOrder)
+    {
+        swapped_ = false;
+    }
+    else if (swap32(magic) == kPcapngByteOrder)
+    {
+        swapped_ = true;
+    }
+    else
+    {
+        error_ = "bad pcapng byte-order magic";
+        return false;
+    }
+    uint32_t length = u32(head + 4);
+    if (length < 28 || length > kMaxBlockSize || (length & 3) != 0)
+    {
+        error_ = "bad pcapng section header length";
+        return false;
+    }
+    // 版本号、节长度和选项都不需要
+    buffer_.resize(length - 12);
+    if (!readExact(buffer_.data(), buffer_.size()))
+    {
+        error_ = "truncated pcapng section header";
+        return false;
+    }
+    interfaces_.clear();
+    return true;
+}
+
+void CaptureReader::readInterface(const uint8_t* body, size_t size)
+{
+    Interface iface;
+    iface.linkType = u16(body);
+    iface.unitsPerSecond = 1000000;
+    // 选项从第 8 字节开始: code(2) length(2) value(按 4 字节对齐)
+    size_t pos = 8;
+    while (pos + 4 <= size)
+    {
+        uint16_t code = u16(body + pos);
+        uint16_t length = u16(body + pos + 2);
+        pos += 4;
+        if (code == 0 || pos + length > size)
+        {
+            break;
+        }
+        if (code == 9 && length >= 1)
+        {
+            // if_tsresol: 最高位为 0 时是 10 的负幂，为 1 时是 2 的负幂
+            uint8_t resolution = body[pos];
+            uint64_t units = 1;
+            uint8_t exponent = resolution & 0x7F;
+            for (uint8_t i = 0; i < exponent && units < (uint64_t(1) << 60); i++)
+            {
+                units *= (resolution & 0x80) ? 2 : 10;
+            }
+            iface.unitsPerSecond = units;
+        }
+        pos += (length + 3) & ~size_t(3);
+    }
+    interfaces_.push_back(iface);
+}
+
+bool CaptureReader::nextPcapng(CapturedPacket& packet)
+{
+    for (;;)
+    {
+        uint8_t head[8];
+        size_t got = std::fread(head, 1, sizeof(head), file_);
+        if (got == 0)
+        {
+            return false;
+        }
+        if (got != sizeof(head))
+        {
+            error_ = "truncated pcapng block header";
+            return false;
+        }
+        if (readNative32(head) == kPcapngSectionHeader)
+        {
+            if (!readSectionHeader(head))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        uint32_t type = u32(head);
+        uint32_t length = u32(head + 4);
+        if (length < 12 || length > kMaxBlockSize || (length & 3) != 0)
+        {
+            error_ = "bad pcapng block length";
+            return false;
+        }
+        // 块体加结尾重复的块长度
+        buffer_.resize(length - 8);
+        if (!readExact(buffer_.data(), buffer_.size()))
+        {
+            error_ = "truncated pcapng block";
+            return false;
+        }
+        const uint8_t* body = buffer_.data();
+        size_t bodySize = buffer_.size() - 4;
+
+        uint32_t interfaceId = 0;
+        const uint8_t* frame = nullptr;
+        size_t captured = 0;
+        packet.timestampUs = -1;
+        uint64_t timestamp = 0;
+        bool hasTime = false;
+
+        if (type == kBlockInterface && bodySize >= 8)
+        {
+            readInterface(body, bodySize);
+            continue;
+        }
+        else if (type == kBlockEnhancedPacket && bodySize >= 20)
+        {
+            interfaceId = u32(body);
+            timestamp = (static_cast<uint64_t>(u32(body + 4)) << 32) | u32(body + 8);
+            hasTime = true;
+            captured = u32(body + 12);
+            frame = body + 20;
+            if (captured > bodySize - 20)
+            {
+                error_ = "pcapng packet exceeds block";
+                return false;
+            }
+        }
+        else if (type == kBlockPacketObsolete && bodySize >= 20)
+        {
+            interfaceId = u16(body);
+            timestamp = (static_cast<uint64_t>(u32(body + 4)) << 32) | u32(body + 8);
+            hasTime = true;
+            captured = u32(body + 12);
+            frame = body + 20;
+            if (captured > bodySize - 20)
+            {
+                error_ = "pcapng packet exceeds block";
+                return false;
+            }
+        }
+        else if (type == kBlockSimplePacket && bodySize >= 4)
+        {
+            // 简单报文块没有时间戳和捕获长度，数据按 4 字节对齐填充
+            captured = std::min<size_t>(u32(body), bodySize - 4);
+            frame = body + 4;
+        }
+        else
+        {
+            // 名称解析、统计等其他块
+            continue;
+        }
+
+        if (interfaceId >= interfaces_.size())
+        {
+            skipped_++;
+            continue;
+        }
+        const Interface& iface = interfaces_[interfaceId];
+        if (hasTime)
+        {
+            uint64_t seconds = timestamp / iface.unitsPerSecond;
+            uint64_t rest = timestamp % iface.unitsPerSecond;
+            packet.timestampUs = static_cast<int64_t>(seconds * 1000000) + static_cast<int64_t>(
+                static_cast<double>(rest) * 1e6 / static_cast<double>(iface.unitsPerSecond));
+        }
+        if (decodeFrame(iface.linkType, frame, captured, packet))
+        {
+            return true;
+        }
+        skipped_++;
+    }
+}
+
+bool CaptureReader::decodeFrame(uint32_t linkType, const uint8_t* frame, size_t size,
+    CapturedPacket& packet)
+{
+    // 链路层: 取出网络层数据，协议以 IP 版本号判断
+    size_t offset = 0;
+    switch (linkType)
+    {
+    case kLinkEthernet:
+    {
+        if (size < 14)
+        {
+            return false;
+        }
+        uint16_t etherType = readBE16(frame + 12);
+        offset = 14;
+        while ((etherType == kEtherVlan || etherType == kEtherQinQ) && size >= offset + 4)
+        {
+            etherType = readBE16(frame + offset + 2);
+            offset += 4;
+        }
+        if (etherType != kEtherIPv4 && etherType != kEtherIPv6)
+        {
+            return false;
+        }
+        break;
+    }
+    case kLinkNull:
+    case kLinkLoop:
+        offset = 4;
+        break;
+    case kLinkLinuxSll:
+        offset = 16;
+        break;
+    case kLinkLinuxSll2:
+        offset = 20;
+        break;
+    case kLinkRaw:
+    case kLinkIPv4:
+    case kLinkIPv6:
+        break;
+    default:
+        return false;
+    }
+    if (size <= offset)
+    {
+        return false;
+    }
+    const uint8_t* ip = frame + offset;
+    size -= offset;
+
+    // 网络层: 只接受未分片的 UDP
+    const uint8_t* udp = nullptr;
+    size_t udpSize = 0;
+    packet.sender = DeviceDiscovery::IpAddress();
+    uint8_t version = ip[0] >> 4;
+    if (version == 4)
+    {
+        size_t headerLength = static_cast<size_t>(ip[0] & 0x0F) * 4;
+        if (headerLength < 20 || size < headerLength || ip[9] != kProtoUdp)
+        {
+            return false;
+        }
+        uint16_t fragment = readBE16(ip + 6);
+        if ((fragment & 0x3FFF) != 0)
+        {
+            return false;
+        }
+        size_t total = readBE16(ip + 2);
+        if (total >= headerLength && total < size)
+        {
+            size = total;  // 去掉以太网填充
+        }
+        packet.sender.family = DeviceDiscovery::IpAddress::Family::IPv4;
+        std::memcpy(packet.sender.bytes.data(), ip + 12, 4);
+        udp = ip + headerLength;
+        udpSize = size - headerLength;
+    }
+    else if (version == 6)
+    {
+        if (size < 40)
+        {
+            return false;
+        }
+        uint8_t next = ip[6];
+        size_t pos = 40;
+        size_t end = std::min<size_t>(size, 40 + readBE16(ip + 4));
+        // 跳过逐跳、路由和目的选项扩展头，分片报文不处理
+        while (next == 0 || next == 43 || next == 60)
+        {
+            if (end < pos + 8)
+            {
+                return false;
+            }
+            next = ip[pos];
+            pos += (static_cast<size_t>(ip[pos + 1]) + 1) * 8;
+        }
+        if (next != kProtoUdp || end < pos)
+        {
+            return false;
+        }
+        packet.sender.family = DeviceDiscovery::IpAddress::Family::IPv6;
+        std::memcpy(packet.sender.bytes.data(), ip + 8, 16);
+        udp = ip + pos;
+        udpSize = end - pos;
+    }
+    else
+    {
+        return false;
+    }
+
+    // 传输层
+    if (udpSize < 8)
+    {
+        return false;
+    }
+    uint16_t sourcePort = readBE16(udp);
+    uint16_t destinationPort = readBE16(udp + 2);
+    if (sourcePort != kMdnsPort && destinationPort != kMdnsPort)
+    {
+        return false;
+    }
+    size_t length = readBE16(udp + 4);
+    if (length >= 8 && length < udpSize)
+    {
+        udpSize = length;
+    }
+    packet.senderPort = sourcePort;
+    packet.data = udp + 8;
+    packet.size = udpSize - 8;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// CaptureWriter
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::open(const std::string& path)
+{
+    close();
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_)
+    {
+        return false;
+    }
+    // 按本机字节序写入，读取端根据魔数判断
+    std::vector<uint8_t> header;
+    appendNative32(header, kPcapMagicMicro);
+    uint16_t version[2] = { 2, 4 };
+    const uint8_t* p = reinterpret_cast<const uint8_t*>(version);
+    header.insert(header.end(), p, p + sizeof(version));
+    appendNative32(header, 0);      // 时区
+    appendNative32(header, 0);      // 时间精度
+    appendNative32(header, 65535);  // snaplen
+    appendNative32(header, kLinkRaw);
+    if (std::fwrite(header.data(), 1, header.size(), file_) != header.size())
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool CaptureWriter::write(const uint8_t* data, size_t size, const DeviceDiscovery::IpAddress& sender,
+    uint16_t senderPort, int64_t timestampUs)
+{
+    if (!file_ || size > 65535 - 48)
+    {
+        return false;
+    }
+    bool ipv6 = sender.family == DeviceDiscovery::IpAddress::Family::IPv6;
+    size_t udpLength = size + 8;
+
+    frame_.clear();
+    uint32_t timestampSeconds = static_cast<uint32_t>(timestampUs / 1000000);
+    uint32_t timestampMicros = static_cast<uint32_t>(timestampUs % 1000000);
+    size_t frameLength = udpLength + (ipv6 ? 40 : 20);
+    appendNative32(frame_, timestampSeconds);
+    appendNative32(frame_, timestampMicros);
+    appendNative32(frame_, static_cast<uint32_t>(frameLength));
+    appendNative32(frame_, static_cast<uint32_t>(frameLength));
+    size_t ipStart = frame_.size();
+
+    // 目的地址记为多播组
+    static const uint8_t kGroup4[4] = { 224, 0, 0, 251 };
+    static const uint8_t kGroup6[16] = { 0xFF, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFB };
+    uint32_t pseudo = 0;
+    if (ipv6)
+    {
+        frame_.push_back(0x60);
+        frame_.push_back(0);
+        appendBE16(frame_, 0);
+        appendBE16(frame_, static_cast<uint16_t>(udpLength));
+        frame_.push_back(kProtoUdp);
+        frame_.push_back(255);
+        frame_.insert(frame_.end(), sender.bytes.begin(), sender.bytes.end());
+        frame_.insert(frame_.end(), kGroup6, kGroup6 + 16);
+        pseudo = checksumAdd(pseudo, frame_.data() + ipStart + 8, 32);
+    }
+    else
+    {
+        frame_.push_back(0x45);
+        frame_.push_back(0);
+        appendBE16(frame_, static_cast<uint16_t>(udpLength + 20));
+        appendBE16(frame_, 0);       // 标识
+        appendBE16(frame_, 0x4000);  // 不分片
+        frame_.push_back(255);
+        frame_.push_back(kProtoUdp);
+        appendBE16(frame_, 0);
+        frame_.insert(frame_.end(), sender.bytes.begin(), sender.bytes.begin() + 4);
+        frame_.insert(frame_.end(), kGroup4, kGroup4 + 4);
+        uint16_t sum = checksumFinish(checksumAdd(0, frame_.data() + ipStart, 20));
+        frame_[ipStart + 10] = static_cast<uint8_t>(sum >> 8);
+        frame_[ipStart + 11] = static_cast<uint8_t>(sum);
+        pseudo = checksumAdd(pseudo, frame_.data() + ipStart + 12, 8);
+    }
+    pseudo += kProtoUdp + static_cast<uint32_t>(udpLength);
+
+    size_t udpStart = frame_.size();
+    appendBE16(frame_, senderPort);
+    appendBE16(frame_, kMdnsPort);
+    appendBE16(frame_, static_cast<uint16_t>(udpLength));
+    appendBE16(frame_, 0);
+    frame_.insert(frame_.end(), data, data + size);
+    uint16_t sum = checksumFinish(checksumAdd(pseudo, frame_.data() + udpStart, udpLength));
+    if (sum == 0)
+    {
+        sum = 0xFFFF;  // 0 表示未计算校验和
+    }
+    frame_[udpStart + 6] = static_cast<uint8_t>(sum >> 8);
+    frame_[udpStart + 7] = static_cast<uint8_t>(sum);
+
+    return std::fwrite(frame_.data(), 1, frame_.size(), file_) == frame_.size();
+}
+
+void CaptureWriter::flush()
+{
+    if (file_)
+    {
+        std::fflush(file_);
+    }
+}
+
+void CaptureWriter::close()
+{
+    if (file_)
+    {
+        std::fclose(file_);
+        file_ = nullptr;
+    }
+}
+
+} // namespace mdns
@@ -0,0 +1,116 @@
+/**
+ * @file packet_capture.h
+ * @brief 抓包文件的读取和写入
+ * @details 读取 pcap 和 pcapng 文件中的 mDNS 报文，写入 pcap 文件:
+ *  - 读取时按文件头识别格式、字节序和时间精度(微秒/纳秒，pcapng 的 if_tsresol)
+ *  - 支持的链路类型: Ethernet(含 802.1Q/QinQ 标签)、BSD loopback、Raw IP、
+ *    Linux cooked(SLL/SLL2)，只取源或目的端口为 5353 的未分片 UDP 报文
+ *  - 写入使用 LINKTYPE_RAW，为每个报文补上 IPv4/IPv6 和 UDP 头部，
+ *    目的地址记为 mDNS 多播组，Wireshark 等工具可以直接打开
+ *
+ * 文件按块顺序读取，不一次装入内存。非线程安全。
+ */
+
+#pragma once
+
+#include "device_discovery.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace mdns {
+
+/// 抓包文件中的一个 mDNS 报文，data 在下一次 CaptureReader::next() 前有效
+struct CapturedPacket {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    DeviceDiscovery::IpAddress sender;
+    uint16_t senderPort = 0;
+    int64_t timestampUs = -1;  ///< Unix 时间(微秒)，SPB 等没有时间的块为 -1
+};
+
+class CaptureReader {
+public:
+    CaptureReader() {}
+    ~CaptureReader();
+
+    CaptureReader(const CaptureReader&) = delete;
+    CaptureReader& operator=(const CaptureReader&) = delete;
+
+    /// 打开 pcap 或 pcapng 文件，失败原因见 error()
+    bool open(const std::string& path);
+
+    /**
+     * @brief 读取下一个 mDNS 报文，跳过其他报文
+     * @return false 文件结束或格式错误，正常结束时 error() 为空
+     */
+    bool next(CapturedPacket& packet);
+
+    const std::string& error() const { return error_; }
+
+    /// 已跳过的非 mDNS 或无法解码的帧数
+    uint64_t skipped() const { return skipped_; }
+
+private:
+    /// pcapng 的接口描述
+    struct Interface {
+        uint32_t linkType;
+        uint64_t unitsPerSecond;  ///< 时间戳单位
+    };
+
+    bool readExact(void* buffer, size_t size);
+    uint16_t u16(const uint8_t* p) const;
+    uint32_t u32(const uint8_t* p) const;
+
+    bool nextPcap(CapturedPacket& packet);
+    bool nextPcapng(CapturedPacket& packet);
+    bool readSectionHeader(const uint8_t* head);
+    void readInterface(const uint8_t* body, size_t size);
+
+    /// 从链路层帧中取出 mDNS 报文
+    bool decodeFrame(uint32_t linkType, const uint8_t* frame, size_t size, CapturedPacket& packet);
+
+    FILE* file_ = nullptr;
+    bool pcapng_ = false;
+    bool swapped_ = false;          ///< 文件字节序与本机相反
+    bool nanoseconds_ = false;      ///< pcap 时间戳为纳秒
+    uint32_t linkType_ = 0;         ///< pcap 的链路类型
+    std::vector<Interface> interfaces_;
+    std::vector<uint8_t> buffer_;
+    std::string error_;
+    uint64_t skipped_ = 0;
+};
+
+class CaptureWriter {
+public:
+    CaptureWriter() {}
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    /// 创建 pcap 文件并写入文件头，已有文件被覆盖
+    bool open(const std::string& path);
+
+    /**
+     * @brief 写入一个收到的报文
+     *
+     * @param sender 发送方地址，IPv4 或 IPv6
+     * @param timestampUs Unix 时间(微秒)
+     */
+    bool write(const uint8_t* data, size_t size, const DeviceDiscovery::IpAddress& sender,
+        uint16_t senderPort, int64_t timestampUs);
+
+    /// 把缓冲的数据写入文件
+    void flush();
+
+    void close();
+    bool isOpen() const { return file_ != nullptr; }
+
+private:
+    FILE* file_ = nullptr;
+    std::vector<uint8_t> frame_;
+};
+
+} // namespace mdns
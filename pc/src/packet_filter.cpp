@@ -0,0 +1,172 @@
+/**
+ * @file packet_filter.cpp
+ * @brief 入站报文头部检查和按来源限速实现
+ */
+
+#include "packet_filter.h"
+#include "fnv1a.h"
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#endif
+
+namespace mdns {
+
+namespace {
+
+const uint16_t kMdnsPort = 5353;
+
+// 每个问题至少有根名称(1 字节)、类型和类；每条记录至少有根名称和 10 字节的固定部分
+const size_t kMinQuestionSize = 1 + 4;
+const size_t kMinRecordSize = 1 + 10;
+
+const std::chrono::seconds kPruneInterval(1);
+
+} // namespace
+
+HeaderCheck checkHeader(const Header& header, size_t size, uint16_t sourcePort)
+{
+    uint16_t opcode = (header.flags >> 11) & 0x0F;
+    if (opcode != 0)
+    {
+        return HeaderCheck::BadHeader;
+    }
+    if (header.isResponse())
+    {
+        if ((header.flags & 0x000F) != 0)
+        {
+            return HeaderCheck::BadHeader;
+        }
+        if (sourcePort != kMdnsPort)
+        {
+            return HeaderCheck::BadPort;
+        }
+    }
+
+    size_t records = static_cast<size_t>(header.ancount) + header.nscount + header.arcount;
+    size_t minimum = kHeaderSize + header.qdcount * kMinQuestionSize + records * kMinRecordSize;
+    if (minimum > size)
+    {
+        return HeaderCheck::BadHeader;
+    }
+    return HeaderCheck::Ok;
+}
+
+size_t SourceRateLimiter::KeyHash::operator()(const Key& key) const
+{
+    uint64_t hash = fnv1a(&key.family, 1);
+    return static_cast<size_t>(fnv1a(key.bytes.data(), key.bytes.size(), hash));
+}
+
+SourceRateLimiter::Key SourceRateLimiter::keyOf(const sockaddr_storage& source)
+{
+    Key key;
+    key.family = static_cast<uint8_t>(source.ss_family);
+    if (source.ss_family == AF_INET6)
+    {
+        const sockaddr_in6& in6 = reinterpret_cast<const sockaddr_in6&>(source);
+        std::memcpy(key.bytes.data(), &in6.sin6_addr, 16);
+    }
+    else
+    {
+        const sockaddr_in& in4 = reinterpret_cast<const sockaddr_in&>(source);
+        std::memcpy(key.bytes.data(), &in4.sin_addr, 4);
+    }
+    return key;
+}
+
+void SourceRateLimiter::configure(uint32_t ratePerSecond, uint32_t burst, size_t maxSources)
+{
+    clear();
+    if (ratePerSecond == 0)
+    {
+        interval_ = Clock::duration::zero();
+        tolerance_ = Clock::duration::zero();
+        maxSources_ = 0;
+        return;
+    }
+    interval_ = std::chrono::duration_cast<Clock::duration>(std::chrono::seconds(1)) / ratePerSecond;
+    interval_ = std::max(interval_, Clock::duration(1));
+    tolerance_ = interval_ * (std::max<uint32_t>(burst, 1) - 1);
+    maxSources_ = std::max<size_t>(maxSources, 1);
+    buckets_.reserve(maxSources_);
+}
+
+bool SourceRateLimiter::allow(const sockaddr_storage& source, Clock::time_point now,
+    bool& firstDrop)
+{
+    firstDrop = false;
+    if (interval_ == Clock::duration::zero())
+    {
+        return true;
+    }
+
+    Key key = keyOf(source);
+    Bucket* bucket = nullptr;
+    auto it = buckets_.find(key);
+    if (it != buckets_.end())
+    {
+        bucket = &it->second;
+    }
+    else
+    {
+        if (buckets_.size() >= maxSources_)
+        {
+            prune(now);
+        }
+        if (buckets_.size() < maxSources_)
+        {
+            Bucket fresh;
+            fresh.tat = now;
+            bucket = &buckets_.emplace(key, fresh).first->second;
+        }
+        else
+        {
+            bucket = &overflow_;
+        }
+    }
+
+    Clock::time_point tat = std::max(bucket->tat, now);
+    if (tat - now > tolerance_)
+    {
+        firstDrop = !bucket->dropping;
+        bucket->dropping = true;
+        return false;
+    }
+    bucket->tat = tat + interval_;
+    bucket->dropping = false;
+    return true;
+}
+
+void SourceRateLimiter::prune(Clock::time_point now)
+{
+    if (now - lastPrune_ < kPruneInterval)
+    {
+        return;
+    }
+    lastPrune_ = now;
+    for (auto it = buckets_.begin(); it != buckets_.end();)
+    {
+        if (it->second.tat <= now)
+        {
+            it = buckets_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void SourceRateLimiter::clear()
+{
+    buckets_.clear();
+    overflow_ = Bucket();
+    lastPrune_ = Clock::time_point();
+}
+
+} // namespace mdns
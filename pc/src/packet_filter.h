@@ -0,0 +1,107 @@
+/**
+ * @file packet_filter.h
+ * @brief 入站报文的头部检查和按来源限速
+ * @details 在解析任何名称或记录之前丢弃明显无效或过多的报文，
+ * 网络上异常的主机不能让接收线程长时间占满 CPU:
+ *  - checkHeader(): 只看 12 字节的头部和来源端口，拒绝非标准操作码、带错误码的应答、
+ *    来源端口不是 5353 的应答(RFC 6762 6, 18.3, 18.11)，以及记录数与报文长度明显不符的报文
+ *  - SourceRateLimiter: 每个来源地址一个令牌桶，以 GCRA(理论到达时间)形式实现，
+ *    每个来源只保存一个时间点。跟踪的来源数有上限，超过后新来源共用一个令牌桶，
+ *    伪造大量来源地址也不会使内存无限增长
+ *
+ * 只在接收线程中使用，不加锁。
+ */
+
+#pragma once
+
+#include "mdns_packet.h"
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
+namespace mdns {
+
+/**
+ * @brief 头部检查结果
+ */
+enum class HeaderCheck {
+    Ok,
+    BadHeader,  ///< 操作码或错误码不为 0，或记录数超过报文能容纳的数量
+    BadPort     ///< 来源端口不是 5353 的应答
+};
+
+/**
+ * @brief 检查报文头部
+ *
+ * @param header 已读出的头部
+ * @param size 报文长度
+ * @param sourcePort 来源 UDP 端口
+ */
+HeaderCheck checkHeader(const Header& header, size_t size, uint16_t sourcePort);
+
+class SourceRateLimiter {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @param ratePerSecond 每个来源每秒允许的平均报文数，0 表示不限速
+     * @param burst 允许连续到达的报文数
+     * @param maxSources 单独限速的来源数上限
+     */
+    void configure(uint32_t ratePerSecond, uint32_t burst, size_t maxSources);
+
+    /**
+     * @brief 来源的下一个报文是否可以处理
+     *
+     * @param source 来源地址，端口不参与区分
+     * @param now 当前时间
+     * @param firstDrop 输出，该来源此前的报文都被接受、本次开始丢弃时为 true，用于限制日志数量
+     */
+    bool allow(const sockaddr_storage& source, Clock::time_point now, bool& firstDrop);
+
+    /// 单独限速的来源数
+    size_t size() const { return buckets_.size(); }
+
+    void clear();
+
+private:
+    struct Key {
+        uint8_t family = 0;
+        std::array<uint8_t, 16> bytes{};
+
+        bool operator==(const Key& other) const
+        {
+            return family == other.family && bytes == other.bytes;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Bucket {
+        Clock::time_point tat;  ///< 理论到达时间，不晚于当前时间时令牌桶是满的
+        bool dropping = false;
+    };
+
+    static Key keyOf(const sockaddr_storage& source);
+
+    /// 删除令牌桶已满的来源(与新来源没有区别)，最多每秒一次
+    void prune(Clock::time_point now);
+
+    std::unordered_map<Key, Bucket, KeyHash> buckets_;
+    Bucket overflow_;          ///< 超过 maxSources 后的新来源共用
+    Clock::duration interval_{ Clock::duration::zero() };  ///< 相邻报文的平均间隔，0 表示不限速
+    Clock::duration tolerance_{ Clock::duration::zero() }; ///< 允许提前到达的时间，即 (burst - 1) 个间隔
+    size_t maxSources_ = 0;
+    Clock::time_point lastPrune_;
+};
+
+} // namespace mdns
@@ -0,0 +1,148 @@
+/**
+ * @file packet_router.cpp
+ * @brief 报文分片路由和缓冲池实现
+ */
+
+#include "packet_router.h"
+#include "fnv1a.h"
+
+namespace mdns {
+
+const size_t PacketRouter::kMaxShards;
+
+uint64_t nameHash(const NameView& name)
+{
+    // 与 toString() 的结果逐字节一致: 标签之间以 '.' 分隔
+    uint64_t hash = kFnvOffsetBasis;
+    NameView::LabelIterator labels(name);
+    StrRef label;
+    bool first = true;
+    while (labels.next(label))
+    {
+        if (!first)
+        {
+            hash = fnv1aLower(StrRef(".", 1), hash);
+        }
+        hash = fnv1aLower(label, hash);
+        first = false;
+    }
+    return hash;
+}
+
+uint64_t nameHash(const StrRef& dotted)
+{
+    return fnv1aLower(dotted);
+}
+
+void PacketRouter::configure(size_t shards)
+{
+    shards_ = shards == 0 ? 1 : shards > kMaxShards ? kMaxShards : shards;
+    hosts_.clear();
+}
+
+size_t PacketRouter::recordShard(PacketReader& reader, const Record& record, bool servicePtr) const
+{
+    // 数据格式错误的 PTR 记录按所有者名称分片，由解析线程解码时计数
+    NameView instance;
+    if (servicePtr && !reader.readPtr(record, instance))
+    {
+        instance = record.name;
+    }
+    return shardOf(nameHash(servicePtr ? instance : record.name));
+}
+
+uint32_t PacketRouter::route(PacketReader& reader, const std::vector<Record>& records,
+    const ServiceMatcher& matcher)
+{
+    uint32_t mask = 0;
+    bool addresses = false;
+
+    // 第一遍: 订阅服务的 PTR 记录和实例记录
+    for (const auto& record : records)
+    {
+        addresses |= record.type == kTypeA || record.type == kTypeAAAA;
+        ServiceMatcher::Match match;
+        if (!matcher.match(record.name, match))
+        {
+            continue;
+        }
+        bool servicePtr = match.exact && record.type == kTypePTR;
+        if (match.exact && !servicePtr)
+        {
+            continue;
+        }
+        size_t shard = recordShard(reader, record, servicePtr);
+        mask |= 1u << shard;
+
+        SrvData srv;
+        if (record.type == kTypeSRV && record.ttl != 0 && reader.readSrv(record, srv))
+        {
+            linkHost(nameHash(srv.target), shard);
+        }
+    }
+
+    // 第二遍: 已关联主机的地址记录
+    if (addresses && !hosts_.empty())
+    {
+        for (const auto& record : records)
+        {
+            if (record.type != kTypeA && record.type != kTypeAAAA)
+            {
+                continue;
+            }
+            auto host = hosts_.find(nameHash(record.name));
+            if (host != hosts_.end())
+            {
+                mask |= host->second;
+            }
+        }
+    }
+    return mask;
+}
+
+void PacketRouter::linkHost(uint64_t hostHash, size_t shard)
+{
+    hosts_[hostHash] |= 1u << shard;
+}
+
+void PacketRouter::unlinkHost(uint64_t hostHash, size_t shard)
+{
+    auto host = hosts_.find(hostHash);
+    if (host == hosts_.end())
+    {
+        return;
+    }
+    host->second &= ~(1u << shard);
+    if (host->second == 0)
+    {
+        hosts_.erase(host);
+    }
+}
+
+PacketPool::PacketPool(size_t count, size_t bufferSize)
+    : count_(count), bufferSize_(bufferSize), slab_(new uint8_t[count * bufferSize]),
+      packets_(new PooledPacket[count]), free_(count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        PooledPacket* packet = &packets_[i];
+        packet->data = &slab_[i * bufferSize];
+        free_.tryPush(std::move(packet));
+    }
+}
+
+PooledPacket* PacketPool::acquire()
+{
+    PooledPacket* packet = nullptr;
+    return free_.tryPop(packet) ? packet : nullptr;
+}
+
+void PacketPool::release(PooledPacket* packet)
+{
+    if (packet->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        free_.tryPush(std::move(packet));
+    }
+}
+
+} // namespace mdns
@@ -0,0 +1,154 @@
+/**
+ * @file packet_router.h
+ * @brief 流水线模式下的报文分片路由和缓冲池
+ * @details 接收线程只读出记录头部，按实例名的哈希决定报文交给哪些解析线程(分片):
+ *  - 服务类型的 PTR 记录按目标实例名，实例的 SRV/TXT 记录按所有者名称分片，
+ *    同一设备的记录始终由同一个分片按到达顺序处理
+ *  - A/AAAA 记录没有实例名，交给关联了该主机(某个实例的 SRV 目标)的所有分片。
+ *    主机与分片的关联由报文中的 SRV 记录建立，分片删除关联时通知接收线程
+ *  - 一个报文可能涉及多个分片，缓冲区按引用计数共享，最后一个分片处理完后放回缓冲池。
+ *    接收线程直接把报文收到缓冲池的缓冲区中，交给分片时不复制
+ *
+ * 名称哈希按点分形式的小写字节计算，报文中的名称视图和保存的字符串得到相同的值。
+ * PacketRouter 只在接收线程中使用；PacketPool 的取出在接收线程中，放回可以在任意线程中。
+ */
+
+#pragma once
+
+#include "mdns_packet.h"
+#include "service_matcher.h"
+#include "bounded_queue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <sys/socket.h>
+#endif
+
+namespace mdns {
+
+/// 名称的大小写不敏感哈希(按点分形式，不含结尾的点)
+uint64_t nameHash(const NameView& name);
+uint64_t nameHash(const StrRef& dotted);
+
+/// 名称哈希所属的分片
+inline size_t shardOf(uint64_t hash, size_t shards)
+{
+    return static_cast<size_t>(hash % shards);
+}
+
+/// 分片掩码中的分片数
+inline uint32_t popCount(uint32_t mask)
+{
+    uint32_t count = 0;
+    for (; mask != 0; mask &= mask - 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+class PacketRouter {
+public:
+    static const size_t kMaxShards = 32;  ///< 分片集合用 32 位掩码表示
+
+    PacketRouter() : shards_(1) {}
+
+    /// 设置分片数(1 到 kMaxShards)，同时清空主机关联
+    void configure(size_t shards);
+
+    size_t shardCount() const { return shards_; }
+
+    /// 名称哈希所属的分片
+    size_t shardOf(uint64_t hash) const { return mdns::shardOf(hash, shards_); }
+
+    /**
+     * @brief 订阅服务的记录所属的分片
+     * @details 服务类型的 PTR 记录按目标实例名，实例的记录按所有者名称。
+     * 解析线程用同一个函数筛选属于自己的记录
+     *
+     * @param servicePtr 记录是订阅服务类型本身的 PTR 记录
+     */
+    size_t recordShard(PacketReader& reader, const Record& record, bool servicePtr) const;
+
+    /**
+     * @brief 计算报文应交给哪些分片
+     * @details 同时根据报文中的 SRV 记录关联目标主机，使之后单独到达的地址记录找到分片
+     *
+     * @param reader 读出 records 的读取器，用于解析 PTR/SRV 数据中的名称
+     * @param records 报文中的全部记录
+     * @param matcher 订阅的服务类型
+     * @return 分片掩码，第 i 位表示分片 i，为 0 时报文与订阅无关
+     */
+    uint32_t route(PacketReader& reader, const std::vector<Record>& records,
+        const ServiceMatcher& matcher);
+
+    /// 分片中的实例以 host 为 SRV 目标
+    void linkHost(uint64_t hostHash, size_t shard);
+
+    /// 分片中已没有以 host 为 SRV 目标的实例
+    void unlinkHost(uint64_t hostHash, size_t shard);
+
+    /// 已关联的主机数
+    size_t hostCount() const { return hosts_.size(); }
+
+    void clear() { hosts_.clear(); }
+
+private:
+    size_t shards_;
+    std::unordered_map<uint64_t, uint32_t> hosts_;  ///< 主机名哈希 -> 分片掩码
+};
+
+/**
+ * @brief 缓冲池中的一个报文
+ */
+struct PooledPacket {
+    typedef std::chrono::steady_clock Clock;
+
+    uint8_t* data = nullptr;           ///< 缓冲池内存块中的 PacketPool::bufferSize() 字节
+    size_t size = 0;
+    sockaddr_storage sender;
+    uint32_t interfaceIndex = 0;
+    Clock::time_point received;        ///< 接收线程读出报文的时间
+    Clock::time_point querySent;       ///< 当时该协议族最近一次查询的时间
+    std::atomic<uint32_t> refs{ 0 };   ///< 尚未处理完的分片数
+};
+
+/**
+ * @brief 固定数量、固定大小的报文缓冲区
+ * @details 全部缓冲区在创建时一次分配为连续的内存块，空闲缓冲区放在无锁队列中，
+ * 运行期间不分配内存。取出的缓冲区引用计数为 0，由调用方在交给分片前设置
+ */
+class PacketPool {
+public:
+    PacketPool(size_t count, size_t bufferSize);
+
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    /// 取出一个空闲缓冲区，没有时返回 nullptr
+    PooledPacket* acquire();
+
+    /// 减少引用计数，最后一个引用时放回缓冲池
+    void release(PooledPacket* packet);
+
+    size_t size() const { return count_; }
+
+    /// 每个缓冲区的字节数
+    size_t bufferSize() const { return bufferSize_; }
+
+private:
+    size_t count_;
+    size_t bufferSize_;
+    std::unique_ptr<uint8_t[]> slab_;
+    std::unique_ptr<PooledPacket[]> packets_;
+    BoundedQueue<PooledPacket*> free_;
+};
+
+} // namespace mdns
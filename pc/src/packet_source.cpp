@@ -0,0 +1,120 @@
+/**
+ * @file packet_source.cpp
+ * @brief 抓包文件和内存报文来源的实现
+ */
+
+#include "packet_source.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+
+namespace mdns {
+
+bool CaptureFileSource::open(const std::string& path)
+{
+    return reader_.open(path);
+}
+
+int CaptureFileSource::next(Packet& packet, int)
+{
+    CapturedPacket captured;
+    if (!reader_.next(captured))
+    {
+        return -1;
+    }
+    packet.data = captured.data;
+    packet.size = captured.size;
+    packet.sender = captured.sender;
+    packet.senderPort = captured.senderPort;
+    packet.interfaceIndex = 0;
+    packet.timestampUs = captured.timestampUs;
+    return 1;
+}
+
+} // namespace mdns
+
+// ---------------------------------------------------------------------------
+// DeviceDiscovery::MemoryPacketSource
+
+class DeviceDiscovery::MemoryPacketSource::State {
+public:
+    struct Entry {
+        std::vector<uint8_t> data;
+        Packet packet;
+    };
+
+    mutable std::mutex mutex;
+    std::condition_variable ready;
+    std::deque<Entry> queue;
+    Entry current;          ///< 最近一次 next() 取出的报文，保证数据在下一次调用前有效
+    bool closed = false;
+    uint64_t interrupts = 0;
+};
+
+DeviceDiscovery::MemoryPacketSource::MemoryPacketSource() : state_(new State())
+{
+}
+
+DeviceDiscovery::MemoryPacketSource::~MemoryPacketSource()
+{
+}
+
+bool DeviceDiscovery::MemoryPacketSource::push(const Packet& packet)
+{
+    State::Entry entry;
+    entry.data.assign(packet.data, packet.data + packet.size);
+    entry.packet = packet;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->closed)
+        {
+            return false;
+        }
+        state_->queue.push_back(std::move(entry));
+    }
+    state_->ready.notify_one();
+    return true;
+}
+
+void DeviceDiscovery::MemoryPacketSource::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->closed = true;
+    }
+    state_->ready.notify_all();
+}
+
+size_t DeviceDiscovery::MemoryPacketSource::pending() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->queue.size();
+}
+
+int DeviceDiscovery::MemoryPacketSource::next(Packet& packet, int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    uint64_t interrupts = state_->interrupts;
+    state_->ready.wait_for(lock, std::chrono::milliseconds(timeoutMs > 0 ? timeoutMs : 0), [&]
+    {
+        return !state_->queue.empty() || state_->closed || state_->interrupts != interrupts;
+    });
+    if (state_->queue.empty())
+    {
+        return state_->closed ? -1 : 0;
+    }
+    state_->current = std::move(state_->queue.front());
+    state_->queue.pop_front();
+    packet = state_->current.packet;
+    packet.data = state_->current.data.data();
+    return 1;
+}
+
+void DeviceDiscovery::MemoryPacketSource::interrupt()
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        state_->interrupts++;
+    }
+    state_->ready.notify_all();
+}
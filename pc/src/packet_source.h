@@ -0,0 +1,31 @@
+/**
+ * @file packet_source.h
+ * @brief 抓包文件报文来源
+ * @details 把 CaptureReader 读出的报文包装为 DeviceDiscovery::PacketSource，
+ * 由 DeviceDiscovery::openCaptureFile() 创建。文件中的报文立即可读，next() 从不等待。
+ */
+
+#pragma once
+
+#include "device_discovery.h"
+#include "packet_capture.h"
+
+namespace mdns {
+
+class CaptureFileSource : public DeviceDiscovery::PacketSource {
+public:
+    /// 打开文件，失败原因见 error()
+    bool open(const std::string& path);
+
+    int next(Packet& packet, int timeoutMs) override;
+
+    std::string error() const override { return reader_.error(); }
+
+    /// 已跳过的非 mDNS 帧数
+    uint64_t skipped() const { return reader_.skipped(); }
+
+private:
+    CaptureReader reader_;
+};
+
+} // namespace mdns
@@ -0,0 +1,239 @@
+/**
+ * @file poller.cpp
+ * @brief 套接字可读事件等待实现
+ */
+
+#include "poller.h"
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+namespace mdns {
+
+#if defined(__linux__)
+
+Poller::Poller()
+{
+    epoll_ = epoll_create1(EPOLL_CLOEXEC);
+    event_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_ < 0 || event_ < 0)
+    {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = event_;
+    valid_ = epoll_ctl(epoll_, EPOLL_CTL_ADD, event_, &ev) == 0;
+}
+
+Poller::~Poller()
+{
+    if (event_ >= 0)
+    {
+        close(event_);
+    }
+    if (epoll_ >= 0)
+    {
+        close(epoll_);
+    }
+}
+
+bool Poller::add(SOCKET sock)
+{
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = sock;
+    if (epoll_ctl(epoll_, EPOLL_CTL_ADD, sock, &ev) != 0)
+    {
+        return false;
+    }
+    sockets_.push_back(sock);
+    return true;
+}
+
+void Poller::remove(SOCKET sock)
+{
+    auto it = std::find(sockets_.begin(), sockets_.end(), sock);
+    if (it != sockets_.end())
+    {
+        epoll_ctl(epoll_, EPOLL_CTL_DEL, sock, nullptr);
+        sockets_.erase(it);
+    }
+}
+
+int Poller::wait(int timeoutMs, std::vector<SOCKET>& ready)
+{
+    ready.clear();
+    struct epoll_event events[16];
+    int count = epoll_wait(epoll_, events, 16, timeoutMs);
+    if (count < 0)
+    {
+        return errno == EINTR ? 0 : -1;
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (events[i].data.fd == event_)
+        {
+            drainWakeup();
+        }
+        else
+        {
+            ready.push_back(events[i].data.fd);
+        }
+    }
+    return static_cast<int>(ready.size());
+}
+
+void Poller::wakeup()
+{
+    uint64_t one = 1;
+    ssize_t written = write(event_, &one, sizeof(one));
+    (void)written;  // 计数器溢出(EAGAIN)时已处于唤醒状态
+}
+
+void Poller::drainWakeup()
+{
+    uint64_t value;
+    ssize_t bytes = read(event_, &value, sizeof(value));
+    (void)bytes;
+}
+
+#else // poll / WSAPoll
+
+#ifdef _WIN32
+#define MDNS_POLL WSAPoll
+#else
+#define MDNS_POLL poll
+#endif
+
+Poller::Poller()
+{
+#ifdef _WIN32
+    wake_ = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (wake_ == INVALID_SOCKET)
+    {
+        return;
+    }
+    wakeAddr_.sin_family = AF_INET;
+    wakeAddr_.sin_port = 0;
+    wakeAddr_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    int length = sizeof(wakeAddr_);
+    if (bind(wake_, (struct sockaddr*)&wakeAddr_, sizeof(wakeAddr_)) != 0 ||
+        getsockname(wake_, (struct sockaddr*)&wakeAddr_, &length) != 0 || !setNonBlocking(wake_))
+    {
+        return;
+    }
+    WSAPOLLFD fd;
+    fd.fd = wake_;
+#else
+    if (pipe(pipe_) != 0 || !setNonBlocking(pipe_[0]) || !setNonBlocking(pipe_[1]))
+    {
+        return;
+    }
+    pollfd fd;
+    fd.fd = pipe_[0];
+#endif
+    fd.events = POLLIN;
+    fd.revents = 0;
+    fds_.push_back(fd);
+    valid_ = true;
+}
+
+Poller::~Poller()
+{
+#ifdef _WIN32
+    if (wake_ != INVALID_SOCKET)
+    {
+        closesocket(wake_);
+    }
+#else
+    for (int fd : pipe_)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool Poller::add(SOCKET sock)
+{
+    sockets_.push_back(sock);
+    fds_.push_back(fds_.front());
+    fds_.back().fd = sock;
+    return true;
+}
+
+void Poller::remove(SOCKET sock)
+{
+    for (size_t i = 1; i < fds_.size(); i++)
+    {
+        if (fds_[i].fd == sock)
+        {
+            fds_.erase(fds_.begin() + i);
+            break;
+        }
+    }
+    sockets_.erase(std::remove(sockets_.begin(), sockets_.end(), sock), sockets_.end());
+}
+
+int Poller::wait(int timeoutMs, std::vector<SOCKET>& ready)
+{
+    ready.clear();
+    int count = MDNS_POLL(fds_.data(), static_cast<unsigned long>(fds_.size()), timeoutMs);
+    if (count < 0)
+    {
+#ifdef _WIN32
+        return -1;
+#else
+        return errno == EINTR ? 0 : -1;
+#endif
+    }
+    if (fds_[0].revents != 0)
+    {
+        drainWakeup();
+    }
+    for (size_t i = 1; i < fds_.size(); i++)
+    {
+        if (fds_[i].revents != 0)
+        {
+            ready.push_back(fds_[i].fd);
+        }
+    }
+    return static_cast<int>(ready.size());
+}
+
+void Poller::wakeup()
+{
+    char byte = 1;
+#ifdef _WIN32
+    sendto(wake_, &byte, 1, 0, (struct sockaddr*)&wakeAddr_, sizeof(wakeAddr_));
+#else
+    ssize_t written = write(pipe_[1], &byte, 1);
+    (void)written;  // 管道已满时已处于唤醒状态
+#endif
+}
+
+void Poller::drainWakeup()
+{
+    char buffer[64];
+#ifdef _WIN32
+    while (recv(wake_, buffer, sizeof(buffer), 0) > 0)
+    {
+    }
+#else
+    while (read(pipe_[0], buffer, sizeof(buffer)) > 0)
+    {
+    }
+#endif
+}
+
+#undef MDNS_POLL
+
+#endif
+
+} // namespace mdns
@@ -0,0 +1,70 @@
+/**
+ * @file poller.h
+ * @brief 套接字可读事件等待
+ * @details 接收线程在一个 Poller 上等待一个或多个套接字可读、超时或被唤醒:
+ *  - Linux 使用 epoll，唤醒使用 eventfd
+ *  - Windows 使用 WSAPoll，唤醒使用回环 UDP 套接字(WSAPoll 不支持管道)
+ *  - 其他 POSIX 平台使用 poll，唤醒使用自管道
+ *
+ * wakeup() 可以在任意线程中调用，用于停止接收线程或让其立即处理新的请求，
+ * 不依赖关闭套接字来中断阻塞的系统调用。其余方法只在等待线程中(或等待线程启动前)调用。
+ */
+
+#pragma once
+
+#include "socket_platform.h"
+#include <vector>
+
+#if !defined(_WIN32) && !defined(__linux__)
+#include <poll.h>
+#endif
+
+namespace mdns {
+
+class Poller {
+public:
+    Poller();
+    ~Poller();
+
+    Poller(const Poller&) = delete;
+    Poller& operator=(const Poller&) = delete;
+
+    /// 唤醒机制是否创建成功
+    bool valid() const { return valid_; }
+
+    /// 添加要等待可读的套接字
+    bool add(SOCKET sock);
+
+    void remove(SOCKET sock);
+
+    /**
+     * @brief 等待套接字可读、超时或被唤醒
+     *
+     * @param timeoutMs 最长等待时间(毫秒)
+     * @param ready 输出可读(或有错误待读取)的套接字，先清空
+     * @return 可读的套接字数，超时或被唤醒时为 0，出错时为 -1
+     */
+    int wait(int timeoutMs, std::vector<SOCKET>& ready);
+
+    /// 使正在进行或下一次的 wait() 立即返回
+    void wakeup();
+
+private:
+    void drainWakeup();
+
+    bool valid_ = false;
+    std::vector<SOCKET> sockets_;
+#if defined(__linux__)
+    int epoll_ = -1;
+    int event_ = -1;
+#elif defined(_WIN32)
+    SOCKET wake_ = INVALID_SOCKET;  ///< 绑定到回环地址，向自己发送一个字节唤醒
+    struct sockaddr_in wakeAddr_;
+    std::vector<WSAPOLLFD> fds_;
+#else
+    int pipe_[2] = { -1, -1 };
+    std::vector<pollfd> fds_;
+#endif
+};
+
+} // namespace mdns
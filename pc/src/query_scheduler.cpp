@@ -0,0 +1,133 @@
+/**
+ * @file query_scheduler.cpp
+ * @brief mDNS 持续查询调度实现
+ */
+
+#include "query_scheduler.h"
+#include <algorithm>
+
+namespace mdns {
+
+QueryScheduler::QueryScheduler(Clock::duration initialInterval, Clock::duration maxInterval)
+    : initialInterval_(initialInterval), maxInterval_(maxInterval)
+{
+}
+
+void QueryScheduler::add(const std::string& name, uint16_t type, Clock::time_point now)
+{
+    for (auto& entry : continuous_)
+    {
+        if (sameQuestion(entry.question, name, type))
+        {
+            entry.due = now;
+            entry.interval = initialInterval_;
+            return;
+        }
+    }
+    Entry entry;
+    entry.question.name = name;
+    entry.question.type = type;
+    entry.due = now;
+    entry.interval = initialInterval_;
+    continuous_.push_back(entry);
+}
+
+void QueryScheduler::remove(const StrRef& name, uint16_t type)
+{
+    auto matches = [&](const Entry& entry) { return sameQuestion(entry.question, name, type); };
+    continuous_.erase(std::remove_if(continuous_.begin(), continuous_.end(), matches),
+        continuous_.end());
+    oneShot_.erase(std::remove_if(oneShot_.begin(), oneShot_.end(), matches), oneShot_.end());
+}
+
+void QueryScheduler::once(const std::string& name, uint16_t type, Clock::time_point when,
+    bool unicast)
+{
+    for (auto& entry : oneShot_)
+    {
+        if (sameQuestion(entry.question, name, type))
+        {
+            entry.due = std::min(entry.due, when);
+            entry.question.unicast = entry.question.unicast || unicast;
+            return;
+        }
+    }
+    Entry entry;
+    entry.question.name = name;
+    entry.question.type = type;
+    entry.question.unicast = unicast;
+    entry.due = when;
+    entry.interval = Clock::duration::zero();
+    oneShot_.push_back(entry);
+}
+
+QueryScheduler::Question* QueryScheduler::listed(std::vector<Question>& out, size_t first,
+    const Question& q)
+{
+    for (size_t i = first; i < out.size(); i++)
+    {
+        if (sameQuestion(out[i], q.name, q.type))
+        {
+            return &out[i];
+        }
+    }
+    return nullptr;
+}
+
+size_t QueryScheduler::collect(Clock::time_point now, std::vector<Question>& out)
+{
+    size_t first = out.size();
+    for (auto& entry : continuous_)
+    {
+        if (entry.due > now)
+        {
+            continue;
+        }
+        out.push_back(entry.question);
+        entry.due = now + entry.interval;
+        entry.interval = std::min(entry.interval * 2, maxInterval_);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < oneShot_.size(); i++)
+    {
+        if (oneShot_[i].due > now)
+        {
+            oneShot_[kept++] = oneShot_[i];
+            continue;
+        }
+        Question* same = listed(out, first, oneShot_[i].question);
+        if (!same)
+        {
+            out.push_back(oneShot_[i].question);
+        }
+        else if (oneShot_[i].question.unicast)
+        {
+            same->unicast = true;
+        }
+    }
+    oneShot_.resize(kept);
+    return out.size() - first;
+}
+
+QueryScheduler::Clock::time_point QueryScheduler::nextDue() const
+{
+    Clock::time_point next = Clock::time_point::max();
+    for (const auto& entry : continuous_)
+    {
+        next = std::min(next, entry.due);
+    }
+    for (const auto& entry : oneShot_)
+    {
+        next = std::min(next, entry.due);
+    }
+    return next;
+}
+
+void QueryScheduler::clear()
+{
+    continuous_.clear();
+    oneShot_.clear();
+}
+
+} // namespace mdns
@@ -0,0 +1,95 @@
+/**
+ * @file query_scheduler.h
+ * @brief mDNS 持续查询调度
+ * @details 按 RFC 6762 5.2 安排查询的发送时间:
+ *  - 持续查询的问题(例如订阅的服务类型)立即发送第一次，之后间隔 1 秒、2 秒、4 秒……加倍，
+ *    直到上限
+ *  - 记录刷新和补充查询是一次性的问题，在指定时间发送一次
+ *  - 同一时刻到期的问题合并到同一个查询报文中，相同的问题只发送一次
+ *  - 一次性问题可以请求单播应答(RFC 6762 5.4 的 QU 位)，与相同的问题合并时保留该请求
+ *
+ * 所有订阅共用一个调度器，只在接收线程中使用，非线程安全。
+ */
+
+#pragma once
+
+#include "mdns_packet.h"
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace mdns {
+
+class QueryScheduler {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// 一个待发送的问题
+    struct Question {
+        std::string name;  ///< 点分形式的名称
+        uint16_t type;
+        bool unicast = false;  ///< 请求单播应答(QU)
+    };
+
+    /**
+     * @param initialInterval 第一次和第二次查询之间的间隔
+     * @param maxInterval 持续查询间隔的上限
+     */
+    explicit QueryScheduler(Clock::duration initialInterval = std::chrono::seconds(1),
+        Clock::duration maxInterval = std::chrono::minutes(60));
+
+    /**
+     * @brief 添加持续查询的问题，在 now 立即到期
+     * @details 问题已存在时重新从初始间隔开始
+     */
+    void add(const std::string& name, uint16_t type, Clock::time_point now);
+
+    /// 删除持续查询的问题以及同名的一次性问题
+    void remove(const StrRef& name, uint16_t type);
+
+    /**
+     * @brief 安排一次性问题在 when 发送
+     * @details 同一问题已安排时保留较早的时间，任一次请求了单播应答时都按 QU 发送
+     */
+    void once(const std::string& name, uint16_t type, Clock::time_point when, bool unicast = false);
+
+    /**
+     * @brief 取出到 now 为止到期的所有问题
+     * @details 持续查询的问题按退避间隔安排下一次发送，一次性问题被删除。
+     * 与到期的持续查询相同的一次性问题合并为一个
+     *
+     * @param now 当前时间
+     * @param out 追加到期的问题
+     * @return 到期的问题数
+     */
+    size_t collect(Clock::time_point now, std::vector<Question>& out);
+
+    /// 最早的到期时间，没有问题时返回 time_point::max()
+    Clock::time_point nextDue() const;
+
+    size_t size() const { return continuous_.size() + oneShot_.size(); }
+
+    void clear();
+
+private:
+    struct Entry {
+        Question question;
+        Clock::time_point due;
+        Clock::duration interval;  ///< 持续查询下一次使用的间隔
+    };
+
+    static bool sameQuestion(const Question& q, const StrRef& name, uint16_t type)
+    {
+        return q.type == type && StrRef(q.name).equalsIgnoreCase(name);
+    }
+
+    /// 本次 collect() 的输出中相同的问题，没有时返回 nullptr
+    static Question* listed(std::vector<Question>& out, size_t first, const Question& q);
+
+    Clock::duration initialInterval_;
+    Clock::duration maxInterval_;
+    std::vector<Entry> continuous_;  ///< 持续查询的问题，数量为订阅数，线性查找即可
+    std::vector<Entry> oneShot_;
+};
+
+} // namespace mdns
@@ -0,0 +1,352 @@
+/**
+ * @file record_cache.cpp
+ * @brief 带 TTL 的 mDNS 记录缓存实现
+ *
+ * 存储结构:
+ * - entries_: 记录槽数组，下标同时作为时间轮中的定时器编号
+ * - free_: 空闲槽位列表，删除的槽位会被复用
+ * - sets_: 集合键到槽位列表的映射，集合成员通常只有一到几条
+ *
+ * 每条记录在时间轮中只有一个定时器，依次经过 4 个刷新阶段后到期，
+ * 刷新和到期共用同一个定时器，不额外占用内存。
+ */
+
+#include "record_cache.h"
+
+namespace mdns {
+
+namespace {
+
+const std::chrono::seconds kGoodbyeDelay(1);
+
+} // namespace
+
+RecordCache::RecordCache(Clock::time_point start)
+    : wheel_(4096, std::chrono::milliseconds(250), start),
+      random_(static_cast<uint32_t>(start.time_since_epoch().count()))
+{
+}
+
+bool RecordCache::decode(PacketReader& reader, const Record& record, CachedRecord& out)
+{
+    out.name.clear();
+    record.name.appendTo(out.name);
+    out.type = record.type;
+    out.rclass = record.recordClass();
+    out.ttl = record.ttl;
+    out.rdata.clear();
+    out.target.clear();
+    out.port = 0;
+
+    switch (record.type)
+    {
+    case kTypePTR:
+    {
+        NameView target;
+        if (!reader.readPtr(record, target))
+        {
+            return false;
+        }
+        target.appendWire(out.rdata);
+        target.appendTo(out.target);
+        return true;
+    }
+    case kTypeSRV:
+    {
+        SrvData srv;
+        if (!reader.readSrv(record, srv))
+        {
+            return false;
+        }
+        out.rdata.assign(reinterpret_cast<const char*>(record.rdata), 6);
+        srv.target.appendWire(out.rdata);
+        srv.target.appendTo(out.target);
+        out.port = srv.port;
+        return true;
+    }
+    case kTypeA:
+        if (record.rdlength != 4)
+        {
+            return false;
+        }
+        break;
+    case kTypeAAAA:
+        if (record.rdlength != 16)
+        {
+            return false;
+        }
+        break;
+    default:
+        break;
+    }
+    out.rdata.assign(reinterpret_cast<const char*>(record.rdata), record.rdlength);
+    return true;
+}
+
+const std::string& RecordCache::makeKey(const StrRef& name, uint16_t type, uint16_t rclass) const
+{
+    key_.clear();
+    for (size_t i = 0; i < name.size(); i++)
+    {
+        key_ += asciiLower(name[i]);
+    }
+    key_ += '\0';
+    key_ += static_cast<char>(type >> 8);
+    key_ += static_cast<char>(type & 0xFF);
+    key_ += static_cast<char>(rclass >> 8);
+    key_ += static_cast<char>(rclass & 0xFF);
+    return key_;
+}
+
+bool RecordCache::sameRdata(const CachedRecord& a, const CachedRecord& b)
+{
+    if (a.type == kTypePTR || a.type == kTypeSRV)
+    {
+        // 名称部分按 DNS 规则忽略大小写，SRV 的优先级/权重/端口按字节比较
+        size_t fixed = a.type == kTypeSRV ? 6 : 0;
+        if (a.rdata.size() != b.rdata.size() ||
+            a.rdata.compare(0, fixed, b.rdata, 0, fixed) != 0)
+        {
+            return false;
+        }
+        return StrRef(a.rdata).substr(fixed, a.rdata.size())
+            .equalsIgnoreCase(StrRef(b.rdata).substr(fixed, b.rdata.size()));
+    }
+    return a.rdata == b.rdata;
+}
+
+uint32_t RecordCache::allocate()
+{
+    if (!free_.empty())
+    {
+        uint32_t id = free_.back();
+        free_.pop_back();
+        entries_[id].used = true;
+        return id;
+    }
+    entries_.push_back(Entry());
+    entries_.back().used = true;
+    return static_cast<uint32_t>(entries_.size() - 1);
+}
+
+void RecordCache::release(uint32_t id)
+{
+    wheel_.cancel(id);
+    entries_[id].used = false;
+    entries_[id].record = CachedRecord();
+    free_.push_back(id);
+}
+
+void RecordCache::expireIn(uint32_t id, Clock::time_point now, Clock::duration delay)
+{
+    entries_[id].record.expires = now + delay;
+    scheduleStage(id, kStageExpire);
+}
+
+void RecordCache::scheduleStage(uint32_t id, uint8_t stage)
+{
+    Entry& entry = entries_[id];
+    entry.stage = stage;
+    if (stage >= kStageExpire)
+    {
+        wheel_.schedule(id, entry.record.expires);
+        return;
+    }
+
+    // 阶段 n 位于 TTL 的 (75 + 5n)%，第一个阶段额外加 0-2% 的随机偏移
+    Clock::duration ttl = entry.record.expires - entry.record.received;
+    Clock::duration offset = ttl * (75 + 5 * stage) / 100;
+    if (stage == 1)
+    {
+        offset += ttl * static_cast<Clock::rep>(random_() % 21) / 1000;
+    }
+    wheel_.schedule(id, entry.record.received + offset);
+}
+
+RecordCache::Update RecordCache::insert(const CachedRecord& record, bool cacheFlush,
+    Clock::time_point now)
+{
+    std::vector<uint32_t>& members = sets_[makeKey(record.name, record.type, record.rclass)];
+
+    uint32_t match = 0;
+    bool found = false;
+    for (size_t i = 0; i < members.size(); i++)
+    {
+        if (sameRdata(entries_[members[i]].record, record))
+        {
+            match = members[i];
+            found = true;
+            break;
+        }
+    }
+
+    if (record.ttl == 0)
+    {
+        if (!found)
+        {
+            if (members.empty())
+            {
+                sets_.erase(key_);
+            }
+            return Update::Ignored;
+        }
+        entries_[match].record.ttl = 0;
+        expireIn(match, now, kGoodbyeDelay);
+        return Update::Goodbye;
+    }
+
+    if (cacheFlush)
+    {
+        for (size_t i = 0; i < members.size(); i++)
+        {
+            CachedRecord& other = entries_[members[i]].record;
+            if ((!found || members[i] != match) && now - other.received > kGoodbyeDelay &&
+                other.expires > now + kGoodbyeDelay && other.interfaceIndex == record.interfaceIndex)
+            {
+                expireIn(members[i], now, kGoodbyeDelay);
+            }
+        }
+    }
+
+    Update result = Update::Refreshed;
+    if (!found)
+    {
+        match = allocate();
+        members.push_back(match);
+        result = Update::Added;
+    }
+
+    CachedRecord& stored = entries_[match].record;
+    stored = record;
+    stored.received = now;
+    stored.expires = now + std::chrono::seconds(record.ttl);
+    scheduleStage(match, 1);
+    return result;
+}
+
+void RecordCache::snapshot(std::vector<CachedRecord>& out) const
+{
+    for (const auto& entry : entries_)
+    {
+        if (entry.used)
+        {
+            out.push_back(entry.record);
+        }
+    }
+}
+
+size_t RecordCache::expireInterface(uint32_t interfaceIndex, Clock::time_point now)
+{
+    size_t count = 0;
+    for (uint32_t id = 0; id < entries_.size(); id++)
+    {
+        const CachedRecord& record = entries_[id].record;
+        if (entries_[id].used && record.interfaceIndex == interfaceIndex &&
+            record.expires > now + kGoodbyeDelay)
+        {
+            expireIn(id, now, kGoodbyeDelay);
+            count++;
+        }
+    }
+    return count;
+}
+
+const CachedRecord* RecordCache::find(const StrRef& name, uint16_t type, uint16_t rclass) const
+{
+    SetMap::const_iterator it = sets_.find(makeKey(name, type, rclass));
+    if (it == sets_.end() || it->second.empty())
+    {
+        return nullptr;
+    }
+    // cache-flush 替换的旧记录在 1 秒内仍在集合中，取最近收到的一条
+    const CachedRecord* latest = &entries_[it->second.front()].record;
+    for (size_t i = 1; i < it->second.size(); i++)
+    {
+        const CachedRecord* record = &entries_[it->second[i]].record;
+        if (record->received > latest->received)
+        {
+            latest = record;
+        }
+    }
+    return latest;
+}
+
+void RecordCache::findAll(const StrRef& name, uint16_t type,
+    std::vector<const CachedRecord*>& out, uint16_t rclass) const
+{
+    SetMap::const_iterator it = sets_.find(makeKey(name, type, rclass));
+    if (it == sets_.end())
+    {
+        return;
+    }
+    for (size_t i = 0; i < it->second.size(); i++)
+    {
+        out.push_back(&entries_[it->second[i]].record);
+    }
+}
+
+bool RecordCache::hasPtr(const StrRef& name, const StrRef& target) const
+{
+    SetMap::const_iterator it = sets_.find(makeKey(name, kTypePTR, kClassIN));
+    if (it == sets_.end())
+    {
+        return false;
+    }
+    for (size_t i = 0; i < it->second.size(); i++)
+    {
+        if (StrRef(entries_[it->second[i]].record.target).equalsIgnoreCase(target))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t RecordCache::advance(Clock::time_point now, std::vector<CachedRecord>& expired,
+    std::vector<CachedRecord>& refresh)
+{
+    return wheel_.advance(now, [&](uint32_t id) {
+        Entry& entry = entries_[id];
+        if (entry.stage < kStageExpire)
+        {
+            refresh.push_back(entry.record);
+            scheduleStage(id, static_cast<uint8_t>(entry.stage + 1));
+            return;
+        }
+
+        CachedRecord& record = entry.record;
+        SetMap::iterator it = sets_.find(makeKey(record.name, record.type, record.rclass));
+        if (it != sets_.end())
+        {
+            std::vector<uint32_t>& members = it->second;
+            for (size_t i = 0; i < members.size(); i++)
+            {
+                if (members[i] == id)
+                {
+                    members.erase(members.begin() + i);
+                    break;
+                }
+            }
+            if (members.empty())
+            {
+                sets_.erase(it);
+            }
+        }
+        expired.push_back(record);
+        release(id);
+    });
+}
+
+void RecordCache::clear()
+{
+    for (size_t i = 0; i < entries_.size(); i++)
+    {
+        if (entries_[i].used)
+        {
+            release(static_cast<uint32_t>(i));
+        }
+    }
+    sets_.clear();
+}
+
+} // namespace mdns
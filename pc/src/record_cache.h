@@ -0,0 +1,151 @@
+/**
+ * @file record_cache.h
+ * @brief 带 TTL 的 mDNS 记录缓存
+ * @details 按 (名称, 类型, 类) 组织资源记录集合:
+ *  - 同一集合中的成员以记录数据区分(例如同一服务类型下的多条 PTR)
+ *  - 每条记录在收到时根据 TTL 计算到期时间，由哈希时间轮调度到期
+ *  - TTL 为 0 的 goodbye 记录按 RFC 6762 10.1 在 1 秒后删除
+ *  - 带 cache-flush 位的记录按 RFC 6762 10.2 使同一集合中 1 秒前收到的其他成员在 1 秒后删除，
+ *    只作用于同一接口收到的成员(多宿主主机在不同链路上可能有不同的记录)
+ *  - 按 RFC 6762 5.2 在 TTL 的 80%、85%、90%、95% 报告需要刷新的记录(80% 加 0-2% 随机偏移)，
+ *    记录被刷新后重新从 80% 开始
+ *
+ * 缓存只在接收线程中使用，非线程安全。
+ */
+
+#pragma once
+
+#include "mdns_packet.h"
+#include "timer_wheel.h"
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mdns {
+
+/**
+ * @brief 缓存中的一条资源记录
+ */
+struct CachedRecord {
+    typedef TimerWheel::Clock Clock;
+
+    CachedRecord() : type(0), rclass(0), ttl(0), port(0), interfaceIndex(0), verified(true) {}
+
+    std::string name;     ///< 记录所有者名称，保留原始大小写
+    uint16_t type;
+    uint16_t rclass;      ///< 去掉 cache-flush 位后的类
+    uint32_t ttl;         ///< 收到时的 TTL(秒)
+    std::string rdata;    ///< 记录数据，PTR/SRV 中的名称已展开为非压缩格式
+    std::string target;   ///< PTR/SRV 的目标名称(点分形式)
+    uint16_t port;        ///< SRV 端口
+    uint32_t interfaceIndex; ///< 最近一次收到该记录的接口编号，0 表示未知
+    bool verified;        ///< false 表示从缓存文件恢复、尚未重新收到，不作为已知答案
+    Clock::time_point received;
+    Clock::time_point expires;
+};
+
+class RecordCache {
+public:
+    typedef TimerWheel::Clock Clock;
+
+    /// insert() 的结果
+    enum class Update {
+        Added,      ///< 新记录
+        Refreshed,  ///< 已有记录，更新了 TTL
+        Goodbye,    ///< TTL 为 0，记录将在 1 秒后删除
+        Ignored     ///< TTL 为 0 但缓存中没有该记录
+    };
+
+    explicit RecordCache(Clock::time_point start = Clock::now());
+
+    /**
+     * @brief 把报文中的记录转换为缓存记录
+     * @details 展开 PTR/SRV 中的压缩名称，其余类型直接复制记录数据
+     *
+     * @return false 记录数据格式错误
+     */
+    static bool decode(PacketReader& reader, const Record& record, CachedRecord& out);
+
+    /**
+     * @brief 插入或刷新记录
+     *
+     * @param record 记录，received/expires 由缓存根据 now 设置
+     * @param cacheFlush 是否带 cache-flush 位
+     * @param now 当前时间
+     */
+    Update insert(const CachedRecord& record, bool cacheFlush, Clock::time_point now);
+
+    /// 查找集合中最近收到的记录，不存在时返回 nullptr
+    const CachedRecord* find(const StrRef& name, uint16_t type, uint16_t rclass = kClassIN) const;
+
+    /// 取出集合中的所有记录
+    void findAll(const StrRef& name, uint16_t type, std::vector<const CachedRecord*>& out,
+        uint16_t rclass = kClassIN) const;
+
+    /// 判断是否存在指向 target 的 PTR 记录
+    bool hasPtr(const StrRef& name, const StrRef& target) const;
+
+    /**
+     * @brief 接口消失时使最近从该接口收到的记录在 1 秒后删除
+     * @details 调用方应立即重新查询，仍能从其他接口收到的记录会被刷新而保留
+     *
+     * @return 受影响的记录数
+     */
+    size_t expireInterface(uint32_t interfaceIndex, Clock::time_point now);
+
+    /**
+     * @brief 推进时间，删除所有到期记录
+     *
+     * @param now 当前时间
+     * @param expired 追加被删除的记录
+     * @param refresh 追加到达刷新时间点的记录，调用方应为其发送查询
+     * @return 删除和需要刷新的记录数
+     */
+    size_t advance(Clock::time_point now, std::vector<CachedRecord>& expired,
+        std::vector<CachedRecord>& refresh);
+
+    /// 下一次需要调用 advance() 的时间
+    Clock::time_point nextTick() const { return wheel_.nextTick(); }
+
+    size_t size() const { return wheel_.size(); }
+
+    /// 追加缓存中的全部记录(包括等待删除的 goodbye 记录)
+    void snapshot(std::vector<CachedRecord>& out) const;
+
+    void clear();
+
+private:
+    /// 刷新阶段: 1-4 对应 TTL 的 80%、85%、90%、95%，kStageExpire 表示下一次定时器即删除
+    enum { kStageExpire = 5 };
+
+    struct Entry {
+        Entry() : used(false), stage(kStageExpire) {}
+        CachedRecord record;
+        bool used;
+        uint8_t stage;
+    };
+
+    typedef std::unordered_map<std::string, std::vector<uint32_t>> SetMap;
+
+    /// 生成集合键: 小写名称 + '\0' + 类型 + 类，复用 key_ 的内存
+    const std::string& makeKey(const StrRef& name, uint16_t type, uint16_t rclass) const;
+
+    static bool sameRdata(const CachedRecord& a, const CachedRecord& b);
+
+    uint32_t allocate();
+    void release(uint32_t id);
+    void expireIn(uint32_t id, Clock::time_point now, Clock::duration delay);
+
+    /// 调度记录的下一个刷新阶段，stage 为 kStageExpire 时调度到期时间
+    void scheduleStage(uint32_t id, uint8_t stage);
+
+    std::vector<Entry> entries_;
+    std::vector<uint32_t> free_;
+    SetMap sets_;
+    TimerWheel wheel_;
+    std::minstd_rand random_;  ///< 刷新时间的随机偏移，避免多个查询方同时刷新
+    mutable std::string key_;
+};
+
+} // namespace mdns
@@ -0,0 +1,944 @@
+/**
+ * @file responder.cpp
+ * @brief mDNS 服务广播的响应方实现
+ */
+
+#include "responder.h"
+#include "fnv1a.h"
+#include <algorithm>
+
+namespace mdns {
+
+namespace {
+
+const uint32_t kHostTtl = 120;     ///< 包含主机名的记录(SRV、A)，RFC 6762 10
+const uint32_t kDefaultTtl = 4500; ///< 其余记录
+const int kProbeCount = 3;
+const int kAnnounceCount = 2;
+const char* const kServicesName = "_services._dns-sd._udp.local";
+
+void appendU16(std::vector<uint8_t>& out, uint16_t value)
+{
+    out.push_back(static_cast<uint8_t>(value >> 8));
+    out.push_back(static_cast<uint8_t>(value & 0xFF));
+}
+
+void appendU32(std::vector<uint8_t>& out, uint32_t value)
+{
+    appendU16(out, static_cast<uint16_t>(value >> 16));
+    appendU16(out, static_cast<uint16_t>(value & 0xFFFF));
+}
+
+void setU16(std::vector<uint8_t>& out, size_t offset, uint16_t value)
+{
+    out[offset] = static_cast<uint8_t>(value >> 8);
+    out[offset + 1] = static_cast<uint8_t>(value & 0xFF);
+}
+
+bool appendLabel(std::string& wire, const StrRef& label)
+{
+    if (label.empty() || label.size() > 63)
+    {
+        return false;
+    }
+    wire += static_cast<char>(label.size());
+    wire.append(label.data(), label.size());
+    return true;
+}
+
+/// 把点分名称追加为 wire 格式，包含结尾的 0
+bool appendDotted(std::string& wire, const StrRef& dotted)
+{
+    StrRef rest = dotted;
+    if (!rest.empty() && rest[rest.size() - 1] == '.')
+    {
+        rest = rest.substr(0, rest.size() - 1);
+    }
+    while (!rest.empty())
+    {
+        size_t dot = rest.find('.');
+        if (!appendLabel(wire, rest.substr(0, dot)))
+        {
+            return false;
+        }
+        rest = dot == rest.size() ? StrRef() : rest.substr(dot + 1, rest.size());
+    }
+    wire += '\0';
+    return wire.size() <= kMaxNameLength;
+}
+
+/**
+ * @brief 写入报文时的名称压缩表
+ * @details 记录已写出的每个名称后缀(wire 格式)及其偏移，后缀相同(大小写不敏感)时写压缩指针
+ */
+class NameWriter {
+public:
+    explicit NameWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void write(const StrRef& wire)
+    {
+        size_t pos = 0;
+        while (pos < wire.size() && wire[pos] != 0)
+        {
+            StrRef suffix = wire.substr(pos, wire.size());
+            for (const auto& entry : entries_)
+            {
+                if (entry.second.equalsIgnoreCase(suffix))
+                {
+                    out_.push_back(static_cast<uint8_t>(0xC0 | (entry.first >> 8)));
+                    out_.push_back(static_cast<uint8_t>(entry.first & 0xFF));
+                    return;
+                }
+            }
+            if (out_.size() < 0x3FFF)
+            {
+                entries_.push_back(std::make_pair(out_.size(), suffix));
+            }
+            size_t length = 1 + static_cast<uint8_t>(wire[pos]);
+            out_.insert(out_.end(), wire.data() + pos, wire.data() + pos + length);
+            pos += length;
+        }
+        out_.push_back(0);
+    }
+
+    /// 丢弃 size 之后写入的名称(报文被截断时)
+    void truncate(size_t size)
+    {
+        while (!entries_.empty() && entries_.back().first >= size)
+        {
+            entries_.pop_back();
+        }
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    std::vector<std::pair<size_t, StrRef>> entries_;
+};
+
+StrRef wireRef(const std::string& wire)
+{
+    return StrRef(wire.data(), wire.size());
+}
+
+bool sameRdata(const CachedRecord& a, const CachedRecord& b)
+{
+    // PTR/SRV 的记录数据中包含名称，名称比较不区分大小写
+    if (a.type == kTypePTR || a.type == kTypeSRV)
+    {
+        return StrRef(a.rdata).equalsIgnoreCase(b.rdata);
+    }
+    return a.rdata == b.rdata;
+}
+
+/// 对方记录的 TTL 是否不少于本机记录 TTL 的一半(RFC 6762 7.1、7.4)
+bool halfTtl(uint32_t ttl, const CachedRecord& own)
+{
+    return static_cast<uint64_t>(ttl) * 2 >= own.ttl;
+}
+
+/// RFC 6762 8.2 的记录排序: 类、类型、记录数据按无符号字节比较
+bool recordLess(const CachedRecord* a, const CachedRecord* b)
+{
+    if (a->rclass != b->rclass)
+    {
+        return a->rclass < b->rclass;
+    }
+    if (a->type != b->type)
+    {
+        return a->type < b->type;
+    }
+    return a->rdata < b->rdata;
+}
+
+/// 比较两组记录，返回负数表示 a 在字典序上较小(同时探测中失败)
+int compareRecords(std::vector<const CachedRecord*>& a, std::vector<const CachedRecord*>& b)
+{
+    std::sort(a.begin(), a.end(), recordLess);
+    std::sort(b.begin(), b.end(), recordLess);
+    for (size_t i = 0; i < a.size() && i < b.size(); i++)
+    {
+        if (recordLess(a[i], b[i]))
+        {
+            return -1;
+        }
+        if (recordLess(b[i], a[i]))
+        {
+            return 1;
+        }
+    }
+    return a.size() == b.size() ? 0 : (a.size() < b.size() ? -1 : 1);
+}
+
+} // namespace
+
+Responder::Responder(size_t maxPacketSize)
+    : maxPacketSize_(maxPacketSize),
+      random_(static_cast<uint32_t>(Clock::now().time_since_epoch().count()))
+{
+    lastMulticast_.fill(Clock::time_point());
+    sent_.fill(Sent{ 0, 0, Clock::time_point() });
+}
+
+uint32_t Responder::additionalsFor(uint32_t answers)
+{
+    // RFC 6763 12: PTR 附带 SRV/TXT/地址，SRV 附带地址
+    uint32_t additionals = 0;
+    if (answers & bit(kPtr))
+    {
+        additionals |= bit(kSrv) | bit(kTxt) | bit(kAddress);
+    }
+    if (answers & bit(kSrv))
+    {
+        additionals |= bit(kAddress);
+    }
+    return additionals & ~answers;
+}
+
+bool Responder::start(const Service& service, Clock::time_point now)
+{
+    service_ = service;
+    baseName_ = service.name;
+    size_t dot = service.host.find('.');
+    baseHost_ = service.host.substr(0, dot);
+    hostDomain_ = dot == std::string::npos ? std::string(".local") : service.host.substr(dot);
+    renames_ = 0;
+    if (!buildRecords())
+    {
+        state_ = State::Idle;
+        return false;
+    }
+    lastMulticast_.fill(Clock::time_point());
+    restartProbing(now, randomDelay(0, 250));
+    return true;
+}
+
+bool Responder::setTxt(const std::map<std::string, std::string>& txtRecords, Clock::time_point now)
+{
+    std::string rdata;
+    if (!buildTxt(txtRecords, rdata))
+    {
+        return false;
+    }
+    service_.txtRecords = txtRecords;
+    if (state_ == State::Idle)
+    {
+        return true;
+    }
+    records_[kTxt][0].rdata = rdata;
+    buildPackets();
+
+    // RFC 6762 8.4: 记录变化后重新宣告，cache-flush 位使对方替换旧的 TXT 记录
+    if (state_ != State::Probing)
+    {
+        state_ = State::Announcing;
+        announcements_ = 0;
+        nextAnnounce_ = now;
+    }
+    return true;
+}
+
+void Responder::stop(Clock::time_point now, std::vector<Packet>& out)
+{
+    if (state_ == State::Announcing || state_ == State::Established)
+    {
+        push(goodbyePacket_, true, 0, 0, now, out);
+    }
+    state_ = State::Idle;
+    pendingAnswers_ = 0;
+    unicast_.clear();
+}
+
+std::string Responder::instanceName() const
+{
+    return instanceName_.valid() ? instanceName_.toString() : std::string();
+}
+
+bool Responder::encodeTxt(const std::map<std::string, std::string>& txtRecords,
+    std::string& rdata)
+{
+    rdata.clear();
+    for (const auto& txt : txtRecords)
+    {
+        size_t length = txt.first.size() + 1 + txt.second.size();
+        if (txt.first.empty() || txt.first.find('=') != std::string::npos || length > 255)
+        {
+            return false;
+        }
+        rdata += static_cast<char>(length);
+        rdata += txt.first;
+        rdata += '=';
+        rdata += txt.second;
+    }
+    if (rdata.empty())
+    {
+        rdata += '\0';  // RFC 6763 6.1: 没有属性时为一个空字符串
+    }
+    return rdata.size() <= 0xFFFF;
+}
+
+bool Responder::buildRecords()
+{
+    serviceWire_.clear();
+    instanceWire_.clear();
+    hostWire_.clear();
+    enumWire_.clear();
+    if (!appendDotted(serviceWire_, service_.serviceType) ||
+        !appendLabel(instanceWire_, service_.name) ||
+        !appendDotted(hostWire_, service_.host) ||
+        !appendDotted(enumWire_, kServicesName))
+    {
+        return false;
+    }
+    instanceWire_ += serviceWire_;
+    if (instanceWire_.size() > kMaxNameLength || service_.serviceType.empty())
+    {
+        return false;
+    }
+    std::string txt;
+    if (!buildTxt(service_.txtRecords, txt))
+    {
+        return false;
+    }
+
+    NameView::parse(reinterpret_cast<const uint8_t*>(serviceWire_.data()), serviceWire_.size(), 0,
+        serviceName_);
+    NameView::parse(reinterpret_cast<const uint8_t*>(instanceWire_.data()), instanceWire_.size(),
+        0, instanceName_);
+    NameView::parse(reinterpret_cast<const uint8_t*>(hostWire_.data()), hostWire_.size(), 0,
+        hostName_);
+    NameView::parse(reinterpret_cast<const uint8_t*>(enumWire_.data()), enumWire_.size(), 0,
+        enumName_);
+
+    for (auto& records : records_)
+    {
+        records.clear();
+    }
+
+    CachedRecord record;
+    record.rclass = kClassIN;
+
+    record.name = serviceName_.toString();
+    record.type = kTypePTR;
+    record.ttl = kDefaultTtl;
+    record.rdata = instanceWire_;
+    record.target = instanceName_.toString();
+    records_[kPtr].push_back(record);
+
+    record.name = instanceName_.toString();
+    record.type = kTypeSRV;
+    record.ttl = kHostTtl;
+    record.rdata.assign(4, '\0');  // 优先级和权重
+    record.rdata += static_cast<char>(service_.port >> 8);
+    record.rdata += static_cast<char>(service_.port & 0xFF);
+    record.rdata += hostWire_;
+    record.target = hostName_.toString();
+    record.port = service_.port;
+    records_[kSrv].push_back(record);
+
+    record.type = kTypeTXT;
+    record.ttl = kDefaultTtl;
+    record.rdata = txt;
+    record.target.clear();
+    record.port = 0;
+    records_[kTxt].push_back(record);
+
+    record.name = hostName_.toString();
+    record.type = kTypeA;
+    record.ttl = kHostTtl;
+    for (uint32_t address : service_.addresses)
+    {
+        record.rdata.assign(reinterpret_cast<const char*>(&address), 4);
+        records_[kAddress].push_back(record);
+    }
+
+    record.name = enumName_.toString();
+    record.type = kTypePTR;
+    record.ttl = kDefaultTtl;
+    record.rdata = serviceWire_;
+    record.target = serviceName_.toString();
+    records_[kEnum].push_back(record);
+
+    buildPackets();
+    return true;
+}
+
+void Responder::buildPackets()
+{
+    packets_.clear();
+    uint32_t unique = bit(kSrv) | bit(kTxt) | bit(kAddress);
+    serialize(0, 0, unique, false, probePacket_);
+    serialize(bit(kKindCount) - 1, 0, 0, true, goodbyePacket_);
+}
+
+/**
+ * @brief 序列化报文
+ * @details authority 不为 0 时生成探测查询: 问题为实例名和主机名(ANY, QU)，
+ * 授权部分为拟使用的唯一记录。否则生成应答，唯一记录带 cache-flush 位。
+ * 附加记录放不下时省略。
+ */
+void Responder::serialize(uint32_t answers, uint32_t additionals, uint32_t authority,
+    bool goodbye, std::vector<uint8_t>& out) const
+{
+    bool probe = authority != 0;
+    out.clear();
+    appendU16(out, 0);                          // ID
+    appendU16(out, probe ? 0x0000 : 0x8400);    // 查询 / 权威应答
+    appendU16(out, probe ? 2 : 0);
+    appendU16(out, 0);
+    appendU16(out, 0);
+    appendU16(out, 0);
+
+    NameWriter names(out);
+    if (probe)
+    {
+        names.write(wireRef(instanceWire_));
+        appendU16(out, kTypeANY);
+        appendU16(out, kClassIN | kUnicastResponseBit);
+        names.write(wireRef(hostWire_));
+        appendU16(out, kTypeANY);
+        appendU16(out, kClassIN | kUnicastResponseBit);
+    }
+
+    const std::string* owners[kKindCount] = {
+        &serviceWire_, &instanceWire_, &instanceWire_, &hostWire_, &enumWire_
+    };
+    auto writeSection = [&](uint32_t kinds, size_t limit) -> uint16_t
+    {
+        uint16_t count = 0;
+        for (int kind = 0; kind < kKindCount; kind++)
+        {
+            if (!(kinds & bit(kind)))
+            {
+                continue;
+            }
+            size_t mark = out.size();
+            uint16_t written = 0;
+            for (const auto& record : records_[kind])
+            {
+                names.write(wireRef(*owners[kind]));
+                appendU16(out, record.type);
+                appendU16(out, static_cast<uint16_t>(record.rclass |
+                    (isUnique(kind) && !probe ? kCacheFlushBit : 0)));
+                appendU32(out, goodbye ? 0 : record.ttl);
+                size_t length = out.size();
+                appendU16(out, 0);
+                if (record.type == kTypePTR)
+                {
+                    names.write(wireRef(record.rdata));
+                }
+                else if (record.type == kTypeSRV)
+                {
+                    out.insert(out.end(), record.rdata.begin(), record.rdata.begin() + 6);
+                    names.write(StrRef(record.rdata).substr(6, record.rdata.size()));
+                }
+                else
+                {
+                    out.insert(out.end(), record.rdata.begin(), record.rdata.end());
+                }
+                setU16(out, length, static_cast<uint16_t>(out.size() - length - 2));
+                written++;
+            }
+            if (out.size() > limit)
+            {
+                // 这一种记录放不下，之后的也不再尝试
+                out.resize(mark);
+                names.truncate(mark);
+                break;
+            }
+            count += written;
+        }
+        return count;
+    };
+
+    size_t unlimited = static_cast<size_t>(-1);
+    setU16(out, 6, writeSection(answers, unlimited));
+    setU16(out, 8, writeSection(authority, unlimited));
+    setU16(out, 10, writeSection(additionals, maxPacketSize_));
+}
+
+const std::vector<uint8_t>& Responder::responsePacket(uint32_t answers)
+{
+    auto it = packets_.find(answers);
+    if (it != packets_.end())
+    {
+        return it->second;
+    }
+    std::vector<uint8_t>& packet = packets_[answers];
+    serialize(answers, additionalsFor(answers), 0, false, packet);
+    return packet;
+}
+
+void Responder::restartProbing(Clock::time_point now, Clock::duration delay)
+{
+    state_ = State::Probing;
+    probesSent_ = 0;
+    nextProbe_ = now + delay;
+    announcements_ = 0;
+    pendingAnswers_ = 0;
+    unicast_.clear();
+}
+
+void Responder::rename(bool instance)
+{
+    renames_++;
+    std::string suffix = std::to_string(renames_ + 1);
+    if (instance)
+    {
+        // RFC 6763 附录 D 的命名方式: "Name (2)"
+        std::string base = baseName_;
+        suffix = " (" + suffix + ")";
+        while (base.size() + suffix.size() > 63)
+        {
+            base.pop_back();
+            // 不截断 UTF-8 多字节字符
+            while (!base.empty() && (static_cast<uint8_t>(base.back()) & 0xC0) == 0x80)
+            {
+                base.pop_back();
+            }
+            if (!base.empty() && static_cast<uint8_t>(base.back()) >= 0xC0)
+            {
+                base.pop_back();
+            }
+        }
+        service_.name = base + suffix;
+    }
+    else
+    {
+        service_.host = baseHost_.substr(0, 62 - suffix.size()) + "-" + suffix + hostDomain_;
+    }
+    buildRecords();
+}
+
+void Responder::handlePacket(const uint8_t* data, size_t size, uint32_t address, uint16_t port,
+    Clock::time_point now)
+{
+    if (state_ == State::Idle || isOwnPacket(data, size, now))
+    {
+        return;
+    }
+    PacketReader reader(data, size);
+    Header header;
+    if (!reader.readHeader(header))
+    {
+        return;
+    }
+    if (header.isResponse())
+    {
+        handleResponse(reader, header, now);
+    }
+    else
+    {
+        handleQuery(reader, header, address, port, now);
+    }
+}
+
+bool Responder::ownsName(const NameView& name) const
+{
+    return name.equals(instanceName_) || name.equals(hostName_);
+}
+
+int Responder::matchRecord(const CachedRecord& record) const
+{
+    for (int kind = 0; kind < kKindCount; kind++)
+    {
+        for (const auto& own : records_[kind])
+        {
+            if (own.type == record.type && own.rclass == record.rclass &&
+                StrRef(own.name).equalsIgnoreCase(record.name) && sameRdata(own, record))
+            {
+                return kind;
+            }
+        }
+    }
+    return kKindCount;
+}
+
+/**
+ * @brief 处理查询
+ * @details 探测期间不应答，只处理同时探测的冲突。源端口不是 5353 的传统单播查询不应答
+ */
+void Responder::handleQuery(PacketReader& reader, const Header& header, uint32_t address,
+    uint16_t port, Clock::time_point now)
+{
+    uint32_t multicast = 0;
+    uint32_t unicast = 0;
+    bool probedInstance = false;
+    bool probedHost = false;
+    for (uint16_t i = 0; i < header.qdcount; i++)
+    {
+        Question question;
+        if (!reader.readQuestion(question))
+        {
+            return;
+        }
+        uint16_t qclass = question.recordClass();
+        if (qclass != kClassIN && qclass != kClassANY)
+        {
+            continue;
+        }
+        bool any = question.type == kTypeANY;
+        uint32_t kinds = 0;
+        if (question.name.equals(serviceName_))
+        {
+            kinds = (any || question.type == kTypePTR) ? bit(kPtr) : 0;
+        }
+        else if (question.name.equals(enumName_))
+        {
+            kinds = (any || question.type == kTypePTR) ? bit(kEnum) : 0;
+        }
+        else if (question.name.equals(instanceName_))
+        {
+            probedInstance = true;
+            kinds = (any || question.type == kTypeSRV ? bit(kSrv) : 0) |
+                (any || question.type == kTypeTXT ? bit(kTxt) : 0);
+        }
+        else if (question.name.equals(hostName_))
+        {
+            probedHost = true;
+            // 没有地址时不应答，否则应答报文中没有任何答案记录
+            bool wanted = any || question.type == kTypeA;
+            kinds = (wanted && !records_[kAddress].empty()) ? bit(kAddress) : 0;
+        }
+        (question.unicastResponse() ? unicast : multicast) |= kinds;
+    }
+
+    // 已知答案: 对方缓存中剩余 TTL 不少于一半的记录不再应答
+    uint32_t known = 0;
+    std::array<size_t, kKindCount> knownCount = {};
+    CachedRecord record;
+    for (uint16_t i = 0; i < header.ancount; i++)
+    {
+        Record answer;
+        if (!reader.readRecord(answer))
+        {
+            return;
+        }
+        if (!RecordCache::decode(reader, answer, record))
+        {
+            continue;
+        }
+        int kind = matchRecord(record);
+        if (kind != kKindCount && halfTtl(answer.ttl, records_[kind][0]) &&
+            ++knownCount[kind] == records_[kind].size())
+        {
+            known |= bit(kind);
+        }
+    }
+
+    if (state_ == State::Probing)
+    {
+        if (header.nscount > 0 && (probedInstance || probedHost) && probeLost(reader, header))
+        {
+            // RFC 6762 8.2: 同时探测失败，1 秒后重新探测
+            restartProbing(now, std::chrono::seconds(1));
+        }
+        return;
+    }
+
+    if (header.qdcount == 0)
+    {
+        // TC 查询的后续报文只携带已知答案
+        pendingAnswers_ &= ~known;
+        return;
+    }
+    if (port != 5353)
+    {
+        return;
+    }
+    multicast &= ~known;
+    unicast &= ~known;
+
+    // RFC 6762 5.4: 记录在 1/4 TTL 内没有多播过时，即使是 QU 问题也多播
+    for (int kind = 0; kind < kKindCount; kind++)
+    {
+        if ((unicast & bit(kind)) && !records_[kind].empty() &&
+            now - lastMulticast_[kind] >= std::chrono::seconds(records_[kind][0].ttl / 4))
+        {
+            unicast &= ~bit(kind);
+            multicast |= bit(kind);
+        }
+    }
+    if (unicast)
+    {
+        unicast_.push_back(Unicast{ unicast, address, port });
+    }
+
+    // RFC 6762 6.2: 同一记录 1 秒内只多播一次，应答探测时为 250 毫秒
+    Clock::duration interval = header.nscount > 0 ?
+        std::chrono::milliseconds(250) : std::chrono::seconds(1);
+    for (int kind = 0; kind < kKindCount; kind++)
+    {
+        if ((multicast & bit(kind)) && now - lastMulticast_[kind] < interval)
+        {
+            multicast &= ~bit(kind);
+        }
+    }
+    if (!multicast)
+    {
+        return;
+    }
+
+    // 只包含唯一记录的应答立即发送，共享记录随机延迟以免多个响应方同时应答
+    Clock::duration delay = Clock::duration::zero();
+    if (header.isTruncated())
+    {
+        delay = randomDelay(400, 500);
+    }
+    else if (multicast & (bit(kPtr) | bit(kEnum)))
+    {
+        delay = randomDelay(20, 120);
+    }
+    Clock::time_point due = now + delay;
+    pendingDue_ = pendingAnswers_ == 0 ? due : std::min(pendingDue_, due);
+    pendingAnswers_ |= multicast;
+}
+
+/**
+ * @brief 同时探测时比较对方授权部分中与本机同名的记录
+ * @details 实例名与主机名分别比较，任一名称下本机记录在字典序上较小即失败
+ * @return true 本次探测失败
+ */
+bool Responder::probeLost(PacketReader& reader, const Header& header)
+{
+    probeRecords_.clear();
+    for (uint16_t i = 0; i < header.nscount; i++)
+    {
+        Record authority;
+        if (!reader.readRecord(authority))
+        {
+            return false;
+        }
+        if (!ownsName(authority.name))
+        {
+            continue;
+        }
+        probeRecords_.push_back(CachedRecord());
+        if (!RecordCache::decode(reader, authority, probeRecords_.back()))
+        {
+            probeRecords_.pop_back();
+        }
+    }
+
+    const int first[] = { kSrv, kAddress };
+    const int last[] = { kTxt, kAddress };
+    for (int side = 0; side < 2; side++)
+    {
+        std::vector<const CachedRecord*> ours;
+        for (int kind = first[side]; kind <= last[side]; kind++)
+        {
+            for (const auto& record : records_[kind])
+            {
+                ours.push_back(&record);
+            }
+        }
+        const std::string& name = side == 0 ? records_[kSrv][0].name : records_[kSrv][0].target;
+        std::vector<const CachedRecord*> theirs;
+        for (const auto& record : probeRecords_)
+        {
+            if (StrRef(record.name).equalsIgnoreCase(name))
+            {
+                theirs.push_back(&record);
+            }
+        }
+        if (!theirs.empty() && compareRecords(ours, theirs) < 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief 处理其他主机的应答
+ * @details 与本机记录相同的应答用于重复应答抑制；本机名称下不同的记录视为冲突:
+ * 探测期间改名重新探测，已宣告时按 RFC 6762 9 重新探测
+ */
+void Responder::handleResponse(PacketReader& reader, const Header& header, Clock::time_point now)
+{
+    for (uint16_t i = 0; i < header.qdcount; i++)
+    {
+        Question question;
+        if (!reader.readQuestion(question))
+        {
+            return;
+        }
+    }
+
+    CachedRecord record;
+    uint32_t total = static_cast<uint32_t>(header.ancount) + header.nscount + header.arcount;
+    for (uint32_t i = 0; i < total; i++)
+    {
+        Record answer;
+        if (!reader.readRecord(answer))
+        {
+            return;
+        }
+        bool owned = ownsName(answer.name);
+        bool shared = answer.name.equals(serviceName_) || answer.name.equals(enumName_);
+        if (answer.ttl == 0 || (!owned && !(shared && pendingAnswers_)))
+        {
+            continue;
+        }
+        if (!RecordCache::decode(reader, answer, record))
+        {
+            continue;
+        }
+
+        int kind = matchRecord(record);
+        if (kind != kKindCount)
+        {
+            // RFC 6762 7.4: 其他主机已经多播了相同的应答
+            if (halfTtl(answer.ttl, records_[kind][0]) && records_[kind].size() == 1)
+            {
+                pendingAnswers_ &= ~bit(kind);
+            }
+            continue;
+        }
+        if (!owned)
+        {
+            continue;
+        }
+
+        bool instance = answer.name.equals(instanceName_);
+        if (state_ == State::Probing)
+        {
+            rename(instance);
+            restartProbing(now, randomDelay(0, 250));
+            return;
+        }
+        // 已宣告时，只有同名同类型的唯一记录数据不同才是冲突
+        bool conflict = instance ? (record.type == kTypeSRV || record.type == kTypeTXT) :
+            record.type == kTypeA;
+        if (conflict)
+        {
+            restartProbing(now, Clock::duration::zero());
+            return;
+        }
+    }
+}
+
+void Responder::poll(Clock::time_point now, std::vector<Packet>& out)
+{
+    for (const auto& reply : unicast_)
+    {
+        push(responsePacket(reply.answers), false, reply.address, reply.port, now, out);
+    }
+    unicast_.clear();
+
+    if (state_ == State::Probing && now >= nextProbe_)
+    {
+        if (probesSent_ < kProbeCount)
+        {
+            push(probePacket_, true, 0, 0, now, out);
+            probesSent_++;
+            nextProbe_ = now + std::chrono::milliseconds(250);
+        }
+        else
+        {
+            // 最后一次探测后 250 毫秒内没有冲突，名称归本机所有
+            state_ = State::Announcing;
+            announcements_ = 0;
+            nextAnnounce_ = now;
+        }
+    }
+
+    if (state_ == State::Announcing && now >= nextAnnounce_)
+    {
+        uint32_t all = bit(kKindCount) - 1;
+        push(responsePacket(all), true, 0, 0, now, out);
+        lastMulticast_.fill(now);
+        announcements_++;
+        nextAnnounce_ = now + std::chrono::seconds(1);
+        if (announcements_ >= kAnnounceCount)
+        {
+            state_ = State::Established;
+        }
+    }
+
+    if (pendingAnswers_ && now >= pendingDue_)
+    {
+        push(responsePacket(pendingAnswers_), true, 0, 0, now, out);
+        uint32_t sent = pendingAnswers_ | additionalsFor(pendingAnswers_);
+        for (int kind = 0; kind < kKindCount; kind++)
+        {
+            if (sent & bit(kind))
+            {
+                lastMulticast_[kind] = now;
+            }
+        }
+        pendingAnswers_ = 0;
+    }
+}
+
+Responder::Clock::time_point Responder::nextDeadline() const
+{
+    if (state_ == State::Idle)
+    {
+        return Clock::time_point::max();
+    }
+    if (!unicast_.empty())
+    {
+        return Clock::time_point::min();
+    }
+    Clock::time_point next = Clock::time_point::max();
+    if (state_ == State::Probing)
+    {
+        next = nextProbe_;
+    }
+    else if (state_ == State::Announcing)
+    {
+        next = nextAnnounce_;
+    }
+    if (pendingAnswers_)
+    {
+        next = std::min(next, pendingDue_);
+    }
+    return next;
+}
+
+void Responder::push(const std::vector<uint8_t>& packet, bool multicast, uint32_t address,
+    uint16_t port, Clock::time_point now, std::vector<Packet>& out)
+{
+    Packet entry;
+    entry.data = &packet;
+    entry.multicast = multicast;
+    entry.address = address;
+    entry.port = port;
+    out.push_back(entry);
+
+    Sent& slot = sent_[sentNext_];
+    sentNext_ = (sentNext_ + 1) % sent_.size();
+    slot.hash = fnv1a(packet.data(), packet.size());
+    slot.size = packet.size();
+    slot.time = now;
+}
+
+bool Responder::isOwnPacket(const uint8_t* data, size_t size, Clock::time_point now) const
+{
+    uint64_t hash = 0;
+    bool hashed = false;
+    for (const auto& slot : sent_)
+    {
+        if (slot.size != size || now - slot.time >= std::chrono::seconds(2))
+        {
+            continue;
+        }
+        if (!hashed)
+        {
+            hash = fnv1a(data, size);
+            hashed = true;
+        }
+        if (slot.hash == hash)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+Responder::Clock::duration Responder::randomDelay(int minMs, int maxMs)
+{
+    return std::chrono::milliseconds(minMs + static_cast<int>(random_() % (maxMs - minMs + 1)));
+}
+
+} // namespace mdns
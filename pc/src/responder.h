@@ -0,0 +1,209 @@
+/**
+ * @file responder.h
+ * @brief mDNS 服务广播的响应方
+ * @details 按 RFC 6762/6763 广播一个服务实例，只处理协议状态，不涉及套接字:
+ *  - 探测(8.1): 间隔 250 毫秒发送 3 次 QU 探测，期间收到同名记录时改名重新探测；
+ *    同时探测的冲突按 8.2 比较记录数据决定胜负
+ *  - 宣告(8.3): 探测完成后间隔 1 秒发送 2 次全部记录，TXT 变化时重新宣告(8.4)
+ *  - 应答: 服务类型 PTR、实例 SRV/TXT、主机 A 以及服务枚举的问题，附加记录按 RFC 6763 12
+ *  - 多播应答随机延迟 20-120 毫秒(TC 查询 400-500 毫秒)，延迟期间的多个查询合并为一个应答；
+ *    只包含唯一记录的应答立即发送
+ *  - QU 问题单播应答，记录在 1/4 TTL 内没有多播过时改为多播(5.4)
+ *  - 已知答案抑制(7.1)、重复应答抑制(7.4)，同一记录 1 秒内只多播一次(6.2)
+ *  - 停止时发送 TTL 为 0 的 goodbye 报文(10.1)
+ *
+ * 应答报文按(应答记录, 附加记录)组合第一次使用时序列化并缓存，记录变化(改名、TXT 更新)
+ * 时才重新生成，处理查询时只做查表。
+ *
+ * 非线程安全，由调用方在同一线程中驱动。
+ */
+
+#pragma once
+
+#include "mdns_packet.h"
+#include "record_cache.h"
+#include <array>
+#include <chrono>
+#include <map>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mdns {
+
+class Responder {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// 广播的服务实例
+    struct Service {
+        std::string name;         ///< 实例名的第一个标签，例如 "MyDevice"
+        std::string serviceType;  ///< 点分形式，例如 "_leboremote._tcp.local"
+        std::string host;         ///< 主机名，例如 "mypc.local"
+        uint16_t port = 0;
+        std::map<std::string, std::string> txtRecords;
+        std::vector<uint32_t> addresses;  ///< 主机的 IPv4 地址，网络字节序
+    };
+
+    /// poll() 输出的待发送报文
+    struct Packet {
+        const std::vector<uint8_t>* data;  ///< 指向内部缓存，下一次调用 Responder 前有效
+        bool multicast;
+        uint32_t address;  ///< 单播目的地址，网络字节序
+        uint16_t port;     ///< 单播目的端口，主机字节序
+    };
+
+    enum class State {
+        Idle,
+        Probing,
+        Announcing,
+        Established
+    };
+
+    /// @param maxPacketSize 应答报文的上限，附加记录放不下时省略
+    explicit Responder(size_t maxPacketSize = 1472);
+
+    /**
+     * @brief 开始探测并广播服务
+     * @return false 名称、服务类型或 TXT 记录格式错误
+     */
+    bool start(const Service& service, Clock::time_point now);
+
+    /**
+     * @brief 更新 TXT 记录，重新生成应答报文并重新宣告
+     * @return false TXT 记录格式错误，保持原记录
+     */
+    bool setTxt(const std::map<std::string, std::string>& txtRecords, Clock::time_point now);
+
+    /**
+     * @brief 停止广播
+     * @param out 已宣告过的记录追加 goodbye 报文
+     */
+    void stop(Clock::time_point now, std::vector<Packet>& out);
+
+    /**
+     * @brief 处理收到的报文
+     *
+     * @param address 发送方地址，网络字节序
+     * @param port 发送方端口，主机字节序
+     */
+    void handlePacket(const uint8_t* data, size_t size, uint32_t address, uint16_t port,
+        Clock::time_point now);
+
+    /**
+     * @brief 取出到 now 为止需要发送的报文(探测、宣告、应答)
+     */
+    void poll(Clock::time_point now, std::vector<Packet>& out);
+
+    /// 下一次需要调用 poll() 的时间，没有待发送的报文时返回 time_point::max()
+    Clock::time_point nextDeadline() const;
+
+    State state() const { return state_; }
+
+    const Service& service() const { return service_; }
+
+    /// 当前的完整实例名(冲突改名后可能与 start() 时不同)
+    std::string instanceName() const;
+
+    /**
+     * @brief 把键值对编码为 TXT 记录数据，每项为 "key=value"
+     * @return false 键为空或包含 '='，或单项超过 255 字节
+     */
+    static bool encodeTxt(const std::map<std::string, std::string>& txtRecords, std::string& rdata);
+
+private:
+    // 记录种类，按位组合表示一个报文包含的记录
+    enum Kind {
+        kPtr,      ///< 服务类型 -> 实例，共享记录
+        kSrv,      ///< 实例 -> 主机和端口
+        kTxt,      ///< 实例属性
+        kAddress,  ///< 主机 -> IPv4 地址，可有多条
+        kEnum,     ///< _services._dns-sd._udp.local -> 服务类型，共享记录
+        kKindCount
+    };
+
+    static uint32_t bit(int kind) { return 1u << kind; }
+    static bool isUnique(int kind) { return kind == kSrv || kind == kTxt || kind == kAddress; }
+    static uint32_t additionalsFor(uint32_t answers);
+
+    /// 单播等待发送的应答
+    struct Unicast {
+        uint32_t answers;
+        uint32_t address;
+        uint16_t port;
+    };
+
+    /// 最近发送的报文，用于识别多播回环收到的自身报文
+    struct Sent {
+        uint64_t hash;
+        size_t size;
+        Clock::time_point time;
+    };
+
+    bool buildRecords();
+    void buildPackets();
+    bool buildTxt(const std::map<std::string, std::string>& txtRecords, std::string& rdata) const
+    {
+        return encodeTxt(txtRecords, rdata) && rdata.size() + kHeaderSize < maxPacketSize_;
+    }
+    void serialize(uint32_t answers, uint32_t additionals, uint32_t authority, bool goodbye,
+        std::vector<uint8_t>& out) const;
+    const std::vector<uint8_t>& responsePacket(uint32_t answers);
+
+    void restartProbing(Clock::time_point now, Clock::duration delay);
+    void handleQuery(PacketReader& reader, const Header& header, uint32_t address, uint16_t port,
+        Clock::time_point now);
+    void handleResponse(PacketReader& reader, const Header& header, Clock::time_point now);
+    bool probeLost(PacketReader& reader, const Header& header);
+    void rename(bool instance);
+
+    /// 报文中的记录是否与本机的某条记录相同，返回其种类，不同时返回 kKindCount
+    int matchRecord(const CachedRecord& record) const;
+    bool ownsName(const NameView& name) const;
+
+    void push(const std::vector<uint8_t>& packet, bool multicast, uint32_t address, uint16_t port,
+        Clock::time_point now, std::vector<Packet>& out);
+    bool isOwnPacket(const uint8_t* data, size_t size, Clock::time_point now) const;
+    Clock::duration randomDelay(int minMs, int maxMs);
+
+    size_t maxPacketSize_;
+    Service service_;
+    std::string baseName_;  ///< 改名前的实例名
+    std::string baseHost_;  ///< 改名前的主机名的第一个标签
+    std::string hostDomain_; ///< 主机名的其余部分，例如 ".local"
+    int renames_ = 0;
+    State state_ = State::Idle;
+
+    // 名称的 wire 格式及其视图
+    std::string serviceWire_;
+    std::string instanceWire_;
+    std::string hostWire_;
+    std::string enumWire_;
+    NameView serviceName_;
+    NameView instanceName_;
+    NameView hostName_;
+    NameView enumName_;
+
+    std::array<std::vector<CachedRecord>, kKindCount> records_;
+    std::unordered_map<uint32_t, std::vector<uint8_t>> packets_;  ///< 按应答记录组合缓存
+    std::vector<uint8_t> probePacket_;
+    std::vector<uint8_t> goodbyePacket_;
+
+    int probesSent_ = 0;
+    Clock::time_point nextProbe_;
+    int announcements_ = 0;
+    Clock::time_point nextAnnounce_;
+    std::array<Clock::time_point, kKindCount> lastMulticast_;
+
+    uint32_t pendingAnswers_ = 0;  ///< 等待延迟发送的多播应答
+    Clock::time_point pendingDue_;
+    std::vector<Unicast> unicast_;
+
+    std::array<Sent, 8> sent_;
+    size_t sentNext_ = 0;
+    std::vector<CachedRecord> probeRecords_;  ///< 复用的冲突探测记录列表
+    std::minstd_rand random_;
+};
+
+} // namespace mdns
@@ -0,0 +1,180 @@
+/**
+ * @file service_matcher.cpp
+ * @brief 订阅服务类型的名称匹配实现
+ */
+
+#include "service_matcher.h"
+#include "fnv1a.h"
+#include <algorithm>
+#include <functional>
+
+namespace mdns {
+
+namespace {
+
+const uint64_t kSuffixSeed = kFnvOffsetBasis;
+
+} // namespace
+
+uint64_t ServiceMatcher::hashLabel(const StrRef& label)
+{
+    return fnv1aLower(label);
+}
+
+bool ServiceMatcher::splitLabels(const StrRef& dotted, StrRef* labels, size_t& count)
+{
+    StrRef rest = dotted;
+    if (!rest.empty() && rest[rest.size() - 1] == '.')
+    {
+        rest = rest.substr(0, rest.size() - 1);
+    }
+    if (rest.empty() || rest.size() > kMaxNameLength)
+    {
+        return false;
+    }
+
+    count = 0;
+    while (true)
+    {
+        size_t dot = rest.find('.');
+        StrRef label = rest.substr(0, dot);
+        if (label.empty() || label.size() > 63 || count == kMaxLabels)
+        {
+            return false;
+        }
+        labels[count++] = label;
+        if (dot == rest.size())
+        {
+            return true;
+        }
+        rest = rest.substr(dot + 1, rest.size());
+    }
+}
+
+bool ServiceMatcher::add(const StrRef& serviceType, uint32_t id)
+{
+    StrRef labels[kMaxLabels];
+    size_t count = 0;
+    if (!splitLabels(serviceType, labels, count))
+    {
+        return false;
+    }
+
+    Entry entry;
+    entry.id = id;
+    entry.hash = kSuffixSeed;
+    for (size_t i = count; i-- > 0;)
+    {
+        entry.hash = fold(entry.hash, hashLabel(labels[i]));
+    }
+    for (size_t i = 0; i < count; i++)
+    {
+        std::string label;
+        for (size_t j = 0; j < labels[i].size(); j++)
+        {
+            label += asciiLower(labels[i][j]);
+        }
+        entry.labels.push_back(label);
+    }
+
+    for (const auto& other : entries_)
+    {
+        if (other.hash == entry.hash && other.labels == entry.labels)
+        {
+            return false;
+        }
+    }
+
+    auto pos = std::lower_bound(entries_.begin(), entries_.end(), entry.hash,
+        [](const Entry& e, uint64_t hash) { return e.hash < hash; });
+    entries_.insert(pos, entry);
+
+    if (std::find(labelCounts_.begin(), labelCounts_.end(), count) == labelCounts_.end())
+    {
+        labelCounts_.push_back(count);
+        std::sort(labelCounts_.begin(), labelCounts_.end(), std::greater<size_t>());
+    }
+    return true;
+}
+
+bool ServiceMatcher::match(const NameView& name, Match& out) const
+{
+    if (entries_.empty() || name.labelCount() == 0)
+    {
+        return false;
+    }
+    StrRef labels[kMaxLabels];
+    size_t count = 0;
+    NameView::LabelIterator it(name);
+    while (count < kMaxLabels && it.next(labels[count]))
+    {
+        count++;
+    }
+    return matchLabels(labels, count, out);
+}
+
+bool ServiceMatcher::match(const StrRef& dotted, Match& out) const
+{
+    if (entries_.empty())
+    {
+        return false;
+    }
+    StrRef labels[kMaxLabels];
+    size_t count = 0;
+    if (!splitLabels(dotted, labels, count))
+    {
+        return false;
+    }
+    return matchLabels(labels, count, out);
+}
+
+bool ServiceMatcher::matchLabels(const StrRef* labels, size_t count, Match& out) const
+{
+    // suffix[k] 为最后 k 个标签的哈希，只计算到最长的订阅标签数
+    size_t longest = std::min(labelCounts_.front(), count);
+    uint64_t suffix[kMaxLabels + 1];
+    suffix[0] = kSuffixSeed;
+    for (size_t k = 1; k <= longest; k++)
+    {
+        suffix[k] = fold(suffix[k - 1], hashLabel(labels[count - k]));
+    }
+
+    for (size_t labelCount : labelCounts_)
+    {
+        if (labelCount > count)
+        {
+            continue;
+        }
+        uint64_t hash = suffix[labelCount];
+        auto it = std::lower_bound(entries_.begin(), entries_.end(), hash,
+            [](const Entry& e, uint64_t h) { return e.hash < h; });
+        for (; it != entries_.end() && it->hash == hash; ++it)
+        {
+            if (it->labels.size() != labelCount)
+            {
+                continue;
+            }
+            const StrRef* tail = labels + (count - labelCount);
+            bool same = true;
+            for (size_t i = 0; i < labelCount && same; i++)
+            {
+                same = tail[i].equalsIgnoreCase(it->labels[i]);
+            }
+            if (same)
+            {
+                out.id = it->id;
+                out.exact = labelCount == count;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+void ServiceMatcher::clear()
+{
+    entries_.clear();
+    labelCounts_.clear();
+}
+
+} // namespace mdns
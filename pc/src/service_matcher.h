@@ -0,0 +1,75 @@
+/**
+ * @file service_matcher.h
+ * @brief 订阅服务类型的名称匹配
+ * @details 判断报文中的名称属于哪一个订阅的服务类型，不做子串查找:
+ *  - 每个服务类型预先计算小写标签序列的哈希(从右向左折叠每个标签的 FNV-1a 哈希)
+ *  - 匹配时对名称的标签只做一遍哈希，按订阅中出现过的标签数取名称的后缀哈希查表
+ *  - 哈希命中后再逐标签比较(大小写不敏感)，排除哈希冲突
+ *  - 多个订阅都匹配时取标签数最多的一个(例如子类型比父类型优先)
+ *
+ * 匹配过程不分配内存。非线程安全，只在接收线程中使用。
+ */
+
+#pragma once
+
+#include "fnv1a.h"
+#include "mdns_packet.h"
+#include <string>
+#include <vector>
+
+namespace mdns {
+
+class ServiceMatcher {
+public:
+    /// 匹配结果
+    struct Match {
+        uint32_t id;  ///< add() 时指定的编号
+        bool exact;   ///< 名称就是服务类型本身(服务类型 PTR 记录的所有者)
+    };
+
+    /**
+     * @brief 添加服务类型
+     *
+     * @param serviceType 点分形式的服务类型，例如 "_leboremote._tcp.local"，可带结尾的点
+     * @param id 匹配时返回的编号
+     * @return false 格式错误(空标签或超过长度限制)或已存在
+     */
+    bool add(const StrRef& serviceType, uint32_t id);
+
+    /// 名称是服务类型本身或其子域时返回 true
+    bool match(const NameView& name, Match& out) const;
+
+    /// 点分形式名称的匹配，用于已保存的实例名
+    bool match(const StrRef& dotted, Match& out) const;
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    void clear();
+
+    /// 单个标签的小写 FNV-1a 哈希
+    static uint64_t hashLabel(const StrRef& label);
+
+    /// 把下一个(更靠左的)标签折叠到后缀哈希中
+    static uint64_t fold(uint64_t suffix, uint64_t label)
+    {
+        return (suffix ^ label) * kFnvPrime;
+    }
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::vector<std::string> labels;  ///< 小写标签
+        uint32_t id;
+    };
+
+    /// 把点分名称拆成标签，失败时返回 false
+    static bool splitLabels(const StrRef& dotted, StrRef* labels, size_t& count);
+
+    bool matchLabels(const StrRef* labels, size_t count, Match& out) const;
+
+    std::vector<Entry> entries_;       ///< 按哈希排序
+    std::vector<size_t> labelCounts_;  ///< 订阅中出现过的标签数，从大到小
+};
+
+} // namespace mdns
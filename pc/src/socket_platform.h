@@ -0,0 +1,82 @@
+/**
+ * @file socket_platform.h
+ * @brief 套接字接口的平台差异
+ * @details Windows 使用 WinSock，其余平台使用 BSD 套接字。POSIX 下定义 SOCKET、INVALID_SOCKET
+ * 和 closesocket，使两边的代码写法一致。
+ */
+
+#pragma once
+
+#include <string>
+
+#ifdef _WIN32
+#include <WinSock2.h>
+#include <WS2tcpip.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+#include <cstring>
+#define SOCKET int
+#define INVALID_SOCKET (-1)
+#define closesocket close
+#endif
+
+namespace mdns {
+
+/// 最近一次套接字调用的错误码
+inline int lastSocketError()
+{
+#ifdef _WIN32
+    return WSAGetLastError();
+#else
+    return errno;
+#endif
+}
+
+/// 错误码是否表示非阻塞套接字暂时没有数据
+inline bool wouldBlock(int error)
+{
+#ifdef _WIN32
+    return error == WSAEWOULDBLOCK;
+#else
+    return error == EAGAIN || error == EWOULDBLOCK;
+#endif
+}
+
+inline std::string socketErrorString(int error)
+{
+#ifdef _WIN32
+    return "WSA error " + std::to_string(error);
+#else
+    return std::strerror(error);
+#endif
+}
+
+/// 错误码是否表示地址已在使用(例如重复加入同一接口上的多播组)
+inline bool addressInUse(int error)
+{
+#ifdef _WIN32
+    return error == WSAEADDRINUSE;
+#else
+    return error == EADDRINUSE;
+#endif
+}
+
+/// 把套接字设置为非阻塞模式
+inline bool setNonBlocking(SOCKET sock)
+{
+#ifdef _WIN32
+    u_long enable = 1;
+    return ioctlsocket(sock, FIONBIO, &enable) == 0;
+#else
+    int flags = fcntl(sock, F_GETFL, 0);
+    return flags >= 0 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+#endif
+}
+
+} // namespace mdns
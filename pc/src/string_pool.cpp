@@ -0,0 +1,56 @@
+/**
+ * @file string_pool.cpp
+ * @brief 驻留字符串池实现
+ */
+
+#include "string_pool.h"
+#include "fnv1a.h"
+
+namespace mdns {
+
+const size_t StringPool::kDefaultCapacity;
+const size_t StringPool::kMaxLength;
+const size_t StringPool::kChunkSize;
+
+size_t StringPool::Hash::operator()(const StrRef& text) const
+{
+    // 区分大小写: TXT 值按原样比较
+    return static_cast<size_t>(fnv1a(text.data(), text.size()));
+}
+
+StringPool::StringPool(size_t capacity) : capacity_(capacity)
+{
+}
+
+const char* StringPool::intern(const StrRef& text)
+{
+    auto it = index_.find(text);
+    if (it != index_.end())
+    {
+        return it->second;
+    }
+
+    size_t bytes = text.size() + 1;
+    if (text.size() > kMaxLength || used_ + bytes > capacity_)
+    {
+        return nullptr;
+    }
+    if (chunkUsed_ + bytes > kChunkSize)
+    {
+        // 块尾剩余的空间不再使用，最多浪费 kMaxLength 字节
+        chunks_.push_back(std::unique_ptr<char[]>(new char[kChunkSize]));
+        chunkUsed_ = 0;
+    }
+    char* copy = chunks_.back().get() + chunkUsed_;
+    if (!text.empty())
+    {
+        std::memcpy(copy, text.data(), text.size());
+    }
+    copy[text.size()] = '\0';
+    chunkUsed_ += bytes;
+    used_ += bytes;
+    index_.insert(std::make_pair(StrRef(copy, text.size()), copy));
+    return copy;
+}
+
+} // namespace mdns
@@ -0,0 +1,61 @@
+/**
+ * @file string_pool.h
+ * @brief 驻留字符串池
+ * @details TXT 记录的键("version"、"model"、"u" 等)和常见的短值在成千上万个设备中重复出现，
+ * 池中每种内容只保存一份，设备记录只保存指向池的指针:
+ *  - 返回的字符串以 NUL 结尾，在池的生命周期内地址和内容都不变
+ *  - 内存按固定大小的块分配，块不移动，不单独释放
+ *  - 总量达到上限后 intern() 返回 nullptr，调用方改为自行保存，池不会无限增长
+ *
+ * 只在一个线程中调用 intern()；读取已返回的字符串不需要同步(发布前已写入)。
+ */
+
+#pragma once
+
+#include "mdns_packet.h"
+#include <cstddef>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace mdns {
+
+class StringPool {
+public:
+    static const size_t kDefaultCapacity = 64 * 1024;  ///< 默认总容量(字节)
+    static const size_t kMaxLength = 255;              ///< 可驻留的最大长度，与 TXT 项上限相同
+
+    explicit StringPool(size_t capacity = kDefaultCapacity);
+
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+
+    /**
+     * @brief 取得内容相同的驻留字符串
+     *
+     * @param text 字符串内容，可以包含 NUL
+     * @return 池中的副本，超过 kMaxLength 或池已满时返回 nullptr
+     */
+    const char* intern(const StrRef& text);
+
+    /// 已驻留的字符串个数
+    size_t count() const { return index_.size(); }
+
+    /// 已使用的字节数(含结尾 NUL)
+    size_t bytesUsed() const { return used_; }
+
+private:
+    static const size_t kChunkSize = 4096;
+
+    struct Hash {
+        size_t operator()(const StrRef& text) const;
+    };
+
+    std::vector<std::unique_ptr<char[]>> chunks_;
+    size_t chunkUsed_ = kChunkSize;  ///< 当前块已使用的字节数，初始时视为已满
+    size_t used_ = 0;
+    size_t capacity_;
+    std::unordered_map<StrRef, const char*, Hash> index_;  ///< 键指向池中的副本
+};
+
+} // namespace mdns
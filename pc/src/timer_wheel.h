@@ -0,0 +1,221 @@
+/**
+ * @file timer_wheel.h
+ * @brief 哈希时间轮
+ * @details 用于大量记录的 TTL 到期调度:
+ *  - 时间按固定间隔(tick)划分，定时器挂在 due % slotCount 对应的槽位链表上
+ *  - 调度、取消和重新调度都是 O(1)，只需修改双向链表
+ *  - 每个 tick 只检查一个槽位，记录数远大于槽位数时才会退化
+ *
+ * 定时器以调用方分配的 uint32_t 编号标识(例如缓存记录在数组中的下标)，
+ * 每个编号同时最多只有一个定时器，重复调度会移动原有定时器。
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace mdns {
+
+class TimerWheel {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /**
+     * @param slotCount 槽位数，向上取整为 2 的幂
+     * @param tick 每个槽位代表的时间间隔
+     * @param start 时间轮的起始时间
+     */
+    explicit TimerWheel(size_t slotCount = 1024,
+        Clock::duration tick = std::chrono::milliseconds(250),
+        Clock::time_point start = Clock::now())
+        : tick_(tick), start_(start), current_(0), size_(0)
+    {
+        size_t count = 1;
+        while (count < slotCount)
+        {
+            count <<= 1;
+        }
+        heads_.assign(count, kNone);
+        mask_ = count - 1;
+    }
+
+    Clock::duration tick() const { return tick_; }
+    size_t size() const { return size_; }
+
+    bool scheduled(uint32_t id) const
+    {
+        return id < nodes_.size() && nodes_[id].linked;
+    }
+
+    /// 定时器的到期时间(按 tick 取整后)，未调度时返回 time_point::max()
+    Clock::time_point dueTime(uint32_t id) const
+    {
+        if (!scheduled(id))
+        {
+            return Clock::time_point::max();
+        }
+        return start_ + tick_ * static_cast<Clock::rep>(nodes_[id].due);
+    }
+
+    /**
+     * @brief 调度定时器
+     * @details 到期时间按 tick 向上取整；已过期的时间在下一个 tick 触发
+     */
+    void schedule(uint32_t id, Clock::time_point when)
+    {
+        if (id >= nodes_.size())
+        {
+            nodes_.resize(id + 1);
+        }
+        Node& node = nodes_[id];
+        if (node.linked)
+        {
+            unlink(id);
+        }
+
+        uint64_t due = current_ + 1;
+        if (when > start_)
+        {
+            Clock::duration offset = when - start_;
+            uint64_t ticks = static_cast<uint64_t>((offset + tick_ - Clock::duration(1)) / tick_);
+            if (ticks > due)
+            {
+                due = ticks;
+            }
+        }
+        node.due = due;
+        link(id);
+    }
+
+    void cancel(uint32_t id)
+    {
+        if (scheduled(id))
+        {
+            unlink(id);
+        }
+    }
+
+    /// 下一个需要处理的 tick 时间，用于计算等待超时
+    Clock::time_point nextTick() const
+    {
+        return start_ + tick_ * static_cast<Clock::rep>(current_ + 1);
+    }
+
+    /**
+     * @brief 推进时间轮到 now，对每个到期的定时器调用 fire(id)
+     * @details 到期的定时器先摘下再回调，回调中可以重新调度任意定时器
+     * @return 触发的定时器数量
+     */
+    template <typename Fn>
+    size_t advance(Clock::time_point now, Fn fire)
+    {
+        if (now < start_)
+        {
+            return 0;
+        }
+        uint64_t target = static_cast<uint64_t>((now - start_) / tick_);
+        if (target <= current_)
+        {
+            return 0;
+        }
+
+        due_.clear();
+        if (target - current_ > mask_)
+        {
+            // 跨越整圈时每个槽位只扫描一次
+            for (size_t slot = 0; slot <= mask_; slot++)
+            {
+                collect(slot, target);
+            }
+        }
+        else
+        {
+            for (uint64_t t = current_ + 1; t <= target; t++)
+            {
+                collect(static_cast<size_t>(t & mask_), target);
+            }
+        }
+        current_ = target;
+
+        for (size_t i = 0; i < due_.size(); i++)
+        {
+            fire(due_[i]);
+        }
+        return due_.size();
+    }
+
+private:
+    enum : uint32_t { kNone = 0xFFFFFFFFu };
+
+    struct Node {
+        Node() : prev(kNone), next(kNone), due(0), linked(false) {}
+        uint32_t prev;
+        uint32_t next;
+        uint64_t due;  ///< 到期 tick 序号
+        bool linked;
+    };
+
+    void link(uint32_t id)
+    {
+        Node& node = nodes_[id];
+        size_t slot = static_cast<size_t>(node.due & mask_);
+        node.prev = kNone;
+        node.next = heads_[slot];
+        if (node.next != kNone)
+        {
+            nodes_[node.next].prev = id;
+        }
+        heads_[slot] = id;
+        node.linked = true;
+        size_++;
+    }
+
+    void unlink(uint32_t id)
+    {
+        Node& node = nodes_[id];
+        if (node.prev != kNone)
+        {
+            nodes_[node.prev].next = node.next;
+        }
+        else
+        {
+            heads_[static_cast<size_t>(node.due & mask_)] = node.next;
+        }
+        if (node.next != kNone)
+        {
+            nodes_[node.next].prev = node.prev;
+        }
+        node.prev = node.next = kNone;
+        node.linked = false;
+        size_--;
+    }
+
+    /// 摘下槽位中到期时间不晚于 target 的定时器
+    void collect(size_t slot, uint64_t target)
+    {
+        uint32_t id = heads_[slot];
+        while (id != kNone)
+        {
+            uint32_t next = nodes_[id].next;
+            if (nodes_[id].due <= target)
+            {
+                unlink(id);
+                due_.push_back(id);
+            }
+            id = next;
+        }
+    }
+
+    Clock::duration tick_;
+    Clock::time_point start_;
+    uint64_t current_;  ///< 已处理到的 tick 序号
+    size_t mask_;
+    size_t size_;
+    std::vector<uint32_t> heads_;
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> due_;  ///< advance() 中复用的到期列表
+};
+
+} // namespace mdns
@@ -0,0 +1,232 @@
+/**
+ * @file cache_file_test.cpp
+ * @brief 记录缓存文件的回归测试
+ * @details 覆盖 writeCacheFile 和 readCacheFile:
+ *  - roundtrip/...: 写入再读回 A/AAAA/PTR/SRV/TXT 记录，字段保持不变
+ *  - malformed/...: 手工构造的文件中有一条记录数据与类型不符(A 记录截断或超长、
+ *    AAAA 长度错误、PTR/SRV 没有目标或目标名称格式错误)，整个文件作废且不输出记录
+ *  - write/...: 内存中记录数据与类型不符的记录写入时跳过
+ *
+ * 在当前目录创建临时文件。用法: cache_file_test，有失败时返回 1
+ */
+
+#include "cache_file.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+using mdns::CachedRecord;
+
+typedef CachedRecord::Clock Clock;
+
+const char kPath[] = "cache_file_test.lbmc";
+const int64_t kNowUnixMs = 1700000000000LL;
+
+int g_checks = 0;
+int g_failures = 0;
+
+void check(bool ok, const std::string& what)
+{
+    g_checks++;
+    if (!ok)
+    {
+        g_failures++;
+        std::printf("FAIL %s\n", what.c_str());
+    }
+}
+
+CachedRecord makeRecord(uint16_t type, const std::string& name, const std::string& rdata,
+    const std::string& target = std::string(), uint16_t port = 0)
+{
+    CachedRecord record;
+    record.name = name;
+    record.type = type;
+    record.rclass = mdns::kClassIN;
+    record.ttl = 120;
+    record.rdata = rdata;
+    record.target = target;
+    record.port = port;
+    record.interfaceIndex = 2;
+    return record;
+}
+
+/// 非压缩 wire 格式的 tv._lebo._tcp.local 和 h.local
+const std::string kInstanceWire("\x02tv\x05_lebo\x04_tcp\x05local\x00", 21);
+const std::string kHostWire("\x01h\x05local\x00", 9);
+
+std::vector<CachedRecord> validRecords()
+{
+    std::vector<CachedRecord> records;
+    records.push_back(makeRecord(mdns::kTypePTR, "_lebo._tcp.local", kInstanceWire, "tv._lebo._tcp.local"));
+    records.push_back(makeRecord(mdns::kTypeSRV, "tv._lebo._tcp.local",
+        std::string("\x00\x00\x00\x00\x1f\x90", 6) + kHostWire, "h.local", 8080));
+    records.push_back(makeRecord(mdns::kTypeTXT, "tv._lebo._tcp.local", std::string("\x03" "a=1", 4)));
+    records.push_back(makeRecord(mdns::kTypeA, "h.local", std::string("\xc0\xa8\x01\x17", 4)));
+    records.push_back(makeRecord(mdns::kTypeAAAA, "h.local",
+        std::string("\xfe\x80\x00\x00\x00\x00\x00\x00\x0a\x1b\x2c\xff\xfe\x3d\x4e\x5f", 16)));
+    return records;
+}
+
+void append16(std::string& out, uint16_t value)
+{
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>(value >> 8);
+}
+
+void append32(std::string& out, uint32_t value)
+{
+    append16(out, static_cast<uint16_t>(value));
+    append16(out, static_cast<uint16_t>(value >> 16));
+}
+
+/**
+ * @brief 按 cache_file.h 描述的格式编码记录，不做任何检查
+ * @details 定长部分: 到期时间(Unix 毫秒)、TTL、接口编号、类型、类、端口、
+ * 名称/记录数据/目标的长度，之后依次为名称、记录数据和目标
+ */
+void appendRaw(std::string& out, const CachedRecord& record)
+{
+    uint64_t expires = static_cast<uint64_t>(kNowUnixMs + 60000);
+    append32(out, static_cast<uint32_t>(expires));
+    append32(out, static_cast<uint32_t>(expires >> 32));
+    append32(out, record.ttl);
+    append32(out, record.interfaceIndex);
+    append16(out, record.type);
+    append16(out, record.rclass);
+    append16(out, record.port);
+    append16(out, static_cast<uint16_t>(record.name.size()));
+    append16(out, static_cast<uint16_t>(record.rdata.size()));
+    append16(out, static_cast<uint16_t>(record.target.size()));
+    out += record.name;
+    out += record.rdata;
+    out += record.target;
+}
+
+void writeRaw(const std::vector<CachedRecord>& records)
+{
+    std::string out("LBMC", 4);
+    append16(out, 1);
+    append16(out, 0);
+    append32(out, static_cast<uint32_t>(records.size()));
+    for (const auto& record : records)
+    {
+        appendRaw(out, record);
+    }
+    std::FILE* file = std::fopen(kPath, "wb");
+    std::fwrite(out.data(), 1, out.size(), file);
+    std::fclose(file);
+}
+
+bool readBack(std::vector<CachedRecord>& out, std::string& error)
+{
+    out.clear();
+    error.clear();
+    return mdns::readCacheFile(kPath, Clock::now(), kNowUnixMs, out, error);
+}
+
+bool sameRecord(const CachedRecord& a, const CachedRecord& b)
+{
+    return a.name == b.name && a.type == b.type && a.rclass == b.rclass && a.rdata == b.rdata &&
+        a.target == b.target && a.port == b.port && a.interfaceIndex == b.interfaceIndex;
+}
+
+void testRoundtrip()
+{
+    Clock::time_point now = Clock::now();
+    std::vector<CachedRecord> records = validRecords();
+    for (auto& record : records)
+    {
+        record.expires = now + std::chrono::seconds(record.ttl);
+    }
+    std::string error;
+    check(mdns::writeCacheFile(kPath, records, now, kNowUnixMs, error), "roundtrip/write " + error);
+
+    std::vector<CachedRecord> out;
+    check(readBack(out, error), "roundtrip/read " + error);
+    check(out.size() == records.size(), "roundtrip/count");
+    for (size_t i = 0; i < out.size() && i < records.size(); i++)
+    {
+        check(sameRecord(out[i], records[i]), "roundtrip/record " + std::to_string(i));
+        check(!out[i].verified && out[i].ttl > 0 && out[i].ttl <= records[i].ttl,
+            "roundtrip/ttl " + std::to_string(i));
+    }
+
+    // 手工编码的合法文件同样可以读回，下面的畸形样本只有一条记录不同
+    writeRaw(validRecords());
+    check(readBack(out, error) && out.size() == records.size(), "roundtrip/raw " + error);
+}
+
+void testMalformed()
+{
+    struct Sample {
+        const char* name;
+        CachedRecord record;
+    };
+    const std::string srvFixed("\x00\x00\x00\x00\x1f\x90", 6);
+    const Sample samples[] = {
+        { "a_truncated", makeRecord(mdns::kTypeA, "h.local", std::string("\xc0\xa8\x01", 3)) },
+        { "a_oversized", makeRecord(mdns::kTypeA, "h.local", std::string(17, '\x41')) },
+        { "a_empty", makeRecord(mdns::kTypeA, "h.local", std::string()) },
+        { "aaaa_truncated", makeRecord(mdns::kTypeAAAA, "h.local", std::string(15, '\x01')) },
+        { "aaaa_oversized", makeRecord(mdns::kTypeAAAA, "h.local", std::string(4096, '\x01')) },
+        { "ptr_no_target", makeRecord(mdns::kTypePTR, "_lebo._tcp.local", kInstanceWire) },
+        { "ptr_empty_rdata", makeRecord(mdns::kTypePTR, "_lebo._tcp.local", std::string(), "tv._lebo._tcp.local") },
+        { "ptr_label_past_rdata", makeRecord(mdns::kTypePTR, "_lebo._tcp.local",
+            std::string("\x05tv", 3), "tv._lebo._tcp.local") },
+        { "ptr_compressed", makeRecord(mdns::kTypePTR, "_lebo._tcp.local",
+            std::string("\x02tv\xc0\x00", 5), "tv._lebo._tcp.local") },
+        { "srv_no_target", makeRecord(mdns::kTypeSRV, "tv._lebo._tcp.local", srvFixed + kHostWire,
+            std::string(), 8080) },
+        { "srv_rdata_6", makeRecord(mdns::kTypeSRV, "tv._lebo._tcp.local", srvFixed, "h.local", 8080) },
+        { "srv_trailing_bytes", makeRecord(mdns::kTypeSRV, "tv._lebo._tcp.local",
+            srvFixed + kHostWire + "x", "h.local", 8080) },
+    };
+
+    for (const auto& sample : samples)
+    {
+        std::vector<CachedRecord> records = validRecords();
+        records.push_back(sample.record);
+        writeRaw(records);
+
+        std::vector<CachedRecord> out;
+        std::string error;
+        std::string what = std::string("malformed/") + sample.name;
+        check(!readBack(out, error), what + " rejected");
+        check(out.empty(), what + " no records");
+        check(!error.empty(), what + " error");
+    }
+}
+
+void testWriteSkipsInvalid()
+{
+    Clock::time_point now = Clock::now();
+    std::vector<CachedRecord> records = validRecords();
+    records.insert(records.begin() + 1,
+        makeRecord(mdns::kTypeA, "h.local", std::string("\xc0\xa8\x01\x17\x00", 5)));
+    records.push_back(makeRecord(mdns::kTypeSRV, "x._lebo._tcp.local", std::string("\x00\x00", 2), "h.local"));
+    for (auto& record : records)
+    {
+        record.expires = now + std::chrono::seconds(record.ttl);
+    }
+    std::string error;
+    check(mdns::writeCacheFile(kPath, records, now, kNowUnixMs, error), "write/invalid " + error);
+
+    std::vector<CachedRecord> out;
+    check(readBack(out, error), "write/read " + error);
+    check(out.size() == validRecords().size(), "write/skipped");
+}
+
+} // namespace
+
+int main()
+{
+    testRoundtrip();
+    testMalformed();
+    testWriteSkipsInvalid();
+    std::remove(kPath);
+
+    std::printf("%d checks, %d failures\n", g_checks, g_failures);
+    return g_failures ? 1 : 0;
+}
@@ -0,0 +1,357 @@
+/**
+ * @file mdns_packet_test.cpp
+ * @brief mdns_packet 解析器的回归测试
+ * @details 覆盖 PacketReader、NameView::parse、readPtr/readSrv 和 TxtReader::next:
+ *  - corpus/...: packet_corpus.h 中的样本，逐个检查返回的 ParseError
+ *  - limits/...: 指针跳转次数、标签数量和名称长度的边界，两侧各一个样本
+ *  - valid/...: 合法报文解析出的名称、端口和 TXT 键值
+ *  - mutate/...: 对每个样本做截断和单字节替换，检查解析器不越界、错误码有效、
+ *    成功解析的名称满足长度限制；与 AddressSanitizer 一起构建时可以发现越界读取
+ *
+ * 用法: mdns_packet_test，有失败时返回 1
+ */
+
+#include "packet_corpus.h"
+#include "mdns_packet.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace {
+
+using mdns::NameView;
+using mdns::PacketReader;
+using mdns::ParseError;
+using mdns::StrRef;
+
+int g_checks = 0;
+int g_failures = 0;
+
+void check(bool ok, const std::string& what)
+{
+    g_checks++;
+    if (!ok)
+    {
+        g_failures++;
+        std::printf("FAIL %s\n", what.c_str());
+    }
+}
+
+void checkError(ParseError actual, ParseError expected, const std::string& what)
+{
+    g_checks++;
+    if (actual != expected)
+    {
+        g_failures++;
+        std::printf("FAIL %s: expected \"%s\", got \"%s\"\n", what.c_str(),
+            mdns::parseErrorString(expected), mdns::parseErrorString(actual));
+    }
+}
+
+/// 读取整个报文的结果
+struct WalkResult {
+    ParseError error = ParseError::None;
+    bool txtMalformed = false;
+    size_t txtEntries = 0;
+    size_t names = 0;  ///< 成功解析的名称数
+};
+
+/// 校验成功解析的名称: 文本长度与标签迭代结果一致且不超过限制
+bool nameConsistent(const NameView& name)
+{
+    if (name.textLength() >= mdns::kMaxNameLength || name.labelCount() > mdns::kMaxLabels)
+    {
+        return false;
+    }
+    NameView::LabelIterator it(name);
+    StrRef label;
+    size_t labels = 0;
+    size_t length = 0;
+    while (it.next(label))
+    {
+        labels++;
+        length += label.size() + 1;
+    }
+    return labels == name.labelCount() && (labels ? length - 1 : 0) == name.textLength()
+        && name.toString().size() == name.textLength();
+}
+
+/**
+ * @brief 按接收路径的顺序读取报文
+ * @details 读取头部、全部问题和记录，PTR/SRV 记录解析目标名称，TXT 记录读到结束，
+ * 遇到第一个错误即停止
+ */
+WalkResult walkPacket(const uint8_t* data, size_t size, bool& consistent)
+{
+    WalkResult result;
+    consistent = true;
+    PacketReader reader(data, size);
+    mdns::Header header;
+    if (!reader.readHeader(header))
+    {
+        result.error = reader.error();
+        return result;
+    }
+
+    for (uint16_t i = 0; i < header.qdcount; i++)
+    {
+        mdns::Question question;
+        if (!reader.readQuestion(question))
+        {
+            result.error = reader.error();
+            return result;
+        }
+        consistent = consistent && nameConsistent(question.name);
+        result.names++;
+    }
+
+    size_t records = static_cast<size_t>(header.ancount) + header.nscount + header.arcount;
+    for (size_t i = 0; i < records; i++)
+    {
+        mdns::Record record;
+        if (!reader.readRecord(record))
+        {
+            result.error = reader.error();
+            return result;
+        }
+        consistent = consistent && nameConsistent(record.name);
+        result.names++;
+
+        switch (record.recordClass() == mdns::kClassIN ? record.type : 0)
+        {
+        case mdns::kTypePTR:
+        {
+            NameView target;
+            if (!reader.readPtr(record, target))
+            {
+                result.error = reader.error();
+                return result;
+            }
+            consistent = consistent && nameConsistent(target);
+            result.names++;
+            break;
+        }
+        case mdns::kTypeSRV:
+        {
+            mdns::SrvData srv;
+            if (!reader.readSrv(record, srv))
+            {
+                result.error = reader.error();
+                return result;
+            }
+            consistent = consistent && nameConsistent(srv.target);
+            result.names++;
+            break;
+        }
+        case mdns::kTypeTXT:
+        {
+            mdns::TxtReader txt(record.rdata, record.rdlength);
+            StrRef key, value;
+            bool hasValue = false;
+            const char* begin = reinterpret_cast<const char*>(record.rdata);
+            const char* end = begin + record.rdlength;
+            while (txt.next(key, value, hasValue))
+            {
+                result.txtEntries++;
+                const StrRef& last = hasValue ? value : key;
+                consistent = consistent && key.data() >= begin && last.data() + last.size() <= end;
+            }
+            result.txtMalformed = result.txtMalformed || txt.malformed();
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    return result;
+}
+
+ParseError parseName(const std::vector<uint8_t>& data, size_t offset, NameView& name)
+{
+    return NameView::parse(data.data(), data.size(), offset, name);
+}
+
+void testCorpus()
+{
+    for (const corpus::NameSample& sample : corpus::kNameSamples)
+    {
+        // 复制到大小恰好的缓冲区，越界读取可以被 AddressSanitizer 发现
+        std::vector<uint8_t> data(sample.data, sample.data + sample.size);
+        NameView name;
+        std::string what = std::string("corpus/name/") + sample.name;
+        checkError(parseName(data, sample.offset, name), sample.expected, what);
+        check(name.valid() == (sample.expected == ParseError::None), what + " valid()");
+    }
+
+    for (const corpus::PacketSample& sample : corpus::kPacketSamples)
+    {
+        std::vector<uint8_t> data(sample.data, sample.data + sample.size);
+        bool consistent = false;
+        WalkResult result = walkPacket(data.data(), data.size(), consistent);
+        std::string what = std::string("corpus/packet/") + sample.name;
+        checkError(result.error, sample.expected, what);
+        check(result.txtMalformed == sample.txtMalformed, what + " txt malformed");
+        check(result.txtEntries == sample.txtEntries, what + " txt entries");
+        check(consistent, what + " names");
+    }
+}
+
+/// 偏移 0 为根名称，之后 count 个压缩指针各自指向前一个，返回最后一个指针的偏移
+size_t buildPointerChain(std::vector<uint8_t>& data, size_t count)
+{
+    data.assign(1, 0x00);
+    size_t previous = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t offset = data.size();
+        data.push_back(static_cast<uint8_t>(0xC0 | (previous >> 8)));
+        data.push_back(static_cast<uint8_t>(previous & 0xFF));
+        previous = offset;
+    }
+    return previous;
+}
+
+/// 按给定的标签长度生成非压缩名称
+std::vector<uint8_t> buildName(const std::vector<size_t>& lengths)
+{
+    std::vector<uint8_t> data;
+    for (size_t length : lengths)
+    {
+        data.push_back(static_cast<uint8_t>(length));
+        data.insert(data.end(), length, 'x');
+    }
+    data.push_back(0x00);
+    return data;
+}
+
+void testLimits()
+{
+    std::vector<uint8_t> data;
+    NameView name;
+
+    size_t offset = buildPointerChain(data, mdns::kMaxPointerJumps);
+    checkError(parseName(data, offset, name), ParseError::None, "limits/pointer_jumps_at_limit");
+    offset = buildPointerChain(data, mdns::kMaxPointerJumps + 1);
+    checkError(parseName(data, offset, name), ParseError::PointerLimit, "limits/pointer_jumps_over_limit");
+
+    // 63+1 字节的标签 4 个正好 256 字节，去掉最后一个字节为 255
+    data = buildName({ 63, 63, 63, 62 });
+    checkError(parseName(data, 0, name), ParseError::None, "limits/name_length_255");
+    check(name.textLength() == mdns::kMaxNameLength - 1, "limits/name_length_255 textLength()");
+    data = buildName({ 63, 63, 63, 63 });
+    checkError(parseName(data, 0, name), ParseError::NameTooLong, "limits/name_length_256");
+
+    // 标签长度字段超过 63 时按 0x40/0x80 类型处理
+    data = buildName({ 64 });
+    checkError(parseName(data, 0, name), ParseError::BadLabelType, "limits/label_length_64");
+
+    // 每个标签至少占 2 字节，所以 127 个单字节标签(254 字节)是长度限制内的最大标签数，
+    // 再多一个标签时长度限制先于 kMaxLabels 生效
+    data = buildName(std::vector<size_t>(127, 1));
+    checkError(parseName(data, 0, name), ParseError::None, "limits/labels_127");
+    check(name.labelCount() == 127, "limits/labels_127 labelCount()");
+    data = buildName(std::vector<size_t>(mdns::kMaxLabels, 1));
+    checkError(parseName(data, 0, name), ParseError::NameTooLong, "limits/labels_128");
+
+    // 经过压缩指针拼接的名称同样受长度限制
+    data = buildName({ 63, 63, 63 });
+    size_t tail = data.size();
+    data.push_back(63);
+    data.insert(data.end(), 63, 'y');
+    data.push_back(0xC0);
+    data.push_back(0x00);
+    checkError(parseName(data, tail, name), ParseError::NameTooLong, "limits/name_length_via_pointer");
+}
+
+void testValid()
+{
+    std::vector<uint8_t> data(corpus::k_packet_valid,
+        corpus::k_packet_valid + sizeof(corpus::k_packet_valid));
+    PacketReader reader(data.data(), data.size());
+    mdns::Header header;
+    check(reader.readHeader(header) && header.isResponse() && header.ancount == 3, "valid/header");
+
+    mdns::Record ptr;
+    NameView instance;
+    check(reader.readRecord(ptr) && ptr.type == mdns::kTypePTR, "valid/ptr record");
+    check(ptr.name.equals(StrRef("_LEBO._tcp.local")), "valid/ptr owner");
+    check(reader.readPtr(ptr, instance), "valid/readPtr");
+    check(instance.toString() == "tv._lebo._tcp.local", "valid/ptr target");
+    check(instance.firstLabel() == StrRef("tv"), "valid/ptr firstLabel()");
+
+    mdns::Record srvRecord;
+    mdns::SrvData srv;
+    check(reader.readRecord(srvRecord) && srvRecord.cacheFlush(), "valid/srv record");
+    check(srvRecord.name.equals(instance), "valid/srv owner");
+    check(reader.readSrv(srvRecord, srv) && srv.port == 8080, "valid/readSrv");
+    check(srv.target.equals(instance), "valid/srv target");
+
+    mdns::Record txtRecord;
+    check(reader.readRecord(txtRecord) && txtRecord.type == mdns::kTypeTXT, "valid/txt record");
+    mdns::TxtReader txt(txtRecord.rdata, txtRecord.rdlength);
+    StrRef key, value;
+    bool hasValue = false;
+    check(txt.next(key, value, hasValue) && key == StrRef("a") && hasValue && value == StrRef("1"),
+        "valid/txt a=1");
+    check(txt.next(key, value, hasValue) && key == StrRef("flag") && !hasValue && value.empty(),
+        "valid/txt flag");
+    check(!txt.next(key, value, hasValue) && !txt.malformed(), "valid/txt end");
+
+    check(reader.error() == ParseError::None && reader.offset() == data.size(), "valid/offset");
+}
+
+/// 解析结果必须是有效的错误码，成功解析的名称必须满足限制
+void checkMutation(const std::vector<uint8_t>& data, const std::string& what)
+{
+    bool consistent = false;
+    WalkResult result = walkPacket(data.data(), data.size(), consistent);
+    if (static_cast<size_t>(result.error) > static_cast<size_t>(ParseError::BadRdata) || !consistent)
+    {
+        check(false, what);
+    }
+}
+
+void testMutations()
+{
+    static const uint8_t kValues[] = { 0x00, 0x01, 0x3F, 0x40, 0x80, 0xC0, 0xC1, 0xFF };
+    size_t mutations = 0;
+    int failures = g_failures;
+
+    for (const corpus::PacketSample& sample : corpus::kPacketSamples)
+    {
+        std::string base = std::string("mutate/") + sample.name;
+        for (size_t length = 0; length <= sample.size; length++)
+        {
+            std::vector<uint8_t> data(sample.data, sample.data + length);
+            checkMutation(data, base + " truncated to " + std::to_string(length));
+            mutations++;
+        }
+        for (size_t pos = 0; pos < sample.size; pos++)
+        {
+            for (uint8_t value : kValues)
+            {
+                std::vector<uint8_t> data(sample.data, sample.data + sample.size);
+                data[pos] = value;
+                checkMutation(data, base + " byte " + std::to_string(pos) + "=" + std::to_string(value));
+                mutations++;
+            }
+        }
+    }
+
+    // 只统计一次，避免上万次成功的变异淹没检查数
+    check(g_failures == failures, "mutate/all (" + std::to_string(mutations) + " inputs)");
+}
+
+} // namespace
+
+int main()
+{
+    testCorpus();
+    testLimits();
+    testValid();
+    testMutations();
+
+    std::printf("%d checks, %d failures\n", g_checks, g_failures);
+    return g_failures ? 1 : 0;
+}
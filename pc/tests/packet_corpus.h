@@ -0,0 +1,215 @@
+/**
+ * @file packet_corpus.h
+ * @brief 解析器回归测试使用的畸形报文样本
+ * @details 每个样本对应一种应被拒绝的输入，并记录期望的 ParseError:
+ *  - kNameSamples: 直接交给 NameView::parse 的名称片段
+ *  - kPacketSamples: 完整报文，按头部、问题、记录的顺序读取，
+ *    PTR/SRV 记录再调用 readPtr/readSrv，TXT 记录用 TxtReader 读完
+ *
+ * 指针链、255 字节名称这类边界样本由测试程序按参数生成，不在此列出。
+ * 新增样本时同时加入对应的表。
+ */
+
+#pragma once
+
+#include "mdns_packet.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace corpus {
+
+using mdns::ParseError;
+
+/// 名称样本
+struct NameSample {
+    const char* name;
+    const uint8_t* data;
+    size_t size;
+    size_t offset;         ///< 名称起始偏移
+    ParseError expected;
+};
+
+/// 报文样本
+struct PacketSample {
+    const char* name;
+    const uint8_t* data;
+    size_t size;
+    ParseError expected;   ///< PacketReader::error() 的期望值
+    bool txtMalformed;     ///< TxtReader::malformed() 的期望值
+    size_t txtEntries;     ///< 越界前读到的 TXT 条目数
+};
+
+// ---------------------------------------------------------------------------
+// 名称
+// ---------------------------------------------------------------------------
+
+/// 指向自身的压缩指针
+const uint8_t k_name_self_pointer[] = { 0xc0, 0x00 };
+
+/// 指向后面位置的压缩指针
+const uint8_t k_name_forward_pointer[] = { 0xc0, 0x02, 0x00 };
+
+/// 标签之后的指针指回同一名称的开头，形成环
+const uint8_t k_name_pointer_loop[] = { 0x01, 0x61, 0xc0, 0x00 };
+
+/// 合法的向前指针: 偏移 1 处的 "a" 之后指向偏移 0 的根名称
+const uint8_t k_name_backward_pointer[] = { 0x00, 0x01, 0x61, 0xc0, 0x00 };
+
+/// 0x40 扩展标签类型(RFC 6891)
+const uint8_t k_name_label_0x40[] = { 0x40, 0x00 };
+
+/// 0x80 保留标签类型
+const uint8_t k_name_label_0x80[] = { 0x80, 0x00 };
+
+/// 标签长度超出数据末尾
+const uint8_t k_name_label_past_end[] = { 0x05, 0x61, 0x62 };
+
+/// 压缩指针只有一个字节
+const uint8_t k_name_pointer_truncated[] = { 0x01, 0x61, 0xc0 };
+
+/// 缺少结尾的 0 字节
+const uint8_t k_name_missing_root[] = { 0x01, 0x61 };
+
+const NameSample kNameSamples[] = {
+    { "self_pointer", k_name_self_pointer, sizeof(k_name_self_pointer), 0, ParseError::BadPointer },
+    { "forward_pointer", k_name_forward_pointer, sizeof(k_name_forward_pointer), 0, ParseError::BadPointer },
+    { "pointer_loop", k_name_pointer_loop, sizeof(k_name_pointer_loop), 0, ParseError::BadPointer },
+    { "backward_pointer", k_name_backward_pointer, sizeof(k_name_backward_pointer), 1, ParseError::None },
+    { "label_0x40", k_name_label_0x40, sizeof(k_name_label_0x40), 0, ParseError::BadLabelType },
+    { "label_0x80", k_name_label_0x80, sizeof(k_name_label_0x80), 0, ParseError::BadLabelType },
+    { "label_past_end", k_name_label_past_end, sizeof(k_name_label_past_end), 0, ParseError::Truncated },
+    { "pointer_truncated", k_name_pointer_truncated, sizeof(k_name_pointer_truncated), 0, ParseError::Truncated },
+    { "missing_root", k_name_missing_root, sizeof(k_name_missing_root), 0, ParseError::Truncated },
+};
+
+// ---------------------------------------------------------------------------
+// 报文
+// ---------------------------------------------------------------------------
+
+/// 合法的 PTR/SRV/TXT 通告: tv._lebo._tcp.local 端口 8080，TXT 为 a=1 和 flag (86 字节)
+const uint8_t k_packet_valid[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00,
+    // _lebo._tcp.local PTR tv._lebo._tcp.local
+    0x05, 0x5f, 0x6c, 0x65, 0x62, 0x6f, 0x04, 0x5f, 0x74, 0x63, 0x70, 0x05, 0x6c, 0x6f, 0x63, 0x61,
+    0x6c, 0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x05, 0x02, 0x74, 0x76, 0xc0,
+    0x0c,
+    // tv._lebo._tcp.local SRV 0 0 8080 tv._lebo._tcp.local
+    0xc0, 0x28, 0x00, 0x21, 0x80, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00,
+    0x1f, 0x90, 0xc0, 0x28,
+    // tv._lebo._tcp.local TXT "a=1" "flag"
+    0xc0, 0x28, 0x00, 0x10, 0x80, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x09, 0x03, 0x61, 0x3d, 0x31,
+    0x04, 0x66, 0x6c, 0x61, 0x67,
+};
+
+/// 头部不足 12 字节
+const uint8_t k_packet_short_header[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+};
+
+/// 问题的名称是指向自身的压缩指针
+const uint8_t k_packet_question_self_pointer[] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xc0, 0x0c, 0x00, 0x0c, 0x00, 0x01,
+};
+
+/// 记录的固定字段不足 10 字节
+const uint8_t k_packet_record_header_short[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x00, 0x01, 0x00,
+};
+
+/// A 记录的 rdlength 为 4，报文中只剩 2 字节
+const uint8_t k_packet_rdlength_past_end[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x04, 0xc0, 0xa8,
+};
+
+/// SRV 的 rdlength 为 6，放不下优先级、权重、端口和至少 1 字节的目标名称
+const uint8_t k_packet_srv_rdlength_short[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x21, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00, 0x1f,
+    0x90,
+};
+
+/// SRV 目标名称越过 rdlength，剩余部分落在报文的后续字节中
+const uint8_t k_packet_srv_target_past_rdata[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x21, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x1f,
+    0x90, 0x02, 0x74, 0x76, 0x00,
+};
+
+/// SRV 目标名称使用 0x80 标签类型
+const uint8_t k_packet_srv_target_label_0x80[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x21, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x08, 0x00, 0x00, 0x00, 0x00, 0x1f,
+    0x90, 0x80, 0x00,
+};
+
+/// PTR 目标是指向自身(rdata 起始偏移 23)的压缩指针
+const uint8_t k_packet_ptr_self_pointer[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x02, 0xc0, 0x17,
+};
+
+/// PTR 目标指向报文后面的位置
+const uint8_t k_packet_ptr_forward_pointer[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x02, 0xc0, 0x19, 0x00,
+};
+
+/// PTR 的 rdlength 为 1，目标名称的其余部分越过记录数据
+const uint8_t k_packet_ptr_target_past_rdata[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x01, 0x02, 0x74, 0x76, 0x00,
+};
+
+/// PTR 目标使用 0x40 标签类型
+const uint8_t k_packet_ptr_label_0x40[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x0c, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x00, 0x02, 0x40, 0x00,
+};
+
+/// TXT 的第一条字符串长度为 5，记录数据只剩 2 字节
+const uint8_t k_packet_txt_first_past_rdata[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x03, 0x05, 0x61, 0x3d,
+};
+
+/// TXT 的 "a=1" 之后的字符串长度为 9，超出记录数据，但报文后面还有字节
+const uint8_t k_packet_txt_second_past_rdata[] = {
+    0x00, 0x00, 0x84, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x10, 0x00, 0x01, 0x00, 0x00, 0x11, 0x94, 0x00, 0x05, 0x03, 0x61, 0x3d, 0x31, 0x09,
+    0x62, 0x3d, 0x32,
+};
+
+const PacketSample kPacketSamples[] = {
+    { "valid", k_packet_valid, sizeof(k_packet_valid), ParseError::None, false, 2 },
+    { "short_header", k_packet_short_header, sizeof(k_packet_short_header),
+      ParseError::Truncated, false, 0 },
+    { "question_self_pointer", k_packet_question_self_pointer, sizeof(k_packet_question_self_pointer),
+      ParseError::BadPointer, false, 0 },
+    { "record_header_short", k_packet_record_header_short, sizeof(k_packet_record_header_short),
+      ParseError::Truncated, false, 0 },
+    { "rdlength_past_end", k_packet_rdlength_past_end, sizeof(k_packet_rdlength_past_end),
+      ParseError::Truncated, false, 0 },
+    { "srv_rdlength_short", k_packet_srv_rdlength_short, sizeof(k_packet_srv_rdlength_short),
+      ParseError::BadRdata, false, 0 },
+    { "srv_target_past_rdata", k_packet_srv_target_past_rdata, sizeof(k_packet_srv_target_past_rdata),
+      ParseError::BadRdata, false, 0 },
+    { "srv_target_label_0x80", k_packet_srv_target_label_0x80, sizeof(k_packet_srv_target_label_0x80),
+      ParseError::BadLabelType, false, 0 },
+    { "ptr_self_pointer", k_packet_ptr_self_pointer, sizeof(k_packet_ptr_self_pointer),
+      ParseError::BadPointer, false, 0 },
+    { "ptr_forward_pointer", k_packet_ptr_forward_pointer, sizeof(k_packet_ptr_forward_pointer),
+      ParseError::BadPointer, false, 0 },
+    { "ptr_target_past_rdata", k_packet_ptr_target_past_rdata, sizeof(k_packet_ptr_target_past_rdata),
+      ParseError::BadRdata, false, 0 },
+    { "ptr_label_0x40", k_packet_ptr_label_0x40, sizeof(k_packet_ptr_label_0x40),
+      ParseError::BadLabelType, false, 0 },
+    { "txt_first_past_rdata", k_packet_txt_first_past_rdata, sizeof(k_packet_txt_first_past_rdata),
+      ParseError::None, true, 0 },
+    { "txt_second_past_rdata", k_packet_txt_second_past_rdata, sizeof(k_packet_txt_second_past_rdata),
+      ParseError::None, true, 1 },
+};
+
+} // namespace corpus